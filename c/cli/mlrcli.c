@@ -14,6 +14,7 @@
 #include "dsl/mlr_dsl_cst.h"
 #include "mapping/mappers.h"
 #include "output/lrec_writers.h"
+#include "output/output_stream_pool.h"
 #include "cli/mlrcli.h"
 #include "cli/quoting.h"
 #include "cli/argparse.h"
@@ -34,6 +35,7 @@
 #define DEFAULT_OOSVAR_FLATTEN_SEPARATOR ":"
 #define DEFAULT_COMMENT_STRING           "#"
 #define DEFAULT_MAX_FILE_SIZE_FOR_MMAP (4LL*1024LL*1024LL*1024LL)
+#define DEFAULT_MMAP_WINDOW_SIZE (256LL*1024LL*1024LL)
 
 // ----------------------------------------------------------------
 static mapper_setup_t* mapper_lookup_table[] = {
@@ -73,6 +75,7 @@ static mapper_setup_t* mapper_lookup_table[] = {
 	&mapper_seqgen_setup,
 	&mapper_shuffle_setup,
 	&mapper_sort_setup,
+	&mapper_split_setup,
 	&mapper_stats1_setup,
 	&mapper_stats2_setup,
 	&mapper_step_setup,
@@ -125,6 +128,7 @@ static void check_arg_count(char** argv, int argi, int argc, int n);
 static mapper_setup_t* look_up_mapper_setup(char* verb);
 
 static int handle_terminal_usage(char** argv, int argc, int argi);
+static int try_two_pass(cli_opts_t* popts, sllv_t* pmapper_list);
 
 static char* lhmss_get_or_die(lhmss_t* pmap, char* key);
 static int lhmsll_get_or_die(lhmsll_t* pmap, char* key);
@@ -136,8 +140,6 @@ cli_opts_t* parse_command_line(int argc, char** argv, sllv_t** ppmapper_list) {
 	cli_opts_init(popts);
 
 	int no_input       = FALSE;
-	int have_rand_seed = FALSE;
-	unsigned rand_seed = 0;
 
 	int argi = 1;
 	for (; argi < argc; /* variable increment: 1 or 2 depending on flag */) {
@@ -157,10 +159,29 @@ cli_opts_t* parse_command_line(int argc, char** argv, sllv_t** ppmapper_list) {
 			popts->do_in_place = TRUE;
 			argi += 1;
 
+		} else if (streq(argv[argi], "--jobs")) {
+			check_arg_count(argv, argi, argc, 2);
+			if (sscanf(argv[argi+1], "%d", &popts->in_place_jobs) != 1 || popts->in_place_jobs <= 0) {
+				fprintf(stderr,
+					"%s: --jobs argument must be a positive integer; got \"%s\".\n",
+					MLR_GLOBALS.bargv0, argv[argi+1]);
+				main_usage_short(stderr, MLR_GLOBALS.bargv0);
+				exit(1);
+			}
+			argi += 2;
+
 		} else if (streq(argv[argi], "-n")) {
 			no_input = TRUE;
 			argi += 1;
 
+		} else if (streq(argv[argi], "--two-pass")) {
+			popts->do_two_pass = TRUE;
+			argi += 1;
+
+		} else if (streq(argv[argi], "--profile")) {
+			popts->do_profile = TRUE;
+			argi += 1;
+
 		} else if (streq(argv[argi], "--from")) {
 			check_arg_count(argv, argi, argc, 2);
 			slls_append(popts->filenames, argv[argi+1], NO_FREE);
@@ -189,12 +210,51 @@ cli_opts_t* parse_command_line(int argc, char** argv, sllv_t** ppmapper_list) {
 			}
 			argi += 2;
 
+		} else if (streq(argv[argi], "--max-open-files")) {
+			check_arg_count(argv, argi, argc, 2);
+			int max_open = 0;
+			if (sscanf(argv[argi+1], "%d", &max_open) != 1 || max_open <= 0) {
+				fprintf(stderr,
+					"%s: --max-open-files argument must be a positive integer; got \"%s\".\n",
+					MLR_GLOBALS.bargv0, argv[argi+1]);
+				main_usage_short(stderr, MLR_GLOBALS.bargv0);
+				exit(1);
+			}
+			output_stream_pool_set_max_open(max_open);
+			argi += 2;
+
+		} else if (streq(argv[argi], "--flush-every")) {
+			check_arg_count(argv, argi, argc, 2);
+			long long flush_every = 0LL;
+			if (sscanf(argv[argi+1], "%lld", &flush_every) != 1 || flush_every <= 0LL) {
+				fprintf(stderr,
+					"%s: --flush-every argument must be a positive integer; got \"%s\".\n",
+					MLR_GLOBALS.bargv0, argv[argi+1]);
+				main_usage_short(stderr, MLR_GLOBALS.bargv0);
+				exit(1);
+			}
+			output_stream_pool_set_flush_every(flush_every);
+			argi += 2;
+
+		} else if (streq(argv[argi], "--output-buffer-size")) {
+			check_arg_count(argv, argi, argc, 2);
+			long long buffer_size = 0LL;
+			if (sscanf(argv[argi+1], "%lld", &buffer_size) != 1 || buffer_size < 0LL) {
+				fprintf(stderr,
+					"%s: --output-buffer-size argument must be a non-negative integer; got \"%s\".\n",
+					MLR_GLOBALS.bargv0, argv[argi+1]);
+				main_usage_short(stderr, MLR_GLOBALS.bargv0);
+				exit(1);
+			}
+			output_stream_pool_set_buffer_size((size_t)buffer_size);
+			argi += 2;
+
 		} else if (streq(argv[argi], "--seed")) {
 			check_arg_count(argv, argi, argc, 2);
-			if (sscanf(argv[argi+1], "0x%x", &rand_seed) == 1) {
-				have_rand_seed = TRUE;
-			} else if (sscanf(argv[argi+1], "%u", &rand_seed) == 1) {
-				have_rand_seed = TRUE;
+			if (sscanf(argv[argi+1], "0x%x", &popts->rand_seed) == 1) {
+				popts->have_rand_seed = TRUE;
+			} else if (sscanf(argv[argi+1], "%u", &popts->rand_seed) == 1) {
+				popts->have_rand_seed = TRUE;
 			} else {
 				fprintf(stderr,
 					"%s: --seed argument must be a decimal or hexadecimal integer; got \"%s\".\n",
@@ -263,23 +323,31 @@ cli_opts_t* parse_command_line(int argc, char** argv, sllv_t** ppmapper_list) {
 	} else if (popts->filenames->length == 0) {
 		// No filenames means read from standard input, and standard input cannot be mmapped.
 		popts->reader_opts.use_mmap_for_read = FALSE;
-	} else if (popts->reader_opts.use_mmap_for_read == TRUE) {
-		// https://github.com/johnkerl/miller/issues/160: don't use mmap for large files.
+	} else if (popts->reader_opts.use_mmap_for_read == TRUE && popts->reader_opts.use_mmap_read_only != TRUE) {
+		// https://github.com/johnkerl/miller/issues/160: don't use mmap for large files, except
+		// read-only mmap. That doesn't use private memory, and maps a window at a time.
 		//
 		// If any input files don't exist, don't error out just yet ... it's possible that the user
 		// is doing some complex put-with-tee or somesuch which will create the input file by the
 		// time it's needed. In that case we of course can't know the size yet, so avoid mmap there
 		// to be safe.
+		int all_exist = TRUE;
 		int all_exist_and_are_small_enough = TRUE;
 		for (sllse_t* pe = popts->filenames->phead; pe != NULL; pe = pe->pnext) {
 			ssize_t file_size = get_file_size(pe->value);
-			if (file_size == (ssize_t)(-1) || file_size >= popts->reader_opts.max_file_size_for_mmap) {
+			if (file_size == (ssize_t)(-1)) {
+				all_exist = FALSE;
 				all_exist_and_are_small_enough = FALSE;
 				break;
+			} else if (file_size >= popts->reader_opts.max_file_size_for_mmap) {
+				all_exist_and_are_small_enough = FALSE;
 			}
 		}
 		if (!all_exist_and_are_small_enough) {
-			popts->reader_opts.use_mmap_for_read = FALSE;
+			if (all_exist)
+				popts->reader_opts.use_mmap_read_only = TRUE;
+			else
+				popts->reader_opts.use_mmap_for_read = FALSE;
 		}
 	}
 
@@ -288,8 +356,11 @@ cli_opts_t* parse_command_line(int argc, char** argv, sllv_t** ppmapper_list) {
 		exit(1);
 	}
 
-	if (have_rand_seed) {
-		mtrand_init(rand_seed);
+	if (popts->do_two_pass)
+		popts->do_two_pass = try_two_pass(popts, *ppmapper_list);
+
+	if (popts->have_rand_seed) {
+		mtrand_init(popts->rand_seed);
 	} else {
 		mtrand_init_default();
 	}
@@ -304,6 +375,10 @@ sllv_t* cli_parse_mappers(char** argv, int* pargi, int argc, cli_opts_t* popts,
 	sllv_t* pmapper_list = sllv_alloc();
 	int argi = *pargi;
 
+	// For in-place mode this is called once per file; the verbs are the same each time.
+	slls_free(popts->mapper_verbs);
+	popts->mapper_verbs = slls_alloc();
+
 	// Allow then-chains to start with an initial 'then': 'mlr verb1 then verb2 then verb3' or
 	// 'mlr then verb1 then verb2 then verb3'. Particuarly useful in backslashy scripting contexts.
 	if ((argc - argi) >= 1 && streq(argv[argi], "then")) {
@@ -336,18 +411,42 @@ sllv_t* cli_parse_mappers(char** argv, int* pargi, int argc, cli_opts_t* popts,
 		// It's up to the parse func to print its usage on CLI-parse failure.
 		// Also note: this assumes main reader/writer opts are all parsed
 		// *before* mapper parse-CLI methods are invoked.
+		char* prior_line_filter_regex = popts->reader_opts.line_filter_regex;
 		mapper_t* pmapper = pmapper_setup->pparse_func(&argi, argc, argv,
 			&popts->reader_opts, &popts->writer_opts);
 		if (pmapper == NULL) {
 			exit(1);
 		}
 
+		// Input-line filtering is done by the record reader, before any verb
+		// sees the records, so it's only meaningful at the start of the chain.
+		if (popts->reader_opts.line_filter_regex != prior_line_filter_regex && pmapper_list->length > 0) {
+			fprintf(stderr, "%s %s: input-line filtering is only supported for the first verb in the chain.\n",
+				MLR_GLOBALS.bargv0, verb);
+			exit(1);
+		}
+
 		if (pmapper_setup->ignores_input && pmapper_list->length == 0) {
 			// e.g. then-chain starts with seqgen
 			*pno_input = TRUE;
 		}
 
-		sllv_append(pmapper_list, pmapper);
+		// Chain planning: e.g. sort-then-head keeps only the records head will pass.
+		mapper_t* pfused_mapper = (pmapper_list->length > 0)
+			? mapper_sort_fuse_head(pmapper_list->ptail->pvvalue, pmapper)
+			: NULL;
+		if (pfused_mapper != NULL) {
+			pmapper_list->ptail->pvvalue = pfused_mapper;
+			sllse_t* ptail = popts->mapper_verbs->ptail;
+			char* fused_verb = mlr_paste_3_strings(ptail->value, " then ", verb);
+			if (ptail->free_flag & FREE_ENTRY_VALUE)
+				free(ptail->value);
+			ptail->value = fused_verb;
+			ptail->free_flag = FREE_ENTRY_VALUE;
+		} else {
+			sllv_append(pmapper_list, pmapper);
+			slls_append(popts->mapper_verbs, verb, NO_FREE);
+		}
 
 		if (argi >= argc || !streq(argv[argi], "then"))
 			break;
@@ -364,6 +463,7 @@ void cli_opts_free(cli_opts_t* popts) {
 		return;
 
 	slls_free(popts->filenames);
+	slls_free(popts->mapper_verbs);
 	free(popts);
 	free_opt_singletons();
 }
@@ -421,6 +521,7 @@ static lhmss_t* get_default_rses() {
 		lhmss_put(singleton_default_rses, "markdown", "auto",  NO_FREE);
 		lhmss_put(singleton_default_rses, "pprint",   "auto",  NO_FREE);
 		lhmss_put(singleton_default_rses, "xtab",     "(N/A)", NO_FREE);
+		lhmss_put(singleton_default_rses, "bin",      "(N/A)", NO_FREE);
 	}
 	return singleton_default_rses;
 }
@@ -437,6 +538,7 @@ static lhmss_t* get_default_fses() {
 		lhmss_put(singleton_default_fses, "markdown", "(N/A)",  NO_FREE);
 		lhmss_put(singleton_default_fses, "pprint",   " ",      NO_FREE);
 		lhmss_put(singleton_default_fses, "xtab",     "auto",   NO_FREE);
+		lhmss_put(singleton_default_fses, "bin",      "(N/A)",  NO_FREE);
 	}
 	return singleton_default_fses;
 }
@@ -453,6 +555,7 @@ static lhmss_t* get_default_pses() {
 		lhmss_put(singleton_default_pses, "markdown", "(N/A)", NO_FREE);
 		lhmss_put(singleton_default_pses, "pprint",   "(N/A)", NO_FREE);
 		lhmss_put(singleton_default_pses, "xtab",     " ",     NO_FREE);
+		lhmss_put(singleton_default_pses, "bin",      "(N/A)", NO_FREE);
 	}
 	return singleton_default_pses;
 }
@@ -469,6 +572,7 @@ static lhmsll_t* get_default_repeat_ifses() {
 		lhmsll_put(singleton_default_repeat_ifses, "nidx",     FALSE, NO_FREE);
 		lhmsll_put(singleton_default_repeat_ifses, "xtab",     FALSE, NO_FREE);
 		lhmsll_put(singleton_default_repeat_ifses, "pprint",   TRUE,  NO_FREE);
+		lhmsll_put(singleton_default_repeat_ifses, "bin",      FALSE, NO_FREE);
 	}
 	return singleton_default_repeat_ifses;
 }
@@ -485,6 +589,7 @@ static lhmsll_t* get_default_repeat_ipses() {
 		lhmsll_put(singleton_default_repeat_ipses, "nidx",     FALSE, NO_FREE);
 		lhmsll_put(singleton_default_repeat_ipses, "xtab",     TRUE,  NO_FREE);
 		lhmsll_put(singleton_default_repeat_ipses, "pprint",   FALSE, NO_FREE);
+		lhmsll_put(singleton_default_repeat_ipses, "bin",      FALSE, NO_FREE);
 	}
 	return singleton_default_repeat_ipses;
 }
@@ -792,15 +897,31 @@ static void main_usage_data_format_options(FILE* o, char* argv0) {
 	fprintf(o, "                                  non-JSON formats. Defaults to %s.\n",
 		DEFAULT_JSON_FLATTEN_SEPARATOR);
 	fprintf(o, "\n");
+	fprintf(o, "  --ibin    --obin    --bin       Miller's own binary format, for piping from one\n");
+	fprintf(o, "                                  Miller process to another, or for intermediate\n");
+	fprintf(o, "                                  files: records aren't formatted as text and then\n");
+	fprintf(o, "                                  split and type-inferred again. Keys are sent once\n");
+	fprintf(o, "                                  per distinct key list; values already known to be\n");
+	fprintf(o, "                                  numeric, e.g. computed by put, are sent as numbers.\n");
+	fprintf(o, "                    --obin-typed  Also send all other numeric-looking values as\n");
+	fprintf(o, "                                  numbers, so readers needn't infer their types.\n");
+	fprintf(o, "\n");
 	fprintf(o, "  -p is a keystroke-saver for --nidx --fs space --repifs\n");
 	fprintf(o, "\n");
 	fprintf(o, "  --mmap --no-mmap --mmap-below {n} Use mmap for files whenever possible, never, or\n");
 	fprintf(o, "                                  for files less than n bytes in size. Default is for\n");
-	fprintf(o, "                                  files less than %lld bytes in size.\n", DEFAULT_MAX_FILE_SIZE_FOR_MMAP);
+	fprintf(o, "                                  files less than %lld bytes in size. Larger DKVP and\n", DEFAULT_MAX_FILE_SIZE_FOR_MMAP);
+	fprintf(o, "                                  NIDX files are read with --mmap-ro.\n");
 	fprintf(o, "                                  'Whenever possible' means always except for when reading\n");
 	fprintf(o, "                                  standard input which is not mmappable. If you don't know\n");
 	fprintf(o, "                                  what this means, don't worry about it -- it's a minor\n");
 	fprintf(o, "                                  performance optimization.\n");
+	fprintf(o, "  --mmap-ro                       Use read-only mmap for DKVP and NIDX files of any\n");
+	fprintf(o, "                                  size, copying out one record at a time, so input pages\n");
+	fprintf(o, "                                  are shared with the page cache rather than copied. Other\n");
+	fprintf(o, "                                  input formats are read via stdio.\n");
+	fprintf(o, "  --mmap-window {n}               Map read-only-mmapped files n bytes at a time, with\n");
+	fprintf(o, "                                  sequential read-ahead. Default %lld.\n", DEFAULT_MMAP_WINDOW_SIZE);
 	fprintf(o, "\n");
 	fprintf(o, "  Examples: --csv for CSV-formatted input and output; --idkvp --opprint for\n");
 	fprintf(o, "  DKVP-formatted input and pretty-printed output.\n");
@@ -972,6 +1093,39 @@ static void main_usage_other_options(FILE* o, char* argv0) {
 	fprintf(o, "                     file is processed in isolation: if the output format is\n");
 	fprintf(o, "                     CSV, CSV headers will be present in each output file;\n");
 	fprintf(o, "                     statistics are only over each file's own records; and so on.\n");
+	fprintf(o, "  --jobs {n}         With -I, process up to n files at a time, each in its own\n");
+	fprintf(o, "                     process. Messages are written, and files renamed into\n");
+	fprintf(o, "                     place, in file-name order. As without --jobs, a failure\n");
+	fprintf(o, "                     on one file stops there: later files are left unmodified.\n");
+	fprintf(o, "                     NR counts within each file. With --seed n, the file at\n");
+	fprintf(o, "                     index i (from 0) is seeded with n+i: random numbers are\n");
+	fprintf(o, "                     the same from run to run, but not the same as without\n");
+	fprintf(o, "                     --jobs. Default 1.\n");
+	fprintf(o, "  --two-pass         For verbs which otherwise hold all records in memory until\n");
+	fprintf(o, "                     end of stream only to make a second pass over them, read\n");
+	fprintf(o, "                     the input files twice instead. Currently fraction,\n");
+	fprintf(o, "                     unsparsify, histogram --auto, and stats2 --fit without -g,\n");
+	fprintf(o, "                     as the first verb in the chain. The verb's output is the\n");
+	fprintf(o, "                     same either way, but downstream verbs see different\n");
+	fprintf(o, "                     context: NR, FNR, and FILENAME are those of each record as\n");
+	fprintf(o, "                     it's re-read, rather than those at end of stream. Ignored\n");
+	fprintf(o, "                     when reading standard input, pipes, or with --prepipe or\n");
+	fprintf(o, "                     -I.\n");
+	fprintf(o, "  --max-open-files {n} For tee/emit/print/dump redirects, keep at most n output\n");
+	fprintf(o, "                     files open at a time. When another is needed, the least\n");
+	fprintf(o, "                     recently written one is closed, and reopened for append if\n");
+	fprintf(o, "                     written to again. Pipes don't count. Default %d.\n", DEFAULT_MAX_OPEN_OUTPUT_FILES);
+	fprintf(o, "  --flush-every {n}  For redirected output which is flushed (see put/tee\n");
+	fprintf(o, "                     --no-fflush), flush each file or pipe after every n records\n");
+	fprintf(o, "                     written to it, rather than after each one. Default %d.\n", DEFAULT_OUTPUT_FLUSH_EVERY);
+	fprintf(o, "  --output-buffer-size {n} Write buffer size in bytes for each redirected output\n");
+	fprintf(o, "                     file or pipe; 0 for the system default. Default %d.\n", DEFAULT_OUTPUT_BUFFER_SIZE);
+	fprintf(o, "  --profile          At exit, write to stderr one DKVP record each for the record\n");
+	fprintf(o, "                     reader, each verb in the chain, and the record writer, with\n");
+	fprintf(o, "                     wall seconds, allocation counts, records in and out, and\n");
+	fprintf(o, "                     bytes read or written; then one for the totals, with user\n");
+	fprintf(o, "                     and system CPU seconds and peak RSS. Times include the\n");
+	fprintf(o, "                     profiling overhead.\n");
 }
 
 static void main_usage_then_chaining(FILE* o, char* argv0) {
@@ -1044,6 +1198,29 @@ static void check_arg_count(char** argv, int argi, int argc, int n) {
 	}
 }
 
+// ----------------------------------------------------------------
+// For --two-pass: the stream driver can re-read the input only when it's from regular files
+// read directly, and the first verb's mapper must be able to use the re-read. Else
+// processing is as usual.
+static int try_two_pass(cli_opts_t* popts, sllv_t* pmapper_list) {
+	if (popts->filenames == NULL || popts->filenames->length == 0)
+		return FALSE;
+	if (popts->do_in_place || popts->reader_opts.prepipe != NULL)
+		return FALSE;
+	for (sllse_t* pe = popts->filenames->phead; pe != NULL; pe = pe->pnext)
+		if (!is_regular_file(pe->value))
+			return FALSE;
+
+	int argi = popts->mapper_argb;
+	if (streq(popts->argv[argi], "then"))
+		argi++;
+	mapper_setup_t* pmapper_setup = look_up_mapper_setup(popts->argv[argi]);
+	if (pmapper_setup == NULL || pmapper_setup->ptwo_pass_func == NULL)
+		return FALSE;
+	return pmapper_setup->ptwo_pass_func(pmapper_list->phead->pvvalue);
+}
+
+// ----------------------------------------------------------------
 static mapper_setup_t* look_up_mapper_setup(char* verb) {
 	mapper_setup_t* pmapper_setup = NULL;
 	for (int i = 0; i < mapper_lookup_table_length; i++) {
@@ -1068,6 +1245,12 @@ void cli_opts_init(cli_opts_t* popts) {
 	popts->nr_progress_mod = 0LL;
 
 	popts->do_in_place     = FALSE;
+	popts->in_place_jobs   = 1;
+	popts->have_rand_seed  = FALSE;
+	popts->rand_seed       = 0;
+	popts->do_two_pass     = FALSE;
+	popts->do_profile      = FALSE;
+	popts->mapper_verbs    = NULL;
 }
 
 void cli_reader_opts_init(cli_reader_opts_t* preader_opts) {
@@ -1082,12 +1265,18 @@ void cli_reader_opts_init(cli_reader_opts_t* preader_opts) {
 	preader_opts->allow_repeat_ips               = NEITHER_TRUE_NOR_FALSE;
 	preader_opts->use_implicit_csv_header        = NEITHER_TRUE_NOR_FALSE;
 	preader_opts->use_mmap_for_read              = NEITHER_TRUE_NOR_FALSE;
+	preader_opts->use_mmap_read_only             = NEITHER_TRUE_NOR_FALSE;
 
 	preader_opts->prepipe                        = NULL;
 	preader_opts->comment_handling               = COMMENTS_ARE_DATA;
 	preader_opts->comment_string                 = NULL;
 
 	preader_opts->max_file_size_for_mmap         = DEFAULT_MAX_FILE_SIZE_FOR_MMAP;
+	preader_opts->mmap_window_size               = DEFAULT_MMAP_WINDOW_SIZE;
+
+	preader_opts->line_filter_regex              = NULL;
+	preader_opts->line_filter_ignore_case        = FALSE;
+	preader_opts->line_filter_invert             = FALSE;
 
 	// xxx temp
 	preader_opts->generator_opts.field_name     = "i";
@@ -1113,6 +1302,7 @@ void cli_writer_opts_init(cli_writer_opts_t* pwriter_opts) {
 
 	pwriter_opts->output_json_flatten_separator  = NULL;
 	pwriter_opts->oosvar_flatten_separator       = NULL;
+	pwriter_opts->bin_infer_types                = NEITHER_TRUE_NOR_FALSE;
 
 	pwriter_opts->oquoting                       = QUOTE_UNSPECIFIED;
 }
@@ -1144,6 +1334,9 @@ void cli_apply_reader_defaults(cli_reader_opts_t* preader_opts) {
 		preader_opts->use_mmap_for_read = FALSE;
 #endif
 
+	if (preader_opts->use_mmap_read_only == NEITHER_TRUE_NOR_FALSE)
+		preader_opts->use_mmap_read_only = FALSE;
+
 	if (preader_opts->input_json_flatten_separator == NULL)
 		preader_opts->input_json_flatten_separator = DEFAULT_JSON_FLATTEN_SEPARATOR;
 }
@@ -1182,6 +1375,9 @@ void cli_apply_writer_defaults(cli_writer_opts_t* pwriter_opts) {
 	if (pwriter_opts->oosvar_flatten_separator == NULL)
 		pwriter_opts->oosvar_flatten_separator = DEFAULT_OOSVAR_FLATTEN_SEPARATOR;
 
+	if (pwriter_opts->bin_infer_types == NEITHER_TRUE_NOR_FALSE)
+		pwriter_opts->bin_infer_types = FALSE;
+
 	if (pwriter_opts->oquoting == QUOTE_UNSPECIFIED)
 		pwriter_opts->oquoting = DEFAULT_OQUOTING;
 }
@@ -1250,6 +1446,9 @@ void cli_merge_reader_opts(cli_reader_opts_t* pfunc_opts, cli_reader_opts_t* pma
 	if (pfunc_opts->use_mmap_for_read == NEITHER_TRUE_NOR_FALSE)
 		pfunc_opts->use_mmap_for_read = pmain_opts->use_mmap_for_read;
 
+	if (pfunc_opts->use_mmap_read_only == NEITHER_TRUE_NOR_FALSE)
+		pfunc_opts->use_mmap_read_only = pmain_opts->use_mmap_read_only;
+
 	if (pfunc_opts->input_json_flatten_separator == NULL)
 		pfunc_opts->input_json_flatten_separator = pmain_opts->input_json_flatten_separator;
 }
@@ -1308,6 +1507,9 @@ void cli_merge_writer_opts(cli_writer_opts_t* pfunc_opts, cli_writer_opts_t* pma
 	if (pfunc_opts->oosvar_flatten_separator == NULL)
 		pfunc_opts->oosvar_flatten_separator = pmain_opts->oosvar_flatten_separator;
 
+	if (pfunc_opts->bin_infer_types == NEITHER_TRUE_NOR_FALSE)
+		pfunc_opts->bin_infer_types = pmain_opts->bin_infer_types;
+
 	if (pfunc_opts->oquoting == QUOTE_UNSPECIFIED)
 		pfunc_opts->oquoting = pmain_opts->oquoting;
 }
@@ -1540,10 +1742,19 @@ int cli_handle_reader_options(char** argv, int argc, int *pargi, cli_reader_opts
 		preader_opts->allow_repeat_ifs = TRUE;
 		argi += 1;
 
+	} else if (streq(argv[argi], "--ibin")) {
+		preader_opts->ifile_fmt = "bin";
+		argi += 1;
+
 	} else if (streq(argv[argi], "--mmap")) {
 		preader_opts->use_mmap_for_read = TRUE;
 		argi += 1;
 
+	} else if (streq(argv[argi], "--mmap-ro")) {
+		preader_opts->use_mmap_for_read = TRUE;
+		preader_opts->use_mmap_read_only = TRUE;
+		argi += 1;
+
 	} else if (streq(argv[argi], "--no-mmap")) {
 		preader_opts->use_mmap_for_read = FALSE;
 		argi += 1;
@@ -1559,6 +1770,17 @@ int cli_handle_reader_options(char** argv, int argc, int *pargi, cli_reader_opts
 		preader_opts->max_file_size_for_mmap = llmax;
 		argi += 2;
 
+	} else if (streq(argv[argi], "--mmap-window")) {
+		check_arg_count(argv, argi, argc, 2);
+		long long llsize;
+		if (sscanf(argv[argi+1], "%lld", &llsize) != 1 || llsize <= 0) {
+			fprintf(stderr, "%s: could not scan \"%s\" as a positive number of bytes.\n",
+				MLR_GLOBALS.bargv0, argv[argi+1]);
+			exit(1);
+		}
+		preader_opts->mmap_window_size = llsize;
+		argi += 2;
+
 	} else if (streq(argv[argi], "--prepipe")) {
 		check_arg_count(argv, argi, argc, 2);
 		preader_opts->prepipe = argv[argi+1];
@@ -1695,6 +1917,15 @@ int cli_handle_writer_options(char** argv, int argc, int *pargi, cli_writer_opts
 		pwriter_opts->ofile_fmt = "pprint";
 		argi += 1;
 
+	} else if (streq(argv[argi], "--obin")) {
+		pwriter_opts->ofile_fmt = "bin";
+		argi += 1;
+
+	} else if (streq(argv[argi], "--obin-typed")) {
+		pwriter_opts->ofile_fmt = "bin";
+		pwriter_opts->bin_infer_types = TRUE;
+		argi += 1;
+
 	} else if (streq(argv[argi], "--right")) {
 		pwriter_opts->right_align_pprint = TRUE;
 		argi += 1;
@@ -1834,6 +2065,11 @@ int cli_handle_reader_writer_options(char** argv, int argc, int *pargi,
 		pwriter_opts->ofile_fmt        = "pprint";
 		argi += 1;
 
+	} else if (streq(argv[argi], "--bin")) {
+		preader_opts->ifile_fmt = "bin";
+		pwriter_opts->ofile_fmt = "bin";
+		argi += 1;
+
 	} else if (streq(argv[argi], "--c2t")) {
 		preader_opts->ifile_fmt = "csv";
 		preader_opts->irs       = "auto";
@@ -37,6 +37,7 @@ typedef struct _cli_reader_opts_t {
 	int   allow_repeat_ips;
 	int   use_implicit_csv_header;
 	int   use_mmap_for_read;
+	int   use_mmap_read_only; // For --mmap-ro; see input/lrec_reader_mmap_ro.c
 
 	// Command for popen on input, e.g. "zcat -cf <". Can be null in which case
 	// files are read directly rather than through a pipe.
@@ -47,6 +48,15 @@ typedef struct _cli_reader_opts_t {
 
 	// https://github.com/johnkerl/miller/issues/160
 	ssize_t max_file_size_for_mmap;
+	// For read-only mmap, which maps files a window at a time
+	size_t mmap_window_size;
+
+	// Set by "mlr grep -a": input lines are matched against this regex, and
+	// discarded if they don't match (or, if inverted, if they do), before they
+	// are split into fields.
+	char* line_filter_regex;
+	int   line_filter_ignore_case;
+	int   line_filter_invert;
 
 	// Fake internal-data-generator 'reader'
 	generator_opts_t generator_opts;
@@ -71,6 +81,7 @@ typedef struct _cli_writer_opts_t {
 	int   json_quote_non_string_values;
 	char* output_json_flatten_separator;
 	char* oosvar_flatten_separator;
+	int   bin_infer_types;
 
 	quoting_t oquoting;
 
@@ -93,6 +104,20 @@ typedef struct _cli_opts_t {
 	long long nr_progress_mod;
 
 	int do_in_place;
+	// With -I, the number of files to process at a time: see --jobs.
+	int in_place_jobs;
+
+	// From --seed. With -I --jobs, each file's process reseeds from this plus the file's index.
+	int have_rand_seed;
+	unsigned rand_seed;
+
+	// Requested with --two-pass; left TRUE only if the first verb is in two-pass mode.
+	int do_two_pass;
+
+	// Requested with --profile: see stream.c.
+	int do_profile;
+	// The verb for each mapper in the chain, for --profile. Fused verbs are joined with " then ".
+	slls_t* mapper_verbs;
 
 } cli_opts_t;
 
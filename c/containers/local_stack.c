@@ -335,34 +335,34 @@ void local_stack_bounds_check(local_stack_frame_t* pframe, char* op, int set, in
 void local_stack_frame_throw_type_mismatch_for_write(local_stack_frame_entry_t* pentry, mv_t* pval) {
 	MLR_INTERNAL_CODING_ERROR_IF(pentry->name == NULL);
 	char* sval = mv_alloc_format_val_quoting_strings(pval);
-	fprintf(stderr, "%s: %s type assertion for variable %s unmet by value %s with type %s.\n",
+	mlr_print_data_error("%s: %s type assertion for variable %s unmet by value %s with type %s.\n",
 		MLR_GLOBALS.bargv0, type_mask_to_desc(pentry->type_mask), pentry->name,
 		sval, mt_describe_type_simple(pval->type));
 	free(sval);
-	exit(1);
+	mlr_exit_on_data_error();
 }
 
 void local_stack_frame_throw_type_xmismatch_for_write(local_stack_frame_entry_t* pentry, mlhmmv_xvalue_t* pxval) {
 	MLR_INTERNAL_CODING_ERROR_IF(pentry->name == NULL);
 	char* sval = mv_alloc_format_val_quoting_strings(&pxval->terminal_mlrval); // xxx temp -- maybe not terminal
-	fprintf(stderr, "%s: %s type assertion for variable %s unmet by value %s with type %s.\n",
+	mlr_print_data_error("%s: %s type assertion for variable %s unmet by value %s with type %s.\n",
 		MLR_GLOBALS.bargv0, type_mask_to_desc(pentry->type_mask), pentry->name,
 		sval, mlhmmv_xvalue_describe_type_simple(pxval));
 	free(sval);
-	exit(1);
+	mlr_exit_on_data_error();
 }
 
 // ----------------------------------------------------------------
 void local_stack_frame_throw_type_mismatch_for_read(local_stack_frame_entry_t* pentry) {
 	MLR_INTERNAL_CODING_ERROR_IF(pentry->name == NULL);
-	fprintf(stderr, "%s: %s type assertion for variable %s unmet on read.\n",
+	mlr_print_data_error("%s: %s type assertion for variable %s unmet on read.\n",
 		MLR_GLOBALS.bargv0, type_mask_to_desc(pentry->type_mask), pentry->name);
-	exit(1);
+	mlr_exit_on_data_error();
 }
 
 void local_stack_frame_throw_type_xmismatch_for_read(local_stack_frame_entry_t* pentry) {
 	MLR_INTERNAL_CODING_ERROR_IF(pentry->name == NULL);
-	fprintf(stderr, "%s: %s type assertion for variable %s unmet on read.\n",
+	mlr_print_data_error("%s: %s type assertion for variable %s unmet on read.\n",
 		MLR_GLOBALS.bargv0, type_mask_to_desc(pentry->type_mask), pentry->name);
-	exit(1);
+	mlr_exit_on_data_error();
 }
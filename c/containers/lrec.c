@@ -9,6 +9,8 @@
 #define SB_ALLOC_LENGTH 256
 
 static lrece_t* lrec_find_entry(lrec_t* prec, char* key);
+static lrece_t* lrec_put_aux(lrec_t* prec, char* key, char* value, char free_flags);
+static int lrec_set_typed_value(lrec_t* prec, lrece_t* pe, char value_type, lrec_typed_value_t value);
 static void lrec_link_at_head(lrec_t* prec, lrece_t* pe);
 static void lrec_link_at_tail(lrec_t* prec, lrece_t* pe);
 
@@ -65,6 +67,14 @@ lrec_t* lrec_xtab_alloc(slls_t* pxtab_lines) {
 	return prec;
 }
 
+lrec_t* lrec_bin_alloc(char* buffer) {
+	lrec_t* prec = mlr_malloc_or_die(sizeof(lrec_t));
+	memset(prec, 0, sizeof(lrec_t));
+	prec->psingle_line = buffer;
+	prec->pfree_backing_func = lrec_free_single_line_backing;
+	return prec;
+}
+
 // ----------------------------------------------------------------
 static void lrec_free_contents(lrec_t* prec) {
 	for (lrece_t* pe = prec->phead; pe != NULL; /*pe = pe->pnext*/) {
@@ -76,6 +86,7 @@ static void lrec_free_contents(lrec_t* prec) {
 		pe = pe->pnext;
 		free(ope);
 	}
+	free(prec->ptyped_values);
 	prec->pfree_backing_func(prec);
 }
 
@@ -100,14 +111,35 @@ void lrec_free(lrec_t* prec) {
 lrec_t* lrec_copy(lrec_t* pinrec) {
 	lrec_t* poutrec = lrec_unbacked_alloc();
 	for (lrece_t* pe = pinrec->phead; pe != NULL; pe = pe->pnext) {
-		lrec_put(poutrec, mlr_strdup_or_die(pe->key), mlr_strdup_or_die(pe->value),
+		lrece_t* pf = lrec_put_aux(poutrec, mlr_strdup_or_die(pe->key), mlr_strdup_or_die(pe->value),
 			FREE_ENTRY_KEY|FREE_ENTRY_VALUE);
+		lrec_typed_value_t typed_value;
+		if (pe->value_type == LREC_VALUE_INT || pe->value_type == LREC_VALUE_FLOAT) {
+			(void)lrec_get_typed_value(pinrec, pe, &typed_value);
+			(void)lrec_set_typed_value(poutrec, pf, pe->value_type, typed_value);
+		} else {
+			pf->value_type = pe->value_type;
+		}
 	}
 	return poutrec;
 }
 
 // ----------------------------------------------------------------
 void lrec_put(lrec_t* prec, char* key, char* value, char free_flags) {
+	(void)lrec_put_aux(prec, key, value, free_flags);
+}
+
+void lrec_put_int(lrec_t* prec, char* key, char* value, char free_flags, long long intv) {
+	lrece_t* pe = lrec_put_aux(prec, key, value, free_flags);
+	(void)lrec_set_typed_value(prec, pe, LREC_VALUE_INT, (lrec_typed_value_t) { .intv = intv });
+}
+
+void lrec_put_float(lrec_t* prec, char* key, char* value, char free_flags, double fltv) {
+	lrece_t* pe = lrec_put_aux(prec, key, value, free_flags);
+	(void)lrec_set_typed_value(prec, pe, LREC_VALUE_FLOAT, (lrec_typed_value_t) { .fltv = fltv });
+}
+
+static lrece_t* lrec_put_aux(lrec_t* prec, char* key, char* value, char free_flags) {
 	lrece_t* pe = lrec_find_entry(prec, key);
 
 	if (pe != NULL) {
@@ -117,6 +149,7 @@ void lrec_put(lrec_t* prec, char* key, char* value, char free_flags) {
 		if (free_flags & FREE_ENTRY_KEY)
 			free(key);
 		pe->value = value;
+		pe->value_type = LREC_VALUE_UNINFERRED;
 		if (free_flags & FREE_ENTRY_VALUE)
 			pe->free_flags |= FREE_ENTRY_VALUE;
 		else
@@ -125,6 +158,8 @@ void lrec_put(lrec_t* prec, char* key, char* value, char free_flags) {
 		pe = mlr_malloc_or_die(sizeof(lrece_t));
 		pe->key         = key;
 		pe->value       = value;
+		pe->value_type  = LREC_VALUE_UNINFERRED;
+		pe->typed_value_index = 0;
 		pe->free_flags  = free_flags;
 		pe->quote_flags = 0;
 
@@ -141,6 +176,7 @@ void lrec_put(lrec_t* prec, char* key, char* value, char free_flags) {
 		}
 		prec->field_count++;
 	}
+	return pe;
 }
 
 void lrec_put_ext(lrec_t* prec, char* key, char* value, char free_flags, char quote_flags) {
@@ -153,6 +189,7 @@ void lrec_put_ext(lrec_t* prec, char* key, char* value, char free_flags, char qu
 		if (free_flags & FREE_ENTRY_KEY)
 			free(key);
 		pe->value = value;
+		pe->value_type = LREC_VALUE_UNINFERRED;
 		if (free_flags & FREE_ENTRY_VALUE)
 			pe->free_flags |= FREE_ENTRY_VALUE;
 		else
@@ -161,6 +198,8 @@ void lrec_put_ext(lrec_t* prec, char* key, char* value, char free_flags, char qu
 		pe = mlr_malloc_or_die(sizeof(lrece_t));
 		pe->key         = key;
 		pe->value       = value;
+		pe->value_type  = LREC_VALUE_UNINFERRED;
+		pe->typed_value_index = 0;
 		pe->free_flags  = free_flags;
 		pe->quote_flags = quote_flags;
 
@@ -187,6 +226,7 @@ void lrec_prepend(lrec_t* prec, char* key, char* value, char free_flags) {
 			free(pe->value);
 		}
 		pe->value = value;
+		pe->value_type = LREC_VALUE_UNINFERRED;
 		pe->free_flags &= ~FREE_ENTRY_VALUE;
 		if (free_flags & FREE_ENTRY_VALUE)
 			pe->free_flags |= FREE_ENTRY_VALUE;
@@ -194,6 +234,8 @@ void lrec_prepend(lrec_t* prec, char* key, char* value, char free_flags) {
 		pe = mlr_malloc_or_die(sizeof(lrece_t));
 		pe->key         = key;
 		pe->value       = value;
+		pe->value_type  = LREC_VALUE_UNINFERRED;
+		pe->typed_value_index = 0;
 		pe->free_flags  = free_flags;
 		pe->quote_flags = 0;
 
@@ -220,6 +262,7 @@ lrece_t* lrec_put_after(lrec_t* prec, lrece_t* pd, char* key, char* value, char
 			free(pe->value);
 		}
 		pe->value = value;
+		pe->value_type = LREC_VALUE_UNINFERRED;
 		pe->free_flags &= ~FREE_ENTRY_VALUE;
 		if (free_flags & FREE_ENTRY_VALUE)
 			pe->free_flags |= FREE_ENTRY_VALUE;
@@ -227,6 +270,8 @@ lrece_t* lrec_put_after(lrec_t* prec, lrece_t* pd, char* key, char* value, char
 		pe = mlr_malloc_or_die(sizeof(lrece_t));
 		pe->key         = key;
 		pe->value       = value;
+		pe->value_type  = LREC_VALUE_UNINFERRED;
+		pe->typed_value_index = 0;
 		pe->free_flags  = free_flags;
 		pe->quote_flags = 0;
 
@@ -281,6 +326,82 @@ char* lrec_get_ext(lrec_t* prec, char* key, lrece_t** ppentry) {
 	}
 }
 
+// ----------------------------------------------------------------
+// Returns FALSE, leaving the entry uninferred, if the record has run out of slots.
+static int lrec_set_typed_value(lrec_t* prec, lrece_t* pe, char value_type, lrec_typed_value_t value) {
+	if (pe->typed_value_index == 0) {
+		// typed_values_capacity counts the inline slots too.
+		if (prec->typed_values_capacity == 0)
+			prec->typed_values_capacity = LREC_INLINE_TYPED_VALUES;
+		if (prec->num_typed_values >= prec->typed_values_capacity) {
+			if (prec->typed_values_capacity == LREC_MAX_TYPED_VALUES)
+				return FALSE;
+			int new_capacity = 2 * prec->typed_values_capacity + LREC_INLINE_TYPED_VALUES;
+			if (new_capacity > LREC_MAX_TYPED_VALUES)
+				new_capacity = LREC_MAX_TYPED_VALUES;
+			prec->ptyped_values = mlr_realloc_or_die(prec->ptyped_values,
+				(new_capacity - LREC_INLINE_TYPED_VALUES) * sizeof(lrec_typed_value_t));
+			prec->typed_values_capacity = new_capacity;
+		}
+		pe->typed_value_index = ++prec->num_typed_values;
+	}
+	int i = pe->typed_value_index - 1;
+	if (i < LREC_INLINE_TYPED_VALUES)
+		prec->inline_typed_values[i] = value;
+	else
+		prec->ptyped_values[i - LREC_INLINE_TYPED_VALUES] = value;
+	pe->value_type = value_type;
+	return TRUE;
+}
+
+char lrec_infer_typed_value(lrec_t* prec, lrece_t* pe, lrec_typed_value_t* pvalue) {
+	char value_type;
+	if (pe->value == NULL || *pe->value == 0)
+		value_type = LREC_VALUE_NON_NUMERIC;
+	else if (mlr_try_int_from_string(pe->value, &pvalue->intv))
+		value_type = LREC_VALUE_INT;
+	else if (mlr_try_float_from_string(pe->value, &pvalue->fltv))
+		value_type = LREC_VALUE_FLOAT;
+	else
+		value_type = LREC_VALUE_NON_NUMERIC;
+
+	if (value_type == LREC_VALUE_NON_NUMERIC)
+		pe->value_type = value_type;
+	else
+		(void)lrec_set_typed_value(prec, pe, value_type, *pvalue);
+	return value_type;
+}
+
+int lrec_entry_try_float(lrec_t* prec, lrece_t* pe, double* pval) {
+	lrec_typed_value_t typed_value;
+	switch (lrec_get_typed_value(prec, pe, &typed_value)) {
+	case LREC_VALUE_FLOAT:
+		*pval = typed_value.fltv;
+		return TRUE;
+	case LREC_VALUE_INT: {
+		// Ints are scanned with %lli, which reads "010" as octal and "0x10" as hex; %lf reads
+		// the former as decimal. Decimal ints without leading zeroes convert the same either way.
+		char* p = pe->value;
+		if (*p == '-' || *p == '+')
+			p++;
+		if (*p >= '1' && *p <= '9') {
+			*pval = (double)typed_value.intv;
+			return TRUE;
+		}
+		return mlr_try_float_from_string(pe->value, pval);
+	}
+	default:
+		return FALSE;
+	}
+}
+
+double lrec_entry_double_or_die(lrec_t* prec, lrece_t* pe) {
+	double fltv;
+	if (lrec_entry_try_float(prec, pe, &fltv))
+		return fltv;
+	return mlr_double_from_string_or_die(pe->value);
+}
+
 // ----------------------------------------------------------------
 void lrec_remove(lrec_t* prec, char* key) {
 	lrece_t* pe = lrec_find_entry(prec, key);
@@ -565,6 +686,13 @@ void lrec_print(lrec_t* prec) {
 
 char* lrec_sprint(lrec_t* prec, char* ors, char* ofs, char* ops) {
 	string_builder_t* psb = sb_alloc(SB_ALLOC_LENGTH);
+	lrec_sbprint(prec, psb, ors, ofs, ops);
+	char* rv = sb_finish(psb);
+	sb_free(psb);
+	return rv;
+}
+
+void lrec_sbprint(lrec_t* prec, string_builder_t* psb, char* ors, char* ofs, char* ops) {
 	if (prec == NULL) {
 		sb_append_string(psb, "NULL");
 	} else {
@@ -579,7 +707,4 @@ char* lrec_sprint(lrec_t* prec, char* ors, char* ofs, char* ops) {
 		}
 		sb_append_string(psb, ors);
 	}
-	char* rv = sb_finish(psb);
-	sb_free(psb);
-	return rv;
 }
@@ -44,11 +44,27 @@
 #define LREC_H
 
 #include "lib/free_flags.h"
+#include "lib/string_builder.h"
+#include "lib/mlrval.h"
 #include "containers/sllv.h"
 #include "containers/header_keeper.h"
 
 #define FIELD_QUOTED_ON_INPUT 0x02
 
+// Values of lrece_t value_type: see the numeric accessors below.
+#define LREC_VALUE_UNINFERRED  0
+#define LREC_VALUE_NON_NUMERIC 1
+#define LREC_VALUE_INT         2
+#define LREC_VALUE_FLOAT       3
+
+#define LREC_INLINE_TYPED_VALUES 2
+#define LREC_MAX_TYPED_VALUES    255
+
+typedef union _lrec_typed_value_t {
+	long long intv;
+	double    fltv;
+} lrec_typed_value_t;
+
 struct _lrec_t; // forward reference
 typedef struct _lrec_t lrec_t;
 
@@ -66,6 +82,13 @@ typedef struct _lrece_t {
 	char free_flags;
 	char quote_flags;
 
+	// Cached int-or-float inference on the value, reset whenever the value is
+	// replaced. The value string is always present; this only saves re-parsing it.
+	// The number itself is kept in the record, in the slot one less than the
+	// index given here (zero for none), which keeps this struct small.
+	char value_type;
+	unsigned char typed_value_index;
+
 	struct _lrece_t *pprev;
 	struct _lrece_t *pnext;
 } lrece_t;
@@ -73,9 +96,17 @@ typedef struct _lrece_t {
 struct _lrec_t {
 	//  - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 	int      field_count;
+	unsigned char num_typed_values;
+	unsigned char typed_values_capacity;
 	lrece_t* phead;
 	lrece_t* ptail;
 
+	// Slots for numbers cached on entries: see lrec_get_typed_value. Few fields
+	// per record are typically used as numbers, so the first few slots are
+	// inline and the rest are allocated on first use.
+	lrec_typed_value_t  inline_typed_values[LREC_INLINE_TYPED_VALUES];
+	lrec_typed_value_t* ptyped_values;
+
 	//  - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 	// See comments above free_flags. Used to track a mallocked pointer to be
 	// freed at lrec_free().
@@ -99,6 +130,7 @@ lrec_t* lrec_nidx_alloc(char* line);
 lrec_t* lrec_csvlite_alloc(char* data_line);
 lrec_t* lrec_csv_alloc(char* data_line);
 lrec_t* lrec_xtab_alloc(slls_t* pxtab_lines);
+lrec_t* lrec_bin_alloc(char* buffer);
 
 void lrec_clear(lrec_t* prec);
 void  lrec_free(lrec_t* prec);
@@ -156,6 +188,80 @@ void lrec_dump_titled(char* msg, lrec_t* prec);
 void lrec_pointer_dump(lrec_t* prec);
 // The caller should free the return value
 char* lrec_sprint(lrec_t* prec, char* ors, char* ofs, char* ops);
+// Same, but appends to the given string builder.
+void lrec_sbprint(lrec_t* prec, string_builder_t* psb, char* ors, char* ofs, char* ops);
+
+// ----------------------------------------------------------------
+// Numeric views of field values. Fields are often consumed as numbers several
+// times over, e.g. in put ... then stats1 ... then sort -nf, so the
+// int-or-float inference is cached on the entry and done at most once per value
+// along the whole chain. Each has the same semantics as the string-based
+// function named in its comment. Verbs and the DSL get the entry with
+// lrec_get_ext and read numbers through these rather than from the value
+// string, so that a number already cached, e.g. as computed by put, is reused.
+
+// Like lrec_put, for an int-valued field whose value string was formatted with
+// mlr_alloc_string_from_ll: the int is cached so downstream verbs needn't
+// parse it back.
+void lrec_put_int(lrec_t* prec, char* key, char* value, char free_flags, long long intv);
+// Likewise for a float-valued field, e.g. as read from binary input: the float
+// is what the value string parses to, and is cached along with it.
+void lrec_put_float(lrec_t* prec, char* key, char* value, char free_flags, double fltv);
+
+// Returns one of the LREC_VALUE_* constants other than LREC_VALUE_UNINFERRED,
+// with the number in *pvalue for LREC_VALUE_INT and LREC_VALUE_FLOAT. The entry
+// must belong to the record.
+char lrec_infer_typed_value(lrec_t* prec, lrece_t* pe, lrec_typed_value_t* pvalue);
+static inline char lrec_get_typed_value(lrec_t* prec, lrece_t* pe, lrec_typed_value_t* pvalue) {
+	switch (pe->value_type) {
+	case LREC_VALUE_UNINFERRED:
+		return lrec_infer_typed_value(prec, pe, pvalue);
+	case LREC_VALUE_NON_NUMERIC:
+		return LREC_VALUE_NON_NUMERIC;
+	default: {
+		int i = pe->typed_value_index - 1;
+		*pvalue = (i < LREC_INLINE_TYPED_VALUES)
+			? prec->inline_typed_values[i]
+			: prec->ptyped_values[i - LREC_INLINE_TYPED_VALUES];
+		return pe->value_type;
+	}
+	}
+}
+
+// mlr_try_float_from_string
+int    lrec_entry_try_float(lrec_t* prec, lrece_t* pe, double* pval);
+// mlr_double_from_string_or_die
+double lrec_entry_double_or_die(lrec_t* prec, lrece_t* pe);
+
+// mv_ref_type_infer_string_or_float_or_int; NULL entry is absent.
+static inline mv_t lrec_entry_type_infer_string_or_float_or_int(lrec_t* prec, lrece_t* pe) {
+	if (pe == NULL || pe->value == NULL)
+		return mv_absent();
+	if (*pe->value == 0)
+		return mv_empty();
+	lrec_typed_value_t typed_value;
+	switch (lrec_get_typed_value(prec, pe, &typed_value)) {
+	case LREC_VALUE_INT:
+		return mv_from_int(typed_value.intv);
+	case LREC_VALUE_FLOAT:
+		return mv_from_float(typed_value.fltv);
+	default:
+		return mv_from_string(pe->value, NO_FREE);
+	}
+}
+
+// mv_scan_number_or_die
+static inline mv_t lrec_entry_scan_number_or_die(lrec_t* prec, lrece_t* pe) {
+	lrec_typed_value_t typed_value;
+	switch (lrec_get_typed_value(prec, pe, &typed_value)) {
+	case LREC_VALUE_INT:
+		return mv_from_int(typed_value.intv);
+	case LREC_VALUE_FLOAT:
+		return mv_from_float(typed_value.fltv);
+	default:
+		return mv_scan_number_or_die(pe->value);
+	}
+}
 
 // NIDX data are keyed by one-up field index which is not explicitly contained
 // in the file, e.g. line "a b c" splits to an lrec with "{"1" => "a", "2" =>
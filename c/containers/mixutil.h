@@ -32,7 +32,7 @@ void mlr_reference_values_from_record_into_string_array(lrec_t* prec, string_arr
 	string_array_t* pvalues);
 int record_has_all_keys(lrec_t* prec, slls_t* pselected_field_names);
 
-lhmss_t* mlr_reference_key_value_pairs_from_regex_names(lrec_t* prec, regex_t* pregexes, int num_regexes,
+lhmss_t* mlr_reference_key_value_pairs_from_regex_names(lrec_t* prec, mlr_regex_t* pregexes, int num_regexes,
 	int invert_matches);
 
 // Copies data; no referencing concerns.
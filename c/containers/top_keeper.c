@@ -1,16 +1,29 @@
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 #include "lib/mlrutil.h"
 #include "containers/top_keeper.h"
 #include "lib/mvfuncs.h"
 
+static void top_keeper_tree_add(top_keeper_t* ptop_keeper, mv_t value, lrec_t* prec);
+
 // ----------------------------------------------------------------
 top_keeper_t* top_keeper_alloc(int capacity) {
 	top_keeper_t* ptop_keeper = mlr_malloc_or_die(sizeof(top_keeper_t));
-	ptop_keeper->top_values   = mlr_malloc_or_die(capacity*sizeof(mv_t));
-	ptop_keeper->top_precords = mlr_malloc_or_die(capacity*sizeof(lrec_t*));
-	ptop_keeper->size         = 0;
-	ptop_keeper->capacity     = capacity;
+	ptop_keeper->top_values     = mlr_malloc_or_die(capacity*sizeof(mv_t));
+	ptop_keeper->top_precords   = mlr_malloc_or_die(capacity*sizeof(lrec_t*));
+	ptop_keeper->size           = 0;
+	ptop_keeper->capacity       = capacity;
+	ptop_keeper->is_tree        = capacity > TOP_KEEPER_MAX_SORTED_CAPACITY;
+	ptop_keeper->nodes          = ptop_keeper->is_tree
+		? mlr_malloc_or_die(capacity*sizeof(top_keeper_node_t))
+		: NULL;
+	ptop_keeper->root           = -1;
+	ptop_keeper->first          = -1;
+	ptop_keeper->last           = -1;
+	ptop_keeper->has_nan        = FALSE;
+	ptop_keeper->num_nodes_used = 0;
+	ptop_keeper->priority_state = 2463534242U;
 	return ptop_keeper;
 }
 
@@ -20,8 +33,10 @@ void top_keeper_free(top_keeper_t* ptop_keeper) {
 		return;
 	free(ptop_keeper->top_values);
 	free(ptop_keeper->top_precords);
+	free(ptop_keeper->nodes);
 	ptop_keeper->top_values = NULL;
 	ptop_keeper->top_precords = NULL;
+	ptop_keeper->nodes = NULL;
 	ptop_keeper->size = 0;
 	ptop_keeper->capacity = 0;
 	free(ptop_keeper);
@@ -58,6 +73,10 @@ void top_keeper_free(top_keeper_t* ptop_keeper) {
 
 // Our caller, mapper_top, feeds us records. We keep them or free them.
 void top_keeper_add(top_keeper_t* ptop_keeper, mv_t value, lrec_t* prec) {
+	if (ptop_keeper->is_tree) {
+		top_keeper_tree_add(ptop_keeper, value, prec);
+		return;
+	}
 	int destidx = mlr_bsearch_mv_n_for_insert(ptop_keeper->top_values, ptop_keeper->size, &value);
 	if (ptop_keeper->size < ptop_keeper->capacity) {
 		for (int i = ptop_keeper->size-1; i >= destidx; i--) {
@@ -82,11 +101,225 @@ void top_keeper_add(top_keeper_t* ptop_keeper, mv_t value, lrec_t* prec) {
 	}
 }
 
+// ----------------------------------------------------------------
+// Tree for larger capacities: a treap whose in-order traversal is the array.
+// Nodes are ordered by position only, and kept balanced by random priorities,
+// with each node's priority at least those of its children.
+
+static inline int tree_size(top_keeper_t* ptop_keeper, int t) {
+	return t < 0 ? 0 : ptop_keeper->nodes[t].size;
+}
+
+static inline void tree_update_size(top_keeper_t* ptop_keeper, int t) {
+	top_keeper_node_t* pnode = &ptop_keeper->nodes[t];
+	pnode->size = 1 + tree_size(ptop_keeper, pnode->left) + tree_size(ptop_keeper, pnode->right);
+}
+
+// The first k positions of the tree rooted at t go to *pleft, and the rest to *pright.
+static void tree_split(top_keeper_t* ptop_keeper, int t, int k, int* pleft, int* pright) {
+	if (t < 0) {
+		*pleft = *pright = -1;
+		return;
+	}
+	top_keeper_node_t* pnode = &ptop_keeper->nodes[t];
+	int left_size = tree_size(ptop_keeper, pnode->left);
+	if (k <= left_size) {
+		tree_split(ptop_keeper, pnode->left, k, pleft, &pnode->left);
+		*pright = t;
+	} else {
+		tree_split(ptop_keeper, pnode->right, k - left_size - 1, &pnode->right, pright);
+		*pleft = t;
+	}
+	tree_update_size(ptop_keeper, t);
+}
+
+// Concatenation: all of a's positions precede all of b's.
+static int tree_merge(top_keeper_t* ptop_keeper, int a, int b) {
+	if (a < 0)
+		return b;
+	if (b < 0)
+		return a;
+	top_keeper_node_t* pa = &ptop_keeper->nodes[a];
+	top_keeper_node_t* pb = &ptop_keeper->nodes[b];
+	if (pa->priority >= pb->priority) {
+		pa->right = tree_merge(ptop_keeper, pa->right, b);
+		tree_update_size(ptop_keeper, a);
+		return a;
+	} else {
+		pb->left = tree_merge(ptop_keeper, a, pb->left);
+		tree_update_size(ptop_keeper, b);
+		return b;
+	}
+}
+
+static mv_t* tree_value_at(top_keeper_t* ptop_keeper, int i) {
+	int t = ptop_keeper->root;
+	while (TRUE) {
+		top_keeper_node_t* pnode = &ptop_keeper->nodes[t];
+		int left_size = tree_size(ptop_keeper, pnode->left);
+		if (i < left_size) {
+			t = pnode->left;
+		} else if (i == left_size) {
+			return &pnode->value;
+		} else {
+			i -= left_size + 1;
+			t = pnode->right;
+		}
+	}
+}
+
+// Step for step the same as mlr_bsearch_mv_n_for_insert, so that ties are
+// placed as in the array.
+static int tree_bsearch_for_insert(top_keeper_t* ptop_keeper, mv_t* pvalue) {
+	int size = ptop_keeper->size;
+	int lo = 0;
+	int hi = size-1;
+	int mid = (hi+lo)/2;
+	int newmid;
+
+	if (size == 0)
+		return 0;
+	if (mv_i_nn_gt(pvalue, &ptop_keeper->nodes[ptop_keeper->first].value))
+		return 0;
+	if (mv_i_nn_lt(pvalue, &ptop_keeper->nodes[ptop_keeper->last].value))
+		return size;
+
+	while (lo < hi) {
+		mv_t* pa = tree_value_at(ptop_keeper, mid);
+		if (mv_i_nn_eq(pvalue, pa)) {
+			return mid;
+		}
+		else if (mv_i_nn_gt(pvalue, pa)) {
+			hi = mid;
+			newmid = (hi+lo)/2;
+		}
+		else {
+			lo = mid;
+			newmid = (hi+lo)/2;
+		}
+		if (mid == newmid) {
+			if (mv_i_nn_ge(pvalue, tree_value_at(ptop_keeper, lo)))
+				return lo;
+			else if (mv_i_nn_ge(pvalue, tree_value_at(ptop_keeper, hi)))
+				return hi;
+			else
+				return hi+1;
+		}
+		mid = newmid;
+	}
+
+	return lo;
+}
+
+// In a descending array with no value equal to the given one, the binary
+// search finds the index after the values greater than it. That takes one
+// descent of the tree, rather than one per probe; only for ties is the
+// search itself needed.
+static int tree_find_insert_index(top_keeper_t* ptop_keeper, mv_t* pvalue) {
+	if (ptop_keeper->size == 0 || ptop_keeper->has_nan)
+		return tree_bsearch_for_insert(ptop_keeper, pvalue);
+	if (mv_i_nn_lt(pvalue, &ptop_keeper->nodes[ptop_keeper->last].value))
+		return ptop_keeper->size;
+
+	int num_greater = 0;
+	int first_not_greater = -1;
+	int t = ptop_keeper->root;
+	while (t >= 0) {
+		top_keeper_node_t* pnode = &ptop_keeper->nodes[t];
+		if (mv_i_nn_gt(&pnode->value, pvalue)) {
+			num_greater += tree_size(ptop_keeper, pnode->left) + 1;
+			t = pnode->right;
+		} else {
+			first_not_greater = t;
+			t = pnode->left;
+		}
+	}
+	if (first_not_greater >= 0 && mv_i_nn_eq(&ptop_keeper->nodes[first_not_greater].value, pvalue))
+		return tree_bsearch_for_insert(ptop_keeper, pvalue);
+	return num_greater;
+}
+
+// As in top_keeper_add: when full, the last value is evicted to make room.
+static void top_keeper_tree_add(top_keeper_t* ptop_keeper, mv_t value, lrec_t* prec) {
+	if (value.type == MT_FLOAT && isnan(value.u.fltv))
+		ptop_keeper->has_nan = TRUE;
+	int destidx = tree_find_insert_index(ptop_keeper, &value);
+	int t;
+	if (ptop_keeper->size < ptop_keeper->capacity) {
+		t = ptop_keeper->num_nodes_used++;
+		ptop_keeper->size++;
+	} else {
+		if (destidx >= ptop_keeper->capacity) {
+			lrec_free(prec);
+			return;
+		}
+		int rest;
+		tree_split(ptop_keeper, ptop_keeper->root, ptop_keeper->size - 1, &rest, &t);
+		ptop_keeper->root = rest;
+		lrec_free(ptop_keeper->nodes[t].prec);
+	}
+
+	// xorshift32
+	unsigned int x = ptop_keeper->priority_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	ptop_keeper->priority_state = x;
+
+	top_keeper_node_t* pnode = &ptop_keeper->nodes[t];
+	pnode->value    = value;
+	pnode->prec     = prec;
+	pnode->priority = x;
+	pnode->size     = 1;
+	pnode->left     = -1;
+	pnode->right    = -1;
+
+	int left, right;
+	tree_split(ptop_keeper, ptop_keeper->root, destidx, &left, &right);
+	ptop_keeper->root = tree_merge(ptop_keeper, tree_merge(ptop_keeper, left, t), right);
+
+	int first = ptop_keeper->root;
+	while (ptop_keeper->nodes[first].left >= 0)
+		first = ptop_keeper->nodes[first].left;
+	ptop_keeper->first = first;
+	int last = ptop_keeper->root;
+	while (ptop_keeper->nodes[last].right >= 0)
+		last = ptop_keeper->nodes[last].right;
+	ptop_keeper->last = last;
+}
+
+static int tree_fill_array(top_keeper_t* ptop_keeper, int t, int i) {
+	while (t >= 0) {
+		top_keeper_node_t* pnode = &ptop_keeper->nodes[t];
+		i = tree_fill_array(ptop_keeper, pnode->left, i);
+		ptop_keeper->top_values[i]   = pnode->value;
+		ptop_keeper->top_precords[i] = pnode->prec;
+		i++;
+		t = pnode->right;
+	}
+	return i;
+}
+
+// ----------------------------------------------------------------
+void top_keeper_sort(top_keeper_t* ptop_keeper) {
+	if (!ptop_keeper->is_tree)
+		return;
+	tree_fill_array(ptop_keeper, ptop_keeper->root, 0);
+	free(ptop_keeper->nodes);
+	ptop_keeper->nodes = NULL;
+	ptop_keeper->root = -1;
+	ptop_keeper->first = -1;
+	ptop_keeper->last = -1;
+	ptop_keeper->is_tree = FALSE;
+}
+
 // ----------------------------------------------------------------
 void top_keeper_print(top_keeper_t* ptop_keeper) {
 	printf("top_keeper dump:\n");
 	for (int i = 0; i < ptop_keeper->size; i++) {
-		mv_t* pvalue = &ptop_keeper->top_values[i];
+		mv_t* pvalue = ptop_keeper->is_tree
+			? tree_value_at(ptop_keeper, i)
+			: &ptop_keeper->top_values[i];
 		if (pvalue->type == MT_FLOAT)
 			printf("[%02d] %.8lf\n", i, pvalue->u.fltv);
 		else
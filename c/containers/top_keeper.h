@@ -1,5 +1,14 @@
 // ================================================================
 // Data structure for mlr top: just a decorated array.
+//
+// For small capacities the array is kept sorted, largest value first, with
+// each accepted value inserted in place. For larger capacities, where shifting
+// the array down on each insert would make the whole quadratic, the same array
+// is instead held as a balanced tree indexed by position (a treap), so that
+// lookups, inserts, and evictions by index cost O(log n). The insertion index
+// is found by the same binary search either way, so values which tie land
+// where they would in the plain array. Call top_keeper_sort once all values
+// have been added, after which the array is filled in.
 // ================================================================
 
 #ifndef TOP_KEEPER_H
@@ -7,16 +16,41 @@
 #include "lib/mlrval.h"
 #include "containers/lrec.h"
 
+// Capacities above this use the tree.
+#define TOP_KEEPER_MAX_SORTED_CAPACITY 32
+
+typedef struct _top_keeper_node_t {
+	mv_t         value;
+	lrec_t*      prec;
+	unsigned int priority;
+	int          size; // Of the subtree rooted here
+	int          left;
+	int          right;
+} top_keeper_node_t;
+
 typedef struct _top_keeper_t {
 	mv_t*    top_values;
 	lrec_t** top_precords;
 	int      size;
 	int      capacity;
+
+	// Tree only: nodes are indexed from 0, with -1 for none.
+	top_keeper_node_t* nodes;
+	int      root;
+	int      first; // Cached for the quick checks which reject most values
+	int      last;
+	int      has_nan; // Then the values aren't ordered, so only the full search will do
+	int      num_nodes_used;
+	unsigned int priority_state;
+	int      is_tree;
 } top_keeper_t;
 
 top_keeper_t* top_keeper_alloc(int capacity);
 void top_keeper_free(top_keeper_t* ptop_keeper);
 void top_keeper_add(top_keeper_t* ptop_keeper, mv_t value, lrec_t* prec);
+// Fills in top_values and top_precords from the tree. Any values added after
+// this are inserted directly into the array, as for small capacities.
+void top_keeper_sort(top_keeper_t* ptop_keeper);
 
 // For debug/test
 void top_keeper_print(top_keeper_t* ptop_keeper);
@@ -136,6 +136,8 @@ fmgr_t* fmgr_alloc() {
 	pfmgr->pfunc_callsite_evaluators_to_resolve  = sllv_alloc();
 	pfmgr->pfunc_callsite_xevaluators_to_resolve = sllv_alloc();
 
+	pfmgr->compile_to_bytecode = TRUE;
+
 	return pfmgr;
 }
 
@@ -173,6 +175,48 @@ void fmgr_install_udf(fmgr_t* pfmgr, udf_defsite_state_t* pdefsite_state) {
 		FREE_ENTRY_KEY);
 }
 
+// ----------------------------------------------------------------
+int fmgr_function_is_foldable(fmgr_t* pfmgr, char* function_name, int has_float_args) {
+	for (int i = 0; ; i++) {
+		function_lookup_t* plookup = &pfmgr->function_lookup_table[i];
+		if (plookup->function_name == NULL)
+			return FALSE;
+		if (!streq(plookup->function_name, function_name))
+			continue;
+
+		switch (plookup->function_class) {
+		case FUNC_CLASS_MAPS: // Map-valued
+		case FUNC_CLASS_TIME: // Depend on the clock or on TZ, which may be assigned to
+			return FALSE;
+		case FUNC_CLASS_ARITHMETIC:
+		case FUNC_CLASS_MATH:
+			break;
+		default:
+			if (has_float_args) // Formatted using --ofmt
+				return FALSE;
+			break;
+		}
+		if (streq(function_name, "=~") || streq(function_name, "!=~")) // Set the regex captures
+			return FALSE;
+		if (strncmp(function_name, "urand", 5) == 0)
+			return FALSE;
+		if (strncmp(function_name, "asserting_", 10) == 0) // Exit the process on failure
+			return FALSE;
+		return TRUE;
+	}
+}
+
+// ----------------------------------------------------------------
+int fmgr_function_is_builtin(fmgr_t* pfmgr, char* function_name) {
+	for (int i = 0; ; i++) {
+		function_lookup_t* plookup = &pfmgr->function_lookup_table[i];
+		if (plookup->function_name == NULL)
+			return FALSE;
+		if (streq(plookup->function_name, function_name))
+			return TRUE;
+	}
+}
+
 // ================================================================
 static function_lookup_t FUNCTION_LOOKUP_TABLE[] = {
 
@@ -257,6 +301,21 @@ static function_lookup_t FUNCTION_LOOKUP_TABLE[] = {
 	{FUNC_CLASS_MATH, "exp",      1,0, "Exponential function e**x."},
 	{FUNC_CLASS_MATH, "expm1",    1,0, "e**x - 1."},
 	{FUNC_CLASS_MATH, "floor",    1,0, "Floor: nearest integer at or below."},
+	{FUNC_CLASS_MATH, "hll_add",  2,0,
+		"Adds a value to a HyperLogLog sketch for approximate\n"
+		"distinct counting, returning the new sketch. An absent or empty sketch is a new\n"
+		"one of precision 12, e.g. '@users[$day] = hll_add(@users[$day], $user)'."},
+	{FUNC_CLASS_MATH, "hll_estimate", 1,0,
+		"Estimated number of distinct values added to a\n"
+		"HyperLogLog sketch, e.g. 'end {for (k, v in @users) {print k . \" \" . hll_estimate(v)}}'."},
+	{FUNC_CLASS_MATH, "hll_init", 1,0,
+		"Empty HyperLogLog sketch of the given precision, from 4\n"
+		"to 18. The sketch is 2**precision characters long and its relative standard\n"
+		"error is about 1.04/sqrt(2**precision)."},
+	{FUNC_CLASS_MATH, "hll_merge", 2,0,
+		"Merges two HyperLogLog sketches, e.g. from separate runs\n"
+		"or groups. The result estimates the number of distinct values in the union.\n"
+		"Sketches of different precisions merge at the lower one."},
 	// See also http://johnkerl.org/doc/randuv.pdf for more about urand() -> other distributions
 	{FUNC_CLASS_MATH, "invqnorm", 1,0,
 		"Inverse of normal cumulative distribution\n"
@@ -300,6 +359,9 @@ static function_lookup_t FUNCTION_LOOKUP_TABLE[] = {
 	{FUNC_CLASS_TIME, "gmt2sec",   1,0, "Parses GMT timestamp as integer seconds since\nthe epoch."},
 	{FUNC_CLASS_TIME, "localtime2sec", 1,0, "Parses local timestamp as integer seconds since\n"
 		"the epoch. Consults $TZ environment variable."},
+	{FUNC_CLASS_TIME, "localtime2sec", 2,0, "Parses local timestamp as integer seconds since\n"
+		"the epoch, in the time zone given as second argument, e.g.\n"
+		"localtime2sec(\"2001-02-03 04:05:06\", \"Asia/Istanbul\") = 981165906."},
 
 	{FUNC_CLASS_TIME, "hms2fsec",  1,0,
 		"Recovers floating-point seconds as in\nhms2fsec(\"01:23:20.250000\") = 5000.250000"},
@@ -326,10 +388,20 @@ static function_lookup_t FUNCTION_LOOKUP_TABLE[] = {
 		"Formats seconds since epoch as local timestamp with n\n"
 		"decimal places for seconds, e.g. sec2localtime(1440768801.7,1) = \"2015-08-28T13:33:21.7Z\".\n"
 		"Consults $TZ environment variable. Leaves non-numbers as-is."},
+	{FUNC_CLASS_TIME, "sec2localtime",   3,0,
+		"Formats seconds since epoch as local timestamp with n\n"
+		"decimal places for seconds, in the time zone given as third argument, e.g.\n"
+		"sec2localtime(1500000000, 0, \"Asia/Istanbul\") = \"2017-07-14 05:40:00\".\n"
+		"Leaves non-numbers as-is."},
 	{FUNC_CLASS_TIME, "sec2localdate", 1,0,
 		"Formats seconds since epoch (integer part)\n"
 		"as local timestamp with year-month-date, e.g. sec2localdate(1440768801.7) = \"2015-08-28\".\n"
 		"Consults $TZ environment variable. Leaves non-numbers as-is."},
+	{FUNC_CLASS_TIME, "sec2localdate", 2,0,
+		"Formats seconds since epoch (integer part)\n"
+		"as local timestamp with year-month-date, in the time zone given as second argument, e.g.\n"
+		"sec2localdate(1500000000, \"Asia/Istanbul\") = \"2017-07-14\".\n"
+		"Leaves non-numbers as-is."},
 
 	{FUNC_CLASS_TIME, "sec2hms",   1,0,
 		"Formats integer seconds as in\n"
@@ -344,6 +416,9 @@ static function_lookup_t FUNCTION_LOOKUP_TABLE[] = {
 		"See also strftime_local."},
 	{FUNC_CLASS_TIME, "strftime_local",  2,0,
 		"Like strftime but consults the $TZ environment variable to get local time zone."},
+	{FUNC_CLASS_TIME, "strftime_local",  3,0,
+		"Like strftime but uses the time zone given as third argument, e.g.\n"
+		"strftime_local(1500000000, \"%Y-%m-%d %H:%M:%S %Z\", \"Asia/Istanbul\") = \"2017-07-14 05:40:00 +03\"."},
 	{FUNC_CLASS_TIME, "strptime",  2,0,
 		"Parses timestamp as floating-point seconds since the epoch,\n"
 		"e.g. strptime(\"2015-08-28T13:33:21Z\",\"%Y-%m-%dT%H:%M:%SZ\") = 1440768801.000000,\n"
@@ -351,6 +426,9 @@ static function_lookup_t FUNCTION_LOOKUP_TABLE[] = {
 		"See also strptime_local."},
 	{FUNC_CLASS_TIME, "strptime_local",  2,0,
 		"Like strptime, but consults $TZ environment variable to find and use local timezone."},
+	{FUNC_CLASS_TIME, "strptime_local",  3,0,
+		"Like strptime, but uses the time zone given as third argument, e.g.\n"
+		"strptime_local(\"2017-07-14 05:40:00\", \"%Y-%m-%d %H:%M:%S\", \"Asia/Istanbul\") = 1500000000."},
 	{FUNC_CLASS_TIME, "systime",   0,0,
 		"Floating-point seconds since the epoch,\n"
 		"e.g. 1440768801.748936." },
@@ -493,9 +571,17 @@ static void fmgr_check_arity_with_report(fmgr_t* pfmgr, char* function_name,
 		// More flexibly, I'd have a list of arities supported by each
 		// function. But this is overkill: there are unary and binary minus and sec2gmt,
 		// and everything else has a single arity.
-		if (streq(function_name, "-") || streq(function_name, "sec2gmt") || streq(function_name, "sec2localtime")) {
+		if (streq(function_name, "-") || streq(function_name, "sec2gmt")
+			|| streq(function_name, "sec2localdate") || streq(function_name, "localtime2sec"))
+		{
 			fprintf(stderr, "%s: Function named \"%s\" takes one argument or two; got %d.\n",
 				MLR_GLOBALS.bargv0, function_name, user_provided_arity);
+		} else if (streq(function_name, "sec2localtime")) {
+			fprintf(stderr, "%s: Function named \"%s\" takes one, two, or three arguments; got %d.\n",
+				MLR_GLOBALS.bargv0, function_name, user_provided_arity);
+		} else if (streq(function_name, "strftime_local") || streq(function_name, "strptime_local")) {
+			fprintf(stderr, "%s: Function named \"%s\" takes two arguments or three; got %d.\n",
+				MLR_GLOBALS.bargv0, function_name, user_provided_arity);
 		} else if (*pvariadic) {
 			fprintf(stderr, "%s: Function named \"%s\" takes at least %d argument%s; got %d.\n",
 				MLR_GLOBALS.bargv0, function_name, arity, (arity == 1) ? "" : "s", user_provided_arity);
@@ -968,8 +1054,8 @@ static rval_evaluator_t* construct_builtin_function_callsite_evaluator(
 				TYPE_INFER_STRING_FLOAT_INT);
 		} else {
 			// regexes can still be applied here, e.g. if the 2nd argument is a non-terminal AST: however
-			// the regexes will be compiled record-by-record rather than once at alloc time, which will
-			// be slower.
+			// the regexes will be compiled when first seen rather than once at alloc time. The most
+			// recently used few are kept compiled: see regex_cache_get.
 			rval_evaluator_t* parg1 = rval_evaluator_alloc_from_ast(parg1_node, pfmgr, type_inferencing, context_flags);
 			rval_evaluator_t* parg2 = rval_evaluator_alloc_from_ast(parg2_node, pfmgr, type_inferencing, context_flags);
 			pevaluator = fmgr_alloc_evaluator_from_binary_func_name(function_name, parg1, parg2);
@@ -997,8 +1083,8 @@ static rval_evaluator_t* construct_builtin_function_callsite_evaluator(
 
 		} else {
 			// regexes can still be applied here, e.g. if the 2nd argument is a non-terminal AST: however
-			// the regexes will be compiled record-by-record rather than once at alloc time, which will
-			// be slower.
+			// the regexes will be compiled when first seen rather than once at alloc time. The most
+			// recently used few are kept compiled: see regex_cache_get.
 			rval_evaluator_t* parg1 = rval_evaluator_alloc_from_ast(parg1_node, pfmgr, type_inferencing, context_flags);
 			rval_evaluator_t* parg2 = rval_evaluator_alloc_from_ast(parg2_node, pfmgr, type_inferencing, context_flags);
 			rval_evaluator_t* parg3 = rval_evaluator_alloc_from_ast(parg3_node, pfmgr, type_inferencing, context_flags);
@@ -1155,6 +1241,8 @@ static rval_evaluator_t* fmgr_alloc_evaluator_from_unary_func_name(char* fnnm, r
 	} else if (streq(fnnm, "expm1"))           { return rval_evaluator_alloc_from_f_f_func(f_f_expm1_func,       parg1);
 	} else if (streq(fnnm, "float"))           { return rval_evaluator_alloc_from_x_x_func(f_x_float_func,       parg1);
 	} else if (streq(fnnm, "floor"))           { return rval_evaluator_alloc_from_x_x_func(x_x_floor_func,       parg1);
+	} else if (streq(fnnm, "hll_estimate"))    { return rval_evaluator_alloc_from_x_x_func(i_x_hll_estimate_func, parg1);
+	} else if (streq(fnnm, "hll_init"))        { return rval_evaluator_alloc_from_i_i_func(s_i_hll_init_func,    parg1);
 	} else if (streq(fnnm, "fsec2dhms"))       { return rval_evaluator_alloc_from_s_f_func(s_f_fsec2dhms_func,   parg1);
 	} else if (streq(fnnm, "fsec2hms"))        { return rval_evaluator_alloc_from_s_f_func(s_f_fsec2hms_func,    parg1);
 	} else if (streq(fnnm, "gmt2sec"))         { return rval_evaluator_alloc_from_i_s_func(i_s_gmt2sec_func,     parg1);
@@ -1225,10 +1313,14 @@ static rval_evaluator_t* fmgr_alloc_evaluator_from_binary_func_name(char* fnnm,
 	} else if (streq(fnnm, "pow"))  { return rval_evaluator_alloc_from_f_ff_func(f_ff_pow_func,          parg1, parg2);
 	} else if (streq(fnnm, "atan2")){ return rval_evaluator_alloc_from_f_ff_func(f_ff_atan2_func,        parg1, parg2);
 	} else if (streq(fnnm, "roundm")) { return rval_evaluator_alloc_from_x_xx_func(x_xx_roundm_func,     parg1, parg2);
+	} else if (streq(fnnm, "hll_add")) { return rval_evaluator_alloc_from_x_xx_func(s_xx_hll_add_func,   parg1, parg2);
+	} else if (streq(fnnm, "hll_merge")) { return rval_evaluator_alloc_from_x_xx_func(s_xx_hll_merge_func, parg1, parg2);
 	} else if (streq(fnnm, "fmtnum")) { return rval_evaluator_alloc_from_s_xs_func(s_xs_fmtnum_func,     parg1, parg2);
 	} else if (streq(fnnm, "urandint")) { return rval_evaluator_alloc_from_i_ii_func(i_ii_urandint_func, parg1, parg2);
 	} else if (streq(fnnm, "sec2gmt"))  { return rval_evaluator_alloc_from_x_xi_func(s_xi_sec2gmt_func,  parg1, parg2);
 	} else if (streq(fnnm, "sec2localtime")) { return rval_evaluator_alloc_from_x_xi_func(s_xi_sec2localtime_func, parg1, parg2);
+	} else if (streq(fnnm, "sec2localdate")) { return rval_evaluator_alloc_from_s_xs_func(s_xs_sec2localdate_func, parg1, parg2);
+	} else if (streq(fnnm, "localtime2sec")) { return rval_evaluator_alloc_from_x_ss_func(i_ss_localtime2sec_func, parg1, parg2);
 	} else if (streq(fnnm, "&"))    { return rval_evaluator_alloc_from_x_xx_func(x_xx_band_func,         parg1, parg2);
 	} else if (streq(fnnm, "|"))    { return rval_evaluator_alloc_from_x_xx_func(x_xx_bor_func,          parg1, parg2);
 	} else if (streq(fnnm, "^"))    { return rval_evaluator_alloc_from_x_xx_func(x_xx_bxor_func,         parg1, parg2);
@@ -1256,9 +1348,9 @@ static rval_evaluator_t* fmgr_alloc_evaluator_from_ternary_func_name(char* fnnm,
 	rval_evaluator_t* parg1, rval_evaluator_t* parg2, rval_evaluator_t* parg3)
 {
 	if (streq(fnnm, "sub")) {
-		return rval_evaluator_alloc_from_s_sss_func(sub_no_precomp_func,  parg1, parg2, parg3);
+		return rval_evaluator_alloc_from_s_sss_regex_cache_func(sub_no_precomp_func,  parg1, parg2, parg3);
 	} else if (streq(fnnm, "gsub")) {
-		return rval_evaluator_alloc_from_s_sss_func(gsub_no_precomp_func, parg1, parg2, parg3);
+		return rval_evaluator_alloc_from_s_sss_regex_cache_func(gsub_no_precomp_func, parg1, parg2, parg3);
 	} else if (streq(fnnm, "ssub")) {
 		return rval_evaluator_alloc_from_s_sss_func(s_sss_ssub_func,      parg1, parg2, parg3);
 	} else if (streq(fnnm, "logifit")) {
@@ -1273,6 +1365,12 @@ static rval_evaluator_t* fmgr_alloc_evaluator_from_ternary_func_name(char* fnnm,
 		return rval_evaluator_alloc_from_i_iii_func(i_iii_modexp_func,    parg1, parg2, parg3);
 	} else if (streq(fnnm, "substr")) {
 		return rval_evaluator_alloc_from_s_sii_func(s_sii_substr_func,    parg1, parg2, parg3);
+	} else if (streq(fnnm, "sec2localtime")) {
+		return rval_evaluator_alloc_from_x_xis_func(s_xis_sec2localtime_func, parg1, parg2, parg3);
+	} else if (streq(fnnm, "strftime_local")) {
+		return rval_evaluator_alloc_from_x_nss_func(s_nss_strftime_local_func, parg1, parg2, parg3);
+	} else if (streq(fnnm, "strptime_local")) {
+		return rval_evaluator_alloc_from_s_sss_func(i_sss_strptime_local_func, parg1, parg2, parg3);
 	} else if (streq(fnnm, "? :")) {
 		return rval_evaluator_alloc_from_ternop(parg1, parg2, parg3);
 	} else  { return NULL; }
@@ -38,6 +38,8 @@ typedef struct _fmgr_t {
 	// has been defined).
 	sllv_t* pfunc_callsite_evaluators_to_resolve;  // return value in scalar context
 	sllv_t* pfunc_callsite_xevaluators_to_resolve; // return value in map context
+	// Whether operator expressions are compiled to bytecode. See rval_bytecode_evaluators.c.
+	int compile_to_bytecode;
 } fmgr_t;
 
 // ----------------------------------------------------------------
@@ -47,6 +49,15 @@ void fmgr_free(fmgr_t* pfmgr, context_t* pctx);
 
 void fmgr_install_udf(fmgr_t* pfmgr, udf_defsite_state_t* pdefsitate_state);
 
+// True for built-in functions whose return values depend only on their arguments, e.g. strlen but not
+// urand or systime, and which have no side effects. Calls to these with literal arguments can be
+// evaluated once, at startup. Float arguments are formatted as strings using --ofmt, which isn't known
+// until the record writers are set up, so with float arguments only arithmetic and math functions qualify.
+int fmgr_function_is_foldable(fmgr_t* pfmgr, char* function_name, int has_float_args);
+
+// True for built-in functions, as opposed to user-defined ones.
+int fmgr_function_is_builtin(fmgr_t* pfmgr, char* function_name);
+
 // Callsites as defined by AST nodes, with scalar-context return values
 rval_evaluator_t* fmgr_alloc_provisional_from_operator_or_function_call(fmgr_t* pfmgr, mlr_dsl_ast_node_t* pnode,
 	int type_inferencing, int context_flags);
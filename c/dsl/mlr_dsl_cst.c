@@ -56,7 +56,7 @@ static void mlr_dsl_cst_resolve_subr_callsites(mlr_dsl_cst_t* pcst);
 //                 text="6", type=numeric_literal.
 
 mlr_dsl_cst_t* mlr_dsl_cst_alloc(mlr_dsl_ast_t* past, int print_ast, int trace_stack_allocation,
-	int type_inferencing, int flush_every_record,
+	int type_inferencing, int compile_to_bytecode, int flush_every_record,
 	int do_final_filter, int negate_final_filter) // for mlr filter
 {
 	int context_flags = do_final_filter ? IN_MLR_FILTER : 0;
@@ -78,6 +78,7 @@ mlr_dsl_cst_t* mlr_dsl_cst_alloc(mlr_dsl_ast_t* past, int print_ast, int trace_s
 	blocked_ast_allocate_locals(pcst->paast, trace_stack_allocation);
 
 	pcst->pfmgr          = fmgr_alloc();
+	pcst->pfmgr->compile_to_bytecode = compile_to_bytecode;
 	pcst->psubr_defsites = lhmsv_alloc();
 	pcst->psubr_callsite_statements_to_resolve = sllv_alloc();
 	pcst->flush_every_record = flush_every_record;
@@ -94,6 +95,7 @@ mlr_dsl_cst_t* mlr_dsl_cst_alloc(mlr_dsl_ast_t* past, int print_ast, int trace_s
 			printf("FUNCTION DEFINITION:\n");
 			mlr_dsl_ast_node_print(pnode);
 		}
+		mlr_dsl_ast_fold_constants(pnode);
 		udf_defsite_state_t* pudf_defsite_state = mlr_dsl_cst_alloc_udf(pcst, pnode,
 			type_inferencing, context_flags);
 		fmgr_install_udf(pcst->pfmgr, pudf_defsite_state);
@@ -106,6 +108,7 @@ mlr_dsl_cst_t* mlr_dsl_cst_alloc(mlr_dsl_ast_t* past, int print_ast, int trace_s
 			printf("SUBROUTINE DEFINITION:\n");
 			mlr_dsl_ast_node_print(pnode);
 		}
+		mlr_dsl_ast_fold_constants(pnode);
 		subr_defsite_t* psubr_defsite = mlr_dsl_cst_alloc_subroutine(pcst, pnode, type_inferencing, context_flags);
 		if (lhmsv_get(pcst->psubr_defsites, psubr_defsite->name)) {
 			fprintf(stderr, "%s: subroutine named \"%s\" has already been defined.\n",
@@ -123,6 +126,7 @@ mlr_dsl_cst_t* mlr_dsl_cst_alloc(mlr_dsl_ast_t* past, int print_ast, int trace_s
 			printf("BEGIN-BLOCK:\n");
 			mlr_dsl_ast_node_print(pnode);
 		}
+		mlr_dsl_ast_fold_constants(pnode);
 		MLR_INTERNAL_CODING_ERROR_IF(pnode->max_var_depth == MD_UNUSED_INDEX);
 		MLR_INTERNAL_CODING_ERROR_IF(pnode->subframe_var_count == MD_UNUSED_INDEX);
 		cst_top_level_statement_block_t* pblock = cst_top_level_statement_block_alloc(pnode->max_var_depth,
@@ -146,6 +150,7 @@ mlr_dsl_cst_t* mlr_dsl_cst_alloc(mlr_dsl_ast_t* past, int print_ast, int trace_s
 			printf("END-BLOCK:\n");
 			mlr_dsl_ast_node_print(pnode);
 		}
+		mlr_dsl_ast_fold_constants(pnode);
 		MLR_INTERNAL_CODING_ERROR_IF(pnode->max_var_depth == MD_UNUSED_INDEX);
 		MLR_INTERNAL_CODING_ERROR_IF(pnode->subframe_var_count == MD_UNUSED_INDEX);
 		cst_top_level_statement_block_t* pblock = cst_top_level_statement_block_alloc(pnode->max_var_depth,
@@ -166,6 +171,7 @@ mlr_dsl_cst_t* mlr_dsl_cst_alloc(mlr_dsl_ast_t* past, int print_ast, int trace_s
 		printf("MAIN BLOCK:\n");
 		mlr_dsl_ast_node_print(pcst->paast->pmain_block);
 	}
+	mlr_dsl_ast_fold_constants(pcst->paast->pmain_block);
 	MLR_INTERNAL_CODING_ERROR_IF(pcst->paast->pmain_block->max_var_depth == MD_UNUSED_INDEX);
 	MLR_INTERNAL_CODING_ERROR_IF(pcst->paast->pmain_block->subframe_var_count == MD_UNUSED_INDEX);
 	pcst->pmain_block = cst_top_level_statement_block_alloc(pcst->paast->pmain_block->max_var_depth,
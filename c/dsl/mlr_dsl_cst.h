@@ -60,6 +60,19 @@
 // before the CST is build (mlr_dsl_stack_allocate.c).
 void blocked_ast_allocate_locals(blocked_ast_t* paast, int trace);
 
+// ----------------------------------------------------------------
+// dsl/mlr_dsl_fold_constants.c
+// Replaces constant subexpressions, e.g. 2 ** 20, by literals. This operates on
+// each part of the block-structured AST just before the CST is built from it.
+void mlr_dsl_ast_fold_constants(mlr_dsl_ast_node_t* pnode);
+
+// ----------------------------------------------------------------
+// dsl/mlr_dsl_record_local.c
+// Returns TRUE if the expression reads and writes nothing but the current
+// record and its context, so that records may be evaluated independently of
+// one another. This operates on the raw AST, before the CST is built from it.
+int mlr_dsl_ast_is_record_local(mlr_dsl_ast_t* past);
+
 // ----------------------------------------------------------------
 // Forward references for virtual-function prototypes
 struct _mlr_dsl_cst_t;
@@ -202,10 +215,12 @@ typedef struct _mlr_dsl_cst_t {
 // Notes:
 // * do_final_filter is FALSE for mlr put, TRUE for mlr filter.
 // * negate_final_filter is TRUE for mlr filter -x.
+// * compile_to_bytecode is FALSE for mlr put/filter --no-bytecode.
 // * The CST object strips nodes off the raw AST, constructed by the Lemon parser, in order
 //   to do analysis on it. Nonetheless the caller should free what's left.
 mlr_dsl_cst_t* mlr_dsl_cst_alloc(mlr_dsl_ast_t* past, int print_ast, int trace_stack_allocation,
-	int type_inferencing, int flush_every_record, int do_final_filter, int negate_final_filter);
+	int type_inferencing, int compile_to_bytecode, int flush_every_record, int do_final_filter,
+	int negate_final_filter);
 
 mlr_dsl_cst_statement_t* mlr_dsl_cst_alloc_statement(mlr_dsl_cst_t* pcst, mlr_dsl_ast_node_t* pnode,
 	int type_inferencing, int context_flags);
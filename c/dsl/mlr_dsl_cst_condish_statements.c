@@ -11,6 +11,16 @@ typedef struct _conditional_block_state_t {
 
 static mlr_dsl_cst_statement_freer_t free_conditional_block;
 static mlr_dsl_cst_statement_handler_t handle_conditional_block;
+static mlr_dsl_cst_statement_handler_t handle_conditional_block_unconditionally;
+static mlr_dsl_cst_statement_handler_t handle_conditional_block_nop;
+
+// After constant folding (see mlr_dsl_fold_constants.c), conditions may be literal booleans. The blocks they guard
+// are still built, so that errors within them are reported as before, but the conditions aren't evaluated per
+// record, and blocks which can never run aren't visited.
+static int is_literal_boolean(mlr_dsl_ast_node_t* pnode, int boolv) {
+	return pnode != NULL && pnode->type == MD_AST_NODE_TYPE_BOOLEAN_LITERAL
+		&& streq(pnode->text, boolv ? "true" : "false");
+}
 
 // ----------------------------------------------------------------
 mlr_dsl_cst_statement_t* alloc_conditional_block(mlr_dsl_cst_t* pcst, mlr_dsl_ast_node_t* pnode,
@@ -41,9 +51,15 @@ mlr_dsl_cst_statement_t* alloc_conditional_block(mlr_dsl_cst_t* pcst, mlr_dsl_as
 		? mlr_dsl_cst_handle_statement_block_with_break_continue
 		: mlr_dsl_cst_handle_statement_block;
 
+	mlr_dsl_cst_statement_handler_t* pstatement_handler = handle_conditional_block;
+	if (is_literal_boolean(pleft, TRUE))
+		pstatement_handler = handle_conditional_block_unconditionally;
+	else if (is_literal_boolean(pleft, FALSE))
+		pstatement_handler = handle_conditional_block_nop;
+
 	return mlr_dsl_cst_statement_valloc_with_block(
 		pnode,
-		handle_conditional_block,
+		pstatement_handler,
 		pblock,
 		pblock_handler,
 		free_conditional_block,
@@ -83,9 +99,30 @@ static void handle_conditional_block(
 	local_stack_subframe_exit(pframe, pstatement->pblock->subframe_var_count);
 }
 
+static void handle_conditional_block_unconditionally(
+	mlr_dsl_cst_statement_t* pstatement,
+	variables_t*             pvars,
+	cst_outputs_t*           pcst_outputs)
+{
+	local_stack_frame_t* pframe = local_stack_get_top_frame(pvars->plocal_stack);
+	local_stack_subframe_enter(pframe, pstatement->pblock->subframe_var_count);
+	pstatement->pblock_handler(pstatement->pblock, pvars, pcst_outputs);
+	local_stack_subframe_exit(pframe, pstatement->pblock->subframe_var_count);
+}
+
+static void handle_conditional_block_nop(
+	mlr_dsl_cst_statement_t* pstatement,
+	variables_t*             pvars,
+	cst_outputs_t*           pcst_outputs)
+{
+}
+
 // ================================================================
 typedef struct _if_head_state_t {
 	sllv_t* pif_chain_statements;
+	// Those items which can run, i.e. not those with literal-false conditions, nor those after one with a
+	// literal-true condition. Pointers into pif_chain_statements, which owns them.
+	sllv_t* plive_chain_statements;
 } if_head_state_t;
 
 typedef struct _if_item_state_t {
@@ -157,6 +194,8 @@ mlr_dsl_cst_statement_t* alloc_if_head(mlr_dsl_cst_t* pcst, mlr_dsl_ast_node_t*
 	if_head_state_t* pstate = mlr_malloc_or_die(sizeof(if_head_state_t));
 
 	pstate->pif_chain_statements = sllv_alloc();
+	pstate->plive_chain_statements = sllv_alloc();
+	int reachable = TRUE;
 
 	for (sllve_t* pe = pnode->pchildren->phead; pe != NULL; pe = pe->pnext) {
 		// For if and elif:
@@ -175,9 +214,14 @@ mlr_dsl_cst_statement_t* alloc_if_head(mlr_dsl_cst_t* pcst, mlr_dsl_ast_node_t*
 			plistnode = pitemnode->pchildren->phead->pvvalue;
 		}
 
-		sllv_append(pstate->pif_chain_statements,
-			alloc_if_item(pcst, pitemnode, pexprnode, plistnode, type_inferencing, context_flags)
-		);
+		mlr_dsl_cst_statement_t* pitem_statement = alloc_if_item(pcst, pitemnode, pexprnode, plistnode,
+			type_inferencing, context_flags);
+		sllv_append(pstate->pif_chain_statements, pitem_statement);
+
+		if (reachable && !is_literal_boolean(pexprnode, FALSE))
+			sllv_append(pstate->plive_chain_statements, pitem_statement);
+		if (pexprnode == NULL || is_literal_boolean(pexprnode, TRUE))
+			reachable = FALSE;
 	}
 
 	mlr_dsl_cst_block_handler_t* pblock_handler = (context_flags & IN_BREAKABLE)
@@ -232,6 +276,7 @@ static void free_if_head(mlr_dsl_cst_statement_t* pstatement, context_t* pctx) {
 			mlr_dsl_cst_statement_free(pe->pvvalue, pctx);
 		sllv_free(pstate->pif_chain_statements);
 	}
+	sllv_free(pstate->plive_chain_statements);
 
 	free(pstate);
 }
@@ -252,7 +297,7 @@ static void handle_if_head(
 {
 	if_head_state_t* pstate = pstatement->pvstate;
 
-	for (sllve_t* pe = pstate->pif_chain_statements->phead; pe != NULL; pe = pe->pnext) {
+	for (sllve_t* pe = pstate->plive_chain_statements->phead; pe != NULL; pe = pe->pnext) {
 		mlr_dsl_cst_statement_t* pitem_statement = pe->pvvalue;
 		if_item_state_t* pitem_state = pitem_statement->pvstate;
 		rval_evaluator_t* pexpression_evaluator = pitem_state->pexpression_evaluator;
@@ -279,6 +324,7 @@ typedef struct _while_state_t {
 } while_state_t;
 
 static mlr_dsl_cst_statement_handler_t handle_while;
+static mlr_dsl_cst_statement_handler_t handle_while_nop;
 static mlr_dsl_cst_statement_freer_t free_while;
 
 // ----------------------------------------------------------------
@@ -309,7 +355,7 @@ mlr_dsl_cst_statement_t* alloc_while(mlr_dsl_cst_t* pcst, mlr_dsl_ast_node_t* pn
 
 	return mlr_dsl_cst_statement_valloc_with_block(
 		pnode,
-		handle_while,
+		is_literal_boolean(pleft, FALSE) ? handle_while_nop : handle_while,
 		pblock,
 		mlr_dsl_cst_handle_statement_block_with_break_continue,
 		free_while,
@@ -363,6 +409,13 @@ static void handle_while(
 	local_stack_subframe_exit(pframe, pstatement->pblock->subframe_var_count);
 }
 
+static void handle_while_nop(
+	mlr_dsl_cst_statement_t* pstatement,
+	variables_t*             pvars,
+	cst_outputs_t*           pcst_outputs)
+{
+}
+
 
 // ================================================================
 typedef struct _do_while_state_t {
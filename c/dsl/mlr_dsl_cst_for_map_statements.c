@@ -14,6 +14,18 @@ static void handle_for_map_aux(
 	int*                     prest_for_k_type_masks,
 	int                      prest_for_k_count);
 
+static int for_body_may_modify_target(mlr_dsl_cst_t* pcst, mlr_dsl_ast_node_t* pnode);
+
+// ----------------------------------------------------------------
+// Loop variables are bound to keys and terminal values of the map being looped over without copying
+// them: the map is either ephemeral, or a copy, or known to be unmodified by the loop body, and so
+// outlives them. Assignment from a loop variable copies as from any other.
+static inline mv_t mv_borrow(mv_t* pval) {
+	mv_t rv = *pval;
+	rv.free_flags = NO_FREE;
+	return rv;
+}
+
 // ================================================================
 typedef struct _for_map_state_t {
 	char** k_variable_names;
@@ -26,6 +38,7 @@ typedef struct _for_map_state_t {
 	int    v_type_mask;
 
 	rxval_evaluator_t* ptarget_xevaluator;
+	int                body_may_modify_target;
 } for_map_state_t;
 
 static mlr_dsl_cst_statement_handler_t handle_for_map;
@@ -100,6 +113,7 @@ mlr_dsl_cst_statement_t* alloc_for_map(mlr_dsl_cst_t* pcst, mlr_dsl_ast_node_t*
 
 	pstate->ptarget_xevaluator = rxval_evaluator_alloc_from_ast(
 		pmiddle, pcst->pfmgr, type_inferencing, context_flags);
+	pstate->body_may_modify_target = for_body_may_modify_target(pcst, pnode);
 
 	MLR_INTERNAL_CODING_ERROR_IF(pnode->subframe_var_count == MD_UNUSED_INDEX);
 	cst_statement_block_t* pblock = cst_statement_block_alloc(pnode->subframe_var_count);
@@ -149,12 +163,13 @@ static void handle_for_map(
 
 	if (!boxed_xval.xval.is_terminal) { // is a map
 
-		// Copy the map for the very likely case that it is being updated inside the for-loop.
-		// But ephemerals (map-literals, function return values) aren't named and so can't
-		// be modified and so don't need to be copied.
+		// Copy the map if it may be updated inside the for-loop. Ephemerals (map-literals,
+		// function return values) aren't named and so can't be modified and so don't need
+		// to be copied; nor do maps which the loop body doesn't assign to or unset.
 		mlhmmv_xvalue_t* pmap = &boxed_xval.xval;
 		mlhmmv_xvalue_t  copy;
-		if (!boxed_xval.is_ephemeral) {
+		int do_copy = !boxed_xval.is_ephemeral && pstate->body_may_modify_target;
+		if (do_copy) {
 			copy = mlhmmv_xvalue_copy(&boxed_xval.xval);
 			pmap = &copy;
 		}
@@ -181,12 +196,13 @@ static void handle_for_map(
 			}
 		}
 
-		if (!boxed_xval.is_ephemeral) {
-			mlhmmv_xvalue_free(&copy);
-		}
-
+		// Unbind the loop variables before freeing what they point into.
 		loop_stack_pop(pvars->ploop_stack);
 		local_stack_subframe_exit(pframe, pstatement->pblock->subframe_var_count);
+
+		if (do_copy) {
+			mlhmmv_xvalue_free(&copy);
+		}
 	}
 
 	if (boxed_xval.is_ephemeral) {
@@ -215,10 +231,9 @@ static void handle_for_map_aux(
 			for (mlhmmv_level_entry_t* pe = psubmap->pnext_level->phead; pe != NULL; pe = pe->pnext) {
 				// Bind the k-name to the entry-key mlrval:
 				local_stack_frame_t* pframe = local_stack_get_top_frame(pvars->plocal_stack);
-				// xxx note copy/ref semantics
 				local_stack_frame_define_terminal(pframe, prest_for_k_variable_names[0],
 					prest_for_k_frame_relative_indices[0], prest_for_k_type_masks[0],
-					mv_copy(&pe->level_key));
+					mv_borrow(&pe->level_key));
 				// Recurse into the next-level submap:
 				handle_for_map_aux(pstatement, pvars, pcst_outputs, &pe->level_xvalue,
 					&prest_for_k_variable_names[1], &prest_for_k_frame_relative_indices[1], &prest_for_k_type_masks[1],
@@ -238,9 +253,11 @@ static void handle_for_map_aux(
 
 		// Bind the v-name to the terminal mlrval:
 		local_stack_frame_t* pframe = local_stack_get_top_frame(pvars->plocal_stack);
-		// xxx note copy/ref semantics
+		// Submaps are copied since the local owns its map.
 		local_stack_frame_define_extended(pframe, pstate->v_variable_name, pstate->v_frame_relative_index,
-			pstate->v_type_mask, mlhmmv_xvalue_copy(psubmap));
+			pstate->v_type_mask, psubmap->is_terminal
+				? mlhmmv_xvalue_wrap_terminal(mv_borrow(&psubmap->terminal_mlrval))
+				: mlhmmv_xvalue_copy(psubmap));
 		// Execute the loop-body statements:
 		pstatement->pblock_handler(pstatement->pblock, pvars, pcst_outputs);
 
@@ -254,6 +271,7 @@ typedef struct _for_map_key_only_state_t {
 	int   k_type_mask;
 
 	rxval_evaluator_t* ptarget_xevaluator;
+	int                body_may_modify_target;
 } for_map_key_only_state_t;
 
 static mlr_dsl_cst_statement_handler_t handle_for_map_key_only;
@@ -285,6 +303,7 @@ mlr_dsl_cst_statement_t* alloc_for_map_key_only(mlr_dsl_cst_t* pcst, mlr_dsl_ast
 
 	pstate->ptarget_xevaluator = rxval_evaluator_alloc_from_ast(
 		pmiddle, pcst->pfmgr, type_inferencing, context_flags);
+	pstate->body_may_modify_target = for_body_may_modify_target(pcst, pnode);
 
 	MLR_INTERNAL_CODING_ERROR_IF(pnode->subframe_var_count == MD_UNUSED_INDEX);
 	cst_statement_block_t* pblock = cst_statement_block_alloc(pnode->subframe_var_count);
@@ -329,12 +348,13 @@ static void handle_for_map_key_only(
 
 	if (!boxed_xval.xval.is_terminal) { // is a map
 
-		// Copy the map for the very likely case that it is being updated inside the for-loop.
-		// But ephemerals (map-literals, function return values) aren't named and so can't
-		// be modified and so don't need to be copied.
+		// Copy the map if it may be updated inside the for-loop. Ephemerals (map-literals,
+		// function return values) aren't named and so can't be modified and so don't need
+		// to be copied; nor do maps which the loop body doesn't assign to or unset.
 		mlhmmv_xvalue_t* pmap = &boxed_xval.xval;
 		mlhmmv_xvalue_t  copy;
-		if (!boxed_xval.is_ephemeral) {
+		int do_copy = !boxed_xval.is_ephemeral && pstate->body_may_modify_target;
+		if (do_copy) {
 			copy = mlhmmv_xvalue_copy(&boxed_xval.xval);
 			pmap = &copy;
 		}
@@ -343,13 +363,12 @@ static void handle_for_map_key_only(
 		local_stack_subframe_enter(pframe, pstatement->pblock->subframe_var_count);
 		loop_stack_push(pvars->ploop_stack);
 
-		sllv_t* pkeys = mlhmmv_xvalue_copy_keys_nonindexed(pmap);
-
-		for (sllve_t* pe = pkeys->phead; pe != NULL; pe = pe->pnext) {
+		mlhmmv_level_entry_t* phead = (pmap->pnext_level == NULL) ? NULL : pmap->pnext_level->phead;
+		for (mlhmmv_level_entry_t* pe = phead; pe != NULL; pe = pe->pnext) {
 			// Bind the k-name to the current key:
 			local_stack_frame_define_terminal(pframe,
 				pstate->k_variable_name, pstate->k_frame_relative_index,
-				pstate->k_type_mask, mv_copy(pe->pvvalue));
+				pstate->k_type_mask, mv_borrow(&pe->level_key));
 
 			// Execute the loop-body statements:
 			pstatement->pblock_handler(pstatement->pblock, pvars, pcst_outputs);
@@ -361,19 +380,115 @@ static void handle_for_map_key_only(
 				loop_stack_clear(pvars->ploop_stack, LOOP_CONTINUED);
 			}
 
-			mv_free(pe->pvvalue);
-			free(pe->pvvalue);
-		}
-		sllv_free(pkeys);
-		if (!boxed_xval.is_ephemeral) {
-			mlhmmv_xvalue_free(&copy);
 		}
 
+		// Unbind the loop variable before freeing what it points into.
 		loop_stack_pop(pvars->ploop_stack);
 		local_stack_subframe_exit(pframe, pstatement->pblock->subframe_var_count);
+
+		if (do_copy) {
+			mlhmmv_xvalue_free(&copy);
+		}
 	}
 
 	if (boxed_xval.is_ephemeral) {
 		mlhmmv_xvalue_free(&boxed_xval.xval);
 	}
 }
+
+// ================================================================
+// Whether statements in the loop body might assign to, or unset, the map being looped over -- if
+// not, the loop can walk the map in place rather than looping over a copy. Conservatively: for
+// oosvar maps, any oosvar assignment or unset; for local maps, any assignment to or unset of that
+// local; for both, any call to a user-defined function or subroutine, since those may assign to
+// oosvars. Other targets are either ephemeral or are copied.
+static int for_body_may_modify_target_aux(mlr_dsl_cst_t* pcst, mlr_dsl_ast_node_t* pnode,
+	int target_is_oosvar, int target_frame_relative_index);
+
+static int for_body_may_modify_target(mlr_dsl_cst_t* pcst, mlr_dsl_ast_node_t* pnode) {
+	mlr_dsl_ast_node_t* pmiddle = pnode->pchildren->phead->pnext->pvvalue;
+	mlr_dsl_ast_node_t* pright  = pnode->pchildren->phead->pnext->pnext->pvvalue;
+
+	int target_is_oosvar = FALSE;
+	int target_frame_relative_index = MD_UNUSED_INDEX;
+	switch (pnode->type) {
+	case MD_AST_NODE_TYPE_FOR_OOSVAR:
+	case MD_AST_NODE_TYPE_FOR_OOSVAR_KEY_ONLY:
+		target_is_oosvar = TRUE;
+		break;
+	case MD_AST_NODE_TYPE_FOR_LOCAL_MAP:
+	case MD_AST_NODE_TYPE_FOR_LOCAL_MAP_KEY_ONLY:
+		target_frame_relative_index = pmiddle->vardef_frame_relative_index;
+		if (target_frame_relative_index == MD_UNUSED_INDEX)
+			return TRUE;
+		break;
+	default:
+		return TRUE;
+	}
+
+	return for_body_may_modify_target_aux(pcst, pright, target_is_oosvar, target_frame_relative_index);
+}
+
+static int for_body_may_modify_target_aux(mlr_dsl_cst_t* pcst, mlr_dsl_ast_node_t* pnode,
+	int target_is_oosvar, int target_frame_relative_index)
+{
+	switch (pnode->type) {
+
+	case MD_AST_NODE_TYPE_OOSVAR_ASSIGNMENT:
+	case MD_AST_NODE_TYPE_OOSVAR_FROM_FULL_SREC_ASSIGNMENT:
+	case MD_AST_NODE_TYPE_FULL_OOSVAR_ASSIGNMENT:
+	case MD_AST_NODE_TYPE_FULL_OOSVAR_FROM_FULL_SREC_ASSIGNMENT:
+		if (target_is_oosvar)
+			return TRUE;
+		break;
+
+	case MD_AST_NODE_TYPE_NONINDEXED_LOCAL_ASSIGNMENT:
+	case MD_AST_NODE_TYPE_INDEXED_LOCAL_ASSIGNMENT:
+		if (!target_is_oosvar) {
+			mlr_dsl_ast_node_t* plhs = pnode->pchildren->phead->pvvalue;
+			if (plhs->vardef_frame_relative_index == target_frame_relative_index)
+				return TRUE;
+		}
+		break;
+
+	case MD_AST_NODE_TYPE_UNSET:
+		for (sllve_t* pe = pnode->pchildren->phead; pe != NULL; pe = pe->pnext) {
+			mlr_dsl_ast_node_t* pchild = pe->pvvalue;
+			switch (pchild->type) {
+			case MD_AST_NODE_TYPE_OOSVAR_KEYLIST:
+			case MD_AST_NODE_TYPE_FULL_OOSVAR:
+			case MD_AST_NODE_TYPE_ALL:
+				if (target_is_oosvar)
+					return TRUE;
+				break;
+			case MD_AST_NODE_TYPE_NONINDEXED_LOCAL_VARIABLE:
+			case MD_AST_NODE_TYPE_INDEXED_LOCAL_VARIABLE:
+				if (!target_is_oosvar && pchild->vardef_frame_relative_index == target_frame_relative_index)
+					return TRUE;
+				break;
+			default:
+				break;
+			}
+		}
+		break;
+
+	case MD_AST_NODE_TYPE_SUBR_CALLSITE:
+		return TRUE;
+
+	case MD_AST_NODE_TYPE_FUNCTION_CALLSITE:
+		if (!fmgr_function_is_builtin(pcst->pfmgr, pnode->text))
+			return TRUE;
+		break;
+
+	default:
+		break;
+	}
+
+	if (pnode->pchildren != NULL) {
+		for (sllve_t* pe = pnode->pchildren->phead; pe != NULL; pe = pe->pnext) {
+			if (for_body_may_modify_target_aux(pcst, pe->pvvalue, target_is_oosvar, target_frame_relative_index))
+				return TRUE;
+		}
+	}
+	return FALSE;
+}
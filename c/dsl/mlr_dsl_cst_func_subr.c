@@ -233,10 +233,10 @@ static void cst_udf_type_check_return_value(cst_udf_state_t* pstate, mlhmmv_xval
 		}
 	}
 	if (!ok) {
-		fprintf(stderr, "%s: function %s returned type %s, not matching typedecl %s.\n",
+		mlr_print_data_error("%s: function %s returned type %s, not matching typedecl %s.\n",
 			MLR_GLOBALS.bargv0, pstate->name,
 			mlhmmv_xvalue_describe_type_simple(pretval), pstate->return_value_type_name);
-		exit(1);
+		mlr_exit_on_data_error();
 	}
 }
 
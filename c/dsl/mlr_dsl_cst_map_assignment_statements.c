@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include "lib/mlr_globals.h"
 #include "lib/mlrutil.h"
+#include "lib/mvfuncs.h"
 #include "keylist_evaluators.h"
 #include "mlr_dsl_cst.h"
 #include "context_flags.h"
@@ -72,11 +73,15 @@ static void handle_full_srec_assignment(
 	full_srec_assignment_state_t* pstate = pstatement->pvstate;
 
 	lrec_t* poutrec = lrec_unbacked_alloc(); // pinrec might be part of the RHS.
-	lhmsmv_t* pout_typed_overlay = lhmsmv_alloc();
 
 	rxval_evaluator_t* prhs_xevaluator = pstate->prhs_xevaluator;
 	boxed_xval_t boxed_xval = prhs_xevaluator->pprocess_func(prhs_xevaluator->pvstate, pvars);
 
+	// The RHS holds copies of any overlay values it read, so the overlay can be
+	// cleared and refilled rather than reallocated.
+	lhmsmv_t* pout_typed_overlay = pvars->ptyped_overlay;
+	lhmsmv_clear(pout_typed_overlay);
+
 	if (!boxed_xval.xval.is_terminal) {
 		for (mlhmmv_level_entry_t* pe = boxed_xval.xval.pnext_level->phead; pe != NULL; pe = pe->pnext) {
 			mv_t* pkey = &pe->level_key;
@@ -114,9 +119,7 @@ static void handle_full_srec_assignment(
 		mlhmmv_xvalue_free(&boxed_xval.xval);
 	}
 	lrec_free(pvars->pinrec);
-	lhmsmv_free(pvars->ptyped_overlay);
 	pvars->pinrec = poutrec;
-	pvars->ptyped_overlay = pout_typed_overlay;
 }
 
 // ================================================================
@@ -124,9 +127,11 @@ typedef struct _local_variable_definition_state_t {
 	char*              lhs_variable_name;
 	int                lhs_frame_relative_index;
 	int                lhs_type_mask;
+	rval_evaluator_t*  prhs_evaluator;
 	rxval_evaluator_t* prhs_xevaluator;
 } local_variable_definition_state_t;
 
+static mlr_dsl_cst_statement_handler_t handle_local_variable_definition_from_val;
 static mlr_dsl_cst_statement_handler_t handle_local_variable_definition_from_xval;
 static mlr_dsl_cst_statement_freer_t free_local_variable_definition;
 
@@ -144,6 +149,7 @@ mlr_dsl_cst_statement_t* alloc_local_variable_definition(
 	pstate->lhs_variable_name        = NULL;
 	pstate->lhs_frame_relative_index = MD_UNUSED_INDEX;
 	pstate->lhs_type_mask            = 0;
+	pstate->prhs_evaluator           = NULL;
 	pstate->prhs_xevaluator          = NULL;
 
 	mlr_dsl_ast_node_t* pname_node = pnode->pchildren->phead->pvvalue;
@@ -154,9 +160,16 @@ mlr_dsl_cst_statement_t* alloc_local_variable_definition(
 
 	mlr_dsl_cst_statement_handler_t* pstatement_handler = NULL;
 	mlr_dsl_ast_node_t* prhs_node = pnode->pchildren->phead->pnext->pvvalue;
-	pstate->prhs_xevaluator = rxval_evaluator_alloc_from_ast(
-		prhs_node, pcst->pfmgr, type_inferencing, context_flags);
-	pstatement_handler = handle_local_variable_definition_from_xval;
+	if (prhs_node->type == MD_AST_NODE_TYPE_OPERATOR) {
+		// Operators are scalar-valued so there is no need for the map-valued evaluator.
+		pstate->prhs_evaluator = rval_evaluator_alloc_from_ast(
+			prhs_node, pcst->pfmgr, type_inferencing, context_flags);
+		pstatement_handler = handle_local_variable_definition_from_val;
+	} else {
+		pstate->prhs_xevaluator = rxval_evaluator_alloc_from_ast(
+			prhs_node, pcst->pfmgr, type_inferencing, context_flags);
+		pstatement_handler = handle_local_variable_definition_from_xval;
+	}
 
 	return mlr_dsl_cst_statement_valloc(
 		pnode,
@@ -169,11 +182,32 @@ mlr_dsl_cst_statement_t* alloc_local_variable_definition(
 static void free_local_variable_definition(mlr_dsl_cst_statement_t* pstatement, context_t* _) {
 	local_variable_definition_state_t* pstate = pstatement->pvstate;
 
-	pstate->prhs_xevaluator->pfree_func(pstate->prhs_xevaluator);
+	if (pstate->prhs_evaluator != NULL) {
+		pstate->prhs_evaluator->pfree_func(pstate->prhs_evaluator);
+	}
+	if (pstate->prhs_xevaluator != NULL) {
+		pstate->prhs_xevaluator->pfree_func(pstate->prhs_xevaluator);
+	}
 
 	free(pstate);
 }
 
+// ----------------------------------------------------------------
+static void handle_local_variable_definition_from_val(
+	mlr_dsl_cst_statement_t* pstatement,
+	variables_t*             pvars,
+	cst_outputs_t*           pcst_outputs)
+{
+	local_variable_definition_state_t* pstate = pstatement->pvstate;
+	rval_evaluator_t* prhs_evaluator = pstate->prhs_evaluator;
+	mv_t val = prhs_evaluator->pprocess_func(prhs_evaluator->pvstate, pvars);
+
+	local_stack_frame_t* pframe = local_stack_get_top_frame(pvars->plocal_stack);
+	local_stack_frame_define_extended(pframe,
+		pstate->lhs_variable_name, pstate->lhs_frame_relative_index, pstate->lhs_type_mask,
+		mlhmmv_xvalue_wrap_terminal(val));
+}
+
 // ----------------------------------------------------------------
 static void handle_local_variable_definition_from_xval(
 	mlr_dsl_cst_statement_t* pstatement,
@@ -200,9 +234,11 @@ static void handle_local_variable_definition_from_xval(
 typedef struct _nonindexed_local_variable_assignment_state_t {
 	char*              lhs_variable_name; // For error messages only: stack-index is computed by stack-allocator:
 	int                lhs_frame_relative_index;
+	rval_evaluator_t*  prhs_evaluator;
 	rxval_evaluator_t* prhs_xevaluator;
 } nonindexed_local_variable_assignment_state_t;
 
+static mlr_dsl_cst_statement_handler_t handle_nonindexed_local_variable_assignment_from_val;
 static mlr_dsl_cst_statement_handler_t handle_nonindexed_local_variable_assignment_from_xval;
 static mlr_dsl_cst_statement_freer_t free_nonindexed_local_variable_assignment;
 
@@ -215,6 +251,7 @@ mlr_dsl_cst_statement_t* alloc_nonindexed_local_variable_assignment(mlr_dsl_cst_
 
 	pstate->lhs_variable_name        = NULL;
 	pstate->lhs_frame_relative_index = MD_UNUSED_INDEX;
+	pstate->prhs_evaluator           = NULL;
 	pstate->prhs_xevaluator          = NULL;
 
 	MLR_INTERNAL_CODING_ERROR_IF((pnode->pchildren == NULL) || (pnode->pchildren->length != 2));
@@ -231,9 +268,16 @@ mlr_dsl_cst_statement_t* alloc_nonindexed_local_variable_assignment(mlr_dsl_cst_
 
 	mlr_dsl_cst_statement_handler_t* pstatement_handler = NULL;
 
-	pstate->prhs_xevaluator = rxval_evaluator_alloc_from_ast(
-		prhs_node, pcst->pfmgr, type_inferencing, context_flags);
-	pstatement_handler = handle_nonindexed_local_variable_assignment_from_xval;
+	if (prhs_node->type == MD_AST_NODE_TYPE_OPERATOR) {
+		// Operators are scalar-valued so there is no need for the map-valued evaluator.
+		pstate->prhs_evaluator = rval_evaluator_alloc_from_ast(
+			prhs_node, pcst->pfmgr, type_inferencing, context_flags);
+		pstatement_handler = handle_nonindexed_local_variable_assignment_from_val;
+	} else {
+		pstate->prhs_xevaluator = rxval_evaluator_alloc_from_ast(
+			prhs_node, pcst->pfmgr, type_inferencing, context_flags);
+		pstatement_handler = handle_nonindexed_local_variable_assignment_from_xval;
+	}
 
 	return mlr_dsl_cst_statement_valloc(
 		pnode,
@@ -246,6 +290,9 @@ mlr_dsl_cst_statement_t* alloc_nonindexed_local_variable_assignment(mlr_dsl_cst_
 static void free_nonindexed_local_variable_assignment(mlr_dsl_cst_statement_t* pstatement, context_t* _) {
 	nonindexed_local_variable_assignment_state_t* pstate = pstatement->pvstate;
 
+	if (pstate->prhs_evaluator != NULL) {
+		pstate->prhs_evaluator->pfree_func(pstate->prhs_evaluator);
+	}
 	if (pstate->prhs_xevaluator != NULL) {
 		pstate->prhs_xevaluator->pfree_func(pstate->prhs_xevaluator);
 	}
@@ -253,6 +300,23 @@ static void free_nonindexed_local_variable_assignment(mlr_dsl_cst_statement_t* p
 	free(pstate);
 }
 
+// ----------------------------------------------------------------
+static void handle_nonindexed_local_variable_assignment_from_val(
+	mlr_dsl_cst_statement_t* pstatement,
+	variables_t*             pvars,
+	cst_outputs_t*           pcst_outputs)
+{
+	nonindexed_local_variable_assignment_state_t* pstate = pstatement->pvstate;
+
+	rval_evaluator_t* prhs_evaluator = pstate->prhs_evaluator;
+	mv_t val = prhs_evaluator->pprocess_func(prhs_evaluator->pvstate, pvars);
+
+	if (mv_is_present(&val)) {
+		local_stack_frame_t* pframe = local_stack_get_top_frame(pvars->plocal_stack);
+		local_stack_frame_assign_terminal_nonindexed(pframe, pstate->lhs_frame_relative_index, val);
+	}
+}
+
 // ----------------------------------------------------------------
 static void handle_nonindexed_local_variable_assignment_from_xval(
 	mlr_dsl_cst_statement_t* pstatement,
@@ -371,14 +435,28 @@ static void handle_indexed_local_variable_assignment_from_xval(
 }
 
 // ================================================================
+// Accumulations such as '@sum[$a][$b] += $x', or '@max[$a] = max(@max[$a], $x)',
+// read the oosvar, apply the function, and write the oosvar back. They are
+// done as in-place updates: the keys are evaluated once, into a stack-allocated
+// keylist, and the oosvar map is searched once except when the keylist is new.
+
 typedef struct _oosvar_assignment_state_t {
 	sllv_t*            plhs_keylist_evaluators;
 	rxval_evaluator_t* prhs_xevaluator;
+
+	// For in-place updates
+	int                num_lhs_keys;
+	mv_binary_func_t*  pupdate_func;
+	rval_evaluator_t*  pupdate_evaluator;
 } oosvar_assignment_state_t;
 
 static mlr_dsl_cst_statement_handler_t handle_oosvar_assignment_from_xval;
+static mlr_dsl_cst_statement_handler_t handle_oosvar_in_place_update;
 static mlr_dsl_cst_statement_freer_t free_oosvar_assignment;
 
+static mv_binary_func_t* get_oosvar_in_place_update_func(mlr_dsl_ast_node_t* plhs_node,
+	mlr_dsl_ast_node_t* prhs_node, fmgr_t* pfmgr);
+
 // ----------------------------------------------------------------
 mlr_dsl_cst_statement_t* alloc_oosvar_assignment(mlr_dsl_cst_t* pcst, mlr_dsl_ast_node_t* pnode,
 	int type_inferencing, int context_flags)
@@ -387,6 +465,9 @@ mlr_dsl_cst_statement_t* alloc_oosvar_assignment(mlr_dsl_cst_t* pcst, mlr_dsl_as
 
 	pstate->plhs_keylist_evaluators = NULL;
 	pstate->prhs_xevaluator         = NULL;
+	pstate->num_lhs_keys            = 0;
+	pstate->pupdate_func            = NULL;
+	pstate->pupdate_evaluator       = NULL;
 
 	mlr_dsl_ast_node_t* plhs_node = pnode->pchildren->phead->pvvalue;
 	mlr_dsl_ast_node_t* prhs_node = pnode->pchildren->phead->pnext->pvvalue;
@@ -395,12 +476,21 @@ mlr_dsl_cst_statement_t* alloc_oosvar_assignment(mlr_dsl_cst_t* pcst, mlr_dsl_as
 
 	pstate->plhs_keylist_evaluators = allocate_keylist_evaluators_from_ast_node(
 		plhs_node, pcst->pfmgr, type_inferencing, context_flags);
+	pstate->num_lhs_keys = pstate->plhs_keylist_evaluators->length;
 
 	mlr_dsl_cst_statement_handler_t* pstatement_handler = NULL;
 
-	pstate->prhs_xevaluator = rxval_evaluator_alloc_from_ast(
-		prhs_node, pcst->pfmgr, type_inferencing, context_flags);
-	pstatement_handler = handle_oosvar_assignment_from_xval;
+	pstate->pupdate_func = get_oosvar_in_place_update_func(plhs_node, prhs_node, pcst->pfmgr);
+	if (pstate->pupdate_func != NULL) {
+		mlr_dsl_ast_node_t* pupdate_node = prhs_node->pchildren->phead->pnext->pvvalue;
+		pstate->pupdate_evaluator = rval_evaluator_alloc_from_ast(
+			pupdate_node, pcst->pfmgr, type_inferencing, context_flags);
+		pstatement_handler = handle_oosvar_in_place_update;
+	} else {
+		pstate->prhs_xevaluator = rxval_evaluator_alloc_from_ast(
+			prhs_node, pcst->pfmgr, type_inferencing, context_flags);
+		pstatement_handler = handle_oosvar_assignment_from_xval;
+	}
 
 	return mlr_dsl_cst_statement_valloc(
 		pnode,
@@ -421,10 +511,188 @@ static void free_oosvar_assignment(mlr_dsl_cst_statement_t* pstatement, context_
 	if (pstate->prhs_xevaluator != NULL) {
 		pstate->prhs_xevaluator->pfree_func(pstate->prhs_xevaluator);
 	}
+	if (pstate->pupdate_evaluator != NULL) {
+		pstate->pupdate_evaluator->pfree_func(pstate->pupdate_evaluator);
+	}
 
 	free(pstate);
 }
 
+// ----------------------------------------------------------------
+typedef struct _oosvar_update_func_t {
+	int               node_type;
+	char*             name;
+	mv_binary_func_t* pfunc;
+} oosvar_update_func_t;
+
+// As in fmgr_alloc_evaluator_from_binary_func_name and fmgr_alloc_evaluator_from_variadic_func_name.
+static oosvar_update_func_t OOSVAR_UPDATE_FUNCS[] = {
+	{ MD_AST_NODE_TYPE_OPERATOR,          "+",       x_xx_plus_func        },
+	{ MD_AST_NODE_TYPE_OPERATOR,          "-",       x_xx_minus_func       },
+	{ MD_AST_NODE_TYPE_OPERATOR,          "*",       x_xx_times_func       },
+	{ MD_AST_NODE_TYPE_OPERATOR,          "/",       x_xx_divide_func      },
+	{ MD_AST_NODE_TYPE_OPERATOR,          "//",      x_xx_int_divide_func  },
+	{ MD_AST_NODE_TYPE_OPERATOR,          ".+",      x_xx_oplus_func       },
+	{ MD_AST_NODE_TYPE_OPERATOR,          ".-",      x_xx_ominus_func      },
+	{ MD_AST_NODE_TYPE_OPERATOR,          ".*",      x_xx_otimes_func      },
+	{ MD_AST_NODE_TYPE_OPERATOR,          "./",      x_xx_odivide_func     },
+	{ MD_AST_NODE_TYPE_OPERATOR,          ".//",     x_xx_int_odivide_func },
+	{ MD_AST_NODE_TYPE_OPERATOR,          "%",       x_xx_mod_func         },
+	{ MD_AST_NODE_TYPE_OPERATOR,          ".",       s_xx_dot_func         },
+	{ MD_AST_NODE_TYPE_OPERATOR,          "&",       x_xx_band_func        },
+	{ MD_AST_NODE_TYPE_OPERATOR,          "|",       x_xx_bor_func         },
+	{ MD_AST_NODE_TYPE_OPERATOR,          "^",       x_xx_bxor_func        },
+	{ MD_AST_NODE_TYPE_FUNCTION_CALLSITE, "min",     x_xx_min_func         },
+	{ MD_AST_NODE_TYPE_FUNCTION_CALLSITE, "max",     x_xx_max_func         },
+	{ MD_AST_NODE_TYPE_FUNCTION_CALLSITE, "hll_add", s_xx_hll_add_func     },
+	{ 0,                                  NULL,      NULL                  },
+};
+
+static int ast_trees_are_equal(mlr_dsl_ast_node_t* pa, mlr_dsl_ast_node_t* pb) {
+	if (pa->type != pb->type || !streq(pa->text, pb->text))
+		return FALSE;
+	if (pa->vardef_frame_relative_index != pb->vardef_frame_relative_index)
+		return FALSE;
+	if (pa->pchildren == NULL || pb->pchildren == NULL)
+		return pa->pchildren == pb->pchildren;
+	if (pa->pchildren->length != pb->pchildren->length)
+		return FALSE;
+	for (sllve_t* pea = pa->pchildren->phead, *peb = pb->pchildren->phead; pea != NULL;
+		pea = pea->pnext, peb = peb->pnext)
+	{
+		if (!ast_trees_are_equal(pea->pvvalue, peb->pvvalue))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+// Keys are evaluated once rather than twice, so they must give the same value
+// each time: e.g. @count[urand32()] += 1 isn't updated in place.
+static int oosvar_key_is_repeatable(mlr_dsl_ast_node_t* pnode) {
+	switch (pnode->type) {
+	case MD_AST_NODE_TYPE_STRING_LITERAL:
+	case MD_AST_NODE_TYPE_NUMERIC_LITERAL:
+	case MD_AST_NODE_TYPE_BOOLEAN_LITERAL:
+	case MD_AST_NODE_TYPE_FIELD_NAME:
+	case MD_AST_NODE_TYPE_CONTEXT_VARIABLE:
+	case MD_AST_NODE_TYPE_NONINDEXED_LOCAL_VARIABLE:
+		return TRUE;
+	case MD_AST_NODE_TYPE_OPERATOR:
+		for (sllve_t* pe = pnode->pchildren->phead; pe != NULL; pe = pe->pnext)
+			if (!oosvar_key_is_repeatable(pe->pvvalue))
+				return FALSE;
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+// The oosvar is read after the right-hand side is evaluated, rather than
+// before, so the latter mustn't call a user-defined function which might
+// modify it.
+static int oosvar_update_calls_no_udfs(mlr_dsl_ast_node_t* pnode, fmgr_t* pfmgr) {
+	if (pnode->type == MD_AST_NODE_TYPE_FUNCTION_CALLSITE
+	&& !hss_has(pfmgr->built_in_function_names, pnode->text))
+		return FALSE;
+	if (pnode->pchildren != NULL)
+		for (sllve_t* pe = pnode->pchildren->phead; pe != NULL; pe = pe->pnext)
+			if (!oosvar_update_calls_no_udfs(pe->pvvalue, pfmgr))
+				return FALSE;
+	return TRUE;
+}
+
+// Returns the function if the assignment is of the form '@x[...] = f(@x[...], y)'
+// for one of the functions above, else NULL.
+static mv_binary_func_t* get_oosvar_in_place_update_func(mlr_dsl_ast_node_t* plhs_node,
+	mlr_dsl_ast_node_t* prhs_node, fmgr_t* pfmgr)
+{
+	if (prhs_node->pchildren == NULL || prhs_node->pchildren->length != 2)
+		return NULL;
+	mlr_dsl_ast_node_t* pread_node   = prhs_node->pchildren->phead->pvvalue;
+	mlr_dsl_ast_node_t* pupdate_node = prhs_node->pchildren->phead->pnext->pvvalue;
+	if (!ast_trees_are_equal(plhs_node, pread_node))
+		return NULL;
+	for (sllve_t* pe = plhs_node->pchildren->phead; pe != NULL; pe = pe->pnext)
+		if (!oosvar_key_is_repeatable(pe->pvvalue))
+			return NULL;
+	if (!oosvar_update_calls_no_udfs(pupdate_node, pfmgr))
+		return NULL;
+
+	for (oosvar_update_func_t* pf = &OOSVAR_UPDATE_FUNCS[0]; pf->name != NULL; pf++)
+		if (pf->node_type == prhs_node->type && streq(pf->name, prhs_node->text))
+			return pf->pfunc;
+	return NULL;
+}
+
+// ----------------------------------------------------------------
+static void handle_oosvar_in_place_update(
+	mlr_dsl_cst_statement_t* pstatement,
+	variables_t*             pvars,
+	cst_outputs_t*           pcst_outputs)
+{
+	oosvar_assignment_state_t* pstate = pstatement->pvstate;
+
+	// As in evaluate_list, but without allocating. The oosvar map copies keys when it keeps them.
+	sllmve_t keys[pstate->num_lhs_keys];
+	sllmv_t keylist = { .phead = &keys[0], .ptail = &keys[pstate->num_lhs_keys - 1],
+		.length = pstate->num_lhs_keys };
+	int num_evaluated = 0;
+	int all_non_null_or_error = TRUE;
+	for (sllve_t* pe = pstate->plhs_keylist_evaluators->phead; pe != NULL; pe = pe->pnext) {
+		rval_evaluator_t* pevaluator = pe->pvvalue;
+		sllmve_t* pkey = &keys[num_evaluated++];
+		pkey->value = pevaluator->pprocess_func(pevaluator->pvstate, pvars);
+		pkey->free_flags = 0;
+		pkey->pnext = (pe->pnext == NULL) ? NULL : &keys[num_evaluated];
+		if (mv_is_null_or_error(&pkey->value)) {
+			all_non_null_or_error = FALSE;
+			break;
+		}
+	}
+
+	if (all_non_null_or_error) {
+		rval_evaluator_t* pupdate_evaluator = pstate->pupdate_evaluator;
+		mv_t update = pupdate_evaluator->pprocess_func(pupdate_evaluator->pvstate, pvars);
+
+		mlhmmv_level_t* plevel = pvars->poosvars->root_xvalue.pnext_level;
+		int error = 0;
+		mv_t* pterminal = mlhmmv_level_look_up_and_ref_terminal(plevel, &keylist, &error);
+
+		// As in rval_evaluator_oosvar_keylist_func, except that the current value is moved out of
+		// the oosvar rather than copied, and the result moved back in. This matters for long strings,
+		// e.g. hll_add sketches. None of the update functions returns absent given a present first
+		// argument, so the terminal is always refilled.
+		mv_t current = mv_absent();
+		int is_moved = FALSE;
+		if (pterminal != NULL) {
+			if (pterminal->type == MT_EMPTY || (pterminal->type == MT_STRING && *pterminal->u.strv == 0)) {
+				current = mv_empty();
+			} else {
+				current = *pterminal;
+				*pterminal = mv_absent();
+				is_moved = TRUE;
+			}
+		}
+
+		mv_t result = pstate->pupdate_func(&current, &update);
+		MLR_INTERNAL_CODING_ERROR_IF(is_moved && !mv_is_present(&result));
+		if (mv_is_present(&result)) {
+			if (result.type == MT_STRING && !(result.free_flags & FREE_ENTRY_VALUE))
+				result = mv_copy(&result);
+			if (pterminal != NULL) {
+				mv_free(pterminal);
+				*pterminal = result;
+			} else {
+				mlhmmv_level_put_terminal(plevel, keylist.phead, &result);
+				mv_free(&result);
+			}
+		}
+	}
+
+	for (int i = 0; i < num_evaluated; i++)
+		mv_free(&keys[i].value);
+}
+
 // ----------------------------------------------------------------
 static void handle_oosvar_assignment_from_xval(
 	mlr_dsl_cst_statement_t* pstatement,
@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "lib/mlr_globals.h"
+#include "lib/mlrutil.h"
+#include "dsl/mlr_dsl_cst.h"
+#include "dsl/function_manager.h"
+#include "dsl/rval_evaluators.h"
+#include "dsl/type_inference.h"
+
+// ================================================================
+// Constant folding for the Miller DSL.
+//
+// Subexpressions whose operands are all literals, e.g. 2 ** 20 or "prefix" .
+// "_suffix", are evaluated once when the CST is built, and replaced in the AST
+// by literals. Besides saving the per-record evaluation this means that, for
+// example, sub($x, "^" . "abc", "") is treated the same as sub($x, "^abc", ""),
+// with the regex compiled once rather than looked up per record.
+//
+// Only built-in functions whose return values depend on their arguments alone,
+// and not on --ofmt, are folded: see fmgr_function_is_foldable. Results which
+// are absent, empty, or error are left alone, as are strings with backslashes:
+// see is_constant_leaf.
+//
+// This is done on the blocked AST after it is printed for put -v, so the
+// printed AST is as parsed.
+// ================================================================
+
+static int fold_constants_aux(mlr_dsl_ast_node_t* pnode, fmgr_t* pfmgr);
+static int is_constant_leaf(mlr_dsl_ast_node_t* pnode);
+static int is_float_leaf(mlr_dsl_ast_node_t* pnode);
+static void replace_with_literal(mlr_dsl_ast_node_t* pnode, mlr_dsl_ast_node_type_t type, char* text);
+static void try_fold(mlr_dsl_ast_node_t* pnode, fmgr_t* pfmgr);
+
+// ----------------------------------------------------------------
+void mlr_dsl_ast_fold_constants(mlr_dsl_ast_node_t* pnode) {
+	// The expressions are evaluated using a function manager of their own,
+	// which knows only about built-in functions.
+	fmgr_t* pfmgr = fmgr_alloc();
+	pfmgr->compile_to_bytecode = FALSE;
+	(void)fold_constants_aux(pnode, pfmgr);
+	fmgr_free(pfmgr, NULL);
+}
+
+// Returns TRUE if the node is a literal on return.
+static int fold_constants_aux(mlr_dsl_ast_node_t* pnode, fmgr_t* pfmgr) {
+	if (pnode->pchildren == NULL)
+		return is_constant_leaf(pnode);
+
+	// The subroutine name is parsed as a function callsite, which mustn't be
+	// looked up as a built-in function. Only its arguments are folded.
+	if (pnode->type == MD_AST_NODE_TYPE_SUBR_CALLSITE) {
+		mlr_dsl_ast_node_t* pnamenode = pnode->pchildren->phead->pvvalue;
+		for (sllve_t* pe = pnamenode->pchildren->phead; pe != NULL; pe = pe->pnext)
+			(void)fold_constants_aux(pe->pvvalue, pfmgr);
+		return FALSE;
+	}
+
+	int all_children_constant = TRUE;
+	int has_float_args = FALSE;
+	for (sllve_t* pe = pnode->pchildren->phead; pe != NULL; pe = pe->pnext) {
+		if (!fold_constants_aux(pe->pvvalue, pfmgr))
+			all_children_constant = FALSE;
+		else if (is_float_leaf(pe->pvvalue))
+			has_float_args = TRUE;
+	}
+
+	if (!all_children_constant)
+		return FALSE;
+	if (pnode->type != MD_AST_NODE_TYPE_OPERATOR && pnode->type != MD_AST_NODE_TYPE_FUNCTION_CALLSITE)
+		return FALSE;
+	if (!fmgr_function_is_foldable(pfmgr, pnode->text, has_float_args))
+		return FALSE;
+	// A non-boolean condition is a fatal error, which should happen when the statement is run, not at startup.
+	if (streq(pnode->text, "? :")
+		&& ((mlr_dsl_ast_node_t*)pnode->pchildren->phead->pvvalue)->type != MD_AST_NODE_TYPE_BOOLEAN_LITERAL)
+		return FALSE;
+
+	try_fold(pnode, pfmgr);
+	return is_constant_leaf(pnode);
+}
+
+// ----------------------------------------------------------------
+static int is_constant_leaf(mlr_dsl_ast_node_t* pnode) {
+	if (pnode->pchildren != NULL)
+		return FALSE;
+	switch (pnode->type) {
+	case MD_AST_NODE_TYPE_NUMERIC_LITERAL:
+	case MD_AST_NODE_TYPE_BOOLEAN_LITERAL:
+		return TRUE;
+	case MD_AST_NODE_TYPE_STRING_LITERAL:
+		// String literals are subject to interpolation of regex captures "\1" etc.
+		// after =~, so aren't constant. Other backslash sequences have been
+		// converted by the parser; those remaining are left as is for regexes.
+		return strchr(pnode->text, '\\') == NULL;
+	case MD_AST_NODE_TYPE_CONTEXT_VARIABLE:
+		return streq(pnode->text, "M_PI") || streq(pnode->text, "M_E");
+	default:
+		return FALSE;
+	}
+}
+
+static int is_float_leaf(mlr_dsl_ast_node_t* pnode) {
+	long long intv;
+	if (pnode->type == MD_AST_NODE_TYPE_CONTEXT_VARIABLE)
+		return TRUE;
+	return pnode->type == MD_AST_NODE_TYPE_NUMERIC_LITERAL && !mlr_try_int_from_string(pnode->text, &intv);
+}
+
+// ----------------------------------------------------------------
+static void try_fold(mlr_dsl_ast_node_t* pnode, fmgr_t* pfmgr) {
+	rval_evaluator_t* pevaluator = rval_evaluator_alloc_from_ast(pnode, pfmgr, TYPE_INFER_STRING_FLOAT_INT, 0);
+	fmgr_resolve_func_callsites(pfmgr);
+
+	variables_t vars;
+	memset(&vars, 0, sizeof(vars));
+	mv_t val = pevaluator->pprocess_func(pevaluator->pvstate, &vars);
+
+	// The value may point into the evaluator, or into the AST, so it is copied out before either is freed.
+	char buffer[64];
+	char* text = NULL;
+	mlr_dsl_ast_node_type_t type = MD_AST_NODE_TYPE_STRING_LITERAL;
+	switch (val.type) {
+
+	case MT_INT:
+		snprintf(buffer, sizeof(buffer), "%lld", val.u.intv);
+		text = mlr_strdup_or_die(buffer);
+		type = MD_AST_NODE_TYPE_NUMERIC_LITERAL;
+		break;
+
+	case MT_FLOAT: {
+		// The literal must scan back to the same float, and not to an int.
+		long long intv;
+		double fltv;
+		snprintf(buffer, sizeof(buffer), "%.17g", val.u.fltv);
+		if (mlr_try_int_from_string(buffer, &intv))
+			strcat(buffer, ".0");
+		if (!mlr_try_int_from_string(buffer, &intv) && mlr_try_float_from_string(buffer, &fltv)
+			&& fltv == val.u.fltv)
+		{
+			text = mlr_strdup_or_die(buffer);
+			type = MD_AST_NODE_TYPE_NUMERIC_LITERAL;
+		}
+		break;
+	}
+
+	case MT_BOOLEAN:
+		text = mlr_strdup_or_die(val.u.boolv ? "true" : "false");
+		type = MD_AST_NODE_TYPE_BOOLEAN_LITERAL;
+		break;
+
+	case MT_STRING:
+		if (*val.u.strv != 0 && strchr(val.u.strv, '\\') == NULL) {
+			text = mlr_strdup_or_die(val.u.strv);
+			type = MD_AST_NODE_TYPE_STRING_LITERAL;
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	mv_free(&val);
+	pevaluator->pfree_func(pevaluator);
+
+	if (text != NULL) {
+		replace_with_literal(pnode, type, text);
+		free(text);
+	}
+}
+
+// ----------------------------------------------------------------
+static void replace_with_literal(mlr_dsl_ast_node_t* pnode, mlr_dsl_ast_node_type_t type, char* text) {
+	for (sllve_t* pe = pnode->pchildren->phead; pe != NULL; pe = pe->pnext)
+		mlr_dsl_ast_node_free(pe->pvvalue);
+	sllv_free(pnode->pchildren);
+	pnode->pchildren = NULL;
+	pnode->type = type;
+	mlr_dsl_ast_node_replace_text(pnode, text);
+}
@@ -0,0 +1,93 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "lib/mlrutil.h"
+#include "dsl/mlr_dsl_cst.h"
+
+// ================================================================
+// Record-locality analysis for the Miller DSL.
+//
+// A put/filter expression is record-local if the result of evaluating it on a
+// record depends only on that record and on its NR/FNR/FILENAME context, and
+// if evaluating it has no effects other than on that record. Such expressions
+// may be evaluated on several records at once, on separate CSTs, with the
+// outputs put back in input order: see mapper_put_or_filter.c.
+//
+// This excludes:
+// * begin/end blocks;
+// * any reference to oosvars, since these carry state from one record to the next;
+// * emit/tee/print/dump, which write outside the record stream, as well as
+//   ENV assignments;
+// * urand and friends, whose outputs depend on the order of the calls;
+// * asserting_* functions, since the process exit on failure should happen after
+//   the preceding records have been written.
+//
+// This operates on the raw AST, before the CST builder reorganizes it.
+// ================================================================
+
+static int is_record_local_aux(mlr_dsl_ast_node_t* pnode);
+
+// ----------------------------------------------------------------
+int mlr_dsl_ast_is_record_local(mlr_dsl_ast_t* past) {
+	if (past->proot == NULL)
+		return TRUE;
+	return is_record_local_aux(past->proot);
+}
+
+// ----------------------------------------------------------------
+static int is_record_local_aux(mlr_dsl_ast_node_t* pnode) {
+	switch (pnode->type) {
+
+	case MD_AST_NODE_TYPE_BEGIN:
+	case MD_AST_NODE_TYPE_END:
+
+	case MD_AST_NODE_TYPE_OOSVAR_KEYLIST:
+	case MD_AST_NODE_TYPE_FULL_OOSVAR:
+	case MD_AST_NODE_TYPE_OOSVAR_ASSIGNMENT:
+	case MD_AST_NODE_TYPE_OOSVAR_FROM_FULL_SREC_ASSIGNMENT:
+	case MD_AST_NODE_TYPE_FULL_OOSVAR_ASSIGNMENT:
+	case MD_AST_NODE_TYPE_FULL_OOSVAR_FROM_FULL_SREC_ASSIGNMENT:
+	case MD_AST_NODE_TYPE_FOR_OOSVAR:
+	case MD_AST_NODE_TYPE_FOR_OOSVAR_KEY_ONLY:
+	case MD_AST_NODE_TYPE_ALL:
+
+	case MD_AST_NODE_TYPE_ENV_ASSIGNMENT:
+	case MD_AST_NODE_TYPE_PIPE:
+	case MD_AST_NODE_TYPE_FILE_WRITE:
+	case MD_AST_NODE_TYPE_FILE_APPEND:
+	case MD_AST_NODE_TYPE_TEE:
+	case MD_AST_NODE_TYPE_EMITF:
+	case MD_AST_NODE_TYPE_EMITP:
+	case MD_AST_NODE_TYPE_EMIT:
+	case MD_AST_NODE_TYPE_EMITP_LASHED:
+	case MD_AST_NODE_TYPE_EMIT_LASHED:
+	case MD_AST_NODE_TYPE_DUMP:
+	case MD_AST_NODE_TYPE_EDUMP:
+	case MD_AST_NODE_TYPE_PRINT:
+	case MD_AST_NODE_TYPE_PRINTN:
+	case MD_AST_NODE_TYPE_EPRINT:
+	case MD_AST_NODE_TYPE_EPRINTN:
+	case MD_AST_NODE_TYPE_STDOUT:
+	case MD_AST_NODE_TYPE_STDERR:
+	case MD_AST_NODE_TYPE_STREAM:
+		return FALSE;
+
+	case MD_AST_NODE_TYPE_FUNCTION_CALLSITE:
+		if (strncmp(pnode->text, "urand", 5) == 0)
+			return FALSE;
+		if (strncmp(pnode->text, "asserting_", 10) == 0)
+			return FALSE;
+		break;
+
+	default:
+		break;
+	}
+
+	if (pnode->pchildren != NULL) {
+		for (sllve_t* pe = pnode->pchildren->phead; pe != NULL; pe = pe->pnext) {
+			if (!is_record_local_aux(pe->pvvalue))
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
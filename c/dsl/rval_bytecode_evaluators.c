@@ -0,0 +1,857 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "lib/mlr_globals.h"
+#include "lib/mlrutil.h"
+#include "containers/local_stack.h"
+#include "dsl/rval_evaluators.h"
+#include "dsl/context_flags.h"
+
+// ================================================================
+// Bytecode compilation of operator expressions for mlr put and mlr filter.
+//
+// The tree of evaluators built by rval_evaluator_alloc_from_ast costs a
+// function-pointer call, and an mv_t return, per AST node per record. For
+// arithmetic-heavy expressions such as '$z = $x * $x + $y * $y' that dispatch
+// overhead dominates. Here an operator expression is instead lowered to a flat
+// array of register-based instructions, executed by a single interpreter loop.
+//
+// * Instruction operands are either temporaries, which are registers, or
+//   literals, or local variables. The latter two are read in place: they are
+//   copied only when they need to be handed to a function which may take
+//   ownership of them, not on the int/float fast paths.
+//
+// * Registers are mv_t's. Since the AST is a tree, each temporary is written
+//   once and read once per evaluation, so ownership of string values passes
+//   through the registers just as it does through the tree evaluators' return
+//   values.
+//
+// * The register file is on the C stack, so evaluation is reentrant: e.g. for
+//   a recursive function whose body has a compiled expression calling itself.
+//
+// * Arithmetic and comparison opcodes have inline int/float paths with the
+//   same semantics as lib/mvfuncs.c; other type combinations go through the
+//   same disposition matrices the tree evaluators use. Chains of dots such as
+//   $a . "_" . $b are concatenated in a single allocation when all operands
+//   are strings.
+//
+// * Anything else -- function calls, regex matches, oosvars, etc. -- is
+//   compiled as an escape to a tree evaluator for that subtree, whose own
+//   operator subexpressions are in turn compiled.
+//
+// Compilation may be turned off, for differential testing against the tree
+// evaluators, using mlr put/filter --no-bytecode.
+// ================================================================
+
+typedef enum _bc_opcode_t {
+	BC_LOAD_FIELD_STRING_ONLY,
+	BC_LOAD_FIELD_STRING_FLOAT,
+	BC_LOAD_FIELD_STRING_FLOAT_INT,
+	BC_LOAD_NR,
+	BC_LOAD_FNR,
+	BC_LOAD_NF,
+	BC_LOAD_FILENUM,
+	BC_EVAL,
+	BC_MOVE,
+	BC_PLUS,
+	BC_MINUS,
+	BC_TIMES,
+	BC_DIVIDE,
+	BC_EQ,
+	BC_NE,
+	BC_GT,
+	BC_GE,
+	BC_LT,
+	BC_LE,
+	BC_DOT,
+	BC_BINARY,
+	BC_UNARY,
+	BC_NOT,
+	BC_AND_LHS,
+	BC_AND_RHS,
+	BC_OR_LHS,
+	BC_OR_RHS,
+	BC_TERNARY_TEST,
+	BC_SELECT,
+	BC_JUMP,
+} bc_opcode_t;
+
+typedef enum _bc_operand_kind_t {
+	BC_TEMP,
+	BC_CONSTANT,
+	BC_LOCAL,
+} bc_operand_kind_t;
+
+typedef struct _bc_operand_t {
+	bc_operand_kind_t kind;
+	int index; // Register, constant-table, or local-stack-frame index
+} bc_operand_t;
+
+typedef struct _bc_instruction_t {
+	bc_opcode_t   opcode;
+	int           dst;     // Always a temporary
+	bc_operand_t  src1;
+	bc_operand_t  src2;
+	int           target;  // For jumps and the ternary test (else-branch)
+	int           target2; // For the ternary test (end)
+	int           nsrcs;   // For dot-chains and selects
+	bc_operand_t* srcs;    // For dot-chains and selects
+	union {
+		mv_binary_func_t* pbinary_func;
+		mv_unary_func_t*  punary_func;
+		char*             field_name;
+		rval_evaluator_t* pevaluator;
+	} u;
+} bc_instruction_t;
+
+typedef struct _bc_program_t {
+	bc_instruction_t* instructions;
+	int num_instructions;
+	int alloc_instructions;
+
+	mv_t* constants;
+	int   num_constants;
+	int   alloc_constants;
+
+	int num_temps;
+	int next_temp;
+	int result_register;
+	int uses_locals;
+} bc_program_t;
+
+// Expressions needing more temporaries than this are left to the tree evaluators.
+#define BC_MAX_REGISTERS 64
+
+static bc_operand_t bc_compile_node(bc_program_t* pprogram, mlr_dsl_ast_node_t* pnode, fmgr_t* pfmgr,
+	int type_inferencing, int context_flags);
+static mv_t rval_evaluator_bytecode_func(void* pvstate, variables_t* pvars);
+static void rval_evaluator_bytecode_free(rval_evaluator_t* pevaluator);
+static void bc_program_free(bc_program_t* pprogram);
+static int bc_count_temps(mlr_dsl_ast_node_t* pnode);
+
+// ================================================================
+// OPERATOR TABLE
+
+typedef struct _bc_operator_t {
+	char*             name;
+	int               arity;
+	bc_opcode_t       opcode;
+	mv_binary_func_t* pbinary_func; // Also used for the non-fast-path cases of the arithmetic opcodes.
+	mv_unary_func_t*  punary_func;
+} bc_operator_t;
+
+static bc_operator_t BC_OPERATORS[] = {
+	{ "+",   2, BC_PLUS,   x_xx_plus_func,         NULL},
+	{ "-",   2, BC_MINUS,  x_xx_minus_func,        NULL},
+	{ "*",   2, BC_TIMES,  x_xx_times_func,        NULL},
+	{ "/",   2, BC_DIVIDE, x_xx_divide_func,       NULL},
+	{ "==",  2, BC_EQ,     eq_op_func,             NULL},
+	{ "!=",  2, BC_NE,     ne_op_func,             NULL},
+	{ ">",   2, BC_GT,     gt_op_func,             NULL},
+	{ ">=",  2, BC_GE,     ge_op_func,             NULL},
+	{ "<",   2, BC_LT,     lt_op_func,             NULL},
+	{ "<=",  2, BC_LE,     le_op_func,             NULL},
+	{ ".",   2, BC_DOT,    s_xx_dot_func,          NULL},
+	{ "//",  2, BC_BINARY, x_xx_int_divide_func,   NULL},
+	{ ".+",  2, BC_BINARY, x_xx_oplus_func,        NULL},
+	{ ".-",  2, BC_BINARY, x_xx_ominus_func,       NULL},
+	{ ".*",  2, BC_BINARY, x_xx_otimes_func,       NULL},
+	{ "./",  2, BC_BINARY, x_xx_odivide_func,      NULL},
+	{ ".//", 2, BC_BINARY, x_xx_int_odivide_func,  NULL},
+	{ "%",   2, BC_BINARY, x_xx_mod_func,          NULL},
+	{ "&",   2, BC_BINARY, x_xx_band_func,         NULL},
+	{ "|",   2, BC_BINARY, x_xx_bor_func,          NULL},
+	{ "^",   2, BC_BINARY, x_xx_bxor_func,         NULL},
+	{ "&&",  2, BC_AND_LHS, NULL,                  NULL},
+	{ "||",  2, BC_OR_LHS,  NULL,                  NULL},
+	{ "+",   1, BC_UNARY,  NULL,                   x_x_upos_func},
+	{ "-",   1, BC_UNARY,  NULL,                   x_x_uneg_func},
+	{ ".+",  1, BC_UNARY,  NULL,                   x_x_upos_func},
+	{ ".-",  1, BC_UNARY,  NULL,                   x_x_uneg_func},
+	{ "!",   1, BC_NOT,    NULL,                   NULL},
+	{ "? :", 3, BC_TERNARY_TEST, NULL,             NULL},
+	{ NULL,  0, 0,         NULL,                   NULL},
+};
+
+static bc_operator_t* bc_operator_lookup(mlr_dsl_ast_node_t* pnode) {
+	if (pnode->type != MD_AST_NODE_TYPE_OPERATOR || pnode->pchildren == NULL)
+		return NULL;
+	int arity = pnode->pchildren->length;
+	for (bc_operator_t* pop = &BC_OPERATORS[0]; pop->name != NULL; pop++)
+		if (pop->arity == arity && streq(pop->name, pnode->text))
+			return pop;
+	return NULL;
+}
+
+// ================================================================
+// Returns NULL if the node isn't an operator expression which is handled here,
+// in which case the caller should build a tree evaluator for it.
+
+rval_evaluator_t* rval_evaluator_alloc_from_bytecode(mlr_dsl_ast_node_t* pnode, fmgr_t* pfmgr,
+	int type_inferencing, int context_flags)
+{
+	if (!pfmgr->compile_to_bytecode)
+		return NULL;
+	if (bc_operator_lookup(pnode) == NULL)
+		return NULL;
+	// This is decided before compiling since compiling escapes to tree evaluators registers their
+	// function callsites for resolution, after which they can't be freed.
+	if (bc_count_temps(pnode) > BC_MAX_REGISTERS)
+		return NULL;
+
+	bc_program_t* pprogram = mlr_malloc_or_die(sizeof(bc_program_t));
+	pprogram->num_instructions   = 0;
+	pprogram->alloc_instructions = 16;
+	pprogram->instructions       = mlr_malloc_or_die(pprogram->alloc_instructions * sizeof(bc_instruction_t));
+	pprogram->num_constants      = 0;
+	pprogram->alloc_constants    = 8;
+	pprogram->constants          = mlr_malloc_or_die(pprogram->alloc_constants * sizeof(mv_t));
+	pprogram->num_temps          = 0;
+	pprogram->next_temp          = 0;
+	pprogram->uses_locals        = FALSE;
+
+	bc_operand_t result = bc_compile_node(pprogram, pnode, pfmgr, type_inferencing, context_flags);
+	MLR_INTERNAL_CODING_ERROR_IF(result.kind != BC_TEMP);
+	pprogram->result_register = result.index;
+	MLR_INTERNAL_CODING_ERROR_IF(pprogram->num_temps > BC_MAX_REGISTERS);
+
+	rval_evaluator_t* pevaluator = mlr_malloc_or_die(sizeof(rval_evaluator_t));
+	pevaluator->pvstate       = pprogram;
+	pevaluator->pprocess_func = rval_evaluator_bytecode_func;
+	pevaluator->pfree_func    = rval_evaluator_bytecode_free;
+	return pevaluator;
+}
+
+static void rval_evaluator_bytecode_free(rval_evaluator_t* pevaluator) {
+	bc_program_free(pevaluator->pvstate);
+	free(pevaluator);
+}
+
+static void bc_program_free(bc_program_t* pprogram) {
+	for (int i = 0; i < pprogram->num_instructions; i++) {
+		bc_instruction_t* pinstr = &pprogram->instructions[i];
+		if (pinstr->opcode == BC_EVAL)
+			pinstr->u.pevaluator->pfree_func(pinstr->u.pevaluator);
+		else if (pinstr->opcode == BC_LOAD_FIELD_STRING_ONLY || pinstr->opcode == BC_LOAD_FIELD_STRING_FLOAT
+		|| pinstr->opcode == BC_LOAD_FIELD_STRING_FLOAT_INT)
+			free(pinstr->u.field_name);
+		free(pinstr->srcs);
+	}
+	free(pprogram->instructions);
+	for (int i = 0; i < pprogram->num_constants; i++)
+		mv_free(&pprogram->constants[i]);
+	free(pprogram->constants);
+	free(pprogram);
+}
+
+// ================================================================
+// COMPILER
+
+static bc_operand_t bc_operand(bc_operand_kind_t kind, int index) {
+	bc_operand_t operand = { .kind = kind, .index = index };
+	return operand;
+}
+
+static bc_instruction_t* bc_emit(bc_program_t* pprogram, bc_opcode_t opcode, int dst,
+	bc_operand_t src1, bc_operand_t src2)
+{
+	if (pprogram->num_instructions >= pprogram->alloc_instructions) {
+		pprogram->alloc_instructions *= 2;
+		pprogram->instructions = mlr_realloc_or_die(pprogram->instructions,
+			pprogram->alloc_instructions * sizeof(bc_instruction_t));
+	}
+	bc_instruction_t* pinstr = &pprogram->instructions[pprogram->num_instructions++];
+	memset(pinstr, 0, sizeof(bc_instruction_t));
+	pinstr->opcode = opcode;
+	pinstr->dst    = dst;
+	pinstr->src1   = src1;
+	pinstr->src2   = src2;
+	return pinstr;
+}
+
+static bc_operand_t bc_add_constant(bc_program_t* pprogram, mv_t val) {
+	if (pprogram->num_constants >= pprogram->alloc_constants) {
+		pprogram->alloc_constants *= 2;
+		pprogram->constants = mlr_realloc_or_die(pprogram->constants,
+			pprogram->alloc_constants * sizeof(mv_t));
+	}
+	pprogram->constants[pprogram->num_constants] = val;
+	return bc_operand(BC_CONSTANT, pprogram->num_constants++);
+}
+
+// Temporaries are allocated stack-wise: an instruction's sources are released
+// before its destination is allocated, so the destination often reuses the
+// first source's register.
+static int bc_alloc_temp(bc_program_t* pprogram) {
+	int t = pprogram->next_temp++;
+	if (pprogram->num_temps < pprogram->next_temp)
+		pprogram->num_temps = pprogram->next_temp;
+	return t;
+}
+
+static void bc_release(bc_program_t* pprogram, bc_operand_t operand) {
+	if (operand.kind == BC_TEMP) {
+		MLR_INTERNAL_CODING_ERROR_IF(operand.index != pprogram->next_temp - 1);
+		pprogram->next_temp--;
+	}
+}
+
+static bc_operand_t bc_no_operand() {
+	return bc_operand(BC_TEMP, 0);
+}
+
+static bc_operand_t bc_compile_load(bc_program_t* pprogram, bc_opcode_t opcode) {
+	int dst = bc_alloc_temp(pprogram);
+	bc_emit(pprogram, opcode, dst, bc_no_operand(), bc_no_operand());
+	return bc_operand(BC_TEMP, dst);
+}
+
+static bc_operand_t bc_compile_eval(bc_program_t* pprogram, mlr_dsl_ast_node_t* pnode, fmgr_t* pfmgr,
+	int type_inferencing, int context_flags)
+{
+	int dst = bc_alloc_temp(pprogram);
+	bc_instruction_t* pinstr = bc_emit(pprogram, BC_EVAL, dst, bc_no_operand(), bc_no_operand());
+	pinstr->u.pevaluator = rval_evaluator_alloc_from_ast(pnode, pfmgr, type_inferencing, context_flags);
+	return bc_operand(BC_TEMP, dst);
+}
+
+// Literals are as in rval_evaluator_alloc_from_numeric_literal and
+// rval_evaluator_alloc_from_string_literal. String literals which might
+// interpolate regex captures such as "\1" are left to the tree evaluator.
+static bc_operand_t bc_compile_leaf(bc_program_t* pprogram, mlr_dsl_ast_node_t* pnode, fmgr_t* pfmgr,
+	int type_inferencing, int context_flags)
+{
+	switch (pnode->type) {
+
+	case MD_AST_NODE_TYPE_NUMERIC_LITERAL: {
+		long long intv;
+		double fltv;
+		if (pnode->text == NULL)
+			return bc_add_constant(pprogram, mv_absent());
+		else if (mlr_try_int_from_string(pnode->text, &intv))
+			return bc_add_constant(pprogram, mv_from_int(intv));
+		else if (mlr_try_float_from_string(pnode->text, &fltv))
+			return bc_add_constant(pprogram, mv_from_float(fltv));
+		break;
+	}
+
+	case MD_AST_NODE_TYPE_STRING_LITERAL:
+		if (pnode->text == NULL)
+			return bc_add_constant(pprogram, mv_absent());
+		else if (strchr(pnode->text, '\\') == NULL)
+			return bc_add_constant(pprogram, mv_from_string_no_free(pnode->text));
+		break;
+
+	case MD_AST_NODE_TYPE_BOOLEAN_LITERAL:
+		if (streq(pnode->text, "true"))
+			return bc_add_constant(pprogram, mv_from_true());
+		else if (streq(pnode->text, "false"))
+			return bc_add_constant(pprogram, mv_from_false());
+		break;
+
+	case MD_AST_NODE_TYPE_CONTEXT_VARIABLE:
+		if (streq(pnode->text, "M_PI"))
+			return bc_add_constant(pprogram, mv_from_float(M_PI));
+		else if (streq(pnode->text, "M_E"))
+			return bc_add_constant(pprogram, mv_from_float(M_E));
+		else if (streq(pnode->text, "NR"))
+			return bc_compile_load(pprogram, BC_LOAD_NR);
+		else if (streq(pnode->text, "FNR"))
+			return bc_compile_load(pprogram, BC_LOAD_FNR);
+		else if (streq(pnode->text, "NF"))
+			return bc_compile_load(pprogram, BC_LOAD_NF);
+		else if (streq(pnode->text, "FILENUM"))
+			return bc_compile_load(pprogram, BC_LOAD_FILENUM);
+		break;
+
+	case MD_AST_NODE_TYPE_NONINDEXED_LOCAL_VARIABLE:
+		MLR_INTERNAL_CODING_ERROR_IF(pnode->vardef_frame_relative_index == MD_UNUSED_INDEX);
+		pprogram->uses_locals = TRUE;
+		return bc_operand(BC_LOCAL, pnode->vardef_frame_relative_index);
+
+	case MD_AST_NODE_TYPE_FIELD_NAME: {
+		// The tree evaluator produces the error message for $-variables in begin/end blocks.
+		if (context_flags & IN_BEGIN_OR_END)
+			break;
+		bc_opcode_t opcode;
+		switch (type_inferencing) {
+		case TYPE_INFER_STRING_ONLY:      opcode = BC_LOAD_FIELD_STRING_ONLY;      break;
+		case TYPE_INFER_STRING_FLOAT:     opcode = BC_LOAD_FIELD_STRING_FLOAT;     break;
+		case TYPE_INFER_STRING_FLOAT_INT: opcode = BC_LOAD_FIELD_STRING_FLOAT_INT; break;
+		default: MLR_INTERNAL_CODING_ERROR(); opcode = BC_LOAD_FIELD_STRING_ONLY; break;
+		}
+		bc_operand_t dst = bc_compile_load(pprogram, opcode);
+		pprogram->instructions[pprogram->num_instructions - 1].u.field_name = mlr_strdup_or_die(pnode->text);
+		return dst;
+	}
+
+	default:
+		break;
+	}
+
+	return bc_compile_eval(pprogram, pnode, pfmgr, type_inferencing, context_flags);
+}
+
+// True if bc_compile_leaf would compile the node to a literal or local-variable
+// operand, emitting no instructions.
+static int bc_is_operand_leaf(mlr_dsl_ast_node_t* pnode) {
+	long long intv;
+	double fltv;
+	switch (pnode->type) {
+	case MD_AST_NODE_TYPE_NUMERIC_LITERAL:
+		return pnode->text == NULL || mlr_try_int_from_string(pnode->text, &intv)
+			|| mlr_try_float_from_string(pnode->text, &fltv);
+	case MD_AST_NODE_TYPE_STRING_LITERAL:
+		return pnode->text == NULL || strchr(pnode->text, '\\') == NULL;
+	case MD_AST_NODE_TYPE_BOOLEAN_LITERAL:
+		return streq(pnode->text, "true") || streq(pnode->text, "false");
+	case MD_AST_NODE_TYPE_NONINDEXED_LOCAL_VARIABLE:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+// Flattens a left-associated dot-chain, ((a . b) . c) . d, into its operands a, b, c, d.
+static void bc_collect_dot_operands(mlr_dsl_ast_node_t* pnode, sllv_t* poperands) {
+	mlr_dsl_ast_node_t* pleft  = pnode->pchildren->phead->pvvalue;
+	mlr_dsl_ast_node_t* pright = pnode->pchildren->phead->pnext->pvvalue;
+	bc_operator_t* pop = bc_operator_lookup(pleft);
+	if (pop != NULL && pop->opcode == BC_DOT)
+		bc_collect_dot_operands(pleft, poperands);
+	else
+		sllv_append(poperands, pleft);
+	sllv_append(poperands, pright);
+}
+
+static inline int bc_max(int a, int b) {
+	return a > b ? a : b;
+}
+
+// Returns the number of temporaries bc_compile_node would use for the node, following its
+// allocation order. This is exact except for M_PI and M_E, which are counted as if they were
+// loaded, so it's an upper bound.
+static int bc_count_temps(mlr_dsl_ast_node_t* pnode) {
+	if (pnode->pchildren == NULL)
+		return bc_is_operand_leaf(pnode) ? 0 : 1;
+
+	bc_operator_t* pop = bc_operator_lookup(pnode);
+	if (pop == NULL)
+		return 1;
+
+	mlr_dsl_ast_node_t* parg1_node = pnode->pchildren->phead->pvvalue;
+	int need1 = bc_count_temps(parg1_node);
+	if (pop->arity == 1)
+		return bc_max(need1, 1);
+
+	mlr_dsl_ast_node_t* parg2_node = pnode->pchildren->phead->pnext->pvvalue;
+
+	switch (pop->opcode) {
+
+	case BC_AND_LHS:
+	case BC_OR_LHS:
+		return bc_max(need1, 1 + bc_count_temps(parg2_node));
+
+	case BC_TERNARY_TEST: {
+		mlr_dsl_ast_node_t* parg3_node = pnode->pchildren->phead->pnext->pnext->pvvalue;
+		int need23 = bc_max(bc_count_temps(parg2_node), bc_count_temps(parg3_node));
+		return bc_max(need1, 1 + need23);
+	}
+
+	case BC_DOT: {
+		// Each operand's result stays live while the ones after it are computed.
+		sllv_t* poperands = sllv_alloc();
+		bc_collect_dot_operands(pnode, poperands);
+		int live = 0;
+		int need = 1;
+		for (sllve_t* pe = poperands->phead; pe != NULL; pe = pe->pnext) {
+			need = bc_max(need, live + bc_count_temps(pe->pvvalue));
+			if (!bc_is_operand_leaf(pe->pvvalue))
+				live++;
+		}
+		sllv_free(poperands);
+		return need;
+	}
+
+	default: {
+		int live1 = bc_is_operand_leaf(parg1_node) ? 0 : 1;
+		return bc_max(bc_max(need1, 1), live1 + bc_count_temps(parg2_node));
+	}
+	}
+}
+
+static bc_operand_t bc_compile_node(bc_program_t* pprogram, mlr_dsl_ast_node_t* pnode, fmgr_t* pfmgr,
+	int type_inferencing, int context_flags)
+{
+	if (pnode->pchildren == NULL)
+		return bc_compile_leaf(pprogram, pnode, pfmgr, type_inferencing, context_flags);
+
+	bc_operator_t* pop = bc_operator_lookup(pnode);
+	if (pop == NULL)
+		return bc_compile_eval(pprogram, pnode, pfmgr, type_inferencing, context_flags);
+
+	mlr_dsl_ast_node_t* parg1_node = pnode->pchildren->phead->pvvalue;
+
+	if (pop->arity == 1) {
+		bc_operand_t src = bc_compile_node(pprogram, parg1_node, pfmgr, type_inferencing, context_flags);
+		bc_release(pprogram, src);
+		int dst = bc_alloc_temp(pprogram);
+		bc_instruction_t* pinstr = bc_emit(pprogram, pop->opcode, dst, src, bc_no_operand());
+		pinstr->u.punary_func = pop->punary_func;
+		return bc_operand(BC_TEMP, dst);
+	}
+
+	mlr_dsl_ast_node_t* parg2_node = pnode->pchildren->phead->pnext->pvvalue;
+
+	switch (pop->opcode) {
+
+	case BC_AND_LHS:
+	case BC_OR_LHS: {
+		// The left-hand result is held in the destination in case the right-hand side is absent.
+		bc_operand_t src1 = bc_compile_node(pprogram, parg1_node, pfmgr, type_inferencing, context_flags);
+		bc_release(pprogram, src1);
+		int dst = bc_alloc_temp(pprogram);
+		int lhs_index = pprogram->num_instructions;
+		bc_emit(pprogram, pop->opcode, dst, src1, bc_no_operand());
+		bc_operand_t src2 = bc_compile_node(pprogram, parg2_node, pfmgr, type_inferencing, context_flags);
+		bc_release(pprogram, src2);
+		bc_emit(pprogram, pop->opcode == BC_AND_LHS ? BC_AND_RHS : BC_OR_RHS, dst, src2, bc_no_operand());
+		pprogram->instructions[lhs_index].target = pprogram->num_instructions;
+		return bc_operand(BC_TEMP, dst);
+	}
+
+	case BC_TERNARY_TEST: {
+		mlr_dsl_ast_node_t* parg3_node = pnode->pchildren->phead->pnext->pnext->pvvalue;
+		bc_operand_t cond = bc_compile_node(pprogram, parg1_node, pfmgr, type_inferencing, context_flags);
+		bc_release(pprogram, cond);
+		int dst = bc_alloc_temp(pprogram);
+
+		// When neither branch needs evaluating, choose between them in one instruction.
+		if (bc_is_operand_leaf(parg2_node) && bc_is_operand_leaf(parg3_node)) {
+			bc_instruction_t* pinstr = bc_emit(pprogram, BC_SELECT, dst, cond, bc_no_operand());
+			pinstr->nsrcs   = 2;
+			pinstr->srcs    = mlr_malloc_or_die(2 * sizeof(bc_operand_t));
+			pinstr->srcs[0] = bc_compile_leaf(pprogram, parg2_node, pfmgr, type_inferencing, context_flags);
+			pinstr->srcs[1] = bc_compile_leaf(pprogram, parg3_node, pfmgr, type_inferencing, context_flags);
+			return bc_operand(BC_TEMP, dst);
+		}
+
+		int test_index = pprogram->num_instructions;
+		bc_emit(pprogram, BC_TERNARY_TEST, dst, cond, bc_no_operand());
+
+		bc_operand_t src2 = bc_compile_node(pprogram, parg2_node, pfmgr, type_inferencing, context_flags);
+		bc_release(pprogram, src2);
+		bc_emit(pprogram, BC_MOVE, dst, src2, bc_no_operand());
+		int jump_index = pprogram->num_instructions;
+		bc_emit(pprogram, BC_JUMP, 0, bc_no_operand(), bc_no_operand());
+
+		pprogram->instructions[test_index].target = pprogram->num_instructions;
+		bc_operand_t src3 = bc_compile_node(pprogram, parg3_node, pfmgr, type_inferencing, context_flags);
+		bc_release(pprogram, src3);
+		bc_emit(pprogram, BC_MOVE, dst, src3, bc_no_operand());
+
+		pprogram->instructions[test_index].target2 = pprogram->num_instructions;
+		pprogram->instructions[jump_index].target  = pprogram->num_instructions;
+		return bc_operand(BC_TEMP, dst);
+	}
+
+	case BC_DOT: {
+		sllv_t* poperands = sllv_alloc();
+		bc_collect_dot_operands(pnode, poperands);
+		int nsrcs = poperands->length;
+		bc_operand_t* srcs = mlr_malloc_or_die(nsrcs * sizeof(bc_operand_t));
+		int i = 0;
+		for (sllve_t* pe = poperands->phead; pe != NULL; pe = pe->pnext, i++)
+			srcs[i] = bc_compile_node(pprogram, pe->pvvalue, pfmgr, type_inferencing, context_flags);
+		for (i = nsrcs - 1; i >= 0; i--)
+			bc_release(pprogram, srcs[i]);
+		sllv_free(poperands);
+		int dst = bc_alloc_temp(pprogram);
+		bc_instruction_t* pinstr = bc_emit(pprogram, BC_DOT, dst, bc_no_operand(), bc_no_operand());
+		pinstr->nsrcs = nsrcs;
+		pinstr->srcs  = srcs;
+		pinstr->u.pbinary_func = pop->pbinary_func;
+		return bc_operand(BC_TEMP, dst);
+	}
+
+	default: {
+		bc_operand_t src1 = bc_compile_node(pprogram, parg1_node, pfmgr, type_inferencing, context_flags);
+		bc_operand_t src2 = bc_compile_node(pprogram, parg2_node, pfmgr, type_inferencing, context_flags);
+		bc_release(pprogram, src2);
+		bc_release(pprogram, src1);
+		int dst = bc_alloc_temp(pprogram);
+		bc_instruction_t* pinstr = bc_emit(pprogram, pop->opcode, dst, src1, src2);
+		pinstr->u.pbinary_func = pop->pbinary_func;
+		return bc_operand(BC_TEMP, dst);
+	}
+	}
+}
+
+// ================================================================
+// INTERPRETER
+
+static mv_t bc_absent = { .u.intv = 0, .type = MT_ABSENT, .free_flags = NO_FREE };
+
+// Returns a pointer to the operand's value, for inspection only.
+static inline mv_t* bc_peek(bc_operand_t* poperand, mv_t* regs, mv_t* constants, local_stack_frame_t* pframe) {
+	switch (poperand->kind) {
+	case BC_TEMP:
+		return &regs[poperand->index];
+	case BC_CONSTANT:
+		return &constants[poperand->index];
+	default: {
+		mlhmmv_xvalue_t* pxvalue = &pframe->pvars[poperand->index].xvalue;
+		return pxvalue->is_terminal ? &pxvalue->terminal_mlrval : &bc_absent;
+	}
+	}
+}
+
+// Returns the operand's value for passing to functions which may take
+// ownership of it. Temporaries are moved; literals don't own their strings.
+static inline mv_t bc_take(bc_operand_t* poperand, mv_t* regs, mv_t* constants, local_stack_frame_t* pframe) {
+	mv_t* pval = bc_peek(poperand, regs, constants, pframe);
+	return poperand->kind == BC_LOCAL ? mv_copy(pval) : *pval;
+}
+
+#define BC_IS_NUMBER(pval) ((pval)->type == MT_INT || (pval)->type == MT_FLOAT)
+
+// Mixed int/float arithmetic and comparison are done in floating point.
+static inline double bc_to_float(mv_t* pval) {
+	return pval->type == MT_FLOAT ? pval->u.fltv : (double)pval->u.intv;
+}
+
+static mv_t bc_dot_strings(bc_instruction_t* pinstr, mv_t* regs, mv_t* constants, local_stack_frame_t* pframe) {
+	int total_length = 0;
+	for (int i = 0; i < pinstr->nsrcs; i++)
+		total_length += strlen(bc_peek(&pinstr->srcs[i], regs, constants, pframe)->u.strv);
+	char* output = mlr_malloc_or_die(total_length + 1);
+	char* p = output;
+	for (int i = 0; i < pinstr->nsrcs; i++) {
+		mv_t* pval = bc_peek(&pinstr->srcs[i], regs, constants, pframe);
+		int length = strlen(pval->u.strv);
+		memcpy(p, pval->u.strv, length);
+		p += length;
+		if (pinstr->srcs[i].kind == BC_TEMP)
+			mv_free(pval);
+	}
+	*p = 0;
+	return mv_from_string_with_free(output);
+}
+
+static mv_t rval_evaluator_bytecode_func(void* pvstate, variables_t* pvars) {
+	bc_program_t* pprogram = pvstate;
+	mv_t regs[BC_MAX_REGISTERS];
+	mv_t* constants = pprogram->constants;
+	// Function calls within the expression push and pop their own frames, so
+	// the top frame is the same throughout.
+	local_stack_frame_t* pframe = pprogram->uses_locals
+		? local_stack_get_top_frame(pvars->plocal_stack)
+		: NULL;
+
+	bc_instruction_t* instructions = pprogram->instructions;
+	int num_instructions = pprogram->num_instructions;
+
+#define BC_PEEK(operand) bc_peek(&(operand), regs, constants, pframe)
+#define BC_TAKE(operand) bc_take(&(operand), regs, constants, pframe)
+
+	bc_instruction_t* pend = &instructions[num_instructions];
+	for (bc_instruction_t* pinstr = instructions; pinstr < pend; pinstr++) {
+		mv_t* pdst = &regs[pinstr->dst];
+
+		switch (pinstr->opcode) {
+
+		case BC_LOAD_FIELD_STRING_ONLY:
+			*pdst = get_srec_value_string_only(pinstr->u.field_name, pvars->pinrec, pvars->ptyped_overlay);
+			break;
+		case BC_LOAD_FIELD_STRING_FLOAT:
+			*pdst = get_srec_value_string_float(pinstr->u.field_name, pvars->pinrec, pvars->ptyped_overlay);
+			break;
+		case BC_LOAD_FIELD_STRING_FLOAT_INT:
+			*pdst = get_srec_value_string_float_int(pinstr->u.field_name, pvars->pinrec, pvars->ptyped_overlay);
+			break;
+
+		case BC_LOAD_NR:      *pdst = mv_from_int(pvars->pctx->nr);            break;
+		case BC_LOAD_FNR:     *pdst = mv_from_int(pvars->pctx->fnr);           break;
+		case BC_LOAD_NF:      *pdst = mv_from_int(pvars->pinrec->field_count); break;
+		case BC_LOAD_FILENUM: *pdst = mv_from_int(pvars->pctx->filenum);       break;
+
+		case BC_EVAL:
+			*pdst = pinstr->u.pevaluator->pprocess_func(pinstr->u.pevaluator->pvstate, pvars);
+			break;
+
+		case BC_MOVE:
+			*pdst = BC_TAKE(pinstr->src1);
+			break;
+
+		case BC_JUMP:
+			pinstr = &instructions[pinstr->target - 1];
+			break;
+
+		// Arithmetic, with the same overflow-to-float semantics for ints as the disposition matrices.
+#define BC_ARITHMETIC(op, int_func) { \
+			mv_t* pa = BC_PEEK(pinstr->src1); \
+			mv_t* pb = BC_PEEK(pinstr->src2); \
+			if (pa->type == MT_INT && pb->type == MT_INT) { \
+				*pdst = int_func(pa, pb); \
+			} else if (BC_IS_NUMBER(pa) && BC_IS_NUMBER(pb)) { \
+				*pdst = mv_from_float(bc_to_float(pa) op bc_to_float(pb)); \
+			} else { \
+				mv_t a = BC_TAKE(pinstr->src1); \
+				mv_t b = BC_TAKE(pinstr->src2); \
+				*pdst = pinstr->u.pbinary_func(&a, &b); \
+			} \
+			break; \
+		}
+		case BC_PLUS:  BC_ARITHMETIC(+, plus_n_ii)
+		case BC_MINUS: BC_ARITHMETIC(-, minus_n_ii)
+		case BC_TIMES: BC_ARITHMETIC(*, times_n_ii)
+#undef BC_ARITHMETIC
+
+		case BC_DIVIDE: {
+			mv_t* pa = BC_PEEK(pinstr->src1);
+			mv_t* pb = BC_PEEK(pinstr->src2);
+			if ((pa->type == MT_FLOAT && BC_IS_NUMBER(pb)) || (pb->type == MT_FLOAT && BC_IS_NUMBER(pa))) {
+				*pdst = mv_from_float(bc_to_float(pa) / bc_to_float(pb));
+			} else {
+				mv_t a = BC_TAKE(pinstr->src1);
+				mv_t b = BC_TAKE(pinstr->src2);
+				*pdst = pinstr->u.pbinary_func(&a, &b);
+			}
+			break;
+		}
+
+#define BC_COMPARE(op) { \
+			mv_t* pa = BC_PEEK(pinstr->src1); \
+			mv_t* pb = BC_PEEK(pinstr->src2); \
+			if (pa->type == MT_INT && pb->type == MT_INT) { \
+				*pdst = mv_from_bool(pa->u.intv op pb->u.intv); \
+			} else if (BC_IS_NUMBER(pa) && BC_IS_NUMBER(pb)) { \
+				*pdst = mv_from_bool(bc_to_float(pa) op bc_to_float(pb)); \
+			} else { \
+				mv_t a = BC_TAKE(pinstr->src1); \
+				mv_t b = BC_TAKE(pinstr->src2); \
+				*pdst = pinstr->u.pbinary_func(&a, &b); \
+			} \
+			break; \
+		}
+		case BC_EQ: BC_COMPARE(==)
+		case BC_NE: BC_COMPARE(!=)
+		case BC_GT: BC_COMPARE(>)
+		case BC_GE: BC_COMPARE(>=)
+		case BC_LT: BC_COMPARE(<)
+		case BC_LE: BC_COMPARE(<=)
+#undef BC_COMPARE
+
+		case BC_DOT: {
+			int all_strings = TRUE;
+			for (int i = 0; i < pinstr->nsrcs; i++) {
+				if (BC_PEEK(pinstr->srcs[i])->type != MT_STRING) {
+					all_strings = FALSE;
+					break;
+				}
+			}
+			if (all_strings) {
+				*pdst = bc_dot_strings(pinstr, regs, constants, pframe);
+			} else {
+				mv_t acc = BC_TAKE(pinstr->srcs[0]);
+				for (int i = 1; i < pinstr->nsrcs; i++) {
+					mv_t b = BC_TAKE(pinstr->srcs[i]);
+					acc = pinstr->u.pbinary_func(&acc, &b);
+				}
+				*pdst = acc;
+			}
+			break;
+		}
+
+		case BC_BINARY: {
+			mv_t a = BC_TAKE(pinstr->src1);
+			mv_t b = BC_TAKE(pinstr->src2);
+			*pdst = pinstr->u.pbinary_func(&a, &b);
+			break;
+		}
+
+		case BC_UNARY: {
+			mv_t a = BC_TAKE(pinstr->src1);
+			*pdst = pinstr->u.punary_func(&a);
+			break;
+		}
+
+		// As in rval_evaluator_b_b_func.
+		case BC_NOT: {
+			mv_t* pa = BC_PEEK(pinstr->src1);
+			if (pa->type <= MT_EMPTY)
+				*pdst = BC_TAKE(pinstr->src1);
+			else if (pa->type != MT_BOOLEAN)
+				*pdst = mv_error();
+			else
+				*pdst = b_b_not_func(pa);
+			break;
+		}
+
+		// As in rval_evaluator_b_bb_and_func and rval_evaluator_b_bb_or_func, with short-circuiting.
+		case BC_AND_LHS:
+		case BC_OR_LHS: {
+			mv_t* pa = BC_PEEK(pinstr->src1);
+			if (pa->type == MT_ERROR || pa->type == MT_EMPTY) {
+				*pdst = BC_TAKE(pinstr->src1);
+				pinstr = &instructions[pinstr->target - 1];
+			} else if (pa->type == MT_BOOLEAN) {
+				*pdst = *pa;
+				if (pa->u.boolv == (pinstr->opcode == BC_OR_LHS))
+					pinstr = &instructions[pinstr->target - 1];
+			} else if (pa->type == MT_ABSENT) {
+				*pdst = *pa;
+			} else {
+				*pdst = mv_error();
+				pinstr = &instructions[pinstr->target - 1];
+			}
+			break;
+		}
+		case BC_AND_RHS:
+		case BC_OR_RHS: {
+			mv_t* pa = BC_PEEK(pinstr->src1);
+			if (pa->type == MT_ERROR || pa->type == MT_EMPTY || pa->type == MT_BOOLEAN)
+				*pdst = BC_TAKE(pinstr->src1);
+			else if (pa->type != MT_ABSENT)
+				*pdst = mv_error();
+			break;
+		}
+
+		// As in rval_evaluator_ternop_func.
+		case BC_TERNARY_TEST: {
+			mv_t* pa = BC_PEEK(pinstr->src1);
+			if (pa->type <= MT_EMPTY) {
+				*pdst = BC_TAKE(pinstr->src1);
+				pinstr = &instructions[pinstr->target2 - 1];
+			} else {
+				mv_set_boolean_strict(pa);
+				if (!pa->u.boolv)
+					pinstr = &instructions[pinstr->target - 1];
+			}
+			break;
+		}
+		case BC_SELECT: {
+			mv_t* pa = BC_PEEK(pinstr->src1);
+			if (pa->type <= MT_EMPTY) {
+				*pdst = BC_TAKE(pinstr->src1);
+			} else {
+				mv_set_boolean_strict(pa);
+				*pdst = BC_TAKE(pinstr->srcs[pa->u.boolv ? 0 : 1]);
+			}
+			break;
+		}
+		}
+	}
+
+#undef BC_PEEK
+#undef BC_TAKE
+
+	// Copied field-wise: the type and flags were written as narrower stores
+	// than a whole-struct copy would read, which defeats store-to-load forwarding.
+	mv_t* presult = &regs[pprogram->result_register];
+	mv_t rv;
+	rv.u          = presult->u;
+	rv.type       = presult->type;
+	rv.free_flags = presult->free_flags;
+	return rv;
+}
@@ -96,6 +96,15 @@ rval_evaluator_t* rval_evaluator_alloc_from_local_variable(int vardef_frame_rela
 // For unit test:
 rval_evaluator_t* rval_evaluator_alloc_from_mlrval(mv_t* pval);
 
+// ================================================================
+// rval_bytecode_evaluators.c
+// ================================================================
+
+// Compiles an operator expression, e.g. '$x * $x + $y * $y', to bytecode. Returns NULL if the node
+// isn't an operator handled there, or if compilation is disabled in the function manager.
+rval_evaluator_t* rval_evaluator_alloc_from_bytecode(mlr_dsl_ast_node_t* pnode, fmgr_t* pfmgr,
+	int type_inferencing, int context_flags);
+
 // ================================================================
 // rval_func_evaluators.c
 // ================================================================
@@ -144,6 +153,12 @@ rval_evaluator_t* rval_evaluator_alloc_from_x_ns_func(
 	rval_evaluator_t* parg1,
 	rval_evaluator_t* parg2);
 
+rval_evaluator_t* rval_evaluator_alloc_from_x_xis_func(mv_ternary_func_t* pfunc,
+	rval_evaluator_t* parg1, rval_evaluator_t* parg2, rval_evaluator_t* parg3);
+
+rval_evaluator_t* rval_evaluator_alloc_from_x_nss_func(mv_ternary_func_t* pfunc,
+	rval_evaluator_t* parg1, rval_evaluator_t* parg2, rval_evaluator_t* parg3);
+
 rval_evaluator_t* rval_evaluator_alloc_from_x_ss_func(
 	mv_binary_func_t* pfunc,
 	rval_evaluator_t* parg1,
@@ -167,6 +182,8 @@ rval_evaluator_t* rval_evaluator_alloc_from_s_xs_func(
 
 rval_evaluator_t* rval_evaluator_alloc_from_s_sss_func(mv_ternary_func_t* pfunc,
 	rval_evaluator_t* parg1, rval_evaluator_t* parg2, rval_evaluator_t* parg3);
+rval_evaluator_t* rval_evaluator_alloc_from_s_sss_regex_cache_func(mv_ternary_arg2_regex_cache_func_t* pfunc,
+	rval_evaluator_t* parg1, rval_evaluator_t* parg2, rval_evaluator_t* parg3);
 
 rval_evaluator_t* rval_evaluator_alloc_from_x_srs_func(mv_ternary_arg2_regex_func_t* pfunc,
 	rval_evaluator_t* parg1, char* regex_string, int ignore_case, rval_evaluator_t* parg3);
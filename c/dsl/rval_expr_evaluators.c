@@ -113,6 +113,9 @@ rval_evaluator_t* rval_evaluator_alloc_from_ast(mlr_dsl_ast_node_t* pnode, fmgr_
 
 	//  - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 	} else if ((pnode->type == MD_AST_NODE_TYPE_FUNCTION_CALLSITE) || (pnode->type == MD_AST_NODE_TYPE_OPERATOR)) {
+		rval_evaluator_t* pevaluator = rval_evaluator_alloc_from_bytecode(pnode, pfmgr, type_inferencing, context_flags);
+		if (pevaluator != NULL)
+			return pevaluator;
 		return fmgr_alloc_provisional_from_operator_or_function_call(pfmgr, pnode, type_inferencing, context_flags);
 
 	} else if (pnode->type == MD_AST_NODE_TYPE_FULL_SREC) {
@@ -1005,7 +1008,13 @@ mv_t get_srec_value_string_float(char* field_name, lrec_t* pinrec, lhmsmv_t* pty
 		// freed out from underneath it by the evaluator functions.
 		rv = mv_copy(poverlay);
 	} else {
-		rv = mv_ref_type_infer_string_or_float(lrec_get(pinrec, field_name));
+		lrece_t* pentry = NULL;
+		char* value = lrec_get_ext(pinrec, field_name, &pentry);
+		double fltv;
+		if (value != NULL && *value != 0 && lrec_entry_try_float(pinrec, pentry, &fltv))
+			rv = mv_from_float(fltv);
+		else
+			rv = mv_ref_type_infer_string(value);
 		rv = mv_copy(&rv);
 	}
 	return rv;
@@ -1022,7 +1031,9 @@ mv_t get_srec_value_string_float_int(char* field_name, lrec_t* pinrec, lhmsmv_t*
 		// freed out from underneath it by the evaluator functions.
 		rv = mv_copy(poverlay);
 	} else {
-		rv = mv_ref_type_infer_string_or_float_or_int(lrec_get(pinrec, field_name));
+		lrece_t* pentry = NULL;
+		(void)lrec_get_ext(pinrec, field_name, &pentry);
+		rv = lrec_entry_type_infer_string_or_float_or_int(pinrec, pentry);
 		rv = mv_copy(&rv);
 	}
 	return rv;
@@ -1024,6 +1024,118 @@ rval_evaluator_t* rval_evaluator_alloc_from_x_ns_func(mv_binary_func_t* pfunc,
 	return pevaluator;
 }
 
+// ----------------------------------------------------------------
+typedef struct _rval_evaluator_x_xis_state_t {
+	mv_ternary_func_t* pfunc;
+	rval_evaluator_t* parg1;
+	rval_evaluator_t* parg2;
+	rval_evaluator_t* parg3;
+} rval_evaluator_x_xis_state_t;
+
+static mv_t rval_evaluator_x_xis_func(void* pvstate, variables_t* pvars) {
+	rval_evaluator_x_xis_state_t* pstate = pvstate;
+	mv_t val1 = pstate->parg1->pprocess_func(pstate->parg1->pvstate, pvars);
+	mv_t val2 = pstate->parg2->pprocess_func(pstate->parg2->pvstate, pvars);
+
+	if (val2.type != MT_INT) {
+		mv_free(&val1);
+		mv_free(&val2);
+		return mv_error();
+	}
+
+	mv_t val3 = pstate->parg3->pprocess_func(pstate->parg3->pvstate, pvars);
+	if (!mv_is_string_or_empty(&val3)) {
+		mv_free(&val1);
+		mv_free(&val3);
+		return mv_error();
+	}
+
+	// nullity of 1st argument handled by full disposition matrices
+	return pstate->pfunc(&val1, &val2, &val3);
+}
+static void rval_evaluator_x_xis_free(rval_evaluator_t* pevaluator) {
+	rval_evaluator_x_xis_state_t* pstate = pevaluator->pvstate;
+	pstate->parg1->pfree_func(pstate->parg1);
+	pstate->parg2->pfree_func(pstate->parg2);
+	pstate->parg3->pfree_func(pstate->parg3);
+	free(pstate);
+	free(pevaluator);
+}
+
+rval_evaluator_t* rval_evaluator_alloc_from_x_xis_func(mv_ternary_func_t* pfunc,
+	rval_evaluator_t* parg1, rval_evaluator_t* parg2, rval_evaluator_t* parg3)
+{
+	rval_evaluator_x_xis_state_t* pstate = mlr_malloc_or_die(sizeof(rval_evaluator_x_xis_state_t));
+	pstate->pfunc = pfunc;
+	pstate->parg1 = parg1;
+	pstate->parg2 = parg2;
+	pstate->parg3 = parg3;
+
+	rval_evaluator_t* pevaluator = mlr_malloc_or_die(sizeof(rval_evaluator_t));
+	pevaluator->pvstate = pstate;
+	pevaluator->pprocess_func = rval_evaluator_x_xis_func;
+	pevaluator->pfree_func = rval_evaluator_x_xis_free;
+
+	return pevaluator;
+}
+
+// ----------------------------------------------------------------
+typedef struct _rval_evaluator_x_nss_state_t {
+	mv_ternary_func_t* pfunc;
+	rval_evaluator_t* parg1;
+	rval_evaluator_t* parg2;
+	rval_evaluator_t* parg3;
+} rval_evaluator_x_nss_state_t;
+
+static mv_t rval_evaluator_x_nss_func(void* pvstate, variables_t* pvars) {
+	rval_evaluator_x_nss_state_t* pstate = pvstate;
+	mv_t val1 = pstate->parg1->pprocess_func(pstate->parg1->pvstate, pvars);
+	mv_set_number_nullable(&val1);
+	NULL_OR_ERROR_OUT_FOR_NUMBERS(val1);
+
+	mv_t val2 = pstate->parg2->pprocess_func(pstate->parg2->pvstate, pvars);
+	NULL_OR_ERROR_OUT_FOR_STRINGS(val2);
+	if (!mv_is_string_or_empty(&val2)) {
+		mv_free(&val1);
+		return mv_error();
+	}
+
+	mv_t val3 = pstate->parg3->pprocess_func(pstate->parg3->pvstate, pvars);
+	NULL_OR_ERROR_OUT_FOR_STRINGS(val3);
+	if (!mv_is_string_or_empty(&val3)) {
+		mv_free(&val1);
+		mv_free(&val2);
+		return mv_error();
+	}
+
+	return pstate->pfunc(&val1, &val2, &val3);
+}
+static void rval_evaluator_x_nss_free(rval_evaluator_t* pevaluator) {
+	rval_evaluator_x_nss_state_t* pstate = pevaluator->pvstate;
+	pstate->parg1->pfree_func(pstate->parg1);
+	pstate->parg2->pfree_func(pstate->parg2);
+	pstate->parg3->pfree_func(pstate->parg3);
+	free(pstate);
+	free(pevaluator);
+}
+
+rval_evaluator_t* rval_evaluator_alloc_from_x_nss_func(mv_ternary_func_t* pfunc,
+	rval_evaluator_t* parg1, rval_evaluator_t* parg2, rval_evaluator_t* parg3)
+{
+	rval_evaluator_x_nss_state_t* pstate = mlr_malloc_or_die(sizeof(rval_evaluator_x_nss_state_t));
+	pstate->pfunc = pfunc;
+	pstate->parg1 = parg1;
+	pstate->parg2 = parg2;
+	pstate->parg3 = parg3;
+
+	rval_evaluator_t* pevaluator = mlr_malloc_or_die(sizeof(rval_evaluator_t));
+	pevaluator->pvstate = pstate;
+	pevaluator->pprocess_func = rval_evaluator_x_nss_func;
+	pevaluator->pfree_func = rval_evaluator_x_nss_free;
+
+	return pevaluator;
+}
+
 // ----------------------------------------------------------------
 typedef struct _rval_evaluator_x_ss_state_t {
 	mv_binary_func_t* pfunc;
@@ -1074,6 +1186,7 @@ typedef struct _rval_evaluator_x_ssc_state_t {
 	mv_binary_arg3_capture_func_t* pfunc;
 	rval_evaluator_t* parg1;
 	rval_evaluator_t* parg2;
+	regex_cache_t*    pregex_cache;
 } rval_evaluator_x_ssc_state_t;
 
 static mv_t rval_evaluator_x_ssc_func(void* pvstate, variables_t* pvars) {
@@ -1087,12 +1200,13 @@ static mv_t rval_evaluator_x_ssc_func(void* pvstate, variables_t* pvars) {
 	NULL_OR_ERROR_OUT_FOR_STRINGS(val2);
 	if (!mv_is_string_or_empty(&val2))
 		return mv_error();
-	return pstate->pfunc(&val1, &val2, pvars->ppregex_captures);
+	return pstate->pfunc(&val1, &val2, pstate->pregex_cache, pvars->ppregex_captures);
 }
 static void rval_evaluator_x_ssc_free(rval_evaluator_t* pevaluator) {
 	rval_evaluator_x_ssc_state_t* pstate = pevaluator->pvstate;
 	pstate->parg1->pfree_func(pstate->parg1);
 	pstate->parg2->pfree_func(pstate->parg2);
+	regex_cache_free(pstate->pregex_cache);
 	free(pstate);
 	free(pevaluator);
 }
@@ -1104,6 +1218,7 @@ rval_evaluator_t* rval_evaluator_alloc_from_x_ssc_func(mv_binary_arg3_capture_fu
 	pstate->pfunc = pfunc;
 	pstate->parg1 = parg1;
 	pstate->parg2 = parg2;
+	pstate->pregex_cache = regex_cache_alloc();
 
 	rval_evaluator_t* pevaluator = mlr_malloc_or_die(sizeof(rval_evaluator_t));
 	pevaluator->pvstate = pstate;
@@ -1117,7 +1232,7 @@ rval_evaluator_t* rval_evaluator_alloc_from_x_ssc_func(mv_binary_arg3_capture_fu
 typedef struct _rval_evaluator_x_sr_state_t {
 	mv_binary_arg2_regex_func_t* pfunc;
 	rval_evaluator_t*             parg1;
-	regex_t                       regex;
+	mlr_regex_t                   regex;
 	string_builder_t*             psb;
 } rval_evaluator_x_sr_state_t;
 
@@ -1134,7 +1249,7 @@ static mv_t rval_evaluator_x_sr_func(void* pvstate, variables_t* pvars) {
 static void rval_evaluator_x_sr_free(rval_evaluator_t* pevaluator) {
 	rval_evaluator_x_sr_state_t* pstate = pevaluator->pvstate;
 	pstate->parg1->pfree_func(pstate->parg1);
-	regfree(&pstate->regex);
+	mlr_regfree(&pstate->regex);
 	sb_free(pstate->psb);
 	free(pstate);
 	free(pevaluator);
@@ -1258,11 +1373,77 @@ rval_evaluator_t* rval_evaluator_alloc_from_s_sss_func(mv_ternary_func_t* pfunc,
 	return pevaluator;
 }
 
+// ----------------------------------------------------------------
+// For sub and gsub with regexes computed per record.
+typedef struct _rval_evaluator_s_sss_regex_cache_state_t {
+	mv_ternary_arg2_regex_cache_func_t* pfunc;
+	rval_evaluator_t* parg1;
+	rval_evaluator_t* parg2;
+	rval_evaluator_t* parg3;
+	regex_cache_t*    pregex_cache;
+	string_builder_t* psb;
+} rval_evaluator_s_sss_regex_cache_state_t;
+
+static mv_t rval_evaluator_s_sss_regex_cache_func(void* pvstate, variables_t* pvars) {
+	rval_evaluator_s_sss_regex_cache_state_t* pstate = pvstate;
+	mv_t val1 = pstate->parg1->pprocess_func(pstate->parg1->pvstate, pvars);
+	NULL_OR_ERROR_OUT_FOR_STRINGS(val1);
+	if (!mv_is_string_or_empty(&val1))
+		return mv_error();
+
+	mv_t val2 = pstate->parg2->pprocess_func(pstate->parg2->pvstate, pvars);
+	NULL_OR_ERROR_OUT_FOR_STRINGS(val2);
+	if (!mv_is_string_or_empty(&val2)) {
+		mv_free(&val1);
+		return mv_error();
+	}
+
+	mv_t val3 = pstate->parg3->pprocess_func(pstate->parg3->pvstate, pvars);
+	NULL_OR_ERROR_OUT_FOR_STRINGS(val3);
+	if (!mv_is_string_or_empty(&val3)) {
+		mv_free(&val1);
+		mv_free(&val2);
+		return mv_error();
+	}
+
+	return pstate->pfunc(&val1, &val2, pstate->pregex_cache, pstate->psb, &val3);
+}
+static void rval_evaluator_s_sss_regex_cache_free(rval_evaluator_t* pevaluator) {
+	rval_evaluator_s_sss_regex_cache_state_t* pstate = pevaluator->pvstate;
+	pstate->parg1->pfree_func(pstate->parg1);
+	pstate->parg2->pfree_func(pstate->parg2);
+	pstate->parg3->pfree_func(pstate->parg3);
+	regex_cache_free(pstate->pregex_cache);
+	sb_free(pstate->psb);
+	free(pstate);
+	free(pevaluator);
+}
+
+rval_evaluator_t* rval_evaluator_alloc_from_s_sss_regex_cache_func(mv_ternary_arg2_regex_cache_func_t* pfunc,
+	rval_evaluator_t* parg1, rval_evaluator_t* parg2, rval_evaluator_t* parg3)
+{
+	rval_evaluator_s_sss_regex_cache_state_t* pstate = mlr_malloc_or_die(
+		sizeof(rval_evaluator_s_sss_regex_cache_state_t));
+	pstate->pfunc = pfunc;
+	pstate->parg1 = parg1;
+	pstate->parg2 = parg2;
+	pstate->parg3 = parg3;
+	pstate->pregex_cache = regex_cache_alloc();
+	pstate->psb = sb_alloc(MV_SB_ALLOC_LENGTH);
+
+	rval_evaluator_t* pevaluator = mlr_malloc_or_die(sizeof(rval_evaluator_t));
+	pevaluator->pvstate = pstate;
+	pevaluator->pprocess_func = rval_evaluator_s_sss_regex_cache_func;
+	pevaluator->pfree_func = rval_evaluator_s_sss_regex_cache_free;
+
+	return pevaluator;
+}
+
 // ----------------------------------------------------------------
 typedef struct _rval_evaluator_x_srs_state_t {
 	mv_ternary_arg2_regex_func_t* pfunc;
 	rval_evaluator_t*             parg1;
-	regex_t                       regex;
+	mlr_regex_t                   regex;
 	rval_evaluator_t*             parg3;
 	string_builder_t*             psb;
 } rval_evaluator_x_srs_state_t;
@@ -1287,7 +1468,7 @@ static mv_t rval_evaluator_x_srs_func(void* pvstate, variables_t* pvars) {
 static void rval_evaluator_x_srs_free(rval_evaluator_t* pevaluator) {
 	rval_evaluator_x_srs_state_t* pstate = pevaluator->pvstate;
 	pstate->parg1->pfree_func(pstate->parg1);
-	regfree(&pstate->regex);
+	mlr_regfree(&pstate->regex);
 	pstate->parg3->pfree_func(pstate->parg3);
 	sb_free(pstate->psb);
 	free(pstate);
@@ -551,9 +551,9 @@ static boxed_xval_t rxval_evaluator_A_x_func(void* pvstate, variables_t* pvars)
 	boxed_xval_t ok = pstate->pfunc(&val1);
 
 	if (!ok.xval.terminal_mlrval.u.boolv) {
-		fprintf(stderr, "%s: %s type-assertion failed at NR=%lld FNR=%lld FILENAME=%s\n",
+		mlr_print_data_error("%s: %s type-assertion failed at NR=%lld FNR=%lld FILENAME=%s\n",
 			MLR_GLOBALS.bargv0, pstate->desc, pvars->pctx->nr, pvars->pctx->fnr, pvars->pctx->filename);
-		exit(1);
+		mlr_exit_on_data_error();
 	}
 
 	return val1;
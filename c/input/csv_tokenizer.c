@@ -0,0 +1,316 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lib/mlr_globals.h"
+#include "lib/mlrutil.h"
+#include "containers/lrec.h"
+#include "input/csv_tokenizer.h"
+
+// Byte classes: bits since IFS and IRS may start with the same byte.
+#define BYTE_IFS    0x01
+#define BYTE_IRS    0x02
+#define BYTE_DQUOTE 0x04
+
+#define LINE_TERM_NONE 0 // end of input
+#define LINE_TERM_LF   1
+#define LINE_TERM_CRLF 2
+
+#define SEP_NONE      0
+#define SEP_IFS       1
+#define SEP_IRS       2
+#define SEP_NEED_MORE 3
+
+#define INITIAL_MAX_SLICES 64
+
+// ----------------------------------------------------------------
+csv_tokenizer_t* csv_tokenizer_alloc(char* irs, char* ifs) {
+	csv_tokenizer_t* ptokenizer = mlr_malloc_or_die(sizeof(csv_tokenizer_t));
+
+	ptokenizer->do_auto_line_term = FALSE;
+	if (streq(irs, "auto")) {
+		irs = "\n";
+		ptokenizer->do_auto_line_term = TRUE;
+	}
+	ptokenizer->ifs    = ifs;
+	ptokenizer->ifslen = strlen(ifs);
+	ptokenizer->irs    = irs;
+	ptokenizer->irslen = strlen(irs);
+
+	memset(ptokenizer->byte_classes, 0, sizeof(ptokenizer->byte_classes));
+	ptokenizer->byte_classes[(unsigned char)ifs[0]] |= BYTE_IFS;
+	ptokenizer->byte_classes[(unsigned char)irs[0]] |= BYTE_IRS;
+	ptokenizer->byte_classes['"'] |= BYTE_DQUOTE;
+
+	ptokenizer->max_slices = INITIAL_MAX_SLICES;
+	ptokenizer->pslices    = mlr_malloc_or_die(ptokenizer->max_slices * sizeof(csv_field_slice_t));
+	ptokenizer->num_slices = 0;
+	ptokenizer->line_term  = LINE_TERM_NONE;
+
+	ptokenizer->resume_field_offset = -1;
+	ptokenizer->resume_scan_offset  = -1;
+	ptokenizer->resume_has_escapes  = FALSE;
+
+	return ptokenizer;
+}
+
+void csv_tokenizer_free(csv_tokenizer_t* ptokenizer) {
+	if (ptokenizer == NULL)
+		return;
+	free(ptokenizer->pslices);
+	free(ptokenizer);
+}
+
+// ----------------------------------------------------------------
+static inline void add_slice(csv_tokenizer_t* ptokenizer, char* sol, char* start, int length,
+	char quote_flag, char has_escapes)
+{
+	if (ptokenizer->num_slices >= ptokenizer->max_slices) {
+		ptokenizer->max_slices *= 2;
+		ptokenizer->pslices = mlr_realloc_or_die(ptokenizer->pslices,
+			ptokenizer->max_slices * sizeof(csv_field_slice_t));
+	}
+	csv_field_slice_t* pslice = &ptokenizer->pslices[ptokenizer->num_slices++];
+	pslice->offset      = start - sol;
+	pslice->length      = length;
+	pslice->quote_flag  = quote_flag;
+	pslice->has_escapes = has_escapes;
+}
+
+// Returns TRUE if sep is at p, FALSE if not, or SEP_NEED_MORE if eob cuts off a possible match.
+// The caller has already checked the first byte.
+static inline int match_at(char* sep, int seplen, char* p, char* eob, int is_final) {
+	if (seplen == 1)
+		return TRUE;
+	int avail = eob - p;
+	if (avail >= seplen)
+		return memcmp(p, sep, seplen) == 0;
+	if (is_final)
+		return FALSE;
+	return (memcmp(p, sep, avail) == 0) ? SEP_NEED_MORE : FALSE;
+}
+
+// If IFS and IRS both match, the longer one wins, as with a parse trie.
+static inline int match_separator(csv_tokenizer_t* ptokenizer, char* p, char* eob, int is_final) {
+	unsigned char byte_class = ptokenizer->byte_classes[(unsigned char)*p];
+	int ifs_first = ptokenizer->ifslen > ptokenizer->irslen;
+	for (int i = 0; i < 2; i++) {
+		int try_ifs = (i == 0) ? ifs_first : !ifs_first;
+		int rc;
+		if (try_ifs) {
+			if (!(byte_class & BYTE_IFS))
+				continue;
+			rc = match_at(ptokenizer->ifs, ptokenizer->ifslen, p, eob, is_final);
+			if (rc == TRUE)
+				return SEP_IFS;
+		} else {
+			if (!(byte_class & BYTE_IRS))
+				continue;
+			rc = match_at(ptokenizer->irs, ptokenizer->irslen, p, eob, is_final);
+			if (rc == TRUE)
+				return SEP_IRS;
+		}
+		if (rc == SEP_NEED_MORE)
+			return SEP_NEED_MORE;
+	}
+	return SEP_NONE;
+}
+
+// Notes where a scan cut off by eob left off: in the field starting at field_start, carrying on
+// from scan_at, or from the field's start if that's NULL.
+static int need_more(csv_tokenizer_t* ptokenizer, char* sol, char* field_start, char* scan_at,
+	int has_escapes)
+{
+	ptokenizer->resume_field_offset = field_start - sol;
+	ptokenizer->resume_scan_offset  = (scan_at == NULL) ? -1 : scan_at - sol;
+	ptokenizer->resume_has_escapes  = has_escapes;
+	return CSV_TOKENIZER_NEED_MORE;
+}
+
+// ----------------------------------------------------------------
+int csv_tokenizer_scan(csv_tokenizer_t* ptokenizer, char* sol, char* eob, int is_final, char** pend,
+	long long ilno)
+{
+	unsigned char* byte_classes = ptokenizer->byte_classes;
+	ptokenizer->line_term = LINE_TERM_NONE;
+
+	// Carry on from where the previous scan of this record left off, if it was cut short.
+	char* p = sol;
+	char* resume_at = NULL;
+	int resume_has_escapes = FALSE;
+	if (ptokenizer->resume_field_offset >= 0) {
+		p = sol + ptokenizer->resume_field_offset;
+		if (ptokenizer->resume_scan_offset >= 0)
+			resume_at = sol + ptokenizer->resume_scan_offset;
+		resume_has_escapes = ptokenizer->resume_has_escapes;
+		ptokenizer->resume_field_offset = -1;
+	} else {
+		ptokenizer->num_slices = 0;
+		if (sol >= eob)
+			return is_final ? CSV_TOKENIZER_EOF : CSV_TOKENIZER_NEED_MORE;
+	}
+
+	// Loop over fields in record
+	while (TRUE) {
+		if (p < eob && *p == '"') { // DOUBLE-QUOTED
+			char* start = p + 1;
+			char* q = start;
+			int has_escapes = FALSE;
+			if (resume_at != NULL) {
+				q = resume_at;
+				has_escapes = resume_has_escapes;
+				resume_at = NULL;
+			}
+			while (TRUE) {
+				q = memchr(q, '"', eob - q);
+				if (q == NULL) {
+					if (!is_final)
+						return need_more(ptokenizer, sol, p, eob, has_escapes);
+					fprintf(stderr, "%s: unmatched double quote at line %lld.\n",
+						MLR_GLOBALS.bargv0, ilno);
+					exit(1);
+				}
+
+				char* r = q + 1;
+				if (r >= eob) { // end of record
+					if (!is_final)
+						return need_more(ptokenizer, sol, p, q, has_escapes);
+					add_slice(ptokenizer, sol, start, q - start, FIELD_QUOTED_ON_INPUT, has_escapes);
+					*pend = eob;
+					return CSV_TOKENIZER_RECORD;
+				}
+
+				if (*r == '"') { // RFC-4180 CSV: "" inside a dquoted field is an escape for "
+					has_escapes = TRUE;
+					q = r + 1;
+					continue;
+				}
+
+				if (ptokenizer->do_auto_line_term && *r == '\r') {
+					if (r + 1 >= eob && !is_final)
+						return need_more(ptokenizer, sol, p, q, has_escapes);
+					if (r + 1 < eob && r[1] == '\n') { // end of record
+						add_slice(ptokenizer, sol, start, q - start, FIELD_QUOTED_ON_INPUT, has_escapes);
+						ptokenizer->line_term = LINE_TERM_CRLF;
+						*pend = r + 2;
+						return CSV_TOKENIZER_RECORD;
+					}
+				} else if (byte_classes[(unsigned char)*r] & (BYTE_IFS|BYTE_IRS)) {
+					int sep = match_separator(ptokenizer, r, eob, is_final);
+					if (sep == SEP_NEED_MORE)
+						return need_more(ptokenizer, sol, p, q, has_escapes);
+					if (sep == SEP_IFS) { // end of field
+						add_slice(ptokenizer, sol, start, q - start, FIELD_QUOTED_ON_INPUT, has_escapes);
+						p = r + ptokenizer->ifslen;
+						break;
+					}
+					if (sep == SEP_IRS) { // end of record
+						add_slice(ptokenizer, sol, start, q - start, FIELD_QUOTED_ON_INPUT, has_escapes);
+						ptokenizer->line_term = LINE_TERM_LF;
+						*pend = r + ptokenizer->irslen;
+						return CSV_TOKENIZER_RECORD;
+					}
+				}
+
+				// Any other double quote within the field is taken literally.
+				q = r;
+			}
+
+		} else { // NOT DOUBLE-QUOTED
+			char* start = p;
+			if (resume_at != NULL) {
+				p = resume_at;
+				resume_at = NULL;
+			}
+			while (TRUE) {
+				while (p < eob && byte_classes[(unsigned char)*p] == 0)
+					p++;
+
+				if (p >= eob) { // end of record
+					if (!is_final)
+						return need_more(ptokenizer, sol, start, p > start ? p : NULL, FALSE);
+					add_slice(ptokenizer, sol, start, p - start, 0, FALSE);
+					*pend = eob;
+					return CSV_TOKENIZER_RECORD;
+				}
+
+				unsigned char byte_class = byte_classes[(unsigned char)*p];
+				if (byte_class & (BYTE_IFS|BYTE_IRS)) {
+					int sep = match_separator(ptokenizer, p, eob, is_final);
+					if (sep == SEP_NEED_MORE)
+						return need_more(ptokenizer, sol, start, p > start ? p : NULL, FALSE);
+					if (sep == SEP_IFS) { // end of field
+						add_slice(ptokenizer, sol, start, p - start, 0, FALSE);
+						p += ptokenizer->ifslen;
+						break;
+					}
+					if (sep == SEP_IRS) { // end of record
+						int length = p - start;
+						// The line-ending '\n' won't be included in the field.
+						if (ptokenizer->do_auto_line_term) {
+							if (length > 0 && p[-1] == '\r') {
+								length--;
+								ptokenizer->line_term = LINE_TERM_CRLF;
+							} else {
+								ptokenizer->line_term = LINE_TERM_LF;
+							}
+						}
+						add_slice(ptokenizer, sol, start, length, 0, FALSE);
+						*pend = p + ptokenizer->irslen;
+						return CSV_TOKENIZER_RECORD;
+					}
+				}
+
+				if (byte_class & BYTE_DQUOTE) {
+					// CSV syntax error: fields containing quotes must be fully wrapped in quotes
+					fprintf(stderr, "%s: syntax error: unwrapped double quote at line %lld.\n",
+						MLR_GLOBALS.bargv0, ilno);
+					exit(1);
+				}
+
+				p++;
+			}
+		}
+	}
+}
+
+// ----------------------------------------------------------------
+// In place: the result is never longer.
+static void undouble_double_quotes(char* value) {
+	char* r = value;
+	char* w = value;
+	while (*r) {
+		if (r[0] == '"' && r[1] == '"')
+			r++;
+		*w++ = *r++;
+	}
+	*w = 0;
+}
+
+void csv_tokenizer_emit(csv_tokenizer_t* ptokenizer, rslls_t* pfields, char* sol, char* limit,
+	context_t* pctx)
+{
+	for (int i = 0; i < ptokenizer->num_slices; i++) {
+		csv_field_slice_t* pslice = &ptokenizer->pslices[i];
+		char* value = sol + pslice->offset;
+		char free_flag = NO_FREE;
+		if (value + pslice->length >= limit) {
+			// E.g. the last field of an mmapped file not ending in IRS: a null character can't always
+			// be poked there, since that's one byte past the mapping when the file size is a multiple
+			// of the page size.
+			value = mlr_alloc_string_from_char_range(value, pslice->length);
+			free_flag = FREE_ENTRY_VALUE;
+		} else {
+			value[pslice->length] = 0;
+		}
+		if (pslice->has_escapes)
+			undouble_double_quotes(value);
+		rslls_append(pfields, value, free_flag, pslice->quote_flag);
+	}
+
+	if (ptokenizer->do_auto_line_term) {
+		if (ptokenizer->line_term == LINE_TERM_CRLF)
+			context_set_autodetected_crlf(pctx);
+		else if (ptokenizer->line_term == LINE_TERM_LF)
+			context_set_autodetected_lf(pctx);
+	}
+}
@@ -0,0 +1,80 @@
+// ================================================================
+// Record splitter for the RFC-CSV readers (mmap and stdio), working on a contiguous range of
+// bytes rather than a character at a time.
+//
+// A 256-entry table classifies each byte as ordinary or as possibly starting a field separator,
+// record separator, or double quote. Runs of ordinary bytes are skipped with one table lookup per
+// byte; multi-character IFS/IRS are compared only where their first byte is seen. Within
+// double-quoted fields, memchr finds the next double quote.
+//
+// Splitting is done in two steps so that the stdio reader can retry a record which is cut off
+// by the end of its buffer:
+// * csv_tokenizer_scan finds the fields of the next record as slices of the input, modifying
+//   nothing. If the range ends mid-record and isn't the end of input, it says so, and the caller
+//   can read more and scan again from the same start of record. The tokenizer remembers where it
+//   left off, so the second scan looks only at the new bytes: a long record arriving in many
+//   pieces is scanned once in all, not once per piece.
+// * csv_tokenizer_emit then null-terminates the fields in place (un-doubling "" within quoted
+//   fields) and appends them to a list.
+// ================================================================
+
+#ifndef CSV_TOKENIZER_H
+#define CSV_TOKENIZER_H
+
+#include "lib/context.h"
+#include "containers/rslls.h"
+
+// Return values from csv_tokenizer_scan
+#define CSV_TOKENIZER_EOF       0
+#define CSV_TOKENIZER_RECORD    1
+#define CSV_TOKENIZER_NEED_MORE 2
+
+typedef struct _csv_field_slice_t {
+	int   offset; // From the start of the record
+	int   length;
+	char  quote_flag;  // FIELD_QUOTED_ON_INPUT or 0
+	char  has_escapes; // "" within the double quotes
+} csv_field_slice_t;
+
+typedef struct _csv_tokenizer_t {
+	char* ifs;
+	int   ifslen;
+	char* irs;
+	int   irslen;
+	int   do_auto_line_term;
+	unsigned char byte_classes[256];
+
+	// Fields of the most recently scanned record
+	csv_field_slice_t* pslices;
+	int   num_slices;
+	int   max_slices;
+	// For line-ending autodetect: whether the record ended in LF, CRLF, or end of input.
+	int   line_term;
+
+	// After CSV_TOKENIZER_NEED_MORE: the field in progress, and where within it to carry on
+	// (-1 for its start), as offsets from the start of the record. Otherwise -1.
+	int   resume_field_offset;
+	int   resume_scan_offset;
+	int   resume_has_escapes;
+} csv_tokenizer_t;
+
+// With IRS "auto", records end in LF or CRLF.
+csv_tokenizer_t* csv_tokenizer_alloc(char* irs, char* ifs);
+void csv_tokenizer_free(csv_tokenizer_t* ptokenizer);
+
+// Finds the fields of the record starting at sol, within [sol, eob). If is_final is false, bytes
+// past eob may follow, and CSV_TOKENIZER_NEED_MORE is returned if the record may continue past
+// eob. The next call must then be for the same record, with the bytes seen so far unchanged
+// though possibly moved, and more after them. On CSV_TOKENIZER_RECORD, *pend is the start of the
+// next record. The line number is for error messages.
+int csv_tokenizer_scan(csv_tokenizer_t* ptokenizer, char* sol, char* eob, int is_final, char** pend,
+	long long ilno);
+
+// Appends the fields of the scanned record to pfields, where sol is the start of the record's
+// bytes, which may since have been copied elsewhere. Fields are null-terminated in place, except
+// that a field ending at or past limit is copied out instead. Sets the line-ending autodetect in
+// the context.
+void csv_tokenizer_emit(csv_tokenizer_t* ptokenizer, rslls_t* pfields, char* sol, char* limit,
+	context_t* pctx);
+
+#endif // CSV_TOKENIZER_H
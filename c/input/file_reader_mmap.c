@@ -13,6 +13,8 @@
 static char empty_buf[1] = { 0 };
 #endif
 
+static void file_reader_mmap_map_window(file_reader_mmap_state_t* pstate, off_t offset, size_t length);
+
 // ----------------------------------------------------------------
 file_reader_mmap_state_t* file_reader_mmap_open(char* prepipe, char* file_name) {
 #if MLR_ARCH_MMAP_ENABLED
@@ -24,6 +26,7 @@ file_reader_mmap_state_t* file_reader_mmap_open(char* prepipe, char* file_name)
 	}
 
 	file_reader_mmap_state_t* pstate = mlr_malloc_or_die(sizeof(file_reader_mmap_state_t));
+	pstate->is_read_only = FALSE;
 	pstate->fd = open(file_name, O_RDONLY);
 	if (pstate->fd < 0) {
 		perror("open");
@@ -46,8 +49,13 @@ file_reader_mmap_state_t* file_reader_mmap_open(char* prepipe, char* file_name)
 			fprintf(stderr, "%s: could not mmap \"%s\"\n", MLR_GLOBALS.bargv0, file_name);
 			exit(1);
 		}
+		madvise(pstate->sol, (size_t)stat.st_size, MADV_SEQUENTIAL);
 	}
+	pstate->sof = pstate->sol;
 	pstate->eof = pstate->sol + stat.st_size;
+	pstate->file_size = stat.st_size;
+	pstate->window_offset = 0;
+	pstate->window_size = stat.st_size;
 	// POSIX semantics: the mmap itself increments a reference count to the file, in addition to the
 	// open.  We close the file but keep the mmap reference until a subsequent munmap.
 	if (close(pstate->fd) < 0) {
@@ -63,13 +71,117 @@ file_reader_mmap_state_t* file_reader_mmap_open(char* prepipe, char* file_name)
 }
 
 // ----------------------------------------------------------------
-// Here we intentionally do not munmap.
+// Here the file stays open, for mapping subsequent windows.
+file_reader_mmap_state_t* file_reader_mmap_open_read_only(char* prepipe, char* file_name, size_t window_size) {
+#if MLR_ARCH_MMAP_ENABLED
+	if (prepipe != NULL) {
+		fprintf(stderr, "%s: coding error detected in file %s at line %d.\n",
+			MLR_GLOBALS.bargv0, __FILE__, __LINE__);
+		exit(1);
+	}
+
+	file_reader_mmap_state_t* pstate = mlr_malloc_or_die(sizeof(file_reader_mmap_state_t));
+	pstate->is_read_only = TRUE;
+	pstate->fd = open(file_name, O_RDONLY);
+	if (pstate->fd < 0) {
+		perror("open");
+		fprintf(stderr, "%s: could not open \"%s\"\n", MLR_GLOBALS.bargv0, file_name);
+		exit(1);
+	}
+	struct stat stat;
+	if (fstat(pstate->fd, &stat) < 0) {
+		perror("fstat");
+		fprintf(stderr, "%s: could not fstat \"%s\"\n", MLR_GLOBALS.bargv0, file_name);
+		exit(1);
+	}
+
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	if (window_size < page_size)
+		window_size = page_size;
+	pstate->window_size = ((window_size + page_size - 1) / page_size) * page_size;
+	pstate->file_size = stat.st_size;
+
+	if (stat.st_size == 0) {
+		// mmap doesn't allow us to map zero-length files but zero-length files do exist.
+		pstate->sof = pstate->sol = pstate->eof = &empty_buf[0];
+		pstate->window_offset = 0;
+	} else {
+		file_reader_mmap_map_window(pstate, 0, pstate->window_size);
+		pstate->sol = pstate->sof;
+	}
+	return pstate;
+#else
+	fprintf(stderr, "%s: mmap is unsupported on this architecture.\n", MLR_GLOBALS.bargv0);
+	exit(1);
+	return NULL;
+#endif
+}
+
+// ----------------------------------------------------------------
+int file_reader_mmap_slide(file_reader_mmap_state_t* pstate) {
+#if MLR_ARCH_MMAP_ENABLED
+	size_t window_length = pstate->eof - pstate->sof;
+	if (pstate->window_offset + (off_t)window_length >= pstate->file_size)
+		return FALSE;
+
+	off_t sol_offset = pstate->window_offset + (pstate->sol - pstate->sof);
+	off_t new_offset = sol_offset - sol_offset % (off_t)sysconf(_SC_PAGESIZE);
+	size_t new_length = (new_offset == pstate->window_offset)
+		? 2 * window_length
+		: pstate->window_size;
+
+	if (munmap(pstate->sof, window_length) < 0) {
+		perror("munmap");
+		exit(1);
+	}
+	file_reader_mmap_map_window(pstate, new_offset, new_length);
+	pstate->sol = pstate->sof + (sol_offset - new_offset);
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+// The length is clipped at end of file.
+static void file_reader_mmap_map_window(file_reader_mmap_state_t* pstate, off_t offset, size_t length) {
+#if MLR_ARCH_MMAP_ENABLED
+	if (offset + (off_t)length > pstate->file_size)
+		length = pstate->file_size - offset;
+	pstate->sof = mmap(NULL, length, PROT_READ, MAP_FILE|MAP_SHARED, pstate->fd, offset);
+	if (pstate->sof == MAP_FAILED) {
+		perror("mmap");
+		fprintf(stderr, "%s: could not mmap %llu bytes at offset %llu.\n", MLR_GLOBALS.bargv0,
+			(unsigned long long)length, (unsigned long long)offset);
+		exit(1);
+	}
+	madvise(pstate->sof, length, MADV_SEQUENTIAL);
+	madvise(pstate->sof, length, MADV_WILLNEED);
+	pstate->eof = pstate->sof + length;
+	pstate->window_offset = offset;
+#endif
+}
+
+// ----------------------------------------------------------------
+// Here we intentionally do not munmap, except for read-only mappings.
 //
 // This method is used by various lrec readers, where lrecs are instantiated with keys/values
 // pointing into mmapped file-contents buffers.  This is done for the sake of performance, to reduce
 // data-copies. But it also means we can't unmap files after ingesting lrecs, since the lrecs in
 // question might be retained after the input-file closes.  Example: mlr sort on multiple files.
+// Readers using read-only mappings copy each record out, so there is nothing pointing into those.
 void file_reader_mmap_close(file_reader_mmap_state_t* pstate, char* prepipe) {
+#if MLR_ARCH_MMAP_ENABLED
+	if (pstate->is_read_only) {
+		if (pstate->eof > pstate->sof && munmap(pstate->sof, pstate->eof - pstate->sof) < 0) {
+			perror("munmap");
+			exit(1);
+		}
+		if (close(pstate->fd) < 0) {
+			perror("close");
+			exit(1);
+		}
+	}
+#endif
 	free(pstate);
 }
 
@@ -5,16 +5,36 @@
 #ifndef FILE_READER_MMAP_H
 #define FILE_READER_MMAP_H
 
+#include <sys/types.h>
+
 typedef struct _file_reader_mmap_state_t {
-	char* sol;
-	char* eof;
-	int   fd;
+	char*  sol;
+	char*  eof;
+	int    fd;
+	char*  sof;
+	int    is_read_only;
+	// For read-only mappings, sof..eof is a window onto the file, starting at window_offset.
+	off_t  file_size;
+	off_t  window_offset;
+	size_t window_size;
 } file_reader_mmap_state_t;
 
+// The default mapping is private and writable, since the mmap readers poke null terminators into it.
 file_reader_mmap_state_t* file_reader_mmap_open(char* prepipe, char* file_name);
 void file_reader_mmap_close(file_reader_mmap_state_t* pstate, char* prepipe);
 
 void* file_reader_mmap_vopen(void* pvstate, char* prepipe, char* file_name);
 void file_reader_mmap_vclose(void* pvstate, void* pvhandle, char* prepipe);
 
+// The read-only mapping is shared, so input pages are never copied and concurrent processes reading
+// the same file can share the page cache. It maps the file window_size bytes at a time (rounded up
+// to the page size), sliding forward as the reader asks, with sequential read-ahead; regions behind
+// the window are unmapped. Hence lrecs must not point into it.
+file_reader_mmap_state_t* file_reader_mmap_open_read_only(char* prepipe, char* file_name, size_t window_size);
+
+// Moves the window to start at the page containing sol, keeping sol valid. If that doesn't move it
+// then the window is doubled in length, so the reader can rescan from sol until it finds the end of a
+// record longer than the window. Returns FALSE when the window already reaches end of file.
+int file_reader_mmap_slide(file_reader_mmap_state_t* pstate);
+
 #endif // FILE_READER_MMAP_H
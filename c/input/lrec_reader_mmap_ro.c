@@ -0,0 +1,213 @@
+// ================================================================
+// Read-only-mmap lrec readers for the line-oriented formats, DKVP and NIDX.
+//
+// The other mmap readers map their input private and writable, and poke null
+// terminators into it in place so that lrec keys and values can point into the
+// mapping. Every page so touched is copied by the kernel. Here the mapping is
+// read-only and shared: each record is located as a (start, length) slice of the
+// mapping, and only that slice is copied out as the record's backing line, which
+// is then split in place just as for the stdio readers. Input pages are never
+// dirtied, concurrent processes reading the same file share the page cache, and
+// since no lrec points into the mapping it needn't outlive the read.
+//
+// So the file is mapped a window at a time, making this usable for files of any
+// size. A record straddling the end of the window is rescanned after sliding the
+// window forward to the start of that record.
+// ================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cli/comment_handling.h"
+#include "lib/mlrutil.h"
+#include "input/file_reader_mmap.h"
+#include "input/lrec_readers.h"
+
+typedef struct _lrec_reader_mmap_ro_state_t lrec_reader_mmap_ro_state_t;
+typedef lrec_t* lrec_reader_mmap_ro_parse_func_t(char* line, lrec_reader_mmap_ro_state_t* pstate);
+
+struct _lrec_reader_mmap_ro_state_t {
+	char* irs;
+	char* ifs;
+	char* ips;
+	int   irslen;
+	int   ifslen;
+	int   ipslen;
+	int   allow_repeat_ifs;
+	int   do_auto_line_term;
+	comment_handling_t comment_handling;
+	char* comment_string;
+	int   comment_string_length;
+	size_t window_size;
+	lrec_reader_mmap_ro_parse_func_t* pparse_func;
+};
+
+static lrec_reader_t* lrec_reader_mmap_ro_alloc(char* irs, char* ifs, char* ips, int allow_repeat_ifs,
+	comment_handling_t comment_handling, char* comment_string, size_t window_size);
+static void    lrec_reader_mmap_ro_free(lrec_reader_t* preader);
+static void*   lrec_reader_mmap_ro_open(void* pvstate, char* prepipe, char* file_name);
+static void    lrec_reader_mmap_ro_sof(void* pvstate, void* pvhandle);
+static lrec_t* lrec_reader_mmap_ro_process(void* pvstate, void* pvhandle, context_t* pctx);
+
+static lrec_t* lrec_reader_mmap_ro_parse_dkvp_single_sep(char* line, lrec_reader_mmap_ro_state_t* pstate);
+static lrec_t* lrec_reader_mmap_ro_parse_dkvp_multi_sep(char* line, lrec_reader_mmap_ro_state_t* pstate);
+static lrec_t* lrec_reader_mmap_ro_parse_nidx_single_sep(char* line, lrec_reader_mmap_ro_state_t* pstate);
+static lrec_t* lrec_reader_mmap_ro_parse_nidx_multi_sep(char* line, lrec_reader_mmap_ro_state_t* pstate);
+
+// ----------------------------------------------------------------
+lrec_reader_t* lrec_reader_mmap_ro_dkvp_alloc(char* irs, char* ifs, char* ips, int allow_repeat_ifs,
+	comment_handling_t comment_handling, char* comment_string, size_t window_size)
+{
+	lrec_reader_t* plrec_reader = lrec_reader_mmap_ro_alloc(irs, ifs, ips, allow_repeat_ifs,
+		comment_handling, comment_string, window_size);
+	lrec_reader_mmap_ro_state_t* pstate = plrec_reader->pvstate;
+	pstate->pparse_func = (pstate->ifslen == 1 && pstate->ipslen == 1)
+		? lrec_reader_mmap_ro_parse_dkvp_single_sep
+		: lrec_reader_mmap_ro_parse_dkvp_multi_sep;
+	return plrec_reader;
+}
+
+lrec_reader_t* lrec_reader_mmap_ro_nidx_alloc(char* irs, char* ifs, int allow_repeat_ifs,
+	comment_handling_t comment_handling, char* comment_string, size_t window_size)
+{
+	lrec_reader_t* plrec_reader = lrec_reader_mmap_ro_alloc(irs, ifs, "", allow_repeat_ifs,
+		comment_handling, comment_string, window_size);
+	lrec_reader_mmap_ro_state_t* pstate = plrec_reader->pvstate;
+	pstate->pparse_func = (pstate->ifslen == 1)
+		? lrec_reader_mmap_ro_parse_nidx_single_sep
+		: lrec_reader_mmap_ro_parse_nidx_multi_sep;
+	return plrec_reader;
+}
+
+static lrec_reader_t* lrec_reader_mmap_ro_alloc(char* irs, char* ifs, char* ips, int allow_repeat_ifs,
+	comment_handling_t comment_handling, char* comment_string, size_t window_size)
+{
+	lrec_reader_t* plrec_reader = mlr_malloc_or_die(sizeof(lrec_reader_t));
+
+	lrec_reader_mmap_ro_state_t* pstate = mlr_malloc_or_die(sizeof(lrec_reader_mmap_ro_state_t));
+	pstate->irs                   = irs;
+	pstate->ifs                   = ifs;
+	pstate->ips                   = ips;
+	pstate->irslen                = strlen(irs);
+	pstate->ifslen                = strlen(ifs);
+	pstate->ipslen                = strlen(ips);
+	pstate->allow_repeat_ifs      = allow_repeat_ifs;
+	pstate->do_auto_line_term     = FALSE;
+	pstate->comment_handling      = comment_handling;
+	pstate->comment_string        = comment_string;
+	pstate->comment_string_length = comment_string == NULL ? 0 : strlen(comment_string);
+	pstate->window_size           = window_size;
+	pstate->pparse_func           = NULL;
+
+	if (streq(irs, "auto")) {
+		// Lines end in "\n" or "\r\n": split on "\n" and check for a preceding "\r".
+		pstate->do_auto_line_term = TRUE;
+		pstate->irs = "\n";
+		pstate->irslen = 1;
+	}
+
+	plrec_reader->pvstate       = (void*)pstate;
+	plrec_reader->popen_func    = lrec_reader_mmap_ro_open;
+	plrec_reader->pclose_func   = file_reader_mmap_vclose;
+	plrec_reader->pprocess_func = lrec_reader_mmap_ro_process;
+	plrec_reader->psof_func     = lrec_reader_mmap_ro_sof;
+	plrec_reader->pfree_func    = lrec_reader_mmap_ro_free;
+
+	return plrec_reader;
+}
+
+static void lrec_reader_mmap_ro_free(lrec_reader_t* preader) {
+	free(preader->pvstate);
+	free(preader);
+}
+
+static void* lrec_reader_mmap_ro_open(void* pvstate, char* prepipe, char* file_name) {
+	lrec_reader_mmap_ro_state_t* pstate = pvstate;
+	return file_reader_mmap_open_read_only(prepipe, file_name, pstate->window_size);
+}
+
+// No-op for stateless readers such as this one.
+static void lrec_reader_mmap_ro_sof(void* pvstate, void* pvhandle) {
+}
+
+// ----------------------------------------------------------------
+// Returns a pointer to the start of the next IRS at or after p, or eof if there is none.
+static char* find_irs(char* p, char* eof, char* irs, int irslen) {
+	if (irslen == 1) {
+		char* q = memchr(p, irs[0], eof - p);
+		return q == NULL ? eof : q;
+	}
+	while (p < eof) {
+		char* q = memchr(p, irs[0], eof - p);
+		if (q == NULL || eof - q < irslen)
+			return eof;
+		if (memcmp(q, irs, irslen) == 0)
+			return q;
+		p = q + 1;
+	}
+	return eof;
+}
+
+static lrec_t* lrec_reader_mmap_ro_process(void* pvstate, void* pvhandle, context_t* pctx) {
+	file_reader_mmap_state_t* phandle = pvhandle;
+	lrec_reader_mmap_ro_state_t* pstate = pvstate;
+
+	while (TRUE) {
+		if (phandle->sol >= phandle->eof) {
+			if (file_reader_mmap_slide(phandle))
+				continue;
+			return NULL;
+		}
+		char* start = phandle->sol;
+		char* end   = find_irs(start, phandle->eof, pstate->irs, pstate->irslen);
+		if (end == phandle->eof && file_reader_mmap_slide(phandle))
+			continue;
+		phandle->sol = (end < phandle->eof) ? end + pstate->irslen : phandle->eof;
+
+		if (pstate->do_auto_line_term) {
+			if (end > start && end[-1] == '\r') {
+				end--;
+				context_set_autodetected_crlf(pctx);
+			} else {
+				context_set_autodetected_lf(pctx);
+			}
+		}
+
+		if (pstate->comment_string != NULL && end - start >= pstate->comment_string_length
+			&& streqn(start, pstate->comment_string, pstate->comment_string_length))
+		{
+			if (pstate->comment_handling == PASS_COMMENTS) {
+				fwrite(start, 1, end - start, stdout);
+				if (pstate->do_auto_line_term)
+					fputs(pctx->auto_line_term, stdout);
+				else
+					fputs(pstate->irs, stdout);
+				fflush(stdout);
+			}
+			continue;
+		}
+
+		char* line = mlr_alloc_string_from_char_range(start, end - start);
+		return pstate->pparse_func(line, pstate);
+	}
+}
+
+// ----------------------------------------------------------------
+// The stdio parsers take ownership of the line, which backs the returned lrec.
+
+static lrec_t* lrec_reader_mmap_ro_parse_dkvp_single_sep(char* line, lrec_reader_mmap_ro_state_t* pstate) {
+	return lrec_parse_stdio_dkvp_single_sep(line, pstate->ifs[0], pstate->ips[0], pstate->allow_repeat_ifs);
+}
+
+static lrec_t* lrec_reader_mmap_ro_parse_dkvp_multi_sep(char* line, lrec_reader_mmap_ro_state_t* pstate) {
+	return lrec_parse_stdio_dkvp_multi_sep(line, pstate->ifs, pstate->ips, pstate->ifslen, pstate->ipslen,
+		pstate->allow_repeat_ifs);
+}
+
+static lrec_t* lrec_reader_mmap_ro_parse_nidx_single_sep(char* line, lrec_reader_mmap_ro_state_t* pstate) {
+	return lrec_parse_stdio_nidx_single_sep(line, pstate->ifs[0], pstate->allow_repeat_ifs);
+}
+
+static lrec_t* lrec_reader_mmap_ro_parse_nidx_multi_sep(char* line, lrec_reader_mmap_ro_state_t* pstate) {
+	return lrec_parse_stdio_nidx_multi_sep(line, pstate->ifs, pstate->ifslen, pstate->allow_repeat_ifs);
+}
@@ -0,0 +1,309 @@
+// ================================================================
+// Reader for Miller's binary record format: see lib/binary_record_format.h.
+//
+// Each record is backed by a single buffer holding its keys, copied from its schema, followed by
+// its values. Values sent as numbers are cached on the record's entries so downstream verbs
+// needn't infer their types.
+// ================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "lib/mlr_globals.h"
+#include "lib/mlrutil.h"
+#include "lib/binary_record_format.h"
+#include "input/file_reader_stdio.h"
+#include "input/lrec_readers.h"
+
+// Schema ids past this are taken as a sign of corrupt input rather than allocated for.
+#define MAX_SCHEMA_ID (1 << 20)
+// Longest string form of a long long, with null terminator
+#define MAX_INT_STRING_LENGTH 21
+
+typedef struct _bin_reader_schema_t {
+	int   num_keys;
+	char* keys;        // Null-terminated keys, one after another
+	int   keys_length; // Including the null terminators
+	int*  key_offsets;
+} bin_reader_schema_t;
+
+typedef struct _lrec_reader_stdio_bin_state_t {
+	int at_start_of_file;
+	bin_reader_schema_t** pschemas; // Indexed by schema id
+	int num_schema_slots;
+	unsigned char* payload;
+	size_t payload_capacity;
+} lrec_reader_stdio_bin_state_t;
+
+static void    lrec_reader_stdio_bin_free(lrec_reader_t* preader);
+static void    lrec_reader_stdio_bin_sof(void* pvstate, void* pvhandle);
+static lrec_t* lrec_reader_stdio_bin_process(void* pvstate, void* pvhandle, context_t* pctx);
+static void    read_header(FILE* input_stream, context_t* pctx);
+static void    read_schema(lrec_reader_stdio_bin_state_t* pstate, FILE* input_stream, context_t* pctx);
+static lrec_t* read_record(lrec_reader_stdio_bin_state_t* pstate, FILE* input_stream, context_t* pctx);
+static void    free_schemas(lrec_reader_stdio_bin_state_t* pstate);
+
+// ----------------------------------------------------------------
+lrec_reader_t* lrec_reader_stdio_bin_alloc() {
+	lrec_reader_t* plrec_reader = mlr_malloc_or_die(sizeof(lrec_reader_t));
+
+	lrec_reader_stdio_bin_state_t* pstate = mlr_malloc_or_die(sizeof(lrec_reader_stdio_bin_state_t));
+	pstate->at_start_of_file = TRUE;
+	pstate->pschemas         = NULL;
+	pstate->num_schema_slots = 0;
+	pstate->payload_capacity = 1024;
+	pstate->payload          = mlr_malloc_or_die(pstate->payload_capacity);
+
+	plrec_reader->pvstate       = (void*)pstate;
+	plrec_reader->popen_func    = file_reader_stdio_vopen;
+	plrec_reader->pclose_func   = file_reader_stdio_vclose;
+	plrec_reader->pprocess_func = lrec_reader_stdio_bin_process;
+	plrec_reader->psof_func     = lrec_reader_stdio_bin_sof;
+	plrec_reader->pfree_func    = lrec_reader_stdio_bin_free;
+
+	return plrec_reader;
+}
+
+static void lrec_reader_stdio_bin_free(lrec_reader_t* preader) {
+	lrec_reader_stdio_bin_state_t* pstate = preader->pvstate;
+	free_schemas(pstate);
+	free(pstate->pschemas);
+	free(pstate->payload);
+	free(pstate);
+	free(preader);
+}
+
+// Schema ids are per file.
+static void lrec_reader_stdio_bin_sof(void* pvstate, void* pvhandle) {
+	lrec_reader_stdio_bin_state_t* pstate = pvstate;
+	pstate->at_start_of_file = TRUE;
+	free_schemas(pstate);
+}
+
+// ----------------------------------------------------------------
+static void bin_input_error(context_t* pctx, char* description) {
+	fprintf(stderr, "%s: %s in binary input \"%s\".\n", MLR_GLOBALS.bargv0, description, pctx->filename);
+	exit(1);
+}
+
+static void not_bin_input_error(context_t* pctx) {
+	fprintf(stderr, "%s: input \"%s\" is not in Miller binary format.\n", MLR_GLOBALS.bargv0, pctx->filename);
+	exit(1);
+}
+
+static unsigned long long read_varint(FILE* input_stream, context_t* pctx) {
+	unsigned long long u = 0ULL;
+	for (int n = 0; n < BIN_MAX_VARINT_LENGTH; n++) {
+		int c = getc(input_stream);
+		if (c == EOF)
+			bin_input_error(pctx, "unexpected end of data");
+		u |= (unsigned long long)(c & 0x7f) << (7 * n);
+		if ((c & 0x80) == 0)
+			return u;
+	}
+	bin_input_error(pctx, "malformed length");
+	return 0ULL; // not reached
+}
+
+static void read_bytes(FILE* input_stream, void* buffer, size_t length, context_t* pctx) {
+	if (fread(buffer, 1, length, input_stream) != length)
+		bin_input_error(pctx, "unexpected end of data");
+}
+
+// ----------------------------------------------------------------
+static lrec_t* lrec_reader_stdio_bin_process(void* pvstate, void* pvhandle, context_t* pctx) {
+	FILE* input_stream = pvhandle;
+	lrec_reader_stdio_bin_state_t* pstate = pvstate;
+
+	while (TRUE) {
+		int block_type = getc(input_stream);
+		if (block_type == EOF)
+			return NULL;
+
+		if (pstate->at_start_of_file && block_type != BIN_BLOCK_HEADER)
+			not_bin_input_error(pctx);
+		pstate->at_start_of_file = FALSE;
+
+		switch (block_type) {
+		case BIN_BLOCK_HEADER:
+			read_header(input_stream, pctx);
+			free_schemas(pstate);
+			break;
+		case BIN_BLOCK_SCHEMA:
+			read_schema(pstate, input_stream, pctx);
+			break;
+		case BIN_BLOCK_RECORD:
+			return read_record(pstate, input_stream, pctx);
+		default:
+			bin_input_error(pctx, "unrecognized block type");
+		}
+	}
+}
+
+// The first byte has already been read.
+static void read_header(FILE* input_stream, context_t* pctx) {
+	char header[BIN_MAGIC_LENGTH];
+	read_bytes(input_stream, header + 1, BIN_MAGIC_LENGTH - 1, pctx);
+	if (memcmp(header + 1, BIN_MAGIC + 1, BIN_MAGIC_LENGTH - 1) != 0)
+		not_bin_input_error(pctx);
+	int version = getc(input_stream);
+	if (version != BIN_VERSION) {
+		fprintf(stderr, "%s: unsupported binary-format version %d in input \"%s\".\n",
+			MLR_GLOBALS.bargv0, version, pctx->filename);
+		exit(1);
+	}
+}
+
+// ----------------------------------------------------------------
+static void read_schema(lrec_reader_stdio_bin_state_t* pstate, FILE* input_stream, context_t* pctx) {
+	unsigned long long id = read_varint(input_stream, pctx);
+	unsigned long long num_keys = read_varint(input_stream, pctx);
+	if (id >= MAX_SCHEMA_ID)
+		bin_input_error(pctx, "schema id out of range");
+	if (num_keys > INT_MAX / sizeof(int))
+		bin_input_error(pctx, "field count out of range");
+
+	if (id >= pstate->num_schema_slots) {
+		int new_num_slots = 2 * id + 16;
+		pstate->pschemas = mlr_realloc_or_die(pstate->pschemas, new_num_slots * sizeof(bin_reader_schema_t*));
+		for (int i = pstate->num_schema_slots; i < new_num_slots; i++)
+			pstate->pschemas[i] = NULL;
+		pstate->num_schema_slots = new_num_slots;
+	}
+
+	bin_reader_schema_t* pschema = pstate->pschemas[id];
+	if (pschema == NULL) {
+		pschema = mlr_malloc_or_die(sizeof(bin_reader_schema_t));
+		pstate->pschemas[id] = pschema;
+	} else {
+		free(pschema->keys);
+		free(pschema->key_offsets);
+	}
+	pschema->num_keys    = num_keys;
+	pschema->key_offsets = mlr_malloc_or_die((num_keys + 1) * sizeof(int));
+	pschema->keys_length = 0;
+	int keys_capacity    = 64;
+	pschema->keys        = mlr_malloc_or_die(keys_capacity);
+
+	for (int i = 0; i < num_keys; i++) {
+		unsigned long long key_length = read_varint(input_stream, pctx);
+		if (key_length >= INT_MAX - pschema->keys_length - 1)
+			bin_input_error(pctx, "key length out of range");
+		if (pschema->keys_length + key_length + 1 > keys_capacity) {
+			while (pschema->keys_length + key_length + 1 > keys_capacity)
+				keys_capacity *= 2;
+			pschema->keys = mlr_realloc_or_die(pschema->keys, keys_capacity);
+		}
+		char* key = pschema->keys + pschema->keys_length;
+		read_bytes(input_stream, key, key_length, pctx);
+		key[key_length] = 0;
+		pschema->key_offsets[i] = pschema->keys_length;
+		pschema->keys_length += key_length + 1;
+	}
+}
+
+static void free_schemas(lrec_reader_stdio_bin_state_t* pstate) {
+	for (int i = 0; i < pstate->num_schema_slots; i++) {
+		bin_reader_schema_t* pschema = pstate->pschemas[i];
+		if (pschema != NULL) {
+			free(pschema->keys);
+			free(pschema->key_offsets);
+			free(pschema);
+			pstate->pschemas[i] = NULL;
+		}
+	}
+}
+
+// ----------------------------------------------------------------
+// Copies a length-prefixed string from the payload at *pp to the record buffer at *pq, null-terminating it.
+static char* decode_string(unsigned char** pp, unsigned char* end, char** pq, context_t* pctx) {
+	unsigned long long length;
+	int n = bin_get_varint(*pp, end, &length);
+	if (n == 0 || length > end - *pp - n)
+		bin_input_error(pctx, "malformed value");
+	char* value = *pq;
+	memcpy(value, *pp + n, length);
+	value[length] = 0;
+	*pp += n + length;
+	*pq += length + 1;
+	return value;
+}
+
+static long long decode_int(unsigned char** pp, unsigned char* end, context_t* pctx) {
+	unsigned long long u;
+	int n = bin_get_varint(*pp, end, &u);
+	if (n == 0)
+		bin_input_error(pctx, "malformed value");
+	*pp += n;
+	return bin_zigzag_decode(u);
+}
+
+static lrec_t* read_record(lrec_reader_stdio_bin_state_t* pstate, FILE* input_stream, context_t* pctx) {
+	unsigned long long id = read_varint(input_stream, pctx);
+	unsigned long long payload_length = read_varint(input_stream, pctx);
+	if (id >= pstate->num_schema_slots || pstate->pschemas[id] == NULL)
+		bin_input_error(pctx, "record with undefined schema");
+	bin_reader_schema_t* pschema = pstate->pschemas[id];
+	if (payload_length > INT_MAX)
+		bin_input_error(pctx, "record length out of range");
+
+	if (payload_length > pstate->payload_capacity) {
+		while (payload_length > pstate->payload_capacity)
+			pstate->payload_capacity *= 2;
+		pstate->payload = mlr_realloc_or_die(pstate->payload, pstate->payload_capacity);
+	}
+	read_bytes(input_stream, pstate->payload, payload_length, pctx);
+
+	// Each value takes at least as many bytes in the record buffer as in the payload, less its
+	// type byte, plus a null terminator -- except ints sent without their string form.
+	char* buffer = mlr_malloc_or_die(pschema->keys_length + payload_length
+		+ (size_t)pschema->num_keys * MAX_INT_STRING_LENGTH);
+	memcpy(buffer, pschema->keys, pschema->keys_length);
+	lrec_t* prec = lrec_bin_alloc(buffer);
+
+	char* q = buffer + pschema->keys_length;
+	unsigned char* p = pstate->payload;
+	unsigned char* end = p + payload_length;
+	for (int i = 0; i < pschema->num_keys; i++) {
+		char* key = buffer + pschema->key_offsets[i];
+		if (p >= end)
+			bin_input_error(pctx, "record shorter than its schema");
+		int value_type = *p++;
+		switch (value_type) {
+
+		case BIN_VALUE_STRING:
+			lrec_put(prec, key, decode_string(&p, end, &q, pctx), NO_FREE);
+			break;
+
+		case BIN_VALUE_INT: {
+			long long intv = decode_int(&p, end, pctx);
+			char* value = q;
+			q += snprintf(value, MAX_INT_STRING_LENGTH, "%lld", intv) + 1;
+			lrec_put_int(prec, key, value, NO_FREE, intv);
+			break;
+		}
+
+		case BIN_VALUE_INT_TEXT: {
+			long long intv = decode_int(&p, end, pctx);
+			lrec_put_int(prec, key, decode_string(&p, end, &q, pctx), NO_FREE, intv);
+			break;
+		}
+
+		case BIN_VALUE_FLOAT_TEXT: {
+			if (end - p < BIN_FLOAT_LENGTH)
+				bin_input_error(pctx, "malformed value");
+			double fltv = bin_get_float(p);
+			p += BIN_FLOAT_LENGTH;
+			lrec_put_float(prec, key, decode_string(&p, end, &q, pctx), NO_FREE, fltv);
+			break;
+		}
+
+		default:
+			bin_input_error(pctx, "unrecognized value type");
+		}
+	}
+	if (p != end)
+		bin_input_error(pctx, "record longer than its schema");
+
+	return prec;
+}
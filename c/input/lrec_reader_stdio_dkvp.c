@@ -27,6 +27,9 @@ typedef struct _lrec_reader_stdio_dkvp_state_t {
 	comment_handling_t comment_handling;
 	char*  comment_string;
 	size_t line_length;
+	int    do_auto_line_term;
+	mlr_regex_t* pline_filter_regex;
+	int    invert_line_filter;
 } lrec_reader_stdio_dkvp_state_t;
 
 static void    lrec_reader_stdio_dkvp_free(lrec_reader_t* preader);
@@ -43,10 +46,12 @@ static lrec_t* lrec_reader_stdio_dkvp_process_multi_irs_single_others(void* pvst
 	context_t* pctx);
 static lrec_t* lrec_reader_stdio_dkvp_process_multi_irs_multi_others(void* pvstate, void* pvhandle,
 	context_t* pctx);
+static lrec_t* lrec_reader_stdio_dkvp_process_line_filtered(void* pvstate, void* pvhandle,
+	context_t* pctx);
 
 // ----------------------------------------------------------------
 lrec_reader_t* lrec_reader_stdio_dkvp_alloc(char* irs, char* ifs, char* ips, int allow_repeat_ifs,
-	comment_handling_t comment_handling, char* comment_string)
+	comment_handling_t comment_handling, char* comment_string, mlr_regex_t* pline_filter_regex, int invert_line_filter)
 {
 	lrec_reader_t* plrec_reader = mlr_malloc_or_die(sizeof(lrec_reader_t));
 
@@ -62,6 +67,9 @@ lrec_reader_t* lrec_reader_stdio_dkvp_alloc(char* irs, char* ifs, char* ips, int
 	pstate->comment_string   = comment_string;
 	// This is used to track nominal line length over the file read. Bootstrap with a default length.
 	pstate->line_length      = MLR_ALLOC_READ_LINE_INITIAL_SIZE;
+	pstate->do_auto_line_term  = FALSE;
+	pstate->pline_filter_regex = pline_filter_regex;
+	pstate->invert_line_filter = invert_line_filter;
 
 	plrec_reader->pvstate       = (void*)pstate;
 	plrec_reader->popen_func    = file_reader_stdio_vopen;
@@ -73,6 +81,7 @@ lrec_reader_t* lrec_reader_stdio_dkvp_alloc(char* irs, char* ifs, char* ips, int
 		// if that is '\r'.
 		pstate->irs = "\n";
 		pstate->irslen = 1;
+		pstate->do_auto_line_term = TRUE;
 		plrec_reader->pprocess_func = (pstate->ifslen == 1 && pstate->ipslen == 1)
 			? lrec_reader_stdio_dkvp_process_single_irs_single_others_auto_line_term
 			: lrec_reader_stdio_dkvp_process_single_irs_multi_others_auto_line_term;
@@ -85,6 +94,8 @@ lrec_reader_t* lrec_reader_stdio_dkvp_alloc(char* irs, char* ifs, char* ips, int
 			? &lrec_reader_stdio_dkvp_process_multi_irs_single_others
 			: &lrec_reader_stdio_dkvp_process_multi_irs_multi_others;
 	}
+	if (pline_filter_regex != NULL)
+		plrec_reader->pprocess_func = lrec_reader_stdio_dkvp_process_line_filtered;
 	plrec_reader->psof_func     = lrec_reader_stdio_dkvp_sof;
 	plrec_reader->pfree_func    = lrec_reader_stdio_dkvp_free;
 
@@ -92,6 +103,11 @@ lrec_reader_t* lrec_reader_stdio_dkvp_alloc(char* irs, char* ifs, char* ips, int
 }
 
 static void lrec_reader_stdio_dkvp_free(lrec_reader_t* preader) {
+	lrec_reader_stdio_dkvp_state_t* pstate = preader->pvstate;
+	if (pstate->pline_filter_regex != NULL) {
+		mlr_regfree(pstate->pline_filter_regex);
+		free(pstate->pline_filter_regex);
+	}
 	free(preader->pvstate);
 	free(preader);
 }
@@ -195,6 +211,44 @@ static lrec_t* lrec_reader_stdio_dkvp_process_multi_irs_multi_others(void* pvsta
 			pstate->allow_repeat_ifs);
 }
 
+// ----------------------------------------------------------------
+// For "mlr grep -a": lines are matched against the regex as read, and those
+// not passing are discarded without being split into fields. Since this is
+// selected at alloc time only when there is a filter, the other process
+// methods don't pay for it.
+static lrec_t* lrec_reader_stdio_dkvp_process_line_filtered(void* pvstate, void* pvhandle, context_t* pctx) {
+	FILE* input_stream = pvhandle;
+	lrec_reader_stdio_dkvp_state_t* pstate = pvstate;
+
+	while (TRUE) {
+		char* line = NULL;
+		if (pstate->irslen == 1) {
+			line = pstate->comment_handling == COMMENTS_ARE_DATA
+				? mlr_alloc_read_line_single_delimiter(input_stream, pstate->irs[0],
+					&pstate->line_length, pstate->do_auto_line_term, pctx)
+				: mlr_alloc_read_line_single_delimiter_stripping_comments(input_stream, pstate->irs[0],
+					&pstate->line_length, pstate->do_auto_line_term, pstate->comment_handling, pstate->comment_string,
+					pctx);
+		} else {
+			line = pstate->comment_handling == COMMENTS_ARE_DATA
+				? mlr_alloc_read_line_multiple_delimiter(input_stream, pstate->irs, pstate->irslen,
+					&pstate->line_length)
+				: mlr_alloc_read_line_multiple_delimiter_stripping_comments(input_stream, pstate->irs, pstate->irslen,
+					&pstate->line_length, pstate->comment_handling, pstate->comment_string);
+		}
+		if (line == NULL)
+			return NULL;
+
+		if (regmatch_or_die(pstate->pline_filter_regex, line, 0, NULL) ^ pstate->invert_line_filter) {
+			return (pstate->ifslen == 1 && pstate->ipslen == 1)
+				? lrec_parse_stdio_dkvp_single_sep(line, pstate->ifs[0], pstate->ips[0], pstate->allow_repeat_ifs)
+				: lrec_parse_stdio_dkvp_multi_sep(line, pstate->ifs, pstate->ips, pstate->ifslen, pstate->ipslen,
+					pstate->allow_repeat_ifs);
+		}
+		free(line);
+	}
+}
+
 // ----------------------------------------------------------------
 // "abc=def,ghi=jkl"
 //      P     F     P
@@ -4,17 +4,40 @@
 #include "input/lrec_readers.h"
 #include "input/byte_readers.h"
 
+static lrec_reader_t* lrec_reader_alloc_read_only(cli_reader_opts_t* popts);
+static mlr_regex_t* line_filter_regex_alloc(cli_reader_opts_t* popts);
+
+// ----------------------------------------------------------------
 lrec_reader_t*  lrec_reader_alloc(cli_reader_opts_t* popts) {
+	if (popts->line_filter_regex != NULL) {
+		// Only for formats having one record per line; the stdio readers do the filtering.
+		if (streq(popts->ifile_fmt, "dkvp")) {
+			return lrec_reader_stdio_dkvp_alloc(popts->irs, popts->ifs, popts->ips, popts->allow_repeat_ifs,
+				popts->comment_handling, popts->comment_string, line_filter_regex_alloc(popts), popts->line_filter_invert);
+		} else if (streq(popts->ifile_fmt, "nidx")) {
+			return lrec_reader_stdio_nidx_alloc(popts->irs, popts->ifs, popts->allow_repeat_ifs,
+				popts->comment_handling, popts->comment_string, line_filter_regex_alloc(popts), popts->line_filter_invert);
+		} else {
+			fprintf(stderr, "%s: input-line filtering is supported only for DKVP and NIDX input formats, not \"%s\".\n",
+				MLR_GLOBALS.bargv0, popts->ifile_fmt);
+			exit(1);
+		}
+	}
+
 	if (streq(popts->ifile_fmt, "gen")) {
 		generator_opts_t* pgopts = &popts->generator_opts;
 		return lrec_reader_gen_alloc(pgopts->field_name, pgopts->start, pgopts->stop, pgopts->step);
+	} else if (popts->use_mmap_for_read && popts->use_mmap_read_only) {
+		// Read-only mappings are supported for the line-oriented formats. The others read
+		// via stdio, which doesn't dirty the page cache either.
+		return lrec_reader_alloc_read_only(popts);
 	} else if (streq(popts->ifile_fmt, "dkvp")) {
 		if (popts->use_mmap_for_read)
 			return lrec_reader_mmap_dkvp_alloc(popts->irs, popts->ifs, popts->ips, popts->allow_repeat_ifs,
 				popts->comment_handling, popts->comment_string);
 		else
 			return lrec_reader_stdio_dkvp_alloc(popts->irs, popts->ifs, popts->ips, popts->allow_repeat_ifs,
-				popts->comment_handling, popts->comment_string);
+				popts->comment_handling, popts->comment_string, NULL, FALSE);
 	} else if (streq(popts->ifile_fmt, "csv")) {
 		if (popts->use_mmap_for_read)
 			return lrec_reader_mmap_csv_alloc(popts->irs, popts->ifs, popts->use_implicit_csv_header,
@@ -35,7 +58,7 @@ lrec_reader_t*  lrec_reader_alloc(cli_reader_opts_t* popts) {
 				popts->comment_handling, popts->comment_string);
 		else
 			return lrec_reader_stdio_nidx_alloc(popts->irs, popts->ifs, popts->allow_repeat_ifs,
-				popts->comment_handling, popts->comment_string);
+				popts->comment_handling, popts->comment_string, NULL, FALSE);
 	} else if (streq(popts->ifile_fmt, "xtab")) {
 		// Use stdio-xtab for comment handling; not supported in the mmap-xtab reader.
 		if (popts->use_mmap_for_read && popts->comment_string == NULL)
@@ -51,11 +74,40 @@ lrec_reader_t*  lrec_reader_alloc(cli_reader_opts_t* popts) {
 		else
 			return lrec_reader_stdio_json_alloc(popts->input_json_flatten_separator,
 				popts->json_array_ingest, popts->irs, popts->comment_handling, popts->comment_string);
+	} else if (streq(popts->ifile_fmt, "bin")) {
+		// Records are read a block at a time with no scanning for separators, so there's
+		// nothing for mmap to save.
+		return lrec_reader_stdio_bin_alloc();
 	} else {
 		return NULL;
 	}
 }
 
+// ----------------------------------------------------------------
+static lrec_reader_t* lrec_reader_alloc_read_only(cli_reader_opts_t* popts) {
+	if (streq(popts->ifile_fmt, "dkvp")) {
+		return lrec_reader_mmap_ro_dkvp_alloc(popts->irs, popts->ifs, popts->ips, popts->allow_repeat_ifs,
+			popts->comment_handling, popts->comment_string, popts->mmap_window_size);
+	} else if (streq(popts->ifile_fmt, "nidx")) {
+		return lrec_reader_mmap_ro_nidx_alloc(popts->irs, popts->ifs, popts->allow_repeat_ifs,
+			popts->comment_handling, popts->comment_string, popts->mmap_window_size);
+	} else {
+		cli_reader_opts_t stdio_opts = *popts;
+		stdio_opts.use_mmap_for_read = FALSE;
+		return lrec_reader_alloc(&stdio_opts);
+	}
+}
+
+// ----------------------------------------------------------------
+static mlr_regex_t* line_filter_regex_alloc(cli_reader_opts_t* popts) {
+	mlr_regex_t* pregex = mlr_malloc_or_die(sizeof(mlr_regex_t));
+	int cflags = REG_NOSUB;
+	if (popts->line_filter_ignore_case)
+		cflags |= REG_ICASE;
+	return regcomp_or_die_quoted(pregex, popts->line_filter_regex, cflags);
+}
+
+// ----------------------------------------------------------------
 lrec_reader_t* lrec_reader_alloc_or_die(cli_reader_opts_t* popts) {
 	lrec_reader_t* plrec_reader = lrec_reader_alloc(popts);
 	if (plrec_reader == NULL) {
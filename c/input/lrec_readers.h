@@ -2,6 +2,7 @@
 #define LREC_READERS_H
 #include "cli/mlrcli.h"
 #include "cli/comment_handling.h"
+#include "lib/mlrregex.h"
 #include "input/lrec_reader.h"
 
 // ----------------------------------------------------------------
@@ -15,14 +16,16 @@ lrec_reader_t* lrec_reader_stdio_csvlite_alloc(char* irs, char* ifs, int allow_r
 	comment_handling_t comment_handling, char* comment_string);
 lrec_reader_t* lrec_reader_stdio_csv_alloc(char* irs, char* ifs, int use_implicit_header,
 	comment_handling_t comment_handling, char* comment_string);
+// For these two, the line-filter regex may be NULL. If not, the reader takes ownership of it.
 lrec_reader_t* lrec_reader_stdio_dkvp_alloc(char* irs, char* ifs, char* ips, int allow_repeat_ifs,
-	comment_handling_t comment_handling, char* comment_string);
+	comment_handling_t comment_handling, char* comment_string, mlr_regex_t* pline_filter_regex, int invert_line_filter);
 lrec_reader_t* lrec_reader_stdio_nidx_alloc(char* irs, char* ifs, int allow_repeat_ifs,
-	comment_handling_t comment_handling, char* comment_string);
+	comment_handling_t comment_handling, char* comment_string, mlr_regex_t* pline_filter_regex, int invert_line_filter);
 lrec_reader_t* lrec_reader_stdio_xtab_alloc(char* ifs, char* ips, int allow_repeat_ips,
 	comment_handling_t comment_handling, char* comment_string);
 lrec_reader_t* lrec_reader_stdio_json_alloc(char* input_json_flatten_separator, json_array_ingest_t json_array_ingest, char* line_term,
 	comment_handling_t comment_handling, char* comment_string);
+lrec_reader_t* lrec_reader_stdio_bin_alloc();
 
 lrec_reader_t* lrec_reader_mmap_csv_alloc(char* irs, char* ifs, int use_implicit_header,
 	comment_handling_t comment_handling, char* comment_string);
@@ -37,6 +40,12 @@ lrec_reader_t* lrec_reader_mmap_xtab_alloc(char* ifs, char* ips, int allow_repea
 lrec_reader_t* lrec_reader_mmap_json_alloc(char* input_json_flatten_separator, json_array_ingest_t json_array_ingest, char* line_term,
 	comment_handling_t comment_handling, char* comment_string);
 
+// For --mmap-ro and for files too large for mmap: see lrec_reader_mmap_ro.c.
+lrec_reader_t* lrec_reader_mmap_ro_dkvp_alloc(char* irs, char* ifs, char* ips, int allow_repeat_ifs,
+	comment_handling_t comment_handling, char* comment_string, size_t window_size);
+lrec_reader_t* lrec_reader_mmap_ro_nidx_alloc(char* irs, char* ifs, int allow_repeat_ifs,
+	comment_handling_t comment_handling, char* comment_string, size_t window_size);
+
 lrec_reader_t* lrec_reader_in_memory_alloc(sllv_t* precords);
 
 // ----------------------------------------------------------------
@@ -0,0 +1,99 @@
+// ================================================================
+// Miller's binary record format (--ibin/--obin), for passing records from one Miller process to
+// another without formatting them as text and then splitting and type-inferring that text again.
+//
+// A stream is a sequence of blocks, each starting with a one-byte block type:
+//
+// * 'M' 'L' 'R' 'B' {version}: stream header. Each file starts with one. Since it resets the
+//   schema table, streams may be concatenated.
+//
+// * 'S' {schema id} {field count} then {length} {key bytes} per field: defines (or redefines) a
+//   schema, i.e. the list of keys shared by the records which follow it. Keys are written once
+//   per schema rather than once per record.
+//
+// * 'R' {schema id} {payload length} {payload}: a record, with one value per key of the schema,
+//   in the schema's order. Each value is a one-byte value type followed by:
+//   o 's' {length} {bytes}: a string, as is.
+//   o 'i' {int}: an int whose string form is its decimal representation.
+//   o 'I' {int} {length} {bytes}: an int, along with its string form, e.g. 0xff.
+//   o 'F' {8 bytes} {length} {bytes}: an IEEE-754 double, little-endian, along with its string
+//     form since floats can be written many ways.
+//   Numbers are sent as such only when the writer knows them to be numeric, so the reader needn't
+//   infer types; the string form is always recoverable exactly.
+//
+// Lengths, counts, and schema ids are unsigned LEB128 varints. Ints are zigzag-encoded and then
+// written as varints.
+// ================================================================
+
+#ifndef BINARY_RECORD_FORMAT_H
+#define BINARY_RECORD_FORMAT_H
+
+#include <string.h>
+
+#define BIN_MAGIC          "MLRB"
+#define BIN_MAGIC_LENGTH   4
+#define BIN_VERSION        1
+
+#define BIN_BLOCK_HEADER   'M' // BIN_MAGIC[0]
+#define BIN_BLOCK_SCHEMA   'S'
+#define BIN_BLOCK_RECORD   'R'
+
+#define BIN_VALUE_STRING     's'
+#define BIN_VALUE_INT        'i'
+#define BIN_VALUE_INT_TEXT   'I'
+#define BIN_VALUE_FLOAT_TEXT 'F'
+
+#define BIN_MAX_VARINT_LENGTH 10
+#define BIN_FLOAT_LENGTH      8
+
+// Returns the number of bytes written, at most BIN_MAX_VARINT_LENGTH.
+static inline int bin_put_varint(unsigned char* p, unsigned long long u) {
+	int n = 0;
+	while (u >= 0x80) {
+		p[n++] = (unsigned char)(u | 0x80);
+		u >>= 7;
+	}
+	p[n++] = (unsigned char)u;
+	return n;
+}
+
+// Returns the number of bytes read, or 0 if the varint is malformed or runs past end.
+static inline int bin_get_varint(unsigned char* p, unsigned char* end, unsigned long long* pu) {
+	unsigned long long u = 0ULL;
+	for (int n = 0; n < BIN_MAX_VARINT_LENGTH && p + n < end; n++) {
+		u |= (unsigned long long)(p[n] & 0x7f) << (7 * n);
+		if ((p[n] & 0x80) == 0) {
+			*pu = u;
+			return n + 1;
+		}
+	}
+	return 0;
+}
+
+static inline unsigned long long bin_zigzag_encode(long long v) {
+	return ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63);
+}
+
+static inline long long bin_zigzag_decode(unsigned long long u) {
+	return (long long)(u >> 1) ^ -(long long)(u & 1);
+}
+
+static inline void bin_put_float(unsigned char* p, double d) {
+	unsigned long long u;
+	memcpy(&u, &d, sizeof(u));
+	for (int i = 0; i < BIN_FLOAT_LENGTH; i++) {
+		p[i] = (unsigned char)u;
+		u >>= 8;
+	}
+}
+
+static inline double bin_get_float(unsigned char* p) {
+	unsigned long long u = 0ULL;
+	for (int i = BIN_FLOAT_LENGTH - 1; i >= 0; i--)
+		u = (u << 8) | p[i];
+	double d;
+	memcpy(&d, &u, sizeof(d));
+	return d;
+}
+
+#endif // BINARY_RECORD_FORMAT_H
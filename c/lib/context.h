@@ -9,6 +9,7 @@ typedef struct _context_t {
 	int       filenum;
 	char*     filename;
 	int       force_eof; // e.g. mlr head
+	int       exit_after_output; // e.g. mlr put --threads after a data error
 
 	char*     ips;
 	char*     ifs;
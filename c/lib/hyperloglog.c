@@ -0,0 +1,196 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "lib/mlrutil.h"
+#include "lib/hyperloglog.h"
+
+// Register values are serialized as 'A' + value. The largest possible value,
+// 64 - HLL_MIN_PRECISION + 1 = 61, serializes to '~'.
+#define HLL_CHAR_BASE 'A'
+
+// ----------------------------------------------------------------
+hll_t* hll_alloc(int precision) {
+	hll_t* phll = mlr_malloc_or_die(sizeof(hll_t));
+	phll->precision     = precision;
+	phll->num_registers = 1 << precision;
+	phll->registers     = mlr_malloc_or_die(phll->num_registers);
+	memset(phll->registers, 0, phll->num_registers);
+	return phll;
+}
+
+void hll_free(hll_t* phll) {
+	if (phll == NULL)
+		return;
+	free(phll->registers);
+	free(phll);
+}
+
+// ----------------------------------------------------------------
+// The FNV-1a hash of hll_hash_update is fast but its high bits, which are
+// used for the register index, are poorly mixed for short inputs. This is the
+// MurmurHash3 finalizer.
+static unsigned long long hll_mix(unsigned long long h) {
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+// Index is the top p bits of the hash; rank is one plus the number of leading
+// zeros in the remaining 64-p bits.
+static inline void hll_index_and_rank(unsigned long long hash, int precision, int* pindex, int* prank) {
+	unsigned long long h = hll_mix(hash);
+	*pindex = (int)(h >> (64 - precision));
+	unsigned long long w = h << precision;
+	int rank = 1;
+	int max_rank = 64 - precision + 1;
+	while (rank < max_rank && !(w & 0x8000000000000000ULL)) {
+		rank++;
+		w <<= 1;
+	}
+	*prank = rank;
+}
+
+void hll_add_hash(hll_t* phll, unsigned long long hash) {
+	int index, rank;
+	hll_index_and_rank(hash, phll->precision, &index, &rank);
+	if (phll->registers[index] < rank)
+		phll->registers[index] = rank;
+}
+
+// ----------------------------------------------------------------
+// Folding a register from precision ps down to pd < ps: the d = ps-pd low
+// bits of the high-precision index become the leading bits of the
+// low-precision remainder.
+static inline int hll_fold_rank(int src_index, int src_rank, int d) {
+	if (d == 0)
+		return src_rank;
+	int low = src_index & ((1 << d) - 1);
+	if (low == 0)
+		return d + src_rank;
+	int log2_low = 0;
+	while (low >>= 1)
+		log2_low++;
+	return d - log2_low;
+}
+
+void hll_merge(hll_t* pdst, hll_t* psrc) {
+	int d = psrc->precision - pdst->precision;
+	for (int j = 0; j < psrc->num_registers; j++) {
+		int rank = psrc->registers[j];
+		if (rank == 0)
+			continue;
+		rank = hll_fold_rank(j, rank, d);
+		int k = j >> d;
+		if (pdst->registers[k] < rank)
+			pdst->registers[k] = rank;
+	}
+}
+
+hll_t* hll_merge_alloc(hll_t* pa, hll_t* pb) {
+	if (pa->precision > pb->precision) {
+		hll_t* ptemp = pa;
+		pa = pb;
+		pb = ptemp;
+	}
+	hll_t* pmerged = hll_alloc(pa->precision);
+	memcpy(pmerged->registers, pa->registers, pa->num_registers);
+	hll_merge(pmerged, pb);
+	return pmerged;
+}
+
+// ----------------------------------------------------------------
+// Raw estimate with the small-range (linear-counting) correction. With 64-bit
+// hashes there is no need for the paper's large-range correction.
+static long long hll_estimate_from_registers(unsigned char* registers, int num_registers, int char_base) {
+	double m = num_registers;
+	double alpha;
+	switch (num_registers) {
+	case 16: alpha = 0.673; break;
+	case 32: alpha = 0.697; break;
+	case 64: alpha = 0.709; break;
+	default: alpha = 0.7213 / (1.0 + 1.079 / m); break;
+	}
+
+	double sum = 0.0;
+	int num_zeros = 0;
+	for (int j = 0; j < num_registers; j++) {
+		int rank = registers[j] - char_base;
+		if (rank == 0)
+			num_zeros++;
+		sum += ldexp(1.0, -rank);
+	}
+
+	double estimate = alpha * m * m / sum;
+	if (estimate <= 2.5 * m && num_zeros > 0)
+		estimate = m * log(m / num_zeros);
+	return (long long)(estimate + 0.5);
+}
+
+long long hll_estimate(hll_t* phll) {
+	return hll_estimate_from_registers(phll->registers, phll->num_registers, 0);
+}
+
+// ----------------------------------------------------------------
+char* hll_to_string(hll_t* phll) {
+	char* s = mlr_malloc_or_die(phll->num_registers + 1);
+	for (int j = 0; j < phll->num_registers; j++)
+		s[j] = HLL_CHAR_BASE + phll->registers[j];
+	s[phll->num_registers] = 0;
+	return s;
+}
+
+char* hll_alloc_empty_string(int precision) {
+	int num_registers = 1 << precision;
+	char* s = mlr_malloc_or_die(num_registers + 1);
+	memset(s, HLL_CHAR_BASE, num_registers);
+	s[num_registers] = 0;
+	return s;
+}
+
+int hll_string_precision(char* s) {
+	int length = strlen(s);
+	if (length > (1 << HLL_MAX_PRECISION))
+		return -1;
+	int precision = 0;
+	while ((1 << precision) < length)
+		precision++;
+	if ((1 << precision) != length || precision < HLL_MIN_PRECISION || precision > HLL_MAX_PRECISION)
+		return -1;
+	return precision;
+}
+
+// Register contents are checked separately from the length so that adding to
+// a serialized sketch, once per record, doesn't need to scan the whole string.
+static int hll_string_registers_are_valid(char* s, int precision) {
+	int max_char = HLL_CHAR_BASE + 64 - precision + 1;
+	for (char* p = s; *p; p++)
+		if (*p < HLL_CHAR_BASE || *p > max_char)
+			return FALSE;
+	return TRUE;
+}
+
+long long hll_string_estimate(char* s, int precision) {
+	if (!hll_string_registers_are_valid(s, precision))
+		return -1LL;
+	return hll_estimate_from_registers((unsigned char*)s, 1 << precision, HLL_CHAR_BASE);
+}
+
+hll_t* hll_from_string(char* s) {
+	int precision = hll_string_precision(s);
+	if (precision < 0 || !hll_string_registers_are_valid(s, precision))
+		return NULL;
+	hll_t* phll = hll_alloc(precision);
+	for (int j = 0; j < phll->num_registers; j++)
+		phll->registers[j] = s[j] - HLL_CHAR_BASE;
+	return phll;
+}
+
+void hll_string_add(char* s, int precision, char* value) {
+	int index, rank;
+	hll_index_and_rank(hll_hash_update(HLL_HASH_SEED, value), precision, &index, &rank);
+	if (s[index] < HLL_CHAR_BASE + rank)
+		s[index] = HLL_CHAR_BASE + rank;
+}
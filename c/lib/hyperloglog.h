@@ -0,0 +1,71 @@
+#ifndef HYPERLOGLOG_H
+#define HYPERLOGLOG_H
+
+// ================================================================
+// HyperLogLog sketches for approximate distinct counting in bounded memory
+// (Flajolet, Fusy, Gandouet, Meunier 2007). A sketch with precision p has 2^p
+// one-byte registers and a relative standard error of about 1.04/sqrt(2^p):
+// e.g. 4KB and 1.6% for the default p = 12.
+//
+// Sketches are mergeable: the sketch of a union of streams is the
+// register-wise max of the streams' sketches. Sketches of different
+// precisions merge at the lower of the two.
+//
+// For use in the DSL, a sketch can be converted to and from a string of 2^p
+// printable characters, one per register.
+// ================================================================
+
+#define HLL_MIN_PRECISION      4
+#define HLL_MAX_PRECISION     18
+#define HLL_DEFAULT_PRECISION 12
+
+#define HLL_HASH_SEED 0xcbf29ce484222325ULL
+
+typedef struct _hll_t {
+	int            precision;
+	int            num_registers;
+	unsigned char* registers;
+} hll_t;
+
+hll_t* hll_alloc(int precision);
+void   hll_free(hll_t* phll);
+
+// For hashing tuples of values, e.g. group-by field values: start from
+// HLL_HASH_SEED and call hll_hash_update once per value.
+static inline unsigned long long hll_hash_update(unsigned long long hash, char* s) {
+	for (unsigned char* p = (unsigned char*)s; *p; p++) {
+		hash ^= *p;
+		hash *= 0x100000001b3ULL;
+	}
+	// Separator, so that ("ab","c") and ("a","bc") hash differently.
+	hash ^= 0xff;
+	hash *= 0x100000001b3ULL;
+	return hash;
+}
+
+void hll_add_hash(hll_t* phll, unsigned long long hash);
+static inline void hll_add(hll_t* phll, char* value) {
+	hll_add_hash(phll, hll_hash_update(HLL_HASH_SEED, value));
+}
+
+// Merges psrc into pdst, which must have precision less than or equal to
+// that of psrc. Use hll_merge_alloc when the precisions may differ.
+void   hll_merge(hll_t* pdst, hll_t* psrc);
+hll_t* hll_merge_alloc(hll_t* pa, hll_t* pb);
+
+long long hll_estimate(hll_t* phll);
+
+// The caller should free the return value.
+char*  hll_to_string(hll_t* phll);
+char*  hll_alloc_empty_string(int precision);
+// Returns NULL if the string isn't a serialized sketch.
+hll_t* hll_from_string(char* s);
+// Returns the precision of a serialized sketch, judging by its length, or -1
+// if the string can't be one.
+int    hll_string_precision(char* s);
+// Returns -1 if the string isn't a serialized sketch of the given precision.
+long long hll_string_estimate(char* s, int precision);
+// Adds a value to a serialized sketch of the given precision, in place.
+void   hll_string_add(char* s, int precision, char* value);
+
+#endif // HYPERLOGLOG_H
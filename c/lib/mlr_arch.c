@@ -3,9 +3,11 @@
 #include <string.h>
 #include "mlr_globals.h"
 #include "mlr_arch.h"
+#ifndef MLR_ON_MSYS2
+#include <sys/resource.h>
+#endif
 #include "mlrutil.h"
 #include "netbsd_strptime.h"
-#include "nlnet_timegm.h"
 
 // For some Linux distros, in spite of including time.h:
 char *strptime(const char *s, const char *format, struct tm *ptm);
@@ -40,34 +42,20 @@ char *mlr_arch_strptime(const char *s, const char *format, struct tm *ptm) {
 }
 
 // ----------------------------------------------------------------
-// See the GNU timegm manpage -- this is what it does.
-time_t mlr_arch_timegm(struct tm* ptm, timezone_handling_t timezone_handling) {
+int mlr_arch_get_rusage(double* puser_seconds, double* psystem_seconds, long long* ppeak_rss_kb) {
 #ifdef MLR_ON_MSYS2
-	// Crap, we're offering limited Windows support :(
-	if (timezone_handling != TIMEZONE_HANDLING_GMT) {
-		fprintf(stderr, "%s: Local timezone is not handled for output.\n",
-			MLR_GLOBALS.bargv0);
-		exit(1);
-	}
-	return nlnet_timegm(ptm);
+	return FALSE;
 #else
-	time_t ret;
-
-	if (timezone_handling == TIMEZONE_HANDLING_GMT) {
-		char* tz = getenv("TZ");
-		mlr_arch_setenv("TZ", "GMT0");
-		tzset();
-		ret = mktime(ptm);
-		if (tz) {
-			mlr_arch_setenv("TZ", tz);
-		} else {
-			mlr_arch_unsetenv("TZ");
-		}
-		tzset();
-	} else {
-		ret = mktime(ptm);
-	}
-
-	return ret;
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return FALSE;
+	*puser_seconds   = (double)usage.ru_utime.tv_sec + (double)usage.ru_utime.tv_usec * 1e-6;
+	*psystem_seconds = (double)usage.ru_stime.tv_sec + (double)usage.ru_stime.tv_usec * 1e-6;
+#ifdef __APPLE__
+	*ppeak_rss_kb = (long long)usage.ru_maxrss / 1024LL; // bytes on MacOSX
+#else
+	*ppeak_rss_kb = (long long)usage.ru_maxrss;
+#endif
+	return TRUE;
 #endif
 }
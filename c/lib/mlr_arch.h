@@ -3,7 +3,6 @@
 
 #include <stdio.h>
 #include <time.h>
-#include "mlrtimezone.h"
 
 // ================================================================
 // Miller compiles without ifdefs on Linux, BSDs, and MacOSX -- but
@@ -31,11 +30,25 @@
 #include <sys/mman.h>
 #endif
 
+// ----------------------------------------------------------------
+// For in-place mode with --jobs, which forks a child process per file.
+#ifdef MLR_ON_MSYS2
+#define MLR_ARCH_FORK_ENABLED 0
+#else
+#define MLR_ARCH_FORK_ENABLED 1
+#include <unistd.h>
+#include <sys/wait.h>
+#include <signal.h>
+#endif
+
 // ----------------------------------------------------------------
 int mlr_arch_setenv(const char *name, const char *value);
 int mlr_arch_unsetenv(const char *name);
 
 char *mlr_arch_strptime(const char *s, const char *format, struct tm *ptm);
-time_t mlr_arch_timegm(struct tm* ptm, timezone_handling_t timezone_handling);
+
+// User and system CPU seconds and peak resident set size in kilobytes, for this process.
+// Returns FALSE where these aren't available.
+int mlr_arch_get_rusage(double* puser_seconds, double* psystem_seconds, long long* ppeak_rss_kb);
 
 #endif // MLR_ARCH_H
@@ -22,13 +22,33 @@ double get_systime() {
 }
 
 // ----------------------------------------------------------------
-// The essential idea is that we use the library function gmtime to get a struct tm, then strftime
+static mlr_timezone_t* mlr_timezone_from_handling(timezone_handling_t timezone_handling) {
+	switch(timezone_handling) {
+	case TIMEZONE_HANDLING_GMT:
+		return mlr_timezone_get_utc();
+	case TIMEZONE_HANDLING_LOCAL:
+		return mlr_timezone_get_from_env();
+	default:
+		MLR_INTERNAL_CODING_ERROR();
+		return NULL; // not reached
+	}
+}
+
+// ----------------------------------------------------------------
+// The essential idea is that we use the timezone engine to get a struct tm, then strftime
 // to produce a formatted string. The only complication is that we support "%1S" through "%9S" for
 // formatting the seconds with a desired number of decimal places.
 
 char* mlr_alloc_time_string_from_seconds(double seconds_since_the_epoch, char* format_string,
 	timezone_handling_t timezone_handling)
 {
+	return mlr_alloc_time_string_from_seconds_in_zone(seconds_since_the_epoch, format_string,
+		mlr_timezone_from_handling(timezone_handling));
+}
+
+char* mlr_alloc_time_string_from_seconds_in_zone(double seconds_since_the_epoch, char* format_string,
+	mlr_timezone_t* pzone)
+{
 
 	// 1. Split out the integer seconds since the epoch, which the stdlib can handle, and
 	//    the fractional part, which it cannot.
@@ -36,19 +56,7 @@ char* mlr_alloc_time_string_from_seconds(double seconds_since_the_epoch, char* f
 	double fracsec = seconds_since_the_epoch - iseconds;
 
 	struct tm tm;
-	switch(timezone_handling) {
-	case TIMEZONE_HANDLING_GMT:
-		tm = *gmtime(&iseconds); // No gmtime_r on Windows so just use gmtime.
-		break;
-	case TIMEZONE_HANDLING_LOCAL:
-		tm = *localtime(&iseconds); // No gmtime_r on Windows so just use gmtime.
-		break;
-	default:
-		fprintf(stderr, "%s: internal coding error detected in file %s at line %d.\n",
-			MLR_GLOBALS.bargv0, __FILE__, __LINE__);
-		exit(1);
-		break;
-	}
+	mlr_timezone_seconds_to_tm(pzone, iseconds, &tm);
 
 	// 2. See if "%nS" (for n in 1..9) is a substring of the format string.
 	char* middle_nS_format = NULL;
@@ -72,9 +80,9 @@ char* mlr_alloc_time_string_from_seconds(double seconds_since_the_epoch, char* f
 		char* output_string = mlr_malloc_or_die(NZBUFLEN+1);
 		int written_length = strftime(output_string, NZBUFLEN, format_string, &tm);
 		if (written_length > NZBUFLEN || written_length == 0) {
-			fprintf(stderr, "%s: could not strftime(%lf, \"%s\"). See \"%s --help-function strftime\".\n",
+			mlr_print_data_error("%s: could not strftime(%lf, \"%s\"). See \"%s --help-function strftime\".\n",
 				MLR_GLOBALS.bargv0, seconds_since_the_epoch, format_string, MLR_GLOBALS.bargv0);
-			exit(1);
+			mlr_exit_on_data_error();
 		}
 
 		return output_string;
@@ -99,9 +107,9 @@ char* mlr_alloc_time_string_from_seconds(double seconds_since_the_epoch, char* f
 	} else {
 		int written_length = strftime(left_formatted, NZBUFLEN, left_subformat, &tm);
 		if (written_length > NZBUFLEN || written_length == 0) {
-			fprintf(stderr, "%s: could not strftime(%lf, \"%s\"). See \"%s --help-function strftime\".\n",
+			mlr_print_data_error("%s: could not strftime(%lf, \"%s\"). See \"%s --help-function strftime\".\n",
 				MLR_GLOBALS.bargv0, seconds_since_the_epoch, format_string, MLR_GLOBALS.bargv0);
-			exit(1);
+			mlr_exit_on_data_error();
 		}
 	}
 	free(left_subformat);
@@ -113,9 +121,9 @@ char* mlr_alloc_time_string_from_seconds(double seconds_since_the_epoch, char* f
 	char* middle_int_format = "%S";
 	int written_length = strftime(middle_int_formatted, NZBUFLEN, middle_int_format, &tm);
 	if (written_length > NZBUFLEN || written_length == 0) {
-		fprintf(stderr, "%s: could not strftime(%lf, \"%s\"). See \"%s --help-function strftime\".\n",
+		mlr_print_data_error("%s: could not strftime(%lf, \"%s\"). See \"%s --help-function strftime\".\n",
 			MLR_GLOBALS.bargv0, seconds_since_the_epoch, format_string, MLR_GLOBALS.bargv0);
-		exit(1);
+		mlr_exit_on_data_error();
 	}
 
 	// 7. Do the fractional-seconds part. One key point is that sprintf always writes a leading zero,
@@ -136,9 +144,9 @@ char* mlr_alloc_time_string_from_seconds(double seconds_since_the_epoch, char* f
 	} else {
 		int written_length = strftime(right_formatted, NZBUFLEN, right_subformat, &tm);
 		if (written_length > NZBUFLEN || written_length == 0) {
-			fprintf(stderr, "%s: could not strftime(%lf, \"%s\"). See \"%s --help-function strftime\".\n",
+			mlr_print_data_error("%s: could not strftime(%lf, \"%s\"). See \"%s --help-function strftime\".\n",
 				MLR_GLOBALS.bargv0, seconds_since_the_epoch, format_string, MLR_GLOBALS.bargv0);
-			exit(1);
+			mlr_exit_on_data_error();
 		}
 	}
 
@@ -172,6 +180,13 @@ char* mlr_alloc_time_string_from_seconds(double seconds_since_the_epoch, char* f
 
 double mlr_seconds_from_time_string(char* time_string, char* format_string,
 	timezone_handling_t timezone_handling)
+{
+	return mlr_seconds_from_time_string_in_zone(time_string, format_string,
+		mlr_timezone_from_handling(timezone_handling));
+}
+
+double mlr_seconds_from_time_string_in_zone(char* time_string, char* format_string,
+	mlr_timezone_t* pzone)
 {
 	struct tm tm;
 
@@ -180,11 +195,11 @@ double mlr_seconds_from_time_string(char* time_string, char* format_string,
 	char* strptime_retval = mlr_arch_strptime(time_string, format_string, &tm);
 	if (strptime_retval != NULL) {
 		if (*strptime_retval != 0) { // Extraneous stuff in the input not matching the format
-			fprintf(stderr, "%s: could not strptime(\"%s\", \"%s\"). See \"%s --help-function strptime\".\n",
+			mlr_print_data_error("%s: could not strptime(\"%s\", \"%s\"). See \"%s --help-function strptime\".\n",
 				MLR_GLOBALS.bargv0, time_string, format_string, MLR_GLOBALS.bargv0);
-			exit(1);
+			mlr_exit_on_data_error();
 		}
-		return (double)mlr_arch_timegm(&tm, timezone_handling);
+		return (double)mlr_timezone_tm_to_seconds(pzone, &tm);
 	}
 
 	// 2. Now either there's floating-point seconds in the input, or something else is wrong.
@@ -195,9 +210,9 @@ double mlr_seconds_from_time_string(char* time_string, char* format_string,
 	if (pS == NULL) {
 		// strptime failure couldn't have been because of floating-point-seconds stuff. No
 		// reason to try any harder.
-		fprintf(stderr, "%s: could not strptime(\"%s\", \"%s\"). See \"%s --help-function strptime\".\n",
+		mlr_print_data_error("%s: could not strptime(\"%s\", \"%s\"). See \"%s --help-function strptime\".\n",
 			MLR_GLOBALS.bargv0, time_string, format_string, MLR_GLOBALS.bargv0);
-		exit(1);
+		mlr_exit_on_data_error();
 	}
 
 	// There's "%S" in the format string, and the input has fractional seconds matching that
@@ -220,9 +235,9 @@ double mlr_seconds_from_time_string(char* time_string, char* format_string,
 	//    Example return value: ".123456 TZBLAHBLAH"
 	strptime_retval = mlr_arch_strptime(time_string, truncated_format_string, &tm);
 	if (strptime_retval == NULL) {
-		fprintf(stderr, "%s: could not strptime(\"%s\", \"%s\"). See \"%s --help-function strptime\".\n",
+		mlr_print_data_error("%s: could not strptime(\"%s\", \"%s\"). See \"%s --help-function strptime\".\n",
 			MLR_GLOBALS.bargv0, time_string, format_string, MLR_GLOBALS.bargv0);
-		exit(1);
+		mlr_exit_on_data_error();
 	}
 	free(truncated_format_string);
 
@@ -240,9 +255,9 @@ double mlr_seconds_from_time_string(char* time_string, char* format_string,
 		fractional_seconds = strtod(strptime_retval, &stuff_after);
 		if (stuff_after == strptime_retval) {
 			// Non-parseable
-			fprintf(stderr, "%s: could not strptime(\"%s\", \"%s\"). See \"%s --help-function strptime\".\n",
+			mlr_print_data_error("%s: could not strptime(\"%s\", \"%s\"). See \"%s --help-function strptime\".\n",
 				MLR_GLOBALS.bargv0, time_string, format_string, MLR_GLOBALS.bargv0);
-			exit(1);
+			mlr_exit_on_data_error();
 		}
 	}
 
@@ -258,17 +273,17 @@ double mlr_seconds_from_time_string(char* time_string, char* format_string,
 	memset(&tm, 0, sizeof(tm));
 	strptime_retval = mlr_arch_strptime(elided_fraction_input, format_string, &tm);
 	if (strptime_retval == NULL) {
-		fprintf(stderr, "%s: could not strptime(\"%s\", \"%s\"). See \"%s --help-function strptime\".\n",
+		mlr_print_data_error("%s: could not strptime(\"%s\", \"%s\"). See \"%s --help-function strptime\".\n",
 			MLR_GLOBALS.bargv0, time_string, format_string, MLR_GLOBALS.bargv0);
-		exit(1);
+		mlr_exit_on_data_error();
 	}
 	if (*strptime_retval != 0) { // Extraneous stuff in the input not matching the format
-		fprintf(stderr, "%s: could not strptime(\"%s\", \"%s\"). See \"%s --help-function strptime\".\n",
+		mlr_print_data_error("%s: could not strptime(\"%s\", \"%s\"). See \"%s --help-function strptime\".\n",
 			MLR_GLOBALS.bargv0, time_string, format_string, MLR_GLOBALS.bargv0);
-		exit(1);
+		mlr_exit_on_data_error();
 	}
 	free(elided_fraction_input);
 
 	// 8. Convert the tm to a time_t (seconds since the epoch) and then add the fractional seconds.
-	return mlr_arch_timegm(&tm, timezone_handling) + fractional_seconds;
+	return mlr_timezone_tm_to_seconds(pzone, &tm) + fractional_seconds;
 }
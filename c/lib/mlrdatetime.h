@@ -10,11 +10,18 @@
 // Seconds since the epoch.
 double get_systime();
 
-// These use the gmtime/timegm and strftime/strptime standard-library functions, with the addition
-// of support for floating-point seconds since the epoch.
+// These use the strftime/strptime standard-library functions, with the addition of support for
+// floating-point seconds since the epoch. Conversion between seconds and broken-down time is done
+// by Miller's own timezone engine rather than gmtime/localtime/mktime: see mlrtimezone.h.
 char* mlr_alloc_time_string_from_seconds(double seconds_since_the_epoch, char* format,
 	timezone_handling_t timezone_handling);
 double mlr_seconds_from_time_string(char* string, char* format,
 	timezone_handling_t timezone_handling);
 
+// Same, but with an explicit timezone rather than UTC or $TZ.
+char* mlr_alloc_time_string_from_seconds_in_zone(double seconds_since_the_epoch, char* format,
+	mlr_timezone_t* pzone);
+double mlr_seconds_from_time_string_in_zone(char* string, char* format,
+	mlr_timezone_t* pzone);
+
 #endif // MLRDATETIME_H
@@ -8,6 +8,10 @@
 #include "lib/mlr_globals.h"
 #include "lib/free_flags.h"
 
+static int compile_fast_path(mlr_regex_t* pregex, char* pattern);
+static int match_literal(const mlr_regex_t* pregex, const char* s, size_t nmatchmax, regmatch_t pmatch[]);
+static int match_classes(const mlr_regex_t* pregex, const char* s, size_t nmatchmax, regmatch_t pmatch[]);
+
 // ----------------------------------------------------------------
 // Succeeds or aborts the process. cflag REG_EXTENDED is already included.
 //
@@ -40,18 +44,27 @@
 //
 // as desired.
 
-regex_t* regcomp_or_die(regex_t* pregex, char* regex_string, int cflags) {
+mlr_regex_t* regcomp_or_die(mlr_regex_t* pregex, char* regex_string, int cflags) {
 	cflags |= REG_EXTENDED;
 	char* doubly_backslashed = mlr_alloc_double_backslash(regex_string);
-	int rc = regcomp(pregex, doubly_backslashed, cflags);
+
+	memset(pregex, 0, sizeof(mlr_regex_t));
+	pregex->ignore_case = (cflags & REG_ICASE) ? TRUE : FALSE;
+	if (!(cflags & REG_NEWLINE) && compile_fast_path(pregex, doubly_backslashed)) {
+		free(doubly_backslashed);
+		return pregex;
+	}
+
+	pregex->kind = MLR_REGEX_KIND_POSIX;
+	int rc = regcomp(&pregex->posix_regex, doubly_backslashed, cflags);
 	free(doubly_backslashed);
 	if (rc != 0) {
-		size_t nbytes = regerror(rc, pregex, NULL, 0);
+		size_t nbytes = regerror(rc, &pregex->posix_regex, NULL, 0);
 		char* errbuf = malloc(nbytes);
-		(void)regerror(rc, pregex, errbuf, nbytes);
-		fprintf(stderr, "%s: could not compile regex \"%s\" : %s\n",
+		(void)regerror(rc, &pregex->posix_regex, errbuf, nbytes);
+		mlr_print_data_error("%s: could not compile regex \"%s\" : %s\n",
 			MLR_GLOBALS.bargv0, regex_string, errbuf);
-		exit(1);
+		mlr_exit_on_data_error();
 	}
 	return pregex;
 }
@@ -60,7 +73,7 @@ regex_t* regcomp_or_die(regex_t* pregex, char* regex_string, int cflags) {
 // If the regex_string is of the form a.*b, compiles it using cflags without REG_ICASE.
 // If the regex_string is of the form "a.*b", compiles a.*b using cflags without REG_ICASE.
 // If the regex_string is of the form "a.*b"i, compiles a.*b using cflags with REG_ICASE.
-regex_t* regcomp_or_die_quoted(regex_t* pregex, char* orig_regex_string, int cflags) {
+mlr_regex_t* regcomp_or_die_quoted(mlr_regex_t* pregex, char* orig_regex_string, int cflags) {
 	cflags |= REG_EXTENDED;
 	if (string_starts_with(orig_regex_string, "\"")) {
 		char* regex_string = mlr_strdup_or_die(orig_regex_string);
@@ -83,30 +96,424 @@ regex_t* regcomp_or_die_quoted(regex_t* pregex, char* orig_regex_string, int cfl
 	return pregex;
 }
 
+void mlr_regfree(mlr_regex_t* pregex) {
+	if (pregex->kind == MLR_REGEX_KIND_POSIX)
+		regfree(&pregex->posix_regex);
+	free(pregex->literal);
+	free(pregex->char_masks);
+	pregex->literal = NULL;
+	pregex->char_masks = NULL;
+}
+
+// ----------------------------------------------------------------
+regex_cache_t* regex_cache_alloc() {
+	regex_cache_t* pcache = mlr_malloc_or_die(sizeof(regex_cache_t));
+	pcache->num_entries = 0;
+	return pcache;
+}
+
+void regex_cache_free(regex_cache_t* pcache) {
+	if (pcache == NULL)
+		return;
+	for (int i = 0; i < pcache->num_entries; i++) {
+		regex_cache_entry_t* pentry = pcache->pentries[i];
+		mlr_regfree(&pentry->regex);
+		free(pentry->regex_string);
+		free(pentry);
+	}
+	free(pcache);
+}
+
+mlr_regex_t* regex_cache_get(regex_cache_t* pcache, char* regex_string, int cflags) {
+	regex_cache_entry_t* pentry = NULL;
+	int i = 0;
+	for ( ; i < pcache->num_entries; i++) {
+		regex_cache_entry_t* pcandidate = pcache->pentries[i];
+		if (pcandidate->cflags == cflags && streq(pcandidate->regex_string, regex_string)) {
+			pentry = pcandidate;
+			break;
+		}
+	}
+
+	if (pentry == NULL) {
+		if (pcache->num_entries < REGEX_CACHE_CAPACITY) {
+			i = pcache->num_entries++;
+			pentry = mlr_malloc_or_die(sizeof(regex_cache_entry_t));
+		} else {
+			// Evict the least recently used.
+			i = REGEX_CACHE_CAPACITY - 1;
+			pentry = pcache->pentries[i];
+			mlr_regfree(&pentry->regex);
+			free(pentry->regex_string);
+		}
+		pentry->regex_string = mlr_strdup_or_die(regex_string);
+		pentry->cflags = cflags;
+		regcomp_or_die(&pentry->regex, regex_string, cflags);
+		pcache->pentries[i] = pentry;
+	}
+
+	// Move to front
+	if (i > 0) {
+		memmove(&pcache->pentries[1], &pcache->pentries[0], i * sizeof(regex_cache_entry_t*));
+		pcache->pentries[0] = pentry;
+	}
+	return &pentry->regex;
+}
+
 // Returns TRUE for match, FALSE for no match, and aborts the process if
 // regexec returns anything else.
-int regmatch_or_die(const regex_t* pregex, const char* restrict match_string,
+int regmatch_or_die(const mlr_regex_t* pregex, const char* restrict match_string,
 	size_t nmatchmax, regmatch_t pmatch[restrict])
 {
-	int rc = regexec(pregex, match_string, nmatchmax, pmatch, 0);
+	switch (pregex->kind) {
+	case MLR_REGEX_KIND_LITERAL:
+		return match_literal(pregex, match_string, nmatchmax, pmatch);
+	case MLR_REGEX_KIND_CLASSES:
+		return match_classes(pregex, match_string, nmatchmax, pmatch);
+	default:
+		break;
+	}
+
+	int rc = regexec(&pregex->posix_regex, match_string, nmatchmax, pmatch, 0);
 	if (rc == 0) {
 		return TRUE;
 	} else if (rc == REG_NOMATCH) {
 		return FALSE;
 	} else {
-		size_t nbytes = regerror(rc, pregex, NULL, 0);
+		size_t nbytes = regerror(rc, &pregex->posix_regex, NULL, 0);
 		char* errbuf = malloc(nbytes);
-		(void)regerror(rc, pregex, errbuf, nbytes);
+		(void)regerror(rc, &pregex->posix_regex, errbuf, nbytes);
 		printf("regexec failure: %s\n", errbuf);
 		exit(1);
 	}
 }
 
+// ================================================================
+// FAST PATHS
+//
+// Patterns are examined after the double-backslashing above, i.e. exactly as
+// regcomp would see them. Anything not understood here is left to regcomp, so
+// this only needs to be right about what it accepts, not complete.
+// ================================================================
+
+#define ALL_ATOMS_MASK(n) ((n) >= 64 ? ~0ULL : (1ULL << (n)) - 1ULL)
+
+typedef struct _char_set_t {
+	unsigned char bits[32];
+} char_set_t;
+
+static void char_set_add(char_set_t* pset, unsigned char c) {
+	pset->bits[c >> 3] |= 1 << (c & 7);
+}
+static int char_set_has(char_set_t* pset, unsigned char c) {
+	return (pset->bits[c >> 3] >> (c & 7)) & 1;
+}
+
+static int is_regex_special(char c) {
+	return c != 0 && strchr(".[]()*+?{}|^$\\", c) != NULL;
+}
+
+static int add_named_class(char_set_t* pset, char* name, int length) {
+	int (*pfunc)(int) = NULL;
+	if      (length == 5 && !strncmp(name, "alpha",  5)) pfunc = isalpha;
+	else if (length == 5 && !strncmp(name, "digit",  5)) pfunc = isdigit;
+	else if (length == 5 && !strncmp(name, "alnum",  5)) pfunc = isalnum;
+	else if (length == 5 && !strncmp(name, "upper",  5)) pfunc = isupper;
+	else if (length == 5 && !strncmp(name, "lower",  5)) pfunc = islower;
+	else if (length == 5 && !strncmp(name, "space",  5)) pfunc = isspace;
+	else if (length == 5 && !strncmp(name, "blank",  5)) pfunc = isblank;
+	else if (length == 5 && !strncmp(name, "punct",  5)) pfunc = ispunct;
+	else if (length == 5 && !strncmp(name, "print",  5)) pfunc = isprint;
+	else if (length == 5 && !strncmp(name, "graph",  5)) pfunc = isgraph;
+	else if (length == 5 && !strncmp(name, "cntrl",  5)) pfunc = iscntrl;
+	else if (length == 6 && !strncmp(name, "xdigit", 6)) pfunc = isxdigit;
+	else
+		return FALSE;
+	for (int c = 1; c < 256; c++)
+		if (pfunc(c))
+			char_set_add(pset, c);
+	return TRUE;
+}
+
+// Parses a bracket expression starting at *pp, which points to the '['.
+// Within brackets, backslash is not special, as per POSIX. Collating elements
+// and equivalence classes aren't handled here.
+static int parse_bracket(char** pp, char_set_t* pset, int* pnegated) {
+	char* p = *pp + 1;
+	*pnegated = FALSE;
+	if (*p == '^') {
+		*pnegated = TRUE;
+		p++;
+	}
+	int first = TRUE;
+	while (TRUE) {
+		if (*p == 0)
+			return FALSE;
+		if (*p == ']' && !first) {
+			p++;
+			break;
+		}
+		first = FALSE;
+		if (p[0] == '[' && (p[1] == '.' || p[1] == '='))
+			return FALSE;
+		if (p[0] == '[' && p[1] == ':') {
+			char* name = p + 2;
+			char* end = strstr(name, ":]");
+			if (end == NULL || !add_named_class(pset, name, end - name))
+				return FALSE;
+			p = end + 2;
+			continue;
+		}
+		unsigned char lo = *p++;
+		if (p[0] == '-' && p[1] != ']' && p[1] != 0) {
+			unsigned char hi = p[1];
+			if (hi == '[' || hi < lo)
+				return FALSE;
+			p += 2;
+			for (int c = lo; c <= hi; c++)
+				char_set_add(pset, c);
+		} else {
+			char_set_add(pset, lo);
+		}
+	}
+	*pp = p;
+	return TRUE;
+}
+
+// Recognizes literals and sequences of single-character atoms with optional
+// *, +, or ? quantifiers, possibly anchored at either end.
+static int compile_fast_path(mlr_regex_t* pregex, char* pattern) {
+	int ignore_case = pregex->ignore_case;
+	char_set_t sets[MLR_REGEX_MAX_ATOMS];
+	unsigned long long optional_mask = 0ULL;
+	unsigned long long repeat_mask = 0ULL;
+	int num_atoms = 0;
+	int all_literal = TRUE;
+	int anchored_at_start = FALSE;
+	int anchored_at_end = FALSE;
+	char* literal = mlr_malloc_or_die(strlen(pattern) + 1);
+	int literal_length = 0;
+
+	char* p = pattern;
+	if (*p == '^') {
+		anchored_at_start = TRUE;
+		p++;
+	}
+	while (*p) {
+		if (p[0] == '$' && p[1] == 0) {
+			anchored_at_end = TRUE;
+			break;
+		}
+
+		char_set_t set;
+		memset(&set, 0, sizeof(set));
+		int is_literal_char = FALSE;
+		unsigned char c = 0;
+		int negated = FALSE;
+
+		if (*p == '\\') {
+			if (!is_regex_special(p[1]))
+				goto fail;
+			c = p[1];
+			is_literal_char = TRUE;
+			p += 2;
+		} else if (*p == '.') {
+			negated = TRUE; // Everything but NUL
+			p++;
+		} else if (*p == '[') {
+			if (!parse_bracket(&p, &set, &negated))
+				goto fail;
+		} else if (is_regex_special(*p) && *p != ']') {
+			goto fail;
+		} else {
+			c = *p++;
+			is_literal_char = TRUE;
+		}
+
+		if (is_literal_char)
+			char_set_add(&set, c);
+		if (ignore_case) {
+			for (int d = 1; d < 256; d++) {
+				if (char_set_has(&set, d)) {
+					char_set_add(&set, tolower(d));
+					char_set_add(&set, toupper(d));
+				}
+			}
+		}
+		if (negated) {
+			for (int i = 0; i < 32; i++)
+				set.bits[i] = ~set.bits[i];
+			set.bits[0] &= ~1;
+		}
+
+		int quantified = FALSE;
+		if (*p == '*' || *p == '+' || *p == '?') {
+			if (num_atoms < MLR_REGEX_MAX_ATOMS) {
+				if (*p != '+')
+					optional_mask |= 1ULL << num_atoms;
+				if (*p != '?')
+					repeat_mask |= 1ULL << num_atoms;
+			}
+			quantified = TRUE;
+			p++;
+			if (*p == '*' || *p == '+' || *p == '?' || *p == '{')
+				goto fail;
+		}
+
+		if (!is_literal_char || quantified)
+			all_literal = FALSE;
+		else
+			literal[literal_length++] = c;
+		if (num_atoms < MLR_REGEX_MAX_ATOMS)
+			sets[num_atoms] = set;
+		num_atoms++;
+		if (num_atoms > MLR_REGEX_MAX_ATOMS && !all_literal)
+			goto fail;
+	}
+	// Leave the empty regex, and its compile-time diagnostics if any, to the system library.
+	if (num_atoms == 0)
+		goto fail;
+
+	pregex->anchored_at_start = anchored_at_start;
+	pregex->anchored_at_end = anchored_at_end;
+	if (all_literal) {
+		literal[literal_length] = 0;
+		pregex->kind = MLR_REGEX_KIND_LITERAL;
+		pregex->literal = literal;
+		pregex->literal_length = literal_length;
+		return TRUE;
+	}
+	free(literal);
+
+	pregex->kind = MLR_REGEX_KIND_CLASSES;
+	pregex->num_atoms = num_atoms;
+	pregex->optional_mask = optional_mask;
+	pregex->repeat_mask = repeat_mask;
+	pregex->char_masks = mlr_malloc_or_die(256 * sizeof(unsigned long long));
+	for (int d = 0; d < 256; d++) {
+		unsigned long long mask = 0ULL;
+		for (int i = 0; i < num_atoms; i++)
+			if (char_set_has(&sets[i], d))
+				mask |= 1ULL << i;
+		pregex->char_masks[d] = mask;
+	}
+	return TRUE;
+
+fail:
+	free(literal);
+	return FALSE;
+}
+
+// ----------------------------------------------------------------
+static int set_match(size_t nmatchmax, regmatch_t pmatch[], regoff_t start, regoff_t end) {
+	if (nmatchmax > 0) {
+		pmatch[0].rm_so = start;
+		pmatch[0].rm_eo = end;
+		for (size_t i = 1; i < nmatchmax; i++) {
+			pmatch[i].rm_so = -1;
+			pmatch[i].rm_eo = -1;
+		}
+	}
+	return TRUE;
+}
+
+static const char* strcasestr_or_null(const char* s, const char* t, int tlen) {
+	if (tlen == 0)
+		return s;
+	int lc = tolower((unsigned char)t[0]);
+	int uc = toupper((unsigned char)t[0]);
+	for ( ; *s; s++)
+		if ((*s == lc || *s == uc) && strncasecmp(s, t, tlen) == 0)
+			return s;
+	return NULL;
+}
+
+static int match_literal(const mlr_regex_t* pregex, const char* s, size_t nmatchmax, regmatch_t pmatch[]) {
+	const char* literal = pregex->literal;
+	int length = pregex->literal_length;
+	int ignore_case = pregex->ignore_case;
+
+	if (pregex->anchored_at_start) {
+		int rc = ignore_case ? strncasecmp(s, literal, length) : strncmp(s, literal, length);
+		if (rc != 0)
+			return FALSE;
+		if (pregex->anchored_at_end && s[length] != 0)
+			return FALSE;
+		return set_match(nmatchmax, pmatch, 0, length);
+	}
+
+	if (pregex->anchored_at_end) {
+		int slen = strlen(s);
+		if (slen < length)
+			return FALSE;
+		const char* tail = &s[slen - length];
+		int rc = ignore_case ? strcasecmp(tail, literal) : strcmp(tail, literal);
+		if (rc != 0)
+			return FALSE;
+		return set_match(nmatchmax, pmatch, slen - length, slen);
+	}
+
+	const char* found = ignore_case ? strcasestr_or_null(s, literal, length) : strstr(s, literal);
+	if (found == NULL)
+		return FALSE;
+	return set_match(nmatchmax, pmatch, found - s, found - s + length);
+}
+
+// ----------------------------------------------------------------
+// Bit i of the state is set when atom i is the next one to be matched; bit
+// num_atoms is the accepting state. Optional atoms may be skipped, and
+// repeating atoms may be matched again once matched.
+static inline unsigned long long classes_closure(const mlr_regex_t* pregex, unsigned long long state) {
+	while (TRUE) {
+		unsigned long long next = state | ((state & pregex->optional_mask) << 1);
+		if (next == state)
+			return state;
+		state = next;
+	}
+}
+
+static int match_classes(const mlr_regex_t* pregex, const char* s, size_t nmatchmax, regmatch_t pmatch[]) {
+	const unsigned char* u = (const unsigned char*)s;
+	unsigned long long accept = 1ULL << pregex->num_atoms;
+	unsigned long long initial = classes_closure(pregex, 1ULL);
+	unsigned long long* char_masks = pregex->char_masks;
+	int anchored_at_end = pregex->anchored_at_end;
+
+	for (int start = 0; ; start++) {
+		// Quick rejection: the first byte can't start a match.
+		if (u[start] != 0 && !(initial & accept) && !(char_masks[u[start]] & initial)) {
+			if (pregex->anchored_at_start)
+				return FALSE;
+			continue;
+		}
+
+		unsigned long long state = initial;
+		int end = -1;
+		int i = start;
+		while (TRUE) {
+			if ((state & accept) && (!anchored_at_end || u[i] == 0))
+				end = i;
+			if (u[i] == 0)
+				break;
+			unsigned long long matched = state & char_masks[u[i]];
+			if (matched == 0ULL)
+				break;
+			state = classes_closure(pregex, (matched << 1) | (matched & pregex->repeat_mask));
+			i++;
+		}
+		if (end >= 0)
+			return set_match(nmatchmax, pmatch, start, end);
+
+		if (pregex->anchored_at_start || u[start] == 0)
+			return FALSE;
+	}
+}
+
 // Capture-group example:
 // sed: $ echo '<<abcdefg>>'|sed 's/ab\(.\)d\(..\)g/AYEBEE\1DEE\2GEE/' gives <<AYEBEEcDEEefGEE>>
 // mlr: echo 'x=<<abcdefg>>' | mlr put '$x = sub($x, "ab(.)d(..)g", "AYEBEE\1DEE\2GEE")' x=<<AYEBEEcDEEefGEE>>
 
-char* regex_sub(char* input, regex_t* pregex, string_builder_t* psb, char* replacement,
+char* regex_sub(char* input, mlr_regex_t* pregex, string_builder_t* psb, char* replacement,
 	int* pmatched, int *pall_captured)
 {
 	const size_t nmatchmax = 10; // Capture-groups \1 through \9 supported, along with entire-string match \0
@@ -143,7 +550,7 @@ char* regex_sub(char* input, regex_t* pregex, string_builder_t* psb, char* repla
 	}
 }
 
-char* regex_gsub(char* input, regex_t* pregex, string_builder_t* psb, char* replacement,
+char* regex_gsub(char* input, mlr_regex_t* pregex, string_builder_t* psb, char* replacement,
 	int *pmatched, int* pall_captured, char* pfree_flags)
 {
 	const size_t nmatchmax = 10;
@@ -10,27 +10,97 @@
 #include "string_builder.h"
 #include "string_array.h"
 
+// ----------------------------------------------------------------
+// Compiled regexes. Most regexes seen in practice are literals, or literals
+// anchored at one or both ends, or short runs of character classes such as
+// "^[0-9]+$". These are recognized at compile time and matched without going
+// through regexec, which is comparatively slow for such simple patterns: literals
+// via strcmp/strstr-style searches, and character-class runs via a small
+// bit-parallel automaton. Everything else -- alternation, grouping, bounded
+// repetition, backslash classes -- falls back to the system regex library.
+//
+// Match semantics are those of POSIX extended regexes either way: leftmost
+// match, longest at that position. Since the fast paths only apply to patterns
+// without parenthesized groups, the only capture they ever produce is \0.
+
+typedef enum _mlr_regex_kind_t {
+	MLR_REGEX_KIND_POSIX,    // Compiled and matched by regcomp/regexec
+	MLR_REGEX_KIND_LITERAL,  // Literal string, possibly anchored with ^ and/or $
+	MLR_REGEX_KIND_CLASSES,  // Sequence of characters/classes with optional *, +, ? quantifiers
+} mlr_regex_kind_t;
+
+// The class-run automaton keeps one state bit per atom, plus one for the final state.
+#define MLR_REGEX_MAX_ATOMS 63
+
+typedef struct _mlr_regex_t {
+	mlr_regex_kind_t    kind;
+	int                 ignore_case;
+	int                 anchored_at_start;
+	int                 anchored_at_end;
+
+	// For MLR_REGEX_KIND_LITERAL
+	char*               literal;
+	int                 literal_length;
+
+	// For MLR_REGEX_KIND_CLASSES. Bit i of the masks is for the ith atom,
+	// i.e. single character, bracket expression, or dot.
+	int                 num_atoms;
+	unsigned long long* char_masks;    // 256 of these: atoms matching each byte value
+	unsigned long long  optional_mask; // Atoms quantified with * or ?
+	unsigned long long  repeat_mask;   // Atoms quantified with * or +
+
+	// For MLR_REGEX_KIND_POSIX
+	regex_t             posix_regex;
+} mlr_regex_t;
+
 // Succeeds or aborts the process. cflag REG_EXTENDED is already included.
 // Returns its first argument (after compilation).
-regex_t* regcomp_or_die(regex_t* pregex, char* regex_string, int cflags);
+mlr_regex_t* regcomp_or_die(mlr_regex_t* pregex, char* regex_string, int cflags);
 // Always uses cflags with REG_EXTENDED.
 // If the regex_string is of the form a.*b, compiles it using cflags without REG_ICASE.
 // If the regex_string is of the form "a.*b", compiles a.*b using cflags without REG_ICASE.
 // If the regex_string is of the form "a.*b"i, compiles a.*b using cflags with REG_ICASE.
-regex_t* regcomp_or_die_quoted(regex_t* pregex, char* regex_string, int cflags);
+mlr_regex_t* regcomp_or_die_quoted(mlr_regex_t* pregex, char* regex_string, int cflags);
+// Frees the memory owned by the compiled regex, but not the mlr_regex_t itself.
+void mlr_regfree(mlr_regex_t* pregex);
+
+// ----------------------------------------------------------------
+// Regexes which are computed rather than literal, e.g. in sub($x, $pattern, "")
+// or $x =~ "^" . @prefix, are usually drawn from a small set of distinct
+// strings. The cache keeps the most recently used few compiled, keyed by
+// regex string and cflags, so they needn't be recompiled record by record.
+
+#define REGEX_CACHE_CAPACITY 16
+
+typedef struct _regex_cache_entry_t {
+	char*       regex_string;
+	int         cflags;
+	mlr_regex_t regex;
+} regex_cache_entry_t;
+
+typedef struct _regex_cache_t {
+	int                  num_entries;
+	regex_cache_entry_t* pentries[REGEX_CACHE_CAPACITY]; // Most recently used first
+} regex_cache_t;
+
+regex_cache_t* regex_cache_alloc();
+void regex_cache_free(regex_cache_t* pcache);
+// As with regcomp_or_die, aborts the process if the regex doesn't compile. The
+// return value is owned by the cache, and is valid until the next call.
+mlr_regex_t* regex_cache_get(regex_cache_t* pcache, char* regex_string, int cflags);
 
 // Returns TRUE for match, FALSE for no match, and aborts the process if
 // regexec returns anything else.
-int regmatch_or_die(const regex_t* pregex, const char* restrict match_string,
+int regmatch_or_die(const mlr_regex_t* pregex, const char* restrict match_string,
 	size_t nmatchmax, regmatch_t pmatch[restrict]);
 
 // The return value is dynamically allocated even if there is no match, i.e. when output
 // equals input.  The by-reference all-captured flag is true on return if all \1, etc.
 // were satisfiable by parenthesized capture groups.
-char* regex_sub(char* input, regex_t* pregex, string_builder_t* psb, char* replacement,
+char* regex_sub(char* input, mlr_regex_t* pregex, string_builder_t* psb, char* replacement,
 	int* pmatched, int* pall_captured);
 
-char* regex_gsub(char* input, regex_t* pregex, string_builder_t* psb, char* replacement, int* pmatched, int* pall_captured,
+char* regex_gsub(char* input, mlr_regex_t* pregex, string_builder_t* psb, char* replacement, int* pmatched, int* pall_captured,
 	char *pfree_flags);
 
 // The regex library gives us an array of match pointers into the input string. This function strdups them
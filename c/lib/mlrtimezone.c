@@ -0,0 +1,771 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+#include "lib/mlr_globals.h"
+#include "lib/mlr_arch.h"
+#include "lib/mlrutil.h"
+#include "lib/mlrtimezone.h"
+
+// ================================================================
+// See mlrtimezone.h for the API, and tzfile(5) or RFC 8536 for the file
+// format. Briefly: a tzfile has a list of UTC instants at which the zone's
+// offset changes, each associated with a local-time type (UTC offset,
+// DST flag, and abbreviation such as "BRST"). Version-2+ files have a
+// 32-bit-time block (which we skip), a 64-bit-time block, and a footer with
+// a POSIX TZ string such as "<-03>3" or "EST5EDT,M3.2.0,M11.1.0" which
+// governs times after the last listed transition.
+//
+// Leap-second records (the "right/" zones) are skipped, as the C library
+// does for POSIX time.
+// ================================================================
+
+#define DEFAULT_TZDIR      "/usr/share/zoneinfo"
+#define SYSTEM_ZONE_PATH   "/etc/localtime"
+#define SECONDS_PER_DAY    86400LL
+#define DEFAULT_RULE_TIME  7200 // 02:00:00 local
+
+typedef struct _tz_type_t {
+	int   utoff; // Seconds east of UTC
+	int   isdst;
+	char* abbr;
+} tz_type_t;
+
+// One of "Jn", "n", or "Mm.w.d" in a POSIX TZ string, with its optional "/time".
+typedef struct _tz_rule_date_t {
+	char kind; // 'J', 'D', or 'M'
+	int  day;
+	int  week;
+	int  month;
+	int  seconds_into_day;
+} tz_rule_date_t;
+
+typedef struct _tz_rule_t {
+	tz_type_t      std;
+	tz_type_t      dst;
+	int            has_dst;
+	tz_rule_date_t start;
+	tz_rule_date_t end;
+} tz_rule_t;
+
+struct _mlr_timezone_t {
+	char*          name;
+	int            is_valid;
+
+	int            num_transitions;
+	long long*     transition_times;
+	unsigned char* transition_type_indices;
+
+	int            num_types;
+	tz_type_t*     types;
+	char*          abbrs;
+
+	int            has_rule;
+	tz_rule_t      rule;
+
+	struct _mlr_timezone_t* pnext;
+};
+
+static tz_type_t UTC_TYPE = { .utoff = 0, .isdst = FALSE, .abbr = "UTC" };
+static mlr_timezone_t UTC_ZONE = {
+	.name                    = "UTC",
+	.is_valid                = TRUE,
+	.num_transitions         = 0,
+	.transition_times        = NULL,
+	.transition_type_indices = NULL,
+	.num_types               = 1,
+	.types                   = &UTC_TYPE,
+	.abbrs                   = NULL,
+	.has_rule                = FALSE,
+	.pnext                   = NULL,
+};
+
+// The cache is a list since programs use only a handful of zones. Entries
+// are never freed or modified once inserted, so the zone pointers handed out
+// can be used without locking.
+static mlr_timezone_t* pzone_cache_head = NULL;
+static mlr_timezone_t* psystem_zone = NULL;
+static pthread_mutex_t zone_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static mlr_timezone_t* zone_cache_find_or_load(char* name);
+static mlr_timezone_t* zone_load(char* name);
+static int zone_load_from_tzfile(mlr_timezone_t* pzone, char* path);
+static int zone_load_from_tzfile_contents(mlr_timezone_t* pzone, unsigned char* buf, long long len);
+static void zone_free_tables(mlr_timezone_t* pzone);
+static int parse_posix_tz_string(char* s, tz_rule_t* prule);
+static int parse_posix_tz_string_aux(char* s, tz_rule_t* prule);
+static tz_type_t* zone_type_at(mlr_timezone_t* pzone, long long t);
+static tz_type_t* zone_type_with_isdst_near(mlr_timezone_t* pzone, long long t, int isdst);
+static tz_type_t* rule_type_at(tz_rule_t* prule, long long t);
+
+static long long days_from_civil(long long y, int m, int d);
+static void civil_from_days(long long days, long long* py, int* pm, int* pd);
+static long long floor_div(long long a, long long b);
+
+// ================================================================
+mlr_timezone_t* mlr_timezone_get(char* name) {
+	if (*name == ':')
+		name++;
+	if (*name == 0)
+		return &UTC_ZONE;
+	mlr_timezone_t* pzone = zone_cache_find_or_load(name);
+	return pzone->is_valid ? pzone : NULL;
+}
+
+mlr_timezone_t* mlr_timezone_get_from_env() {
+	char* name = getenv("TZ");
+	if (name == NULL) {
+		pthread_mutex_lock(&zone_cache_mutex);
+		if (psystem_zone == NULL) {
+			psystem_zone = mlr_malloc_or_die(sizeof(mlr_timezone_t));
+			memset(psystem_zone, 0, sizeof(mlr_timezone_t));
+			psystem_zone->name = SYSTEM_ZONE_PATH;
+			if (!zone_load_from_tzfile(psystem_zone, SYSTEM_ZONE_PATH)) {
+				free(psystem_zone);
+				psystem_zone = &UTC_ZONE;
+			}
+		}
+		pthread_mutex_unlock(&zone_cache_mutex);
+		return psystem_zone;
+	}
+	if (*name == ':')
+		name++;
+	if (*name == 0)
+		return &UTC_ZONE;
+	mlr_timezone_t* pzone = zone_cache_find_or_load(name);
+	return pzone->is_valid ? pzone : &UTC_ZONE;
+}
+
+mlr_timezone_t* mlr_timezone_get_utc() {
+	return &UTC_ZONE;
+}
+
+char* mlr_timezone_get_name(mlr_timezone_t* pzone) {
+	return pzone->name;
+}
+
+// ----------------------------------------------------------------
+void mlr_timezone_seconds_to_tm(mlr_timezone_t* pzone, time_t seconds, struct tm* ptm) {
+	tz_type_t* ptype = zone_type_at(pzone, seconds);
+	long long local_seconds = (long long)seconds + ptype->utoff;
+	long long days = floor_div(local_seconds, SECONDS_PER_DAY);
+	long long seconds_into_day = local_seconds - days * SECONDS_PER_DAY;
+
+	long long y;
+	int m, d;
+	civil_from_days(days, &y, &m, &d);
+
+	memset(ptm, 0, sizeof(struct tm));
+	ptm->tm_year  = y - 1900;
+	ptm->tm_mon   = m - 1;
+	ptm->tm_mday  = d;
+	ptm->tm_hour  = seconds_into_day / 3600;
+	ptm->tm_min   = (seconds_into_day / 60) % 60;
+	ptm->tm_sec   = seconds_into_day % 60;
+	ptm->tm_wday  = mlr_canonical_mod((days + 4) % 7, 7); // 1970-01-01 was a Thursday
+	ptm->tm_yday  = days - days_from_civil(y, 1, 1);
+	ptm->tm_isdst = ptype->isdst;
+#ifndef MLR_ON_MSYS2
+	ptm->tm_gmtoff = ptype->utoff;
+	ptm->tm_zone   = ptype->abbr;
+#endif
+}
+
+// ----------------------------------------------------------------
+// First find the UTC offset which maps to the given local time; for
+// ambiguous local times (in the repeated hour when clocks go back) this finds
+// one of the two, and for nonexistent local times (in the skipped hour when
+// clocks go forward) this finds the offset in effect just after the skip.
+// Then, as with mktime, if the caller specified tm_isdst and it disagrees with
+// the zone rules at that time, use the nearest offset which does agree.
+
+time_t mlr_timezone_tm_to_seconds(mlr_timezone_t* pzone, struct tm* ptm) {
+	long long y = ptm->tm_year + 1900LL;
+	long long mon = ptm->tm_mon;
+	y += floor_div(mon, 12);
+	mon -= floor_div(mon, 12) * 12;
+
+	long long local_seconds = days_from_civil(y, mon + 1, 1) * SECONDS_PER_DAY
+		+ (ptm->tm_mday - 1LL) * SECONDS_PER_DAY
+		+ ptm->tm_hour * 3600LL
+		+ ptm->tm_min * 60LL
+		+ ptm->tm_sec;
+
+	// Offsets in effect a day either side bracket any transition near the
+	// given local time. A candidate offset is consistent if the instant it
+	// yields is in fact at that offset: both are, for the repeated hour when
+	// clocks fall back, and neither is, for the skipped hour when they spring
+	// forward.
+	tz_type_t* pbefore = zone_type_at(pzone, local_seconds - SECONDS_PER_DAY);
+	tz_type_t* pafter  = zone_type_at(pzone, local_seconds + SECONDS_PER_DAY);
+	int before_ok = zone_type_at(pzone, local_seconds - pbefore->utoff)->utoff == pbefore->utoff;
+	int after_ok  = zone_type_at(pzone, local_seconds - pafter->utoff)->utoff == pafter->utoff;
+
+	if (ptm->tm_isdst >= 0) {
+		int isdst = ptm->tm_isdst > 0;
+		if (pbefore->isdst == isdst && (before_ok || pafter->isdst != isdst || !after_ok))
+			return (time_t)(local_seconds - pbefore->utoff);
+		if (pafter->isdst == isdst)
+			return (time_t)(local_seconds - pafter->utoff);
+	}
+
+	tz_type_t* ptype = (before_ok || !after_ok) ? pbefore : pafter;
+	long long t = local_seconds - ptype->utoff;
+
+	// As with mktime, a tm_isdst which disagrees with the zone rules means the
+	// time is to be read at the other offset.
+	if (ptm->tm_isdst >= 0) {
+		int isdst = ptm->tm_isdst > 0;
+		if (ptype->isdst != isdst) {
+			tz_type_t* pmatch = zone_type_with_isdst_near(pzone, t, isdst);
+			if (pmatch != NULL)
+				t = local_seconds - pmatch->utoff;
+		}
+	}
+
+	return (time_t)t;
+}
+
+// ================================================================
+static mlr_timezone_t* zone_cache_find_or_load(char* name) {
+	pthread_mutex_lock(&zone_cache_mutex);
+	mlr_timezone_t* pzone = NULL;
+	for (mlr_timezone_t* pe = pzone_cache_head; pe != NULL; pe = pe->pnext) {
+		if (streq(pe->name, name)) {
+			pzone = pe;
+			break;
+		}
+	}
+	if (pzone == NULL) {
+		// Unknown names are cached too, so that a bad $TZ doesn't cost a
+		// failed file open on every call.
+		pzone = zone_load(name);
+		pzone->pnext = pzone_cache_head;
+		pzone_cache_head = pzone;
+	}
+	pthread_mutex_unlock(&zone_cache_mutex);
+	return pzone;
+}
+
+// ----------------------------------------------------------------
+static mlr_timezone_t* zone_load(char* name) {
+	mlr_timezone_t* pzone = mlr_malloc_or_die(sizeof(mlr_timezone_t));
+	memset(pzone, 0, sizeof(mlr_timezone_t));
+	pzone->name = mlr_strdup_or_die(name);
+
+	if (*name == '/') {
+		pzone->is_valid = zone_load_from_tzfile(pzone, name);
+		return pzone;
+	}
+
+	// Don't let zone names wander outside the zoneinfo directory.
+	if (strstr(name, "..") == NULL) {
+		char* tzdir = getenv("TZDIR");
+		if (tzdir == NULL || *tzdir == 0)
+			tzdir = DEFAULT_TZDIR;
+		char* path = mlr_malloc_or_die(strlen(tzdir) + strlen(name) + 2);
+		sprintf(path, "%s/%s", tzdir, name);
+		pzone->is_valid = zone_load_from_tzfile(pzone, path);
+		free(path);
+		if (pzone->is_valid)
+			return pzone;
+	}
+
+	if (parse_posix_tz_string(name, &pzone->rule)) {
+		pzone->has_rule = TRUE;
+		pzone->is_valid = TRUE;
+	} else if (streq(name, "UTC") || streq(name, "GMT")) {
+		// For systems without zoneinfo files
+		pzone->num_types = 1;
+		pzone->types = &UTC_TYPE;
+		pzone->is_valid = TRUE;
+	}
+	return pzone;
+}
+
+// ----------------------------------------------------------------
+static int zone_load_from_tzfile(mlr_timezone_t* pzone, char* path) {
+	FILE* fp = fopen(path, "rb");
+	if (fp == NULL)
+		return FALSE;
+
+	long long cap = 4096;
+	long long len = 0;
+	unsigned char* buf = mlr_malloc_or_die(cap);
+	while (TRUE) {
+		size_t nread = fread(&buf[len], 1, cap - len, fp);
+		len += nread;
+		if (len < cap)
+			break;
+		cap *= 2;
+		buf = mlr_realloc_or_die(buf, cap);
+	}
+	int ok = !ferror(fp);
+	fclose(fp);
+
+	if (ok)
+		ok = zone_load_from_tzfile_contents(pzone, buf, len);
+	free(buf);
+	if (!ok)
+		zone_free_tables(pzone);
+	return ok;
+}
+
+// Undoes a partial load, so the zone can be retried as a POSIX TZ string or
+// cached as invalid.
+static void zone_free_tables(mlr_timezone_t* pzone) {
+	free(pzone->transition_times);
+	free(pzone->transition_type_indices);
+	free(pzone->types);
+	free(pzone->abbrs);
+	if (pzone->has_rule) {
+		free(pzone->rule.std.abbr);
+		free(pzone->rule.dst.abbr);
+	}
+	pzone->num_transitions = 0;
+	pzone->transition_times = NULL;
+	pzone->transition_type_indices = NULL;
+	pzone->num_types = 0;
+	pzone->types = NULL;
+	pzone->abbrs = NULL;
+	pzone->has_rule = FALSE;
+	memset(&pzone->rule, 0, sizeof(tz_rule_t));
+}
+
+// ----------------------------------------------------------------
+static long long decode_be(unsigned char* p, int nbytes) {
+	unsigned long long u = 0ULL;
+	for (int i = 0; i < nbytes; i++)
+		u = (u << 8) | p[i];
+	// Sign-extend
+	if (nbytes < 8 && (u & (1ULL << (8*nbytes - 1))))
+		u |= ~0ULL << (8*nbytes);
+	return (long long)u;
+}
+
+#define TZIF_HEADER_LENGTH 44
+
+typedef struct _tzif_counts_t {
+	long long isutcnt;
+	long long isstdcnt;
+	long long leapcnt;
+	long long timecnt;
+	long long typecnt;
+	long long charcnt;
+} tzif_counts_t;
+
+static int tzif_read_header(unsigned char* p, long long remaining, int* pversion, tzif_counts_t* pcounts) {
+	if (remaining < TZIF_HEADER_LENGTH || memcmp(p, "TZif", 4) != 0)
+		return FALSE;
+	*pversion = (p[4] == 0) ? 1 : p[4] - '0';
+	pcounts->isutcnt  = decode_be(&p[20], 4);
+	pcounts->isstdcnt = decode_be(&p[24], 4);
+	pcounts->leapcnt  = decode_be(&p[28], 4);
+	pcounts->timecnt  = decode_be(&p[32], 4);
+	pcounts->typecnt  = decode_be(&p[36], 4);
+	pcounts->charcnt  = decode_be(&p[40], 4);
+	if (pcounts->isutcnt < 0 || pcounts->isstdcnt < 0 || pcounts->leapcnt < 0 || pcounts->timecnt < 0
+		|| pcounts->typecnt <= 0 || pcounts->typecnt > 256 || pcounts->charcnt < 0)
+	{
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static long long tzif_data_block_length(tzif_counts_t* pcounts, int time_size) {
+	return pcounts->timecnt * time_size
+		+ pcounts->timecnt
+		+ pcounts->typecnt * 6
+		+ pcounts->charcnt
+		+ pcounts->leapcnt * (time_size + 4)
+		+ pcounts->isstdcnt
+		+ pcounts->isutcnt;
+}
+
+static int zone_load_from_tzfile_contents(mlr_timezone_t* pzone, unsigned char* buf, long long len) {
+	unsigned char* p = buf;
+	unsigned char* end = buf + len;
+	int version;
+	tzif_counts_t counts;
+	int time_size = 4;
+
+	if (!tzif_read_header(p, end - p, &version, &counts))
+		return FALSE;
+	p += TZIF_HEADER_LENGTH;
+
+	if (version >= 2) {
+		// Skip the version-1 data in favor of the 64-bit-time data which follows it.
+		long long skip = tzif_data_block_length(&counts, 4);
+		if (skip > end - p)
+			return FALSE;
+		p += skip;
+		if (!tzif_read_header(p, end - p, &version, &counts))
+			return FALSE;
+		p += TZIF_HEADER_LENGTH;
+		time_size = 8;
+	}
+	if (tzif_data_block_length(&counts, time_size) > end - p)
+		return FALSE;
+
+	int n = counts.timecnt;
+	pzone->num_transitions = n;
+	pzone->transition_times = mlr_malloc_or_die((n > 0 ? n : 1) * sizeof(long long));
+	pzone->transition_type_indices = mlr_malloc_or_die(n > 0 ? n : 1);
+	for (int i = 0; i < n; i++, p += time_size)
+		pzone->transition_times[i] = decode_be(p, time_size);
+	for (int i = 0; i < n; i++, p++) {
+		if (*p >= counts.typecnt)
+			return FALSE;
+		pzone->transition_type_indices[i] = *p;
+	}
+
+	unsigned char* ptypes = p;
+	p += counts.typecnt * 6;
+	pzone->abbrs = mlr_malloc_or_die(counts.charcnt + 1);
+	memcpy(pzone->abbrs, p, counts.charcnt);
+	pzone->abbrs[counts.charcnt] = 0;
+	p += counts.charcnt;
+
+	pzone->num_types = counts.typecnt;
+	pzone->types = mlr_malloc_or_die(counts.typecnt * sizeof(tz_type_t));
+	for (int i = 0; i < counts.typecnt; i++) {
+		unsigned char* ptype = &ptypes[6*i];
+		pzone->types[i].utoff = decode_be(ptype, 4);
+		pzone->types[i].isdst = ptype[4] != 0;
+		if (ptype[5] > counts.charcnt)
+			return FALSE;
+		pzone->types[i].abbr = &pzone->abbrs[ptype[5]];
+	}
+
+	p += counts.leapcnt * (time_size + 4) + counts.isstdcnt + counts.isutcnt;
+
+	// Footer: newline, POSIX TZ string (possibly empty), newline.
+	if (version >= 2 && p < end && *p == '\n') {
+		unsigned char* pnewline = memchr(p + 1, '\n', end - p - 1);
+		if (pnewline != NULL && pnewline > p + 1) {
+			char* tzstring = mlr_alloc_string_from_char_range((char*)p + 1, pnewline - p - 1);
+			pzone->has_rule = parse_posix_tz_string(tzstring, &pzone->rule);
+			free(tzstring);
+		}
+	}
+
+	return TRUE;
+}
+
+// ================================================================
+// POSIX TZ strings, e.g. "EST5EDT,M3.2.0,M11.1.0" or "<+0330>-3:30".
+// Note the sign convention: offsets are hours *west* of Greenwich.
+
+static int parse_posix_tz_abbr(char** ps, char** pabbr) {
+	char* s = *ps;
+	char* start;
+	char* stop;
+	if (*s == '<') {
+		start = ++s;
+		while (*s && *s != '>')
+			s++;
+		if (*s != '>')
+			return FALSE;
+		stop = s++;
+	} else {
+		start = s;
+		while (isalpha((unsigned char)*s))
+			s++;
+		stop = s;
+	}
+	if (stop - start < 3)
+		return FALSE;
+	*pabbr = mlr_alloc_string_from_char_range(start, stop - start);
+	*ps = s;
+	return TRUE;
+}
+
+// [+-]hh[:mm[:ss]]
+static int parse_posix_tz_hms(char** ps, int* pseconds) {
+	char* s = *ps;
+	int sign = 1;
+	if (*s == '+') {
+		s++;
+	} else if (*s == '-') {
+		sign = -1;
+		s++;
+	}
+	if (!isdigit((unsigned char)*s))
+		return FALSE;
+	int fields[3] = { 0, 0, 0 };
+	for (int i = 0; i < 3; i++) {
+		if (i > 0) {
+			if (*s != ':')
+				break;
+			s++;
+		}
+		if (!isdigit((unsigned char)*s))
+			return FALSE;
+		while (isdigit((unsigned char)*s))
+			fields[i] = fields[i] * 10 + (*s++ - '0');
+	}
+	*pseconds = sign * (fields[0] * 3600 + fields[1] * 60 + fields[2]);
+	*ps = s;
+	return TRUE;
+}
+
+static int parse_posix_tz_int(char** ps, int* pvalue) {
+	char* s = *ps;
+	if (!isdigit((unsigned char)*s))
+		return FALSE;
+	int value = 0;
+	while (isdigit((unsigned char)*s))
+		value = value * 10 + (*s++ - '0');
+	*pvalue = value;
+	*ps = s;
+	return TRUE;
+}
+
+static int parse_posix_tz_date(char** ps, tz_rule_date_t* pdate) {
+	char* s = *ps;
+	if (*s == 'J') {
+		s++;
+		pdate->kind = 'J';
+		if (!parse_posix_tz_int(&s, &pdate->day) || pdate->day < 1 || pdate->day > 365)
+			return FALSE;
+	} else if (*s == 'M') {
+		s++;
+		pdate->kind = 'M';
+		if (!parse_posix_tz_int(&s, &pdate->month) || pdate->month < 1 || pdate->month > 12)
+			return FALSE;
+		if (*s++ != '.')
+			return FALSE;
+		if (!parse_posix_tz_int(&s, &pdate->week) || pdate->week < 1 || pdate->week > 5)
+			return FALSE;
+		if (*s++ != '.')
+			return FALSE;
+		if (!parse_posix_tz_int(&s, &pdate->day) || pdate->day > 6)
+			return FALSE;
+	} else {
+		pdate->kind = 'D';
+		if (!parse_posix_tz_int(&s, &pdate->day) || pdate->day > 365)
+			return FALSE;
+	}
+	pdate->seconds_into_day = DEFAULT_RULE_TIME;
+	if (*s == '/') {
+		s++;
+		if (!parse_posix_tz_hms(&s, &pdate->seconds_into_day))
+			return FALSE;
+	}
+	*ps = s;
+	return TRUE;
+}
+
+static int parse_posix_tz_string(char* s, tz_rule_t* prule) {
+	memset(prule, 0, sizeof(tz_rule_t));
+	if (parse_posix_tz_string_aux(s, prule))
+		return TRUE;
+	free(prule->std.abbr);
+	free(prule->dst.abbr);
+	memset(prule, 0, sizeof(tz_rule_t));
+	return FALSE;
+}
+
+static int parse_posix_tz_string_aux(char* s, tz_rule_t* prule) {
+	int offset;
+
+	if (!parse_posix_tz_abbr(&s, &prule->std.abbr))
+		return FALSE;
+	if (!parse_posix_tz_hms(&s, &offset))
+		return FALSE;
+	prule->std.utoff = -offset;
+	prule->std.isdst = FALSE;
+	if (*s == 0)
+		return TRUE;
+
+	if (!parse_posix_tz_abbr(&s, &prule->dst.abbr))
+		return FALSE;
+	prule->has_dst = TRUE;
+	prule->dst.isdst = TRUE;
+	prule->dst.utoff = prule->std.utoff + 3600;
+	if (*s != ',' && *s != 0) {
+		if (!parse_posix_tz_hms(&s, &offset))
+			return FALSE;
+		prule->dst.utoff = -offset;
+	}
+
+	if (*s == 0) {
+		// No rule given: use the US rules, as the C library does.
+		char* default_rule = ",M3.2.0,M11.1.0";
+		s = default_rule;
+	}
+	if (*s++ != ',')
+		return FALSE;
+	if (!parse_posix_tz_date(&s, &prule->start))
+		return FALSE;
+	if (*s++ != ',')
+		return FALSE;
+	if (!parse_posix_tz_date(&s, &prule->end))
+		return FALSE;
+	return *s == 0;
+}
+
+// ----------------------------------------------------------------
+static int is_leap_year(long long year) {
+	return year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+}
+
+static int days_in_month(long long year, int month) {
+	static int lengths[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+	return (month == 2 && is_leap_year(year)) ? 29 : lengths[month - 1];
+}
+
+// Seconds from local midnight of January 1 to the rule's transition instant,
+// in local time as it was before the transition.
+static long long rule_date_seconds_into_year(tz_rule_date_t* pdate, long long year) {
+	long long yday = 0;
+	switch (pdate->kind) {
+	case 'J':
+		yday = pdate->day - 1;
+		if (is_leap_year(year) && pdate->day >= 60)
+			yday++;
+		break;
+	case 'D':
+		yday = pdate->day;
+		break;
+	case 'M': {
+		long long first_of_month = days_from_civil(year, pdate->month, 1);
+		int first_wday = mlr_canonical_mod((first_of_month + 4) % 7, 7);
+		int mday = 1 + mlr_canonical_mod(pdate->day - first_wday, 7) + 7 * (pdate->week - 1);
+		while (mday > days_in_month(year, pdate->month))
+			mday -= 7;
+		yday = first_of_month + mday - 1 - days_from_civil(year, 1, 1);
+		break;
+	}
+	default:
+		MLR_INTERNAL_CODING_ERROR();
+	}
+	return yday * SECONDS_PER_DAY + pdate->seconds_into_day;
+}
+
+static tz_type_t* rule_type_at(tz_rule_t* prule, long long t) {
+	if (!prule->has_dst)
+		return &prule->std;
+
+	// Before 1970 the C library counts the year's transition dates from
+	// 1970-01-01 rather than from the start of the year, so that northern-
+	// hemisphere rules give standard time and southern-hemisphere ones
+	// daylight time throughout. Follow suit, so that results agree with
+	// localtime for the same TZ string.
+	long long y;
+	int m, d;
+	long long year_start;
+	if (t < 0) {
+		civil_from_days(floor_div(t, SECONDS_PER_DAY), &y, &m, &d);
+		year_start = 0LL;
+	} else {
+		civil_from_days(floor_div(t + prule->std.utoff, SECONDS_PER_DAY), &y, &m, &d);
+		year_start = days_from_civil(y, 1, 1) * SECONDS_PER_DAY;
+	}
+	long long dst_start = year_start + rule_date_seconds_into_year(&prule->start, y) - prule->std.utoff;
+	long long dst_end   = year_start + rule_date_seconds_into_year(&prule->end,   y) - prule->dst.utoff;
+
+	int isdst;
+	if (dst_start < dst_end) // Northern hemisphere
+		isdst = dst_start <= t && t < dst_end;
+	else                     // Southern hemisphere
+		isdst = !(dst_end <= t && t < dst_start);
+	return isdst ? &prule->dst : &prule->std;
+}
+
+// ----------------------------------------------------------------
+// Index of the last transition at or before t, or -1 if none.
+static int zone_transition_index_at(mlr_timezone_t* pzone, long long t) {
+	int lo = 0;
+	int hi = pzone->num_transitions - 1;
+	int found = -1;
+	while (lo <= hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (pzone->transition_times[mid] <= t) {
+			found = mid;
+			lo = mid + 1;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return found;
+}
+
+static tz_type_t* zone_type_at(mlr_timezone_t* pzone, long long t) {
+	int n = pzone->num_transitions;
+	if (n == 0)
+		return pzone->has_rule ? rule_type_at(&pzone->rule, t) : &pzone->types[0];
+	int i = zone_transition_index_at(pzone, t);
+	if (i < 0)
+		return &pzone->types[0];
+	if (i == n - 1 && pzone->has_rule)
+		return rule_type_at(&pzone->rule, t);
+	return &pzone->types[pzone->transition_type_indices[i]];
+}
+
+// For mktime-style tm_isdst handling: the type with the given DST flag which
+// was most recently in effect as of t, else the next one to be.
+static tz_type_t* zone_type_with_isdst_near(mlr_timezone_t* pzone, long long t, int isdst) {
+	int n = pzone->num_transitions;
+	int i = zone_transition_index_at(pzone, t);
+
+	if (pzone->has_rule && i == n - 1) {
+		if (isdst)
+			return pzone->rule.has_dst ? &pzone->rule.dst : NULL;
+		else
+			return &pzone->rule.std;
+	}
+
+	for (int j = i; j >= 0; j--) {
+		tz_type_t* ptype = &pzone->types[pzone->transition_type_indices[j]];
+		if (ptype->isdst == isdst)
+			return ptype;
+	}
+	if (pzone->num_types > 0 && pzone->types[0].isdst == isdst)
+		return &pzone->types[0];
+	for (int j = i + 1; j < n; j++) {
+		tz_type_t* ptype = &pzone->types[pzone->transition_type_indices[j]];
+		if (ptype->isdst == isdst)
+			return ptype;
+	}
+	if (pzone->has_rule) {
+		if (isdst)
+			return pzone->rule.has_dst ? &pzone->rule.dst : NULL;
+		else
+			return &pzone->rule.std;
+	}
+	return NULL;
+}
+
+// ================================================================
+// Proleptic-Gregorian day counts relative to 1970-01-01, after
+// http://howardhinnant.github.io/date_algorithms.html.
+
+static long long floor_div(long long a, long long b) {
+	long long q = a / b;
+	if ((a % b != 0) && ((a < 0) != (b < 0)))
+		q--;
+	return q;
+}
+
+static long long days_from_civil(long long y, int m, int d) {
+	y -= m <= 2;
+	long long era = floor_div(y, 400);
+	long long yoe = y - era * 400;
+	long long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	long long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + doe - 719468;
+}
+
+static void civil_from_days(long long days, long long* py, int* pm, int* pd) {
+	days += 719468;
+	long long era = floor_div(days, 146097);
+	long long doe = days - era * 146097;
+	long long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	long long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	long long mp = (5 * doy + 2) / 153;
+	*pd = doy - (153 * mp + 2) / 5 + 1;
+	*pm = mp < 10 ? mp + 3 : mp - 9;
+	*py = yoe + era * 400 + (*pm <= 2);
+}
@@ -1,9 +1,48 @@
 #ifndef MLRTIMEZONE_H
 #define MLRTIMEZONE_H
 
+#include <time.h>
+
 typedef enum _timezone_handling_t {
 	TIMEZONE_HANDLING_GMT,
 	TIMEZONE_HANDLING_LOCAL
 } timezone_handling_t;
 
+// ================================================================
+// Miller's own timezone engine. Zone rules are read from tzfile(5) files
+// (e.g. /usr/share/zoneinfo/America/Sao_Paulo) once, on first use, and the
+// transition tables are cached for the life of the process. Conversions
+// between seconds-since-the-epoch and struct tm are then pure table lookups
+// and arithmetic: they don't consult or modify the process-wide TZ state
+// which localtime()/mktime() use, so several zones can be used in the same
+// pass, and the same zone can be used from multiple threads.
+//
+// Zones are looked up by name: Olson names such as "Asia/Istanbul", absolute
+// paths to tzfiles, or POSIX TZ strings such as "EST5EDT,M3.2.0,M11.1.0".
+// The $TZ environment variable is handled the same way as by the C library:
+// unset means /etc/localtime, and empty means UTC.
+// ================================================================
+
+typedef struct _mlr_timezone_t mlr_timezone_t;
+
+// The returned pointers are owned by the cache and must not be freed. Returns
+// NULL for unknown zone names.
+mlr_timezone_t* mlr_timezone_get(char* name);
+// Zone per the current value of $TZ. Since ENV["TZ"] can be assigned from
+// the DSL, this is rechecked on each call; lookups for an unchanged $TZ are
+// cheap. As with the C library, unknown $TZ values fall back to UTC.
+mlr_timezone_t* mlr_timezone_get_from_env();
+mlr_timezone_t* mlr_timezone_get_utc();
+
+char* mlr_timezone_get_name(mlr_timezone_t* pzone);
+
+// Like gmtime_r/localtime_r. The tm_zone abbreviation, where supported,
+// points into the cached zone and remains valid.
+void mlr_timezone_seconds_to_tm(mlr_timezone_t* pzone, time_t seconds, struct tm* ptm);
+// Like mktime, including its handling of tm_isdst: negative means determine
+// from the zone rules; zero or positive means the time is to be interpreted
+// as standard or daylight-saving time respectively, as far as the zone has
+// such an offset. The input struct tm is not modified.
+time_t mlr_timezone_tm_to_seconds(mlr_timezone_t* pzone, struct tm* ptm);
+
 #endif // MLRTIMEZONE_H
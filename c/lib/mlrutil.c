@@ -1,7 +1,9 @@
 #include <stdio.h>
+#include <stdarg.h>
 #include <string.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include "lib/mlrutil.h"
 #include "lib/mlr_globals.h"
@@ -26,6 +28,53 @@ void mlr_internal_coding_error_unless(int v, char* file, int line) {
 	}
 }
 
+// ----------------------------------------------------------------
+static pthread_key_t  data_error_catcher_key;
+static pthread_once_t data_error_catcher_key_once = PTHREAD_ONCE_INIT;
+
+static void data_error_catcher_key_create() {
+	pthread_key_create(&data_error_catcher_key, NULL);
+}
+
+void mlr_print_data_error(char* format, ...) {
+	pthread_once(&data_error_catcher_key_once, data_error_catcher_key_create);
+	mlr_data_error_catcher_t* pcatcher = pthread_getspecific(data_error_catcher_key);
+	va_list args;
+	va_start(args, format);
+	if (pcatcher == NULL) {
+		vfprintf(stderr, format, args);
+	} else {
+		va_list args_copy;
+		va_copy(args_copy, args);
+		int length = vsnprintf(NULL, 0, format, args_copy);
+		va_end(args_copy);
+		char* text = mlr_malloc_or_die(length + 1);
+		vsnprintf(text, length + 1, format, args);
+		if (pcatcher->message == NULL) {
+			pcatcher->message = text;
+		} else {
+			char* both = mlr_paste_2_strings(pcatcher->message, text);
+			free(pcatcher->message);
+			free(text);
+			pcatcher->message = both;
+		}
+	}
+	va_end(args);
+}
+
+void mlr_exit_on_data_error() {
+	pthread_once(&data_error_catcher_key_once, data_error_catcher_key_create);
+	mlr_data_error_catcher_t* pcatcher = pthread_getspecific(data_error_catcher_key);
+	if (pcatcher != NULL)
+		longjmp(pcatcher->env, 1);
+	exit(1);
+}
+
+void mlr_set_data_error_catcher(mlr_data_error_catcher_t* pcatcher) {
+	pthread_once(&data_error_catcher_key_once, data_error_catcher_key_create);
+	pthread_setspecific(data_error_catcher_key, pcatcher);
+}
+
 // ----------------------------------------------------------------
 char* mlr_strmsep(char **pstring, const char *sep, int seplen) {
 	char* string = *pstring;
@@ -85,12 +134,16 @@ int mlr_bsearch_double_for_insert(double* array, int size, double value) {
 }
 
 // ----------------------------------------------------------------
+int mlr_alloc_counting = FALSE;
+unsigned long long mlr_alloc_count = 0ULL;
+
 void* mlr_malloc_or_die(size_t size) {
 	void* p = malloc(size);
 	if (p == NULL) {
 		fprintf(stderr, "malloc(%llu) failed.\n", (unsigned long long)size);
 		exit(1);
 	}
+	mlr_count_alloc();
 #ifdef MLR_MALLOC_TRACE
 	fprintf(stderr, "MALLOC size=%llu,p=%p\n", (unsigned long long)size, p);
 #endif
@@ -104,6 +157,7 @@ void* mlr_realloc_or_die(void *optr, size_t size) {
 		fprintf(stderr, "realloc(%llu) failed.\n", (unsigned long long)size);
 		exit(1);
 	}
+	mlr_count_alloc();
 #ifdef MLR_MALLOC_TRACE
 	fprintf(stderr, "REALLOC size=%llu,p=%p\n", (unsigned long long)size, nptr);
 #endif
@@ -519,6 +573,17 @@ ssize_t get_file_size(char* filename) {
 	}
 }
 
+// ----------------------------------------------------------------
+// Returns FALSE on error, or if the file is e.g. a pipe or a device.
+int is_regular_file(char* filename) {
+	struct stat statbuf;
+	if (stat(filename, &statbuf) < 0) {
+		return FALSE;
+	} else {
+		return S_ISREG(statbuf.st_mode);
+	}
+}
+
 // ----------------------------------------------------------------
 char* read_file_into_memory(char* filename, size_t* psize) {
 	struct stat statbuf;
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <setjmp.h>
 #include "mtrand.h"
 
 #define TRUE  1
@@ -21,6 +22,21 @@ void mlr_internal_coding_error(char* file, int line);
 void mlr_internal_coding_error_if(int v, char* file, int line);
 void mlr_internal_coding_error_unless(int v, char* file, int line);
 
+// For errors in the data, e.g. a failed type assertion in the DSL: callers print their message with
+// mlr_print_data_error, as with fprintf to stderr, and then call mlr_exit_on_data_error rather than
+// exit(1). These exit unless the calling thread has set a catcher, as put/filter's worker threads
+// do so that records before the bad one can still be written. Then the message is kept in the
+// catcher rather than printed, so that only the first failing record's is shown, and the thread
+// jumps back to the catcher.
+typedef struct _mlr_data_error_catcher_t {
+	jmp_buf env;
+	char*   message; // NULL until something is printed
+} mlr_data_error_catcher_t;
+
+void mlr_print_data_error(char* format, ...);
+void mlr_exit_on_data_error();
+void mlr_set_data_error_catcher(mlr_data_error_catcher_t* pcatcher);
+
 // ----------------------------------------------------------------
 //int mlr_canonical_mod(int a, int n);
 static inline int mlr_canonical_mod(int a, int n) {
@@ -81,6 +97,15 @@ char* mlr_strmsep(char **pstring, const char *sep, int seplen);
 // ----------------------------------------------------------------
 int mlr_bsearch_double_for_insert(double* array, int size, double value);
 
+// For --profile: when mlr_alloc_counting is set, the allocators below count their calls in
+// mlr_alloc_count. Atomically, since put may evaluate records on several threads.
+extern int mlr_alloc_counting;
+extern unsigned long long mlr_alloc_count;
+static inline void mlr_count_alloc() {
+	if (mlr_alloc_counting)
+		__sync_fetch_and_add(&mlr_alloc_count, 1ULL);
+}
+
 void*  mlr_malloc_or_die(size_t size);
 void*  mlr_realloc_or_die(void *ptr, size_t size);
 static inline char * mlr_strdup_or_die(const char *s1) {
@@ -89,6 +114,7 @@ static inline char * mlr_strdup_or_die(const char *s1) {
 		fprintf(stderr, "malloc/strdup failed\n");
 		exit(1);
 	}
+	mlr_count_alloc();
 #ifdef MLR_MALLOC_TRACE
 	fprintf(stderr, "STRDUP size=%d,p=%p\n", (int)strlen(s2), s2);
 #endif
@@ -170,6 +196,8 @@ char* mlr_alloc_double_backslash(char* input);
 
 // Returns -1 on error
 ssize_t get_file_size(char* filename);
+// Returns FALSE on error, or if the file is e.g. a pipe or a device.
+int is_regular_file(char* filename);
 
 // The caller should free the return value.
 char* read_file_into_memory(char* filename, size_t* psize);
@@ -186,8 +186,8 @@ char* mv_describe_val(mv_t val) {
 void mv_set_boolean_strict(mv_t* pval) {
 	if (pval->type != MT_BOOLEAN) {
 		char* desc = mt_describe_type(pval->type);
-		fprintf(stderr, "Expression does not evaluate to boolean: got %s.\n", desc);
-		exit(1);
+		mlr_print_data_error("Expression does not evaluate to boolean: got %s.\n", desc);
+		mlr_exit_on_data_error();
 	}
 }
 
@@ -6,6 +6,7 @@
 #include "lib/mlrutil.h"
 #include "lib/mlrdatetime.h"
 #include "lib/mlrregex.h"
+#include "lib/hyperloglog.h"
 #include "lib/mvfuncs.h"
 
 // ================================================================
@@ -125,12 +126,8 @@ static mv_binary_func_t* dot_dispositions[MT_DIM][MT_DIM] = {
 mv_t s_xx_dot_func(mv_t* pval1, mv_t* pval2) { return (dot_dispositions[pval1->type][pval2->type])(pval1,pval2); }
 
 // ----------------------------------------------------------------
-mv_t sub_no_precomp_func(mv_t* pval1, mv_t* pval2, mv_t* pval3) {
-	regex_t regex;
-	string_builder_t *psb = sb_alloc(MV_SB_ALLOC_LENGTH);
-	mv_t rv = sub_precomp_func(pval1, regcomp_or_die(&regex, pval2->u.strv, 0), psb, pval3);
-	sb_free(psb);
-	regfree(&regex);
+mv_t sub_no_precomp_func(mv_t* pval1, mv_t* pval2, regex_cache_t* pcache, string_builder_t* psb, mv_t* pval3) {
+	mv_t rv = sub_precomp_func(pval1, regex_cache_get(pcache, pval2->u.strv, 0), psb, pval3);
 	mv_free(pval2);
 	return rv;
 }
@@ -147,7 +144,7 @@ mv_t sub_no_precomp_func(mv_t* pval1, mv_t* pval2, mv_t* pval3) {
 // *  len3 = 1 = length of "o"
 // *  len4 = 6 = 2+3+1
 
-mv_t sub_precomp_func(mv_t* pval1, regex_t* pregex, string_builder_t* psb, mv_t* pval3) {
+mv_t sub_precomp_func(mv_t* pval1, mlr_regex_t* pregex, string_builder_t* psb, mv_t* pval3) {
 	int matched      = FALSE;
 	int all_captured = FALSE;
 	char* input      = pval1->u.strv;
@@ -170,17 +167,13 @@ mv_t sub_precomp_func(mv_t* pval1, regex_t* pregex, string_builder_t* psb, mv_t*
 // *  len3 = 1 = length of "o"
 // *  len4 = 6 = 2+3+1
 
-mv_t gsub_no_precomp_func(mv_t* pval1, mv_t* pval2, mv_t* pval3) {
-	regex_t regex;
-	string_builder_t *psb = sb_alloc(MV_SB_ALLOC_LENGTH);
-	mv_t rv = gsub_precomp_func(pval1, regcomp_or_die(&regex, pval2->u.strv, 0), psb, pval3);
-	sb_free(psb);
-	regfree(&regex);
+mv_t gsub_no_precomp_func(mv_t* pval1, mv_t* pval2, regex_cache_t* pcache, string_builder_t* psb, mv_t* pval3) {
+	mv_t rv = gsub_precomp_func(pval1, regex_cache_get(pcache, pval2->u.strv, 0), psb, pval3);
 	mv_free(pval2);
 	return rv;
 }
 
-mv_t gsub_precomp_func(mv_t* pval1, regex_t* pregex, string_builder_t* psb, mv_t* pval3) {
+mv_t gsub_precomp_func(mv_t* pval1, mlr_regex_t* pregex, string_builder_t* psb, mv_t* pval3) {
 	int matched      = FALSE;
 	int all_captured = FALSE;
 	char* input      = pval1->u.strv;
@@ -383,6 +376,15 @@ mv_t s_x_typeof_func(mv_t* pval1) {
 mv_t time_string_from_seconds(mv_t* psec, char* format,
 	timezone_handling_t timezone_handling)
 {
+	return time_string_from_seconds_in_zone(psec, format, timezone_handling == TIMEZONE_HANDLING_GMT
+		? mlr_timezone_get_utc() : mlr_timezone_get_from_env());
+}
+
+// Precondition: psec is either int or float. A NULL zone, from an unknown
+// zone name, gives an error value.
+mv_t time_string_from_seconds_in_zone(mv_t* psec, char* format, mlr_timezone_t* pzone) {
+	if (pzone == NULL)
+		return mv_error();
 	double seconds_since_the_epoch = 0.0;
 	if (psec->type == MT_FLOAT) {
 		if (isinf(psec->u.fltv) || isnan(psec->u.fltv)) {
@@ -393,8 +395,7 @@ mv_t time_string_from_seconds(mv_t* psec, char* format,
 		seconds_since_the_epoch = psec->u.intv;
 	}
 
-	char* string = mlr_alloc_time_string_from_seconds(seconds_since_the_epoch, format,
-		timezone_handling);
+	char* string = mlr_alloc_time_string_from_seconds_in_zone(seconds_since_the_epoch, format, pzone);
 
 	return mv_from_string_with_free(string);
 }
@@ -502,6 +503,30 @@ static mv_binary_func_t* sec2localn_dispositions[MT_DIM] = {
 };
 mv_t s_xi_sec2localtime_func(mv_t* pval1, mv_t* pval2) { return (sec2localn_dispositions[pval1->type])(pval1, pval2); }
 
+static char* ISO8601_LOCAL_TIME_FORMATS_BY_NDECIMALS[] = {
+	ISO8601_LOCAL_TIME_FORMAT,
+	ISO8601_LOCAL_TIME_FORMAT_1, ISO8601_LOCAL_TIME_FORMAT_2, ISO8601_LOCAL_TIME_FORMAT_3,
+	ISO8601_LOCAL_TIME_FORMAT_4, ISO8601_LOCAL_TIME_FORMAT_5, ISO8601_LOCAL_TIME_FORMAT_6,
+	ISO8601_LOCAL_TIME_FORMAT_7, ISO8601_LOCAL_TIME_FORMAT_8, ISO8601_LOCAL_TIME_FORMAT_9,
+};
+
+// Precondition: val2 is already asserted int, and val3 string
+mv_t s_xis_sec2localtime_func(mv_t* pval1, mv_t* pval2, mv_t* pval3) {
+	mv_t rv;
+	if (pval1->type == MT_INT || pval1->type == MT_FLOAT) {
+		long long n = pval2->u.intv;
+		if (n < 0LL || n > 9LL)
+			rv = mv_error();
+		else
+			rv = time_string_from_seconds_in_zone(pval1, ISO8601_LOCAL_TIME_FORMATS_BY_NDECIMALS[n],
+				mlr_timezone_get(pval3->u.strv));
+	} else {
+		rv = (sec2localn_dispositions[pval1->type])(pval1, pval2);
+	}
+	mv_free(pval3);
+	return rv;
+}
+
 // ----------------------------------------------------------------
 static mv_t sec2localdate_s_n(mv_t* pa) {
 	return time_string_from_seconds(pa, ISO8601_DATE_FORMAT, TIMEZONE_HANDLING_LOCAL);
@@ -519,6 +544,17 @@ static mv_unary_func_t* sec2localdate_dispositions[MT_DIM] = {
 
 mv_t s_x_sec2localdate_func(mv_t* pval1) { return (sec2localdate_dispositions[pval1->type])(pval1); }
 
+// Precondition: val2 is already asserted string
+mv_t s_xs_sec2localdate_func(mv_t* pval1, mv_t* pval2) {
+	mv_t rv;
+	if (pval1->type == MT_INT || pval1->type == MT_FLOAT)
+		rv = time_string_from_seconds_in_zone(pval1, ISO8601_DATE_FORMAT, mlr_timezone_get(pval2->u.strv));
+	else
+		rv = (sec2localdate_dispositions[pval1->type])(pval1);
+	mv_free(pval2);
+	return rv;
+}
+
 
 // ----------------------------------------------------------------
 mv_t s_ns_strftime_func(mv_t* pval1, mv_t* pval2) {
@@ -534,6 +570,13 @@ mv_t s_ns_strftime_local_func(mv_t* pval1, mv_t* pval2) {
 	return rv;
 }
 
+mv_t s_nss_strftime_local_func(mv_t* pval1, mv_t* pval2, mv_t* pval3) {
+	mv_t rv = time_string_from_seconds_in_zone(pval1, pval2->u.strv, mlr_timezone_get(pval3->u.strv));
+	mv_free(pval2);
+	mv_free(pval3);
+	return rv;
+}
+
 // ----------------------------------------------------------------
 static mv_t seconds_from_time_string(char* string, char* format,
 	timezone_handling_t timezone_handling)
@@ -545,6 +588,17 @@ static mv_t seconds_from_time_string(char* string, char* format,
 	}
 }
 
+static mv_t seconds_from_time_string_in_zone(char* string, char* format, char* zone_name) {
+	mlr_timezone_t* pzone = mlr_timezone_get(zone_name);
+	if (pzone == NULL) {
+		return mv_error();
+	} else if (*string == '\0') {
+		return mv_empty();
+	} else {
+		return mv_from_float(mlr_seconds_from_time_string_in_zone(string, format, pzone));
+	}
+}
+
 mv_t i_s_gmt2sec_func(mv_t* pval1) {
 	mv_t rv = seconds_from_time_string(pval1->u.strv, ISO8601_TIME_FORMAT, TIMEZONE_HANDLING_GMT);
 	mv_free(pval1);
@@ -557,6 +611,13 @@ mv_t i_s_localtime2sec_func(mv_t* pval1) {
 	return rv;
 }
 
+mv_t i_ss_localtime2sec_func(mv_t* pval1, mv_t* pval2) {
+	mv_t rv = seconds_from_time_string_in_zone(pval1->u.strv, ISO8601_LOCAL_TIME_FORMAT, pval2->u.strv);
+	mv_free(pval1);
+	mv_free(pval2);
+	return rv;
+}
+
 mv_t i_ss_strptime_func(mv_t* pval1, mv_t* pval2) {
 	mv_t rv = seconds_from_time_string(pval1->u.strv, pval2->u.strv, TIMEZONE_HANDLING_GMT);
 	mv_free(pval1);
@@ -571,6 +632,14 @@ mv_t i_ss_strptime_local_func(mv_t* pval1, mv_t* pval2) {
 	return rv;
 }
 
+mv_t i_sss_strptime_local_func(mv_t* pval1, mv_t* pval2, mv_t* pval3) {
+	mv_t rv = seconds_from_time_string_in_zone(pval1->u.strv, pval2->u.strv, pval3->u.strv);
+	mv_free(pval1);
+	mv_free(pval2);
+	mv_free(pval3);
+	return rv;
+}
+
 // ----------------------------------------------------------------
 static void split_ull_to_hms(long long u, long long* ph, long long* pm, long long* ps) {
 	long long h = 0LL, m = 0LL, s = 0LL;
@@ -835,6 +904,107 @@ mv_t f_s_dhms2fsec_func(mv_t* pval1) {
 	return mv_from_float(sec * sign);
 }
 
+// ----------------------------------------------------------------
+// HyperLogLog sketches for the DSL are serialized as strings, so they can be
+// kept in oosvars, emitted, and merged across runs. Absent and empty sketches
+// are treated as empty sketches of the default precision.
+
+// Returns a sketch string which the caller owns, transferring ownership from
+// the argument where possible, or NULL if the argument isn't a sketch.
+static char* hll_steal_or_copy_string(mv_t* pval, int* pprecision) {
+	if (pval->type == MT_ABSENT || pval->type == MT_EMPTY) {
+		*pprecision = HLL_DEFAULT_PRECISION;
+		return hll_alloc_empty_string(HLL_DEFAULT_PRECISION);
+	}
+	if (pval->type != MT_STRING)
+		return NULL;
+	*pprecision = hll_string_precision(pval->u.strv);
+	if (*pprecision < 0) {
+		mv_free(pval);
+		return NULL;
+	}
+	if (pval->free_flags & FREE_ENTRY_VALUE) {
+		char* s = pval->u.strv;
+		*pval = mv_absent();
+		return s;
+	} else {
+		return mlr_strdup_or_die(pval->u.strv);
+	}
+}
+
+mv_t s_i_hll_init_func(mv_t* pval1) {
+	long long precision = pval1->u.intv;
+	if (precision < HLL_MIN_PRECISION || precision > HLL_MAX_PRECISION)
+		return mv_error();
+	return mv_from_string_with_free(hll_alloc_empty_string(precision));
+}
+
+// The sketch is updated in place when the first argument owns it: e.g. for
+// '@s[$a] = hll_add(@s[$a], $b)', the oosvar's string is moved in and back out
+// rather than copied (see mlr_dsl_cst_map_assignment_statements.c).
+mv_t s_xx_hll_add_func(mv_t* pval1, mv_t* pval2) {
+	if (pval2->type == MT_ERROR) {
+		mv_free(pval1);
+		return mv_error();
+	}
+	// Absent and empty values are not counted.
+	int is_null2 = (pval2->type == MT_ABSENT || pval2->type == MT_EMPTY);
+	if (is_null2 && (pval1->type == MT_ABSENT || pval1->type == MT_EMPTY))
+		return *pval1;
+	int precision;
+	char* sketch = hll_steal_or_copy_string(pval1, &precision);
+	if (sketch == NULL) {
+		mv_free(pval2);
+		return mv_error();
+	}
+	if (is_null2) {
+		// nothing to add
+	} else if (pval2->type == MT_STRING) {
+		hll_string_add(sketch, precision, pval2->u.strv);
+		mv_free(pval2);
+	} else {
+		char* value = mv_alloc_format_val(pval2);
+		hll_string_add(sketch, precision, value);
+		free(value);
+	}
+	return mv_from_string_with_free(sketch);
+}
+
+mv_t s_xx_hll_merge_func(mv_t* pval1, mv_t* pval2) {
+	if (pval1->type == MT_ABSENT || pval1->type == MT_EMPTY)
+		return *pval2;
+	if (pval2->type == MT_ABSENT || pval2->type == MT_EMPTY)
+		return *pval1;
+	hll_t* pa = (pval1->type == MT_STRING) ? hll_from_string(pval1->u.strv) : NULL;
+	hll_t* pb = (pval2->type == MT_STRING) ? hll_from_string(pval2->u.strv) : NULL;
+	mv_free(pval1);
+	mv_free(pval2);
+	if (pa == NULL || pb == NULL) {
+		hll_free(pa);
+		hll_free(pb);
+		return mv_error();
+	}
+	hll_t* pmerged = hll_merge_alloc(pa, pb);
+	mv_t rv = mv_from_string_with_free(hll_to_string(pmerged));
+	hll_free(pa);
+	hll_free(pb);
+	hll_free(pmerged);
+	return rv;
+}
+
+mv_t i_x_hll_estimate_func(mv_t* pval1) {
+	if (pval1->type == MT_ABSENT)
+		return mv_absent();
+	if (pval1->type == MT_EMPTY)
+		return mv_from_int(0LL);
+	if (pval1->type != MT_STRING)
+		return mv_error();
+	int precision = hll_string_precision(pval1->u.strv);
+	long long estimate = (precision < 0) ? -1LL : hll_string_estimate(pval1->u.strv, precision);
+	mv_free(pval1);
+	return (estimate < 0LL) ? mv_error() : mv_from_int(estimate);
+}
+
 // ================================================================
 static mv_t plus_f_ff(mv_t* pa, mv_t* pb) {
 	double a = pa->u.fltv;
@@ -853,7 +1023,7 @@ static mv_t plus_f_if(mv_t* pa, mv_t* pb) {
 }
 // Adds & subtracts overflow by at most one bit so it suffices to check
 // sign-changes.
-static mv_t plus_n_ii(mv_t* pa, mv_t* pb) {
+mv_t plus_n_ii(mv_t* pa, mv_t* pb) {
 	long long a = pa->u.intv;
 	long long b = pb->u.intv;
 	long long c = a + b;
@@ -905,7 +1075,7 @@ static mv_t minus_f_if(mv_t* pa, mv_t* pb) {
 }
 // Adds & subtracts overflow by at most one bit so it suffices to check
 // sign-changes.
-static mv_t minus_n_ii(mv_t* pa, mv_t* pb) {
+mv_t minus_n_ii(mv_t* pa, mv_t* pb) {
 	long long a = pa->u.intv;
 	long long b = pb->u.intv;
 	long long c = a - b;
@@ -981,7 +1151,7 @@ static mv_t times_f_if(mv_t* pa, mv_t* pb) {
 // check if the absolute value of the product exceeds the largest representable
 // double less than 2**63. (An alterative would be to do all integer multiplies
 // using handcrafted multi-word 128-bit arithmetic).
-static mv_t times_n_ii(mv_t* pa, mv_t* pb) {
+mv_t times_n_ii(mv_t* pa, mv_t* pb) {
 	long long a = pa->u.intv;
 	long long b = pb->u.intv;
 
@@ -2321,43 +2491,42 @@ int mvnecopy(mv_t* pval1, mv_t* pval2) {
 }
 
 // ----------------------------------------------------------------
-// arg2 evaluates to string via compound expression; regexes compiled on each call.
-mv_t matches_no_precomp_func(mv_t* pval1, mv_t* pval2, string_array_t** ppregex_captures) {
+// arg2 evaluates to string via compound expression; regexes compiled via the cache.
+mv_t matches_no_precomp_func(mv_t* pval1, mv_t* pval2, regex_cache_t* pcache, string_array_t** ppregex_captures) {
 	char* s1 = pval1->u.strv;
 	char* s2 = pval2->u.strv;
 
-	regex_t regex;
 	char* sstr   = s1;
 	char* sregex = s2;
 
-	regcomp_or_die(&regex, sregex, REG_NOSUB);
+	mlr_regex_t* pregex = regex_cache_get(pcache, sregex, REG_NOSUB);
 
 	const size_t nmatchmax = 10; // Capture-groups \1 through \9 supported, along with entire-string match
 	regmatch_t matches[nmatchmax];
-	if (regmatch_or_die(&regex, sstr, nmatchmax, matches)) {
+	if (regmatch_or_die(pregex, sstr, nmatchmax, matches)) {
 		if (ppregex_captures != NULL && *ppregex_captures != NULL)
 			save_regex_captures(ppregex_captures, pval1->u.strv, matches, nmatchmax);
-		regfree(&regex);
 		mv_free(pval1);
 		mv_free(pval2);
 		return mv_from_true();
 	} else {
-		regfree(&regex);
 		mv_free(pval1);
 		mv_free(pval2);
 		return mv_from_false();
 	}
 }
 
-mv_t does_not_match_no_precomp_func(mv_t* pval1, mv_t* pval2, string_array_t** ppregex_captures) {
-	mv_t rv = matches_no_precomp_func(pval1, pval2, ppregex_captures);
+mv_t does_not_match_no_precomp_func(mv_t* pval1, mv_t* pval2, regex_cache_t* pcache,
+	string_array_t** ppregex_captures)
+{
+	mv_t rv = matches_no_precomp_func(pval1, pval2, pcache, ppregex_captures);
 	rv.u.boolv = !rv.u.boolv;
 	return rv;
 }
 
 // ----------------------------------------------------------------
 // arg2 is a string, compiled to regex only once at alloc time
-mv_t matches_precomp_func(mv_t* pval1, regex_t* pregex, string_builder_t* psb, string_array_t** ppregex_captures) {
+mv_t matches_precomp_func(mv_t* pval1, mlr_regex_t* pregex, string_builder_t* psb, string_array_t** ppregex_captures) {
 	const size_t nmatchmax = 10; // Capture-groups \1 through \9 supported, along with entire-string match
 	regmatch_t matches[nmatchmax];
 	if (regmatch_or_die(pregex, pval1->u.strv, nmatchmax, matches)) {
@@ -2380,7 +2549,7 @@ mv_t matches_precomp_func(mv_t* pval1, regex_t* pregex, string_builder_t* psb, s
 	}
 }
 
-mv_t does_not_match_precomp_func(mv_t* pval1, regex_t* pregex, string_builder_t* psb, string_array_t** ppregex_captures) {
+mv_t does_not_match_precomp_func(mv_t* pval1, mlr_regex_t* pregex, string_builder_t* psb, string_array_t** ppregex_captures) {
 	mv_t rv = matches_precomp_func(pval1, pregex, psb, ppregex_captures);
 	rv.u.boolv = !rv.u.boolv;
 	return rv;
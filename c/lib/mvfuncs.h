@@ -44,10 +44,13 @@ typedef mv_t mv_variadic_func_t(mv_t* pvals, int nvals);
 typedef mv_t mv_zary_func_t();
 typedef mv_t mv_unary_func_t(mv_t* pval1);
 typedef mv_t mv_binary_func_t(mv_t* pval1, mv_t* pval2);
-typedef mv_t mv_binary_arg3_capture_func_t(mv_t* pval1, mv_t* pval2, string_array_t** ppregex_captures);
-typedef mv_t mv_binary_arg2_regex_func_t(mv_t* pval1, regex_t* pregex, string_builder_t* psb, string_array_t** ppregex_captures);
+typedef mv_t mv_binary_arg3_capture_func_t(mv_t* pval1, mv_t* pval2, regex_cache_t* pcache,
+	string_array_t** ppregex_captures);
+typedef mv_t mv_binary_arg2_regex_func_t(mv_t* pval1, mlr_regex_t* pregex, string_builder_t* psb, string_array_t** ppregex_captures);
 typedef mv_t mv_ternary_func_t(mv_t* pval1, mv_t* pval2, mv_t* pval3);
-typedef mv_t mv_ternary_arg2_regex_func_t(mv_t* pval1, regex_t* pregex, string_builder_t* psb, mv_t* pval3);
+typedef mv_t mv_ternary_arg2_regex_func_t(mv_t* pval1, mlr_regex_t* pregex, string_builder_t* psb, mv_t* pval3);
+typedef mv_t mv_ternary_arg2_regex_cache_func_t(mv_t* pval1, mv_t* pval2, regex_cache_t* pcache, string_builder_t* psb,
+	mv_t* pval3);
 
 // ----------------------------------------------------------------
 static inline mv_t b_b_not_func(mv_t* pval1) {
@@ -110,6 +113,10 @@ mv_t x_xx_minus_func(mv_t* pval1, mv_t* pval2);
 mv_t x_xx_times_func(mv_t* pval1, mv_t* pval2);
 mv_t x_xx_divide_func(mv_t* pval1, mv_t* pval2);
 mv_t x_xx_int_divide_func(mv_t* pval1, mv_t* pval2);
+// The int-int cases of the above, for callers which have already checked types.
+mv_t plus_n_ii(mv_t* pa, mv_t* pb);
+mv_t minus_n_ii(mv_t* pa, mv_t* pb);
+mv_t times_n_ii(mv_t* pa, mv_t* pb);
 
 // These four intentionally overflow 64-bit ints. This is for use-cases where
 // people want that, e.g. 64-bit integer math.
@@ -200,10 +207,11 @@ mv_t s_x_typeof_func(mv_t* pval1);
 
 mv_t s_xx_dot_func(mv_t* pval1, mv_t* pval2);
 
-mv_t sub_no_precomp_func(mv_t* pval1, mv_t* pval2, mv_t* pval3);
-mv_t sub_precomp_func(mv_t* pval1, regex_t* pregex, string_builder_t* psb, mv_t* pval3);
-mv_t gsub_no_precomp_func(mv_t* pval1, mv_t* pval2, mv_t* pval3);
-mv_t gsub_precomp_func(mv_t* pval1, regex_t* pregex, string_builder_t* psb, mv_t* pval3);
+// The no-precomp variants are for regexes computed per record: these are compiled via the cache.
+mv_t sub_no_precomp_func(mv_t* pval1, mv_t* pval2, regex_cache_t* pcache, string_builder_t* psb, mv_t* pval3);
+mv_t sub_precomp_func(mv_t* pval1, mlr_regex_t* pregex, string_builder_t* psb, mv_t* pval3);
+mv_t gsub_no_precomp_func(mv_t* pval1, mv_t* pval2, regex_cache_t* pcache, string_builder_t* psb, mv_t* pval3);
+mv_t gsub_precomp_func(mv_t* pval1, mlr_regex_t* pregex, string_builder_t* psb, mv_t* pval3);
 // String-substitution with no regexes or special characters.
 mv_t s_sss_ssub_func(mv_t* pstring, mv_t* pold, mv_t* pnew);
 
@@ -225,6 +233,13 @@ mv_t s_ns_strftime_local_func(mv_t* pval1, mv_t* pval2);
 mv_t i_ss_strptime_func(mv_t* pval1, mv_t* pval2);
 mv_t i_ss_strptime_local_func(mv_t* pval1, mv_t* pval2);
 
+// Variants with the timezone name as final argument, rather than consulting $TZ.
+mv_t s_xis_sec2localtime_func(mv_t* pval1, mv_t* pval2, mv_t* pval3);
+mv_t s_xs_sec2localdate_func(mv_t* pval1, mv_t* pval2);
+mv_t i_ss_localtime2sec_func(mv_t* pval1, mv_t* pval2);
+mv_t s_nss_strftime_local_func(mv_t* pval1, mv_t* pval2, mv_t* pval3);
+mv_t i_sss_strptime_local_func(mv_t* pval1, mv_t* pval2, mv_t* pval3);
+
 mv_t s_i_sec2hms_func(mv_t* pval1);
 mv_t s_f_fsec2hms_func(mv_t* pval1);
 mv_t s_i_sec2dhms_func(mv_t* pval1);
@@ -236,14 +251,23 @@ mv_t f_s_dhms2fsec_func(mv_t* pval1);
 
 mv_t time_string_from_seconds(mv_t* psec, char* format,
 	timezone_handling_t timezone_handling);
+mv_t time_string_from_seconds_in_zone(mv_t* psec, char* format, mlr_timezone_t* pzone);
+
+// ----------------------------------------------------------------
+// HyperLogLog sketches, serialized as strings.
+mv_t s_i_hll_init_func(mv_t* pval1);
+mv_t s_xx_hll_add_func(mv_t* pval1, mv_t* pval2);
+mv_t s_xx_hll_merge_func(mv_t* pval1, mv_t* pval2);
+mv_t i_x_hll_estimate_func(mv_t* pval1);
 
 // ----------------------------------------------------------------
-// arg2 evaluates to string via compound expression; regexes compiled on each call
-mv_t matches_no_precomp_func(mv_t* pval1, mv_t* pval2, string_array_t** ppregex_captures);
-mv_t does_not_match_no_precomp_func(mv_t* pval1, mv_t* pval2, string_array_t** ppregex_captures);
+// arg2 evaluates to string via compound expression; regexes compiled via the cache
+mv_t matches_no_precomp_func(mv_t* pval1, mv_t* pval2, regex_cache_t* pcache, string_array_t** ppregex_captures);
+mv_t does_not_match_no_precomp_func(mv_t* pval1, mv_t* pval2, regex_cache_t* pcache,
+	string_array_t** ppregex_captures);
 // arg2 is a string, compiled to regex only once at alloc time
-mv_t matches_precomp_func(mv_t* pval1, regex_t* pregex, string_builder_t* psb, string_array_t** ppregex_captures);
-mv_t does_not_match_precomp_func(mv_t* pval1, regex_t* pregex, string_builder_t* psb, string_array_t** ppregex_captures);
+mv_t matches_precomp_func(mv_t* pval1, mlr_regex_t* pregex, string_builder_t* psb, string_array_t** ppregex_captures);
+mv_t does_not_match_precomp_func(mv_t* pval1, mlr_regex_t* pregex, string_builder_t* psb, string_array_t** ppregex_captures);
 
 // For filter/put DSL:
 mv_t eq_op_func(mv_t* pval1, mv_t* pval2);
@@ -32,11 +32,19 @@ typedef void mapper_usage_func_t(FILE* o, char* argv0, char* verb);
 typedef      mapper_t* mapper_parse_cli_func_t(int* pargi, int argc, char** argv,
 	cli_reader_opts_t* pmain_reader_opts, cli_writer_opts_t* pmain_writer_opts);
 
+// Optional, for verbs which would otherwise retain all their input until end of stream in
+// order to make a second pass over it: see --two-pass in mlrcli.c. If the mapper, as
+// configured, can instead have its input re-read, this puts it in two-pass mode and returns
+// TRUE. It's then given all input records, then a null record, then all input records
+// again, then a null record as usual. It must produce no output on the first pass.
+typedef int mapper_two_pass_func_t(mapper_t* pmapper);
+
 typedef struct _mapper_setup_t {
 	char*                    verb;
 	mapper_usage_func_t*     pusage_func;
 	mapper_parse_cli_func_t* pparse_func;
 	int                      ignores_input; // most don't; data-generators like seqgen do
+	mapper_two_pass_func_t*  ptwo_pass_func; // optional
 } mapper_setup_t;
 
 #endif // MAPPER_H
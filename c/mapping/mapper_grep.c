@@ -6,11 +6,14 @@
 #include "lib/mlrregex.h"
 #include "containers/sllv.h"
 
+#define SB_ALLOC_LENGTH 256
+
 typedef struct _mapper_grep_state_t {
 	ap_state_t* pargp;
 	int exclude;
-	regex_t regex;
+	mlr_regex_t regex;
 	cli_writer_opts_t* pwriter_opts;
+	string_builder_t* psb;
 } mapper_grep_state_t;
 
 static void      mapper_grep_usage(FILE* o, char* argv0, char* verb);
@@ -20,6 +23,7 @@ static mapper_t* mapper_grep_alloc(ap_state_t* pargp, char* regex_string, int ex
 	cli_writer_opts_t* pwriter_opts);
 static void      mapper_grep_free(mapper_t* pmapper, context_t* _);
 static sllv_t*   mapper_grep_process(lrec_t* pinrec, context_t* pctx, void* pvstate);
+static sllv_t*   mapper_grep_process_pass_through(lrec_t* pinrec, context_t* pctx, void* pvstate);
 
 // ----------------------------------------------------------------
 mapper_setup_t mapper_grep_setup = {
@@ -31,11 +35,12 @@ mapper_setup_t mapper_grep_setup = {
 
 // ----------------------------------------------------------------
 static mapper_t* mapper_grep_parse_cli(int* pargi, int argc, char** argv,
-	cli_reader_opts_t* _, cli_writer_opts_t* pwriter_opts)
+	cli_reader_opts_t* preader_opts, cli_writer_opts_t* pwriter_opts)
 {
 	char* regex_string = NULL;
 	int   exclude = FALSE;
 	int   ignore_case = FALSE;
+	int   match_input_lines = FALSE;
 
 	if ((argc - *pargi) < 1) {
 		mapper_grep_usage(stderr, argv[0], argv[*pargi]);
@@ -47,6 +52,7 @@ static mapper_t* mapper_grep_parse_cli(int* pargi, int argc, char** argv,
 	ap_state_t* pstate = ap_alloc();
 	ap_define_true_flag(pstate, "-v", &exclude);
 	ap_define_true_flag(pstate, "-i", &ignore_case);
+	ap_define_true_flag(pstate, "-a", &match_input_lines);
 
 	if (!ap_parse(pstate, verb, pargi, argc, argv)) {
 		mapper_grep_usage(stderr, argv[0], verb);
@@ -61,6 +67,13 @@ static mapper_t* mapper_grep_parse_cli(int* pargi, int argc, char** argv,
 	regex_string = argv[(*pargi)++];
 
 	mapper_t* pmapper = mapper_grep_alloc(pstate, regex_string, exclude, ignore_case, pwriter_opts);
+	if (match_input_lines) {
+		// The record reader does the matching; records reaching this mapper have already passed.
+		preader_opts->line_filter_regex       = regex_string;
+		preader_opts->line_filter_ignore_case = ignore_case;
+		preader_opts->line_filter_invert      = exclude;
+		pmapper->pprocess_func = mapper_grep_process_pass_through;
+	}
 	return pmapper;
 }
 static void mapper_grep_usage(FILE* o, char* argv0, char* verb) {
@@ -69,6 +82,11 @@ static void mapper_grep_usage(FILE* o, char* argv0, char* verb) {
 	fprintf(o, "Options:\n");
 	fprintf(o, "-i    Use case-insensitive search.\n");
 	fprintf(o, "-v    Invert: pass through records which do not match the regex.\n");
+	fprintf(o, "-a    Match the regex against each input line as read, and discard lines\n");
+	fprintf(o, "      which don't match before they are split into fields. This is much\n");
+	fprintf(o, "      faster than matching the DKVP-formatted record, but is supported only\n");
+	fprintf(o, "      for DKVP and NIDX input, and only for the first verb in the chain.\n");
+	fprintf(o, "      NR and FNR count only the lines which are kept.\n");
 	fprintf(o, "Note that \"%s filter\" is more powerful, but requires you to know field names.\n", argv0);
 	fprintf(o, "By contrast, \"%s %s\" allows you to regex-match the entire record. It does\n", argv0, verb);
 	fprintf(o, "this by formatting each record in memory as DKVP, using command-line-specified\n");
@@ -96,6 +114,7 @@ static mapper_t* mapper_grep_alloc(ap_state_t* pargp, char* regex_string, int ex
 	regcomp_or_die_quoted(&pstate->regex, regex_string, cflags);
 	pstate->exclude = exclude;
 	pstate->pwriter_opts = pwriter_opts;
+	pstate->psb = sb_alloc(SB_ALLOC_LENGTH);
 
 	pmapper->pvstate       = pstate;
 	pmapper->pprocess_func = mapper_grep_process;
@@ -104,7 +123,8 @@ static mapper_t* mapper_grep_alloc(ap_state_t* pargp, char* regex_string, int ex
 }
 static void mapper_grep_free(mapper_t* pmapper, context_t* _) {
 	mapper_grep_state_t* pstate = pmapper->pvstate;
-	regfree(&pstate->regex);
+	mlr_regfree(&pstate->regex);
+	sb_free(pstate->psb);
 	ap_free(pstate->pargp);
 	free(pstate);
 	free(pmapper);
@@ -117,18 +137,26 @@ static sllv_t* mapper_grep_process(lrec_t* pinrec, context_t* pctx, void* pvstat
 
 	mapper_grep_state_t* pstate = (mapper_grep_state_t*)pvstate;
 
-	char* line = lrec_sprint(pinrec,
+	// Format the record into a reused buffer rather than allocating a new string per record.
+	string_builder_t* psb = pstate->psb;
+	psb->used_length = 0;
+	lrec_sbprint(pinrec, psb,
 		pstate->pwriter_opts->ors,
 		pstate->pwriter_opts->ofs,
 		pstate->pwriter_opts->ops);
+	sb_append_char(psb, 0);
 
-	int matches = regmatch_or_die(&pstate->regex, line, 0, NULL);
-	sllv_t* poutrecs = NULL;
+	int matches = regmatch_or_die(&pstate->regex, psb->buffer, 0, NULL);
 	if (matches ^ pstate->exclude) {
-		poutrecs = sllv_single(pinrec);
+		return sllv_single(pinrec);
 	} else {
 		lrec_free(pinrec);
+		return NULL;
 	}
-	free(line);
-	return poutrecs;
+}
+
+// ----------------------------------------------------------------
+// For -a: the input lines were already filtered by the record reader.
+static sllv_t* mapper_grep_process_pass_through(lrec_t* pinrec, context_t* pctx, void* pvstate) {
+	return sllv_single(pinrec);
 }
@@ -20,7 +20,7 @@ typedef enum _criterion_t {
 typedef struct _mapper_having_fields_state_t {
 	slls_t* pfield_names;
 	hss_t*  pfield_name_set;
-	regex_t regex;
+	mlr_regex_t regex;
 } mapper_having_fields_state_t;
 
 static void      mapper_having_fields_usage(FILE* o, char* argv0, char* verb);
@@ -191,7 +191,7 @@ static void mapper_having_fields_free(mapper_t* pmapper, context_t* _) {
 		slls_free(pstate->pfield_names);
 	if (pstate->pfield_name_set != NULL)
 		hss_free(pstate->pfield_name_set);
-	regfree(&pstate->regex);
+	mlr_regfree(&pstate->regex);
 	free(pstate);
 	free(pmapper);
 }
@@ -100,6 +100,18 @@ static void mapper_head_free(mapper_t* pmapper, context_t* _) {
 	free(pmapper);
 }
 
+// ----------------------------------------------------------------
+// For chain planning in mlrcli.c: see mapper_sort_fuse_head. The group-by list is
+// still owned by the head mapper.
+int mapper_head_get_params(mapper_t* pmapper, slls_t** ppgroup_by_field_names, unsigned long long* phead_count) {
+	if (pmapper->pprocess_func != mapper_head_process_unkeyed && pmapper->pprocess_func != mapper_head_process_keyed)
+		return FALSE;
+	mapper_head_state_t* pstate = pmapper->pvstate;
+	*ppgroup_by_field_names = pstate->pgroup_by_field_names;
+	*phead_count = pstate->head_count;
+	return TRUE;
+}
+
 // ----------------------------------------------------------------
 static sllv_t* mapper_head_process_unkeyed(lrec_t* pinrec, context_t* pctx, void* pvstate) {
 	mapper_head_state_t* pstate = pvstate;
@@ -23,6 +23,8 @@ typedef struct _mapper_histogram_state_t {
 	double mul;
 	lhmsv_t* pcounts_by_field;
 	lhmsv_t* pvectors_by_field; // For auto-mode
+	int    have_lo_hi;          // For auto-mode
+	int    on_second_pass;      // For auto-mode with --two-pass
 	char*  output_prefix;
 } mapper_histogram_state_t;
 
@@ -40,6 +42,13 @@ static sllv_t*   mapper_histogram_process(lrec_t* pinrec, context_t* pctx, void*
 static void      mapper_histogram_ingest_auto(lrec_t* pinrec, mapper_histogram_state_t* pstate);
 static sllv_t*   mapper_histogram_emit_auto(mapper_histogram_state_t* pstate);
 static sllv_t*   mapper_histogram_process_auto(lrec_t* pinrec, context_t* pctx, void* pvstate);
+static void      mapper_histogram_auto_limit(mapper_histogram_state_t* pstate, double val);
+static void      mapper_histogram_auto_bin(mapper_histogram_state_t* pstate, unsigned long long* pcounts,
+	double val);
+static sllv_t*   mapper_histogram_emit_auto_counts(mapper_histogram_state_t* pstate);
+
+static int       mapper_histogram_two_pass(mapper_t* pmapper);
+static sllv_t*   mapper_histogram_process_auto_two_pass(lrec_t* pinrec, context_t* pctx, void* pvstate);
 
 // ----------------------------------------------------------------
 mapper_setup_t mapper_histogram_setup = {
@@ -47,6 +56,7 @@ mapper_setup_t mapper_histogram_setup = {
 	.pusage_func = mapper_histogram_usage,
 	.pparse_func = mapper_histogram_parse_cli,
 	.ignores_input = FALSE,
+	.ptwo_pass_func = mapper_histogram_two_pass,
 };
 
 // ----------------------------------------------------------------
@@ -58,6 +68,7 @@ static void mapper_histogram_usage(FILE* o, char* argv0, char* verb) {
 	fprintf(o, "--nbins {n}   Number of histogram bins\n");
 	fprintf(o, "--auto        Automatically computes limits, ignoring --lo and --hi.\n");
 	fprintf(o, "              Holds all values in memory before producing any output.\n");
+	fprintf(o, "              With \"%s --two-pass\", input files are instead read twice.\n", argv0);
 	fprintf(o, "-o {prefix}   Prefix for output field name. Default: no prefix.\n");
 	fprintf(o, "Just a histogram. Input values < lo or > hi are not counted.\n");
 }
@@ -131,13 +142,18 @@ static mapper_t* mapper_histogram_alloc(ap_state_t* pargp, slls_t* value_field_n
 			dvector_t* pvector = dvector_alloc(DVECTOR_INITIAL_SIZE);
 			lhmsv_put(pstate->pvectors_by_field, value_field_name, pvector, NO_FREE);
 		}
+		pstate->lo  = 0.0;
+		pstate->hi  = 1.0;
+		pstate->mul = 1.0;
 	} else {
 		pstate->pvectors_by_field = NULL;
 		pstate->lo  = lo;
 		pstate->hi  = hi;
 		pstate->mul = nbins / (hi - lo);
 	}
-	pstate->output_prefix = output_prefix;
+	pstate->have_lo_hi     = FALSE;
+	pstate->on_second_pass = FALSE;
+	pstate->output_prefix  = output_prefix;
 
 	pmapper->pvstate       = pstate;
 	pmapper->pprocess_func = do_auto ? mapper_histogram_process_auto : mapper_histogram_process;
@@ -276,49 +292,59 @@ static void mapper_histogram_ingest_auto(lrec_t* pinrec, mapper_histogram_state_
 }
 
 static sllv_t* mapper_histogram_emit_auto(mapper_histogram_state_t* pstate) {
-	int have_lo_hi = FALSE;
-	double lo = 0.0, hi = 1.0;
-	int nbins = pstate->nbins;
-
 	// Limits pass
 	for (sllse_t* pe = pstate->value_field_names->phead; pe != NULL; pe = pe->pnext) {
 		char* value_field_name = pe->value;
 		dvector_t* pvector = lhmsv_get(pstate->pvectors_by_field, value_field_name);
 		int n = pvector->size;
-		for (int i = 0; i < n; i++) {
-			double val = pvector->data[i];
-			if (have_lo_hi) {
-				if (lo > val)
-					lo = val;
-				if (hi < val)
-					hi = val;
-			} else {
-				lo = val;
-				hi = val;
-				have_lo_hi = TRUE;
-			}
-		}
+		for (int i = 0; i < n; i++)
+			mapper_histogram_auto_limit(pstate, pvector->data[i]);
 	}
 
 	// Binning pass
-	double mul = nbins / (hi - lo);
+	pstate->mul = pstate->nbins / (pstate->hi - pstate->lo);
 	for (sllse_t* pe = pstate->value_field_names->phead; pe != NULL; pe = pe->pnext) {
 		char* value_field_name = pe->value;
 		dvector_t* pvector = lhmsv_get(pstate->pvectors_by_field, value_field_name);
 		unsigned long long* pcounts = lhmsv_get(pstate->pcounts_by_field, value_field_name);
 		int n = pvector->size;
-		for (int i = 0; i < n; i++) {
-			double val = pvector->data[i];
-			if ((val >= lo) && (val < hi)) {
-				int idx = (int)((val-lo) * mul);
-				pcounts[idx]++;
-			} else if (val == hi) {
-				int idx = nbins - 1;
-				pcounts[idx]++;
-			}
-		}
+		for (int i = 0; i < n; i++)
+			mapper_histogram_auto_bin(pstate, pcounts, pvector->data[i]);
 	}
 
+	return mapper_histogram_emit_auto_counts(pstate);
+}
+
+static void mapper_histogram_auto_limit(mapper_histogram_state_t* pstate, double val) {
+	if (pstate->have_lo_hi) {
+		if (pstate->lo > val)
+			pstate->lo = val;
+		if (pstate->hi < val)
+			pstate->hi = val;
+	} else {
+		pstate->lo = val;
+		pstate->hi = val;
+		pstate->have_lo_hi = TRUE;
+	}
+}
+
+static void mapper_histogram_auto_bin(mapper_histogram_state_t* pstate, unsigned long long* pcounts,
+	double val)
+{
+	if ((val >= pstate->lo) && (val < pstate->hi)) {
+		int idx = (int)((val-pstate->lo) * pstate->mul);
+		pcounts[idx]++;
+	} else if (val == pstate->hi) {
+		int idx = pstate->nbins - 1;
+		pcounts[idx]++;
+	}
+}
+
+static sllv_t* mapper_histogram_emit_auto_counts(mapper_histogram_state_t* pstate) {
+	double lo = pstate->lo;
+	double mul = pstate->mul;
+	int nbins = pstate->nbins;
+
 	// Emission pass
 	sllv_t* poutrecs = sllv_alloc();
 	lhmss_t* pcount_field_names = lhmss_alloc();
@@ -360,3 +386,42 @@ static sllv_t* mapper_histogram_emit_auto(mapper_histogram_state_t* pstate) {
 	lhmss_free(pcount_field_names);
 	return poutrecs;
 }
+
+// ----------------------------------------------------------------
+// With --two-pass, in auto mode, the input is read twice rather than its values being
+// retained: limits on the first pass and bin counts on the second. See mapper.h.
+static int mapper_histogram_two_pass(mapper_t* pmapper) {
+	if (pmapper->pprocess_func != mapper_histogram_process_auto)
+		return FALSE;
+	pmapper->pprocess_func = mapper_histogram_process_auto_two_pass;
+	return TRUE;
+}
+
+static sllv_t* mapper_histogram_process_auto_two_pass(lrec_t* pinrec, context_t* pctx, void* pvstate) {
+	mapper_histogram_state_t* pstate = pvstate;
+	if (pinrec == NULL) {
+		if (!pstate->on_second_pass) {
+			pstate->mul = pstate->nbins / (pstate->hi - pstate->lo);
+			pstate->on_second_pass = TRUE;
+			return NULL;
+		} else {
+			return mapper_histogram_emit_auto_counts(pstate);
+		}
+	}
+
+	for (sllse_t* pe = pstate->value_field_names->phead; pe != NULL; pe = pe->pnext) {
+		char* value_field_name = pe->value;
+		char* strv = lrec_get(pinrec, value_field_name);
+		if (strv != NULL) {
+			double val = mlr_double_from_string_or_die(strv);
+			if (!pstate->on_second_pass) {
+				mapper_histogram_auto_limit(pstate, val);
+			} else {
+				unsigned long long* pcounts = lhmsv_get(pstate->pcounts_by_field, value_field_name);
+				mapper_histogram_auto_bin(pstate, pcounts, val);
+			}
+		}
+	}
+	lrec_free(pinrec);
+	return NULL;
+}
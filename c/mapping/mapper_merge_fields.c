@@ -231,7 +231,7 @@ static mapper_t* mapper_merge_fields_alloc(slls_t* paccumulator_names, merge_by_
 	pstate->pvalue_field_regexes = sllv_alloc();
 	for (sllse_t* pa = pvalue_field_names->phead; pa != NULL; pa = pa->pnext) {
 		char* value_field_name = pa->value;
-		regex_t* pvalue_field_regex = mlr_malloc_or_die(sizeof(regex_t));
+		mlr_regex_t* pvalue_field_regex = mlr_malloc_or_die(sizeof(mlr_regex_t));
 		regcomp_or_die(pvalue_field_regex, value_field_name, 0);
 		sllv_append(pstate->pvalue_field_regexes, pvalue_field_regex);
 	}
@@ -255,8 +255,8 @@ static void mapper_merge_fields_free(mapper_t* pmapper, context_t* _) {
 	slls_free(pstate->paccumulator_names);
 	slls_free(pstate->pvalue_field_names);
 	for (sllve_t* pa = pstate->pvalue_field_regexes->phead; pa != NULL; pa = pa->pnext) {
-		regex_t* pvalue_field_regex = pa->pvvalue;
-		regfree(pvalue_field_regex);
+		mlr_regex_t* pvalue_field_regex = pa->pvvalue;
+		mlr_regfree(pvalue_field_regex);
 		free(pvalue_field_regex);
 	}
 	sllv_free(pstate->pvalue_field_regexes);
@@ -283,7 +283,8 @@ static sllv_t* mapper_merge_fields_process_by_name_list(lrec_t* pinrec, context_
 
 	for (sllse_t* pb = pstate->pvalue_field_names->phead; pb != NULL; pb = pb->pnext) {
 		char* field_name = pb->value;
-		char* value_field_sval = lrec_get(pinrec, field_name);
+		lrece_t* pvalue_entry = NULL;
+		char* value_field_sval = lrec_get_ext(pinrec, field_name, &pvalue_entry);
 		if (value_field_sval == NULL) // Key not present
 			continue;
 
@@ -303,7 +304,7 @@ static sllv_t* mapper_merge_fields_process_by_name_list(lrec_t* pinrec, context_
 
 			if (pacc->pdingest_func != NULL) {
 				if (!have_dval) {
-					value_field_dval = mlr_double_from_string_or_die(value_field_sval);
+					value_field_dval = lrec_entry_double_or_die(pinrec, pvalue_entry);
 					have_dval = TRUE;
 				}
 				pacc->pdingest_func(pacc->pvstate, value_field_dval);
@@ -311,8 +312,8 @@ static sllv_t* mapper_merge_fields_process_by_name_list(lrec_t* pinrec, context_
 			if (pacc->pningest_func != NULL) {
 				if (!have_nval) {
 					value_field_nval = pstate->allow_int_float
-						? mv_scan_number_or_die(value_field_sval)
-						: mv_from_float(mlr_double_from_string_or_die(value_field_sval));
+						? lrec_entry_scan_number_or_die(pinrec, pvalue_entry)
+						: mv_from_float(lrec_entry_double_or_die(pinrec, pvalue_entry));
 					have_nval = TRUE;
 				}
 				pacc->pningest_func(pacc->pvstate, &value_field_nval);
@@ -360,10 +361,11 @@ static sllv_t* mapper_merge_fields_process_by_name_regex(lrec_t* pinrec, context
 		char* field_name = pb->key;
 		int matched = FALSE;
 		for (sllve_t* pc = pstate->pvalue_field_regexes->phead; pc != NULL && !matched; pc = pc->pnext) {
-			regex_t* pvalue_field_regex = pc->pvvalue;
+			mlr_regex_t* pvalue_field_regex = pc->pvvalue;
 			matched = regmatch_or_die(pvalue_field_regex, field_name, 0, NULL);
 			if (matched) {
-				char* value_field_sval = lrec_get(pinrec, field_name);
+				lrece_t* pvalue_entry = NULL;
+				char* value_field_sval = lrec_get_ext(pinrec, field_name, &pvalue_entry);
 				if (value_field_sval != NULL) { // Key not present
 					int have_dval = FALSE;
 					int have_nval = FALSE;
@@ -376,7 +378,7 @@ static sllv_t* mapper_merge_fields_process_by_name_regex(lrec_t* pinrec, context
 
 							if (pacc->pdingest_func != NULL) {
 								if (!have_dval) {
-									value_field_dval = mlr_double_from_string_or_die(value_field_sval);
+									value_field_dval = lrec_entry_double_or_die(pinrec, pvalue_entry);
 									have_dval = TRUE;
 								}
 								pacc->pdingest_func(pacc->pvstate, value_field_dval);
@@ -384,8 +386,8 @@ static sllv_t* mapper_merge_fields_process_by_name_regex(lrec_t* pinrec, context
 							if (pacc->pningest_func != NULL) {
 								if (!have_nval) {
 									value_field_nval = pstate->allow_int_float
-										? mv_scan_number_or_die(value_field_sval)
-										: mv_from_float(mlr_double_from_string_or_die(value_field_sval));
+										? lrec_entry_scan_number_or_die(pinrec, pvalue_entry)
+										: mv_from_float(lrec_entry_double_or_die(pinrec, pvalue_entry));
 									have_nval = TRUE;
 								}
 								pacc->pningest_func(pacc->pvstate, &value_field_nval);
@@ -450,7 +452,7 @@ static sllv_t* mapper_merge_fields_process_by_collapsing(lrec_t* pinrec, context
 		char* field_name = pa->key;
 		int matched = FALSE;
 		for (sllve_t* pb = pstate->pvalue_field_regexes->phead; pb != NULL && !matched; pb = pb->pnext) {
-			regex_t* pvalue_field_regex = pb->pvvalue;
+			mlr_regex_t* pvalue_field_regex = pb->pvvalue;
 			char* short_name = regex_sub(field_name, pvalue_field_regex, pstate->psb, "", &matched, NULL);
 			if (matched) {
 				lhmsv_t* in_acc_map_for_short_name = lhmsv_get(short_names_to_in_acc_maps, short_name);
@@ -471,7 +473,8 @@ static sllv_t* mapper_merge_fields_process_by_collapsing(lrec_t* pinrec, context
 
 				}
 
-				char* value_field_sval = lrec_get(pinrec, field_name);
+				lrece_t* pvalue_entry = NULL;
+				char* value_field_sval = lrec_get_ext(pinrec, field_name, &pvalue_entry);
 				if (value_field_sval != NULL) { // Key present
 
 					if (*value_field_sval != 0) { // Key present with non-null value
@@ -485,7 +488,7 @@ static sllv_t* mapper_merge_fields_process_by_collapsing(lrec_t* pinrec, context
 
 							if (pacc->pdingest_func != NULL) {
 								if (!have_dval) {
-									value_field_dval = mlr_double_from_string_or_die(value_field_sval);
+									value_field_dval = lrec_entry_double_or_die(pinrec, pvalue_entry);
 									have_dval = TRUE;
 								}
 								pacc->pdingest_func(pacc->pvstate, value_field_dval);
@@ -493,8 +496,8 @@ static sllv_t* mapper_merge_fields_process_by_collapsing(lrec_t* pinrec, context
 							if (pacc->pningest_func != NULL) {
 								if (!have_nval) {
 									value_field_nval = pstate->allow_int_float
-										? mv_scan_number_or_die(value_field_sval)
-										: mv_from_float(mlr_double_from_string_or_die(value_field_sval));
+										? lrec_entry_scan_number_or_die(pinrec, pvalue_entry)
+										: mv_from_float(lrec_entry_double_or_die(pinrec, pvalue_entry));
 									have_nval = TRUE;
 								}
 								pacc->pningest_func(pacc->pvstate, &value_field_nval);
@@ -43,8 +43,12 @@ static int ascending_vcmp(const void* pva, const void* pvb);
 typedef struct _sort_pair_t {
 	slls_t* pgroup_by_field_values;
 	long long count; // signed, not unsigned, for sort-cmp callback
+	int index; // first-seen order, for ties
 } sort_pair_t;
 
+static void select_first_n(sort_pair_t* sort_pairs, int input_length, int output_length,
+	int (*pcmp)(const void*, const void*));
+
 // ----------------------------------------------------------------
 mapper_setup_t mapper_most_frequent_setup = {
 	.verb          = "most-frequent",
@@ -194,16 +198,19 @@ static sllv_t* mapper_most_or_least_frequent_process(lrec_t* pinrec, context_t*
 		for (lhmslve_t* pe = pstate->pcounts_by_group->phead; pe != NULL; pe = pe->pnext) {
 			sort_pairs[i].pgroup_by_field_values = pe->key;
 			sort_pairs[i].count = *(long long *)pe->pvvalue;
+			sort_pairs[i].index = i;
 			i++;
 		}
 
-		// Sort by count
-		qsort(sort_pairs, input_length, sizeof(sort_pair_t),
+		// Sort by count, only as far as needed for the first n
+		int output_length = (input_length < pstate->max_output_length) ? input_length : pstate->max_output_length;
+		if (output_length < 0)
+			output_length = 0;
+		select_first_n(sort_pairs, input_length, output_length,
 			pstate->descending ? descending_vcmp : ascending_vcmp);
 
 		// Emit top n
 		sllv_t* poutrecs = sllv_alloc();
-		int output_length = (input_length < pstate->max_output_length) ? input_length : pstate->max_output_length;
 		for (i = 0; i < output_length; i++) {
 			lrec_t* poutrec = lrec_unbacked_alloc();
 			slls_t* pgroup_by_field_values = sort_pairs[i].pgroup_by_field_values;
@@ -225,13 +232,59 @@ static sllv_t* mapper_most_or_least_frequent_process(lrec_t* pinrec, context_t*
 	}
 }
 
+// ----------------------------------------------------------------
+// Moves the first output_length of the sort order to the front of the array, in
+// sorted order. The rest of the array is left unsorted. Rather than sorting all
+// the counts, which may be many more than are output, this keeps a max-heap of the
+// output_length pairs sorting first so far: the one sorting last of those is at
+// the top, so most of the remaining pairs are rejected with one comparison.
+
+static void sift_down(sort_pair_t* sort_pairs, int i, int size, int (*pcmp)(const void*, const void*)) {
+	while (TRUE) {
+		int last = i;
+		int left = 2*i + 1;
+		int right = left + 1;
+		if (left < size && pcmp(&sort_pairs[left], &sort_pairs[last]) > 0)
+			last = left;
+		if (right < size && pcmp(&sort_pairs[right], &sort_pairs[last]) > 0)
+			last = right;
+		if (last == i)
+			return;
+		sort_pair_t temp = sort_pairs[i];
+		sort_pairs[i] = sort_pairs[last];
+		sort_pairs[last] = temp;
+		i = last;
+	}
+}
+
+static void select_first_n(sort_pair_t* sort_pairs, int input_length, int output_length,
+	int (*pcmp)(const void*, const void*))
+{
+	if (output_length < input_length) {
+		for (int i = output_length/2 - 1; i >= 0; i--)
+			sift_down(sort_pairs, i, output_length, pcmp);
+		for (int j = output_length; j < input_length && output_length > 0; j++) {
+			if (pcmp(&sort_pairs[j], &sort_pairs[0]) < 0) {
+				sort_pairs[0] = sort_pairs[j];
+				sift_down(sort_pairs, 0, output_length, pcmp);
+			}
+		}
+	}
+	qsort(sort_pairs, output_length, sizeof(sort_pair_t), pcmp);
+}
+
+// Ties are in first-seen order.
 static int descending_vcmp(const void* pva, const void* pvb) {
 	const sort_pair_t* pa = pva;
 	const sort_pair_t* pb = pvb;
-	return pb->count - pa->count;
+	if (pa->count != pb->count)
+		return (pa->count > pb->count) ? -1 : 1;
+	return pa->index - pb->index;
 }
 static int ascending_vcmp(const void* pva, const void* pvb) {
 	const sort_pair_t* pa = pva;
 	const sort_pair_t* pb = pvb;
-	return pa->count - pb->count;
+	if (pa->count != pb->count)
+		return (pa->count < pb->count) ? -1 : 1;
+	return pa->index - pb->index;
 }
@@ -22,7 +22,7 @@ typedef struct _mapper_nest_state_t {
 
 	lhmslv_t* other_keys_to_other_values_to_buckets;
 	string_builder_t* psb;
-	regex_t regex;
+	mlr_regex_t regex;
 } mapper_nest_state_t;
 
 typedef struct _nest_bucket_t {
@@ -240,7 +240,7 @@ static void mapper_nest_free(mapper_t* pmapper, context_t* _) {
 	sb_free(pstate->psb);
 	free(pstate->nested_fs);
 	free(pstate->nested_ps);
-	regfree(&pstate->regex);
+	mlr_regfree(&pstate->regex);
 	ap_free(pstate->pargp);
 	free(pstate);
 	free(pmapper);
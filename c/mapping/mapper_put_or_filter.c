@@ -1,3 +1,5 @@
+#include <pthread.h>
+#include <setjmp.h>
 #include "lib/mlr_globals.h"
 #include "lib/mlrutil.h"
 #include "lib/string_builder.h"
@@ -13,7 +15,28 @@
 
 #define DEFAULT_OOSVAR_FLATTEN_SEPARATOR ":"
 
+// For record-local expressions with --threads: the number of records each
+// worker thread is given at a time.
+#define RECORDS_PER_WORKER 1024
+
 // ----------------------------------------------------------------
+struct _mapper_put_or_filter_state_t;
+
+typedef struct _put_or_filter_worker_t {
+	struct _mapper_put_or_filter_state_t* pstate;
+	mlr_dsl_ast_t* past;
+	mlr_dsl_cst_t* pcst;
+	local_stack_t* plocal_stack;
+	loop_stack_t*  ploop_stack;
+	lhmsmv_t*      ptyped_overlay;
+	int            batch_start;
+	int            batch_end;
+	sllv_t*        poutrecs;
+	int            had_data_error; // The records in poutrecs precede the bad one
+	mlr_data_error_catcher_t data_error_catcher;
+	pthread_t      thread;
+} put_or_filter_worker_t;
+
 typedef struct _mapper_put_or_filter_state_t {
 	char*          mlr_dsl_expression;
 
@@ -30,10 +53,26 @@ typedef struct _mapper_put_or_filter_state_t {
 
 	local_stack_t* plocal_stack;
 	loop_stack_t*  ploop_stack;
+	lhmsmv_t*      ptyped_overlay; // Cleared, not freed, after each record
 
 	int            put_output_disabled; // mlr put -q
 	int            do_final_filter;     // mlr filter
 	int            negate_final_filter; // mlr filter -x
+	int            type_inferencing;
+	int            compile_to_bytecode;
+
+	// Record-local expressions (see dsl/mlr_dsl_record_local.c) are evaluated on
+	// batches of records, split across worker threads each having their own CST.
+	// Worker 0 is the main thread, using the CST above; the others are allocated
+	// as needed. The context is kept per record for NR, FNR, FILENAME, etc.
+	int            num_workers; // 1 for record-at-a-time evaluation
+	int            num_workers_allocated;
+	put_or_filter_worker_t* pworkers;
+	lrec_t**       batch_recs;
+	context_t*     batch_ctxs;
+	int            batch_length;
+	int            batch_capacity;
+	int            had_data_error; // records after the bad one are dropped
 } mapper_put_or_filter_state_t;
 
 typedef struct _expression_info_t {
@@ -66,14 +105,24 @@ static mapper_t* mapper_put_or_filter_alloc(
 	int                do_final_filter,     // mlr filter
 	int                negate_final_filter, // mlr filter -x
 	int                type_inferencing,
+	int                compile_to_bytecode,
 	char*              oosvar_flatten_separator,
 	int                flush_every_record,
+	int                num_threads,
+	int                is_last_verb,
 	cli_writer_opts_t* pwriter_opts,
 	cli_writer_opts_t* pmain_writer_opts);
 
 static void      mapper_put_or_filter_free(mapper_t* pmapper, context_t* pctx);
 
 static sllv_t*   mapper_put_or_filter_process(lrec_t* pinrec, context_t* pctx, void* pvstate);
+static sllv_t*   mapper_put_or_filter_process_batched(lrec_t* pinrec, context_t* pctx,
+	mapper_put_or_filter_state_t* pstate);
+static void      put_or_filter_process_record(mapper_put_or_filter_state_t* pstate, mlr_dsl_cst_t* pcst,
+	local_stack_t* plocal_stack, loop_stack_t* ploop_stack, lhmsmv_t* ptyped_overlay,
+	lrec_t* pinrec, context_t* pctx, sllv_t* poutrecs);
+static sllv_t*   put_or_filter_flush_batch(mapper_put_or_filter_state_t* pstate, context_t* pctx);
+static void*     put_or_filter_worker_run(void* pvworker);
 
 // ----------------------------------------------------------------
 mapper_setup_t mapper_put_setup = {
@@ -219,6 +268,9 @@ static void shared_usage(FILE* o, char* argv0, char* verb) {
 	fprintf(o, "-a: Prints a low-level stack-allocation trace to stdout.\n");
 	fprintf(o, "-t: Prints a low-level parser trace to stderr.\n");
 	fprintf(o, "-T: Prints a every statement to stderr as it is executed.\n");
+	fprintf(o, "--no-bytecode: Evaluates operator expressions by walking the syntax tree, rather\n");
+	fprintf(o, "    than compiling them to bytecode. This is slower, and is intended for checking\n");
+	fprintf(o, "    the bytecode compiler.\n");
 	fprintf(o, "\n");
 
 	fprintf(o, "Other options:\n");
@@ -229,6 +281,12 @@ static void shared_usage(FILE* o, char* argv0, char* verb) {
 	if (streq(verb, "filter")) {
 		fprintf(o, "-x: Prints records for which {expression} evaluates to false.\n");
 	}
+	fprintf(o, "--threads {n}: Number of threads to use for expressions which read and write\n");
+	fprintf(o, "    only the current record: no begin/end blocks, @-variables, emit/tee/print/dump,\n");
+	fprintf(o, "    or urand. Records are then evaluated in batches of up to %d per thread, and\n",
+		RECORDS_PER_WORKER);
+	fprintf(o, "    output in input order, so output is held back until each batch is done.\n");
+	fprintf(o, "    This is done only when %s is the last verb in the then-chain. Default 1.\n", verb);
 	fprintf(o, "\n");
 
 	fprintf(o, "Please use a dollar sign for field names and double-quotes for string\n");
@@ -263,12 +321,14 @@ static mapper_t* shared_parse_cli(int* pargi, int argc, char** argv,
 	int     do_final_filter          = FALSE;
 	int     negate_final_filter      = FALSE;
 	int     type_inferencing         = TYPE_INFER_STRING_FLOAT_INT;
+	int     compile_to_bytecode      = TRUE;
 	int     print_ast                = FALSE;
 	int     trace_stack_allocation   = FALSE;
 	int     trace_parse              = FALSE;
 	int     trace_execution          = FALSE;
 	char*   oosvar_flatten_separator = DEFAULT_OOSVAR_FLATTEN_SEPARATOR;
 	int     flush_every_record       = TRUE;
+	int     num_threads              = 1;
 
 	cli_writer_opts_t* pwriter_opts = mlr_malloc_or_die(sizeof(cli_writer_opts_t));
 	cli_writer_opts_init(pwriter_opts);
@@ -340,6 +400,9 @@ static mapper_t* shared_parse_cli(int* pargi, int argc, char** argv,
 		} else if (streq(argv[argi], "-F")) {
 			type_inferencing = TYPE_INFER_STRING_FLOAT;
 			argi += 1;
+		} else if (streq(argv[argi], "--no-bytecode")) {
+			compile_to_bytecode = FALSE;
+			argi += 1;
 		} else if (streq(argv[argi], "--oflatsep")) {
 			if ((argc - argi) < 2) {
 				mapper_put_or_filter_usage(stderr, argv[0], verb);
@@ -350,6 +413,17 @@ static mapper_t* shared_parse_cli(int* pargi, int argc, char** argv,
 		} else if (streq(argv[argi], "--no-fflush") || streq(argv[argi], "--no-flush")) {
 			flush_every_record = FALSE;
 			argi += 1;
+		} else if (streq(argv[argi], "--threads")) {
+			if ((argc - argi) < 2) {
+				mapper_put_or_filter_usage(stderr, argv[0], verb);
+				return NULL;
+			}
+			if (sscanf(argv[argi+1], "%d", &num_threads) != 1 || num_threads <= 0) {
+				fprintf(stderr, "%s %s: --threads argument must be a positive integer; got \"%s\".\n",
+					MLR_GLOBALS.bargv0, verb, argv[argi+1]);
+				return NULL;
+			}
+			argi += 2;
 
 		} else {
 			mapper_put_or_filter_usage(stderr, argv[0], verb);
@@ -410,10 +484,13 @@ static mapper_t* shared_parse_cli(int* pargi, int argc, char** argv,
 		mlr_dsl_ast_print(past);
 	}
 
+	// Records can be output out of step with the context only if no later verb looks at it.
+	int is_last_verb = argi >= argc || !streq(argv[argi], "then");
+
 	*pargi = argi;
 	return mapper_put_or_filter_alloc(mlr_dsl_expression, print_ast, trace_stack_allocation, trace_execution,
-		past, put_output_disabled, do_final_filter, negate_final_filter, type_inferencing, oosvar_flatten_separator,
-			flush_every_record, pwriter_opts, pmain_writer_opts);
+		past, put_output_disabled, do_final_filter, negate_final_filter, type_inferencing, compile_to_bytecode,
+			oosvar_flatten_separator, flush_every_record, num_threads, is_last_verb, pwriter_opts, pmain_writer_opts);
 }
 
 // ----------------------------------------------------------------
@@ -427,25 +504,46 @@ static mapper_t* mapper_put_or_filter_alloc(
 	int                do_final_filter,     // mlr filter
 	int                negate_final_filter, // mlr filter -x
 	int                type_inferencing,
+	int                compile_to_bytecode,
 	char*              oosvar_flatten_separator,
 	int                flush_every_record,
+	int                num_threads,
+	int                is_last_verb,
 	cli_writer_opts_t* pwriter_opts,
 	cli_writer_opts_t* pmain_writer_opts)
 {
 	mapper_put_or_filter_state_t* pstate = mlr_malloc_or_die(sizeof(mapper_put_or_filter_state_t));
+
+	// This must be done before the CST builder reorganizes the AST.
+	pstate->num_workers = 1;
+	if (is_last_verb && !trace_execution && mlr_dsl_ast_is_record_local(past))
+		pstate->num_workers = num_threads;
+	pstate->num_workers_allocated = 0;
+	pstate->pworkers              = NULL;
+	pstate->batch_recs            = NULL;
+	pstate->batch_ctxs            = NULL;
+	pstate->batch_length          = 0;
+	pstate->batch_capacity        = 0;
+	pstate->had_data_error        = FALSE;
+
 	// Retain the string contents along with any in-pointers from the AST/CST
 	pstate->mlr_dsl_expression = mlr_dsl_expression;
 	pstate->past                     = past;
 	pstate->pcst                     = mlr_dsl_cst_alloc(past, print_ast, trace_stack_allocation,
-		type_inferencing, flush_every_record, do_final_filter, negate_final_filter);
+		type_inferencing, compile_to_bytecode, flush_every_record, do_final_filter, negate_final_filter);
 	pstate->at_begin                     = TRUE;
 	pstate->put_output_disabled          = put_output_disabled;
+	pstate->do_final_filter              = do_final_filter;
+	pstate->negate_final_filter          = negate_final_filter;
+	pstate->type_inferencing             = type_inferencing;
+	pstate->compile_to_bytecode          = compile_to_bytecode;
 	pstate->poosvars                     = mlhmmv_root_alloc();
 	pstate->trace_execution              = trace_execution;
 	pstate->oosvar_flatten_separator     = oosvar_flatten_separator;
 	pstate->flush_every_record           = flush_every_record;
 	pstate->plocal_stack                 = local_stack_alloc();
 	pstate->ploop_stack                  = loop_stack_alloc();
+	pstate->ptyped_overlay               = lhmsmv_alloc();
 	pstate->pwriter_opts                 = pwriter_opts;
 
 	cli_merge_writer_opts(pstate->pwriter_opts, pmain_writer_opts);
@@ -461,10 +559,24 @@ static mapper_t* mapper_put_or_filter_alloc(
 static void mapper_put_or_filter_free(mapper_t* pmapper, context_t* pctx) {
 	mapper_put_or_filter_state_t* pstate = pmapper->pvstate;
 
+	// Worker 0 shares the main CST, freed below.
+	for (int i = 1; i < pstate->num_workers_allocated; i++) {
+		put_or_filter_worker_t* pworker = &pstate->pworkers[i];
+		local_stack_free(pworker->plocal_stack);
+		loop_stack_free(pworker->ploop_stack);
+		lhmsmv_free(pworker->ptyped_overlay);
+		mlr_dsl_cst_free(pworker->pcst, pctx);
+		mlr_dsl_ast_free(pworker->past);
+	}
+	free(pstate->pworkers);
+	free(pstate->batch_recs);
+	free(pstate->batch_ctxs);
+
 	free(pstate->mlr_dsl_expression);
 	mlhmmv_root_free(pstate->poosvars);
 	local_stack_free(pstate->plocal_stack);
 	loop_stack_free(pstate->ploop_stack);
+	lhmsmv_free(pstate->ptyped_overlay);
 	mlr_dsl_cst_free(pstate->pcst, pctx);
 	// Free what's left of the stripped AST after the CST reorganized it.
 	mlr_dsl_ast_free(pstate->past);
@@ -527,6 +639,9 @@ static void mapper_put_or_filter_free(mapper_t* pmapper, context_t* pctx) {
 static sllv_t* mapper_put_or_filter_process(lrec_t* pinrec, context_t* pctx, void* pvstate) {
 	mapper_put_or_filter_state_t* pstate = (mapper_put_or_filter_state_t*)pvstate;
 
+	if (pstate->num_workers > 1)
+		return mapper_put_or_filter_process_batched(pinrec, pctx, pstate);
+
 	sllv_t* poutrecs = sllv_alloc();
 	int should_emit_rec = TRUE;
 
@@ -594,10 +709,20 @@ static sllv_t* mapper_put_or_filter_process(lrec_t* pinrec, context_t* pctx, voi
 		return poutrecs;
 	}
 
-	lhmsmv_t* ptyped_overlay = lhmsmv_alloc();
-	string_array_t* pregex_captures = NULL; // May be set to non-null on evaluation
+	put_or_filter_process_record(pstate, pstate->pcst, pstate->plocal_stack, pstate->ploop_stack,
+		pstate->ptyped_overlay, pinrec, pctx, poutrecs);
+	return poutrecs;
+}
 
-	should_emit_rec = TRUE;
+// ----------------------------------------------------------------
+// Evaluates the main block on one record, appending the record to the output list unless it's filtered out.
+
+static void put_or_filter_process_record(mapper_put_or_filter_state_t* pstate, mlr_dsl_cst_t* pcst,
+	local_stack_t* plocal_stack, loop_stack_t* ploop_stack, lhmsmv_t* ptyped_overlay,
+	lrec_t* pinrec, context_t* pctx, sllv_t* poutrecs)
+{
+	int should_emit_rec = TRUE;
+	string_array_t* pregex_captures = NULL; // May be set to non-null on evaluation
 
 	variables_t variables = (variables_t) {
 		.pinrec           = pinrec, // Note variables.pinrec pointer can update on '$* = ...'
@@ -605,8 +730,8 @@ static sllv_t* mapper_put_or_filter_process(lrec_t* pinrec, context_t* pctx, voi
 		.poosvars         = pstate->poosvars,
 		.ppregex_captures = &pregex_captures,
 		.pctx             = pctx,
-		.plocal_stack     = pstate->plocal_stack,
-		.ploop_stack      = pstate->ploop_stack,
+		.plocal_stack     = plocal_stack,
+		.ploop_stack      = ploop_stack,
 		.return_state = {
 			.returned = FALSE,
 			.retval = box_ephemeral_val(mv_absent()),
@@ -622,7 +747,7 @@ static sllv_t* mapper_put_or_filter_process(lrec_t* pinrec, context_t* pctx, voi
 		.pwriter_opts                 = pstate->pwriter_opts,
 	};
 
-	mlr_dsl_cst_handle_top_level_statement_block(pstate->pcst->pmain_block, &variables, &cst_outputs);
+	mlr_dsl_cst_handle_top_level_statement_block(pcst->pmain_block, &variables, &cst_outputs);
 
 	if (should_emit_rec && !pstate->put_output_disabled) {
 		// Write the output fields from the typed overlay back to the lrec.
@@ -633,6 +758,13 @@ static sllv_t* mapper_put_or_filter_process(lrec_t* pinrec, context_t* pctx, voi
 			// Ownership transfer from mv_t to lrec.
 			if (pval->type == MT_STRING) {
 				lrec_put(variables.pinrec, output_field_name, pval->u.strv, pval->free_flags);
+			} else if (pval->type == MT_INT) {
+				// Keep the int alongside its string form, for downstream verbs. Floats aren't kept
+				// since their string forms, per --ofmt, needn't scan back to the same value.
+				char free_flags = NO_FREE;
+				char* string = mv_format_val(pval, &free_flags);
+				lrec_put_int(variables.pinrec, output_field_name, string, pval->free_flags | free_flags,
+					pval->u.intv);
 			} else {
 				char free_flags = NO_FREE;
 				char* string = mv_format_val(pval, &free_flags);
@@ -641,7 +773,8 @@ static sllv_t* mapper_put_or_filter_process(lrec_t* pinrec, context_t* pctx, voi
 			pval->free_flags = NO_FREE;
 		}
 	}
-	lhmsmv_free(variables.ptyped_overlay);
+	// Values transferred to the lrec above have had their free-flags cleared.
+	lhmsmv_clear(ptyped_overlay);
 	string_array_free(pregex_captures);
 
 	// Note variables.pinrec pointer can update on '$* = ...'
@@ -650,5 +783,155 @@ static sllv_t* mapper_put_or_filter_process(lrec_t* pinrec, context_t* pctx, voi
 	} else {
 		lrec_free(variables.pinrec);
 	}
+}
+
+// ----------------------------------------------------------------
+// For record-local expressions: records and their contexts are held until
+// there are enough to share out among the workers, or until end of stream.
+
+static sllv_t* mapper_put_or_filter_process_batched(lrec_t* pinrec, context_t* pctx,
+	mapper_put_or_filter_state_t* pstate)
+{
+	if (pinrec == NULL && pstate->batch_recs == NULL) { // Empty input stream
+		pstate->num_workers = 1;
+		return mapper_put_or_filter_process(pinrec, pctx, pstate);
+	}
+
+	// The stream exits once the current records are written, but the upstream
+	// mappers may still hand over what they had already produced.
+	if (pstate->had_data_error) {
+		if (pinrec != NULL)
+			lrec_free(pinrec);
+		return NULL;
+	}
+
+	if (pinrec == NULL) { // End of input stream
+		sllv_t* poutrecs = put_or_filter_flush_batch(pstate, pctx);
+		if (!pctx->exit_after_output)
+			sllv_append(poutrecs, NULL);
+		return poutrecs;
+	}
+
+	if (pstate->batch_recs == NULL) {
+		pstate->batch_capacity = pstate->num_workers * RECORDS_PER_WORKER;
+		pstate->batch_recs = mlr_malloc_or_die(pstate->batch_capacity * sizeof(lrec_t*));
+		pstate->batch_ctxs = mlr_malloc_or_die(pstate->batch_capacity * sizeof(context_t));
+		pstate->pworkers   = mlr_malloc_or_die(pstate->num_workers * sizeof(put_or_filter_worker_t));
+		pstate->pworkers[0] = (put_or_filter_worker_t) {
+			.pstate         = pstate,
+			.past           = NULL,
+			.pcst           = pstate->pcst,
+			.plocal_stack   = pstate->plocal_stack,
+			.ploop_stack    = pstate->ploop_stack,
+			.ptyped_overlay = pstate->ptyped_overlay,
+		};
+		pstate->num_workers_allocated = 1;
+	}
+
+	pstate->batch_recs[pstate->batch_length] = pinrec;
+	pstate->batch_ctxs[pstate->batch_length] = *pctx;
+	pstate->batch_length++;
+	if (pstate->batch_length < pstate->batch_capacity)
+		return NULL;
+	return put_or_filter_flush_batch(pstate, pctx);
+}
+
+// Each worker is given a contiguous slice of the batch, so that concatenating
+// their outputs in worker order gives the records back in input order. Only as
+// many workers are used as there are slices of RECORDS_PER_WORKER records.
+//
+// After a data error, e.g. a failed type assertion, the records before the bad
+// one are output as they would have been without threads, and then the stream
+// exits. Only the error for the first bad record is printed, as it would have
+// been without threads: others may be found in later slices meanwhile.
+static sllv_t* put_or_filter_flush_batch(mapper_put_or_filter_state_t* pstate, context_t* pctx) {
+	int num_workers = (pstate->batch_length + RECORDS_PER_WORKER - 1) / RECORDS_PER_WORKER;
+	if (num_workers > pstate->num_workers)
+		num_workers = pstate->num_workers;
+	if (num_workers < 1)
+		num_workers = 1;
+
+	// Each worker has a CST of its own, from a parse of its own, since the CST
+	// holds per-evaluation state such as regex caches and local-variable frames.
+	for ( ; pstate->num_workers_allocated < num_workers; pstate->num_workers_allocated++) {
+		put_or_filter_worker_t* pworker = &pstate->pworkers[pstate->num_workers_allocated];
+		pworker->pstate         = pstate;
+		pworker->past           = mlr_dsl_parse(pstate->mlr_dsl_expression, FALSE);
+		MLR_INTERNAL_CODING_ERROR_IF(pworker->past == NULL);
+		pworker->pcst           = mlr_dsl_cst_alloc(pworker->past, FALSE, FALSE, pstate->type_inferencing,
+			pstate->compile_to_bytecode, pstate->flush_every_record, pstate->do_final_filter,
+			pstate->negate_final_filter);
+		pworker->plocal_stack   = local_stack_alloc();
+		pworker->ploop_stack    = loop_stack_alloc();
+		pworker->ptyped_overlay = lhmsmv_alloc();
+	}
+
+	int slice_length = (pstate->batch_length + num_workers - 1) / num_workers;
+	for (int i = 0; i < num_workers; i++) {
+		put_or_filter_worker_t* pworker = &pstate->pworkers[i];
+		pworker->batch_start = i * slice_length;
+		pworker->batch_end   = pworker->batch_start + slice_length;
+		if (pworker->batch_end > pstate->batch_length)
+			pworker->batch_end = pstate->batch_length;
+		pworker->poutrecs = sllv_alloc();
+	}
+
+	for (int i = 1; i < num_workers; i++) {
+		put_or_filter_worker_t* pworker = &pstate->pworkers[i];
+		if (pthread_create(&pworker->thread, NULL, put_or_filter_worker_run, pworker) != 0) {
+			fprintf(stderr, "%s: could not create worker thread.\n", MLR_GLOBALS.bargv0);
+			exit(1);
+		}
+	}
+	put_or_filter_worker_run(&pstate->pworkers[0]);
+
+	sllv_t* poutrecs = pstate->pworkers[0].poutrecs;
+	char* data_error_message = pstate->pworkers[0].data_error_catcher.message;
+	int had_data_error = pstate->pworkers[0].had_data_error;
+	for (int i = 1; i < num_workers; i++) {
+		put_or_filter_worker_t* pworker = &pstate->pworkers[i];
+		pthread_join(pworker->thread, NULL);
+		if (had_data_error) {
+			for (sllve_t* pe = pworker->poutrecs->phead; pe != NULL; pe = pe->pnext)
+				lrec_free(pe->pvvalue);
+			free(pworker->data_error_catcher.message);
+		} else {
+			sllv_transfer(poutrecs, pworker->poutrecs);
+			had_data_error = pworker->had_data_error;
+			data_error_message = pworker->data_error_catcher.message;
+		}
+		sllv_free(pworker->poutrecs);
+	}
+	if (data_error_message != NULL) {
+		fputs(data_error_message, stderr);
+		free(data_error_message);
+	}
+
+	pstate->batch_length = 0;
+	if (had_data_error) {
+		pstate->had_data_error = TRUE;
+		pctx->exit_after_output = TRUE;
+	}
 	return poutrecs;
 }
+
+// A data error ends the worker's slice, with the error message kept for the caller to print,
+// rather than exiting the process from this thread.
+static void* put_or_filter_worker_run(void* pvworker) {
+	put_or_filter_worker_t* pworker = pvworker;
+	mapper_put_or_filter_state_t* pstate = pworker->pstate;
+	pworker->had_data_error = FALSE;
+	pworker->data_error_catcher.message = NULL;
+	if (setjmp(pworker->data_error_catcher.env) != 0) {
+		mlr_set_data_error_catcher(NULL);
+		pworker->had_data_error = TRUE;
+		return NULL;
+	}
+	mlr_set_data_error_catcher(&pworker->data_error_catcher);
+	for (int i = pworker->batch_start; i < pworker->batch_end; i++) {
+		put_or_filter_process_record(pstate, pworker->pcst, pworker->plocal_stack, pworker->ploop_stack,
+			pworker->ptyped_overlay, pstate->batch_recs[i], &pstate->batch_ctxs[i], pworker->poutrecs);
+	}
+	mlr_set_data_error_catcher(NULL);
+	return NULL;
+}
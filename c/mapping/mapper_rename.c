@@ -9,7 +9,7 @@
 #define RENAME_SB_ALLOC_LENGTH 16
 
 typedef struct _regex_pair_t {
-	regex_t regex;
+	mlr_regex_t regex;
 	char*   replacement;
 } regex_pair_t;
 
@@ -145,7 +145,7 @@ static void mapper_rename_free(mapper_t* pmapper, context_t* _) {
 	if (pstate->pregex_pairs != NULL) {
 		for (sllve_t* pe = pstate->pregex_pairs->phead; pe != NULL; pe = pe->pnext) {
 			regex_pair_t* ppair = pe->pvvalue;
-			regfree(&ppair->regex);
+			mlr_regfree(&ppair->regex);
 			// replacement is in pthe old_to_new list, already freed
 			free(ppair);
 		}
@@ -181,7 +181,7 @@ static sllv_t* mapper_rename_regex_process(lrec_t* pinrec, context_t* pctx, void
 
 		for (sllve_t* pe = pstate->pregex_pairs->phead; pe != NULL; pe = pe->pnext) {
 			regex_pair_t* ppair = pe->pvvalue;
-			regex_t* pregex = &ppair->regex;
+			mlr_regex_t* pregex = &ppair->regex;
 			char* replacement = ppair->replacement;
 			for (lrece_t* pf = pinrec->phead; pf != NULL; pf = pf->pnext) {
 				int matched = FALSE;
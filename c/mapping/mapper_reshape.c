@@ -229,7 +229,7 @@ static mapper_t* mapper_reshape_alloc(
 	} else {
 		pstate->input_field_regexes = sllv_alloc();
 		for (sllse_t* pe = input_field_regex_strings->phead; pe != NULL; pe = pe->pnext) {
-			regex_t* pregex = mlr_malloc_or_die(sizeof(regex_t));
+			mlr_regex_t* pregex = mlr_malloc_or_die(sizeof(mlr_regex_t));
 			regcomp_or_die(pregex, pe->value, 0);
 			sllv_append(pstate->input_field_regexes, pregex);
 		}
@@ -266,8 +266,8 @@ static void mapper_reshape_free(mapper_t* pmapper, context_t* _) {
 
 	if (pstate->input_field_regexes != NULL) {
 		for (sllve_t* pe = pstate->input_field_regexes->phead; pe != NULL; pe = pe->pnext) {
-			regex_t* pregex = pe->pvvalue;
-			regfree(pregex);
+			mlr_regex_t* pregex = pe->pvvalue;
+			mlr_regfree(pregex);
 			free(pregex);
 		}
 		sllv_free(pstate->input_field_regexes);
@@ -341,7 +341,7 @@ static sllv_t* mapper_reshape_wide_to_long_regex_process(lrec_t* pinrec, context
 
 	for (lrece_t* pe = pinrec->phead; pe != NULL; pe = pe->pnext) {
 		for (sllve_t* pf = pstate->input_field_regexes->phead; pf != NULL; pf = pf->pnext) {
-			regex_t* pregex = pf->pvvalue;
+			mlr_regex_t* pregex = pf->pvvalue;
 			if (regmatch_or_die(pregex, pe->key, 0, NULL)) {
 				// Ownership-transfer of the about-to-be-freed key-value pairs from lrec to lhmss
 				lhmss_put(pairs, pe->key, pe->value, pe->free_flags);
@@ -88,7 +88,12 @@ static mapper_t* mapper_sort_alloc(slls_t* pkey_field_names, int* sort_params, i
 static void      mapper_sort_free(mapper_t* pmapper, context_t* _);
 static sllv_t*   mapper_sort_process(lrec_t* pinrec, context_t* pctx, void* pvstate);
 
-static typed_sort_key_t* parse_sort_keys(slls_t* pkey_field_values, int* sort_params, context_t* pctx);
+static typed_sort_key_t* parse_sort_keys(slls_t* pkey_field_values, slls_t* pkey_field_names, int* sort_params,
+	lrec_t* pinrec, context_t* pctx);
+static void parse_sort_keys_into(typed_sort_key_t* typed_sort_keys, slls_t* pkey_field_values,
+	slls_t* pkey_field_names, int* sort_params, lrec_t* pinrec, context_t* pctx);
+static int typed_sort_keys_compare(typed_sort_key_t* akeys, typed_sort_key_t* bkeys, int* sort_params,
+	int num_sort_keys);
 
 // qsort is non-reentrant but qsort_r isn't portable. But since Miller is
 // single-threaded, even if we've got one sort chained to another, only one is
@@ -127,6 +132,8 @@ static void mapper_sort_usage(FILE* o, char* argv0, char* verb) {
 	fprintf(o, "at the end of the output, in the order they were encountered, regardless of the\n");
 	fprintf(o, "specified sort order.) The sort is stable: records that compare equal will sort\n");
 	fprintf(o, "in the order they were encountered in the input record stream.\n");
+	fprintf(o, "When immediately followed by head, e.g. \"%s %s -nr x then head -n 4 -g a\",\n", argv0, verb);
+	fprintf(o, "only the records head will pass are kept in memory.\n");
 	fprintf(o, "\n");
 	fprintf(o, "Example:\n");
 	fprintf(o, "  %s %s -f a,b -nr x,y,z\n", argv0, verb);
@@ -267,7 +274,8 @@ static sllv_t* mapper_sort_process(lrec_t* pinrec, context_t* pctx, void* pvstat
 			if (pbucket == NULL) { // New key-field-value: new bucket and hash-map entry
 				slls_t* pkey_field_values_copy = slls_copy(pkey_field_values);
 				sort_bucket_t* pbucket = mlr_malloc_or_die(sizeof(sort_bucket_t));
-				pbucket->typed_sort_keys = parse_sort_keys(pkey_field_values_copy, pstate->sort_params, pctx);
+				pbucket->typed_sort_keys = parse_sort_keys(pkey_field_values_copy, pstate->pkey_field_names,
+					pstate->sort_params, pinrec, pctx);
 				pbucket->precords = sllv_alloc();
 				sllv_append(pbucket->precords, pinrec);
 				lhmslv_put(pstate->pbuckets_by_key_field_values, pkey_field_values_copy, pbucket,
@@ -326,10 +334,15 @@ static int pbucket_comparator(const void* pva, const void* pvb) {
 	// We are sorting an array of sort_bucket_t*.
 	const sort_bucket_t** pba = (const sort_bucket_t**)pva;
 	const sort_bucket_t** pbb = (const sort_bucket_t**)pvb;
-	typed_sort_key_t* akeys = (*pba)->typed_sort_keys;
-	typed_sort_key_t* bkeys = (*pbb)->typed_sort_keys;
-	for (int i = 0; i < cmp_params_length; i++) {
-		int sort_param = pcmp_sort_params[i];
+	return typed_sort_keys_compare((*pba)->typed_sort_keys, (*pbb)->typed_sort_keys,
+		pcmp_sort_params, cmp_params_length);
+}
+
+static int typed_sort_keys_compare(typed_sort_key_t* akeys, typed_sort_key_t* bkeys, int* sort_params,
+	int num_sort_keys)
+{
+	for (int i = 0; i < num_sort_keys; i++) {
+		int sort_param = sort_params[i];
 		if (sort_param & SORT_NUMERIC) {
 			double a = akeys[i].u.d;
 			double b = bkeys[i].u.d;
@@ -355,14 +368,26 @@ static int pbucket_comparator(const void* pva, const void* pvb) {
 }
 
 // E.g. parse the list ["red","1.0"] into the array ["red",1.0].
-static typed_sort_key_t* parse_sort_keys(slls_t* pkey_field_values, int* sort_params, context_t* pctx) {
+static typed_sort_key_t* parse_sort_keys(slls_t* pkey_field_values, slls_t* pkey_field_names, int* sort_params,
+	lrec_t* pinrec, context_t* pctx)
+{
 	typed_sort_key_t* typed_sort_keys = mlr_malloc_or_die(pkey_field_values->length * sizeof(typed_sort_key_t));
+	parse_sort_keys_into(typed_sort_keys, pkey_field_values, pkey_field_names, sort_params, pinrec, pctx);
+	return typed_sort_keys;
+}
+
+static void parse_sort_keys_into(typed_sort_key_t* typed_sort_keys, slls_t* pkey_field_values,
+	slls_t* pkey_field_names, int* sort_params, lrec_t* pinrec, context_t* pctx)
+{
 	int i = 0;
-	for (sllse_t* pe = pkey_field_values->phead; pe != NULL; pe = pe->pnext, i++) {
+	sllse_t* pn = pkey_field_names->phead;
+	for (sllse_t* pe = pkey_field_values->phead; pe != NULL; pe = pe->pnext, pn = pn->pnext, i++) {
 		if (sort_params[i] & SORT_NUMERIC) {
+			lrece_t* pentry = NULL;
+			(void)lrec_get_ext(pinrec, pn->value, &pentry);
 			if (*pe->value == 0) { // null input value
 				typed_sort_keys[i].u.d = nan("");
-			} else if (!mlr_try_float_from_string(pe->value, &typed_sort_keys[i].u.d)) {
+			} else if (!lrec_entry_try_float(pinrec, pentry, &typed_sort_keys[i].u.d)) {
 				fprintf(stderr, "%s: couldn't parse \"%s\" as number in file \"%s\" record %lld.\n",
 					MLR_GLOBALS.bargv0, pe->value, pctx->filename, pctx->fnr);
 				exit(1);
@@ -371,5 +396,416 @@ static typed_sort_key_t* parse_sort_keys(slls_t* pkey_field_values, int* sort_pa
 			typed_sort_keys[i].u.s = pe->value;
 		}
 	}
-	return typed_sort_keys;
+}
+
+// ================================================================
+// SORT-THEN-HEAD
+//
+// A chain such as "mlr sort -nr x then head -n 4 -g a" need not retain all
+// its input: the records head passes are the first few of each head group in
+// sorted order, so for each head group we keep only the head-count
+// earliest-sorting records seen so far, in a max-heap with the latest-sorting
+// of them at the root. Each new record is either discarded, if it sorts after
+// the root of a full heap, or replaces the root. At end of stream the retained
+// records of all groups are sorted together.
+//
+// The ordering must be the one the sort verb produces: records having sort
+// keys by their typed key values, then by when their bucket was first seen
+// (string keys such as "1" and "1.0" being distinct buckets which compare
+// equally), then by arrival; followed by records lacking sort keys, by
+// arrival. For numeric sort keys we therefore remember when each sort-key
+// value was first seen -- the strings only, not the records. For lexical-only
+// sorts equal keys are identical strings, so arrival order suffices.
+//
+// Without head -g there is one heap, and once it's full its root only moves
+// earlier. Sort-key values sorting after the root can never be retained again,
+// so they aren't remembered, and those already remembered are pruned whenever
+// the number remembered has doubled. Memory is then bounded by the head count
+// (times the number of spellings of equal keys, such as "1" and "1.0") rather
+// than by the number of distinct key values. With head -g, a group first seen
+// later may retain any key value, so all distinct key values are remembered.
+//
+// This is set up by the chain parser in mlrcli.c via mapper_sort_fuse_head.
+// ================================================================
+
+// Sort-key values remembered before the first pruning
+#define MIN_BUCKET_PRUNE_SIZE 1024
+
+typedef struct _sort_head_entry_t {
+	lrec_t*            prec;
+	int                has_sort_keys;
+	typed_sort_key_t*  typed_sort_keys;
+	unsigned long long bucket_seqno;
+	unsigned long long seqno;
+} sort_head_entry_t;
+
+// First-seen sequence number of a sort-key value, with its typed keys for pruning.
+typedef struct _sort_head_bucket_t {
+	unsigned long long seqno;
+	typed_sort_key_t*  typed_sort_keys; // Lexical keys point into the hashmap key
+} sort_head_bucket_t;
+
+typedef struct _sort_head_group_t {
+	sort_head_entry_t** pentries; // Max-heap: latest-sorting entry at the root
+	unsigned long long  num_entries;
+	unsigned long long  capacity;
+} sort_head_group_t;
+
+typedef struct _mapper_sort_head_state_t {
+	slls_t*            pkey_field_names;
+	int*               sort_params;
+	int                num_sort_keys;
+	int                track_bucket_seqnos;
+	slls_t*            pgroup_by_field_names;
+	unsigned long long head_count;
+	unsigned long long seqno;
+	lhmslv_t*          pbuckets_by_key_field_values;
+	int                next_bucket_prune_size;
+	lhmslv_t*          pgroups_by_group_by_field_values;
+	sort_head_group_t* punkeyed_group;
+	typed_sort_key_t*  scratch_sort_keys;
+} mapper_sort_head_state_t;
+
+static void     mapper_sort_head_free(mapper_t* pmapper, context_t* _);
+static sllv_t*  mapper_sort_head_process(lrec_t* pinrec, context_t* pctx, void* pvstate);
+static sort_head_group_t* sort_head_group_alloc();
+static void     sort_head_group_free(sort_head_group_t* pgroup);
+static void     sort_head_group_add(sort_head_group_t* pgroup, sort_head_entry_t* pcandidate,
+	mapper_sort_head_state_t* pstate);
+static int      sort_head_entry_compare(sort_head_entry_t* pa, sort_head_entry_t* pb, int* sort_params,
+	int num_sort_keys);
+static unsigned long long sort_head_get_bucket_seqno(mapper_sort_head_state_t* pstate,
+	slls_t* pkey_field_values, sort_head_entry_t* pcandidate);
+static int      sort_head_key_is_past_root(mapper_sort_head_state_t* pstate, typed_sort_key_t* typed_sort_keys);
+static void     sort_head_prune_buckets(mapper_sort_head_state_t* pstate);
+static void     sort_head_bucket_free(sort_head_bucket_t* pbucket);
+static int      psort_head_entry_comparator(const void* pva, const void* pvb);
+
+// ----------------------------------------------------------------
+mapper_t* mapper_sort_fuse_head(mapper_t* psort_mapper, mapper_t* phead_mapper) {
+	if (psort_mapper->pprocess_func != mapper_sort_process)
+		return NULL;
+	mapper_sort_state_t* psort_state = psort_mapper->pvstate;
+	if (!psort_state->do_sort)
+		return NULL;
+	slls_t* pgroup_by_field_names = NULL;
+	unsigned long long head_count = 0LL;
+	if (!mapper_head_get_params(phead_mapper, &pgroup_by_field_names, &head_count))
+		return NULL;
+
+	mapper_t* pmapper = mlr_malloc_or_die(sizeof(mapper_t));
+	mapper_sort_head_state_t* pstate = mlr_malloc_or_die(sizeof(mapper_sort_head_state_t));
+
+	pstate->pkey_field_names      = psort_state->pkey_field_names;
+	pstate->sort_params           = psort_state->sort_params;
+	pstate->num_sort_keys         = pstate->pkey_field_names->length;
+	pstate->track_bucket_seqnos   = FALSE;
+	for (int i = 0; i < pstate->num_sort_keys; i++)
+		if (pstate->sort_params[i] & SORT_NUMERIC)
+			pstate->track_bucket_seqnos = TRUE;
+	pstate->pgroup_by_field_names = slls_copy(pgroup_by_field_names);
+	pstate->head_count            = head_count;
+	pstate->seqno                 = 0LL;
+	pstate->pbuckets_by_key_field_values = lhmslv_alloc();
+	pstate->next_bucket_prune_size = MIN_BUCKET_PRUNE_SIZE;
+	pstate->pgroups_by_group_by_field_values   = lhmslv_alloc();
+	pstate->punkeyed_group        = sort_head_group_alloc();
+	pstate->scratch_sort_keys     = mlr_malloc_or_die(pstate->num_sort_keys * sizeof(typed_sort_key_t));
+
+	psort_state->pkey_field_names = NULL;
+	psort_state->sort_params      = NULL;
+	psort_mapper->pfree_func(psort_mapper, NULL);
+	phead_mapper->pfree_func(phead_mapper, NULL);
+
+	pmapper->pvstate       = pstate;
+	pmapper->pprocess_func = mapper_sort_head_process;
+	pmapper->pfree_func    = mapper_sort_head_free;
+
+	return pmapper;
+}
+
+static void mapper_sort_head_free(mapper_t* pmapper, context_t* _) {
+	mapper_sort_head_state_t* pstate = pmapper->pvstate;
+	slls_free(pstate->pkey_field_names);
+	free(pstate->sort_params);
+	slls_free(pstate->pgroup_by_field_names);
+	// lhmslv_free will free the hashmap keys; we need to free the void-star hashmap values.
+	for (lhmslve_t* pe = pstate->pbuckets_by_key_field_values->phead; pe != NULL; pe = pe->pnext)
+		sort_head_bucket_free(pe->pvvalue);
+	lhmslv_free(pstate->pbuckets_by_key_field_values);
+	for (lhmslve_t* pe = pstate->pgroups_by_group_by_field_values->phead; pe != NULL; pe = pe->pnext)
+		sort_head_group_free(pe->pvvalue);
+	lhmslv_free(pstate->pgroups_by_group_by_field_values);
+	sort_head_group_free(pstate->punkeyed_group);
+	free(pstate->scratch_sort_keys);
+	free(pstate);
+	free(pmapper);
+}
+
+// ----------------------------------------------------------------
+static sllv_t* mapper_sort_head_process(lrec_t* pinrec, context_t* pctx, void* pvstate) {
+	mapper_sort_head_state_t* pstate = pvstate;
+	if (pinrec != NULL) {
+		sort_head_entry_t candidate = {
+			.prec            = pinrec,
+			.has_sort_keys   = FALSE,
+			.typed_sort_keys = pstate->scratch_sort_keys,
+			.bucket_seqno    = 0LL,
+			.seqno           = ++pstate->seqno,
+		};
+
+		// Sort keys are parsed even for records head will drop, so that parse errors are
+		// reported as the sort verb would report them.
+		slls_t* pkey_field_values = mlr_reference_selected_values_from_record(pinrec, pstate->pkey_field_names);
+		if (pkey_field_values != NULL) {
+			parse_sort_keys_into(candidate.typed_sort_keys, pkey_field_values, pstate->pkey_field_names,
+				pstate->sort_params, pinrec, pctx);
+			candidate.has_sort_keys = TRUE;
+			if (pstate->track_bucket_seqnos)
+				candidate.bucket_seqno = sort_head_get_bucket_seqno(pstate, pkey_field_values, &candidate);
+			slls_free(pkey_field_values);
+		}
+
+		sort_head_group_t* pgroup = pstate->punkeyed_group;
+		if (pstate->pgroup_by_field_names->length > 0) {
+			slls_t* pgroup_by_field_values = mlr_reference_selected_values_from_record(pinrec,
+				pstate->pgroup_by_field_names);
+			if (pgroup_by_field_values == NULL) {
+				lrec_free(pinrec);
+				return NULL;
+			}
+			pgroup = lhmslv_get(pstate->pgroups_by_group_by_field_values, pgroup_by_field_values);
+			if (pgroup == NULL) {
+				pgroup = sort_head_group_alloc();
+				lhmslv_put(pstate->pgroups_by_group_by_field_values, slls_copy(pgroup_by_field_values),
+					pgroup, FREE_ENTRY_KEY);
+			}
+			slls_free(pgroup_by_field_values);
+		}
+
+		sort_head_group_add(pgroup, &candidate, pstate);
+		return NULL;
+
+	} else {
+		// End of input stream: sort the retained records of all groups together
+		unsigned long long num_entries = pstate->punkeyed_group->num_entries;
+		for (lhmslve_t* pe = pstate->pgroups_by_group_by_field_values->phead; pe != NULL; pe = pe->pnext)
+			num_entries += ((sort_head_group_t*)pe->pvvalue)->num_entries;
+
+		sort_head_entry_t** pentry_array = mlr_malloc_or_die((num_entries + 1) * sizeof(sort_head_entry_t*));
+		unsigned long long n = 0LL;
+		for (unsigned long long i = 0; i < pstate->punkeyed_group->num_entries; i++)
+			pentry_array[n++] = pstate->punkeyed_group->pentries[i];
+		for (lhmslve_t* pe = pstate->pgroups_by_group_by_field_values->phead; pe != NULL; pe = pe->pnext) {
+			sort_head_group_t* pgroup = pe->pvvalue;
+			for (unsigned long long i = 0; i < pgroup->num_entries; i++)
+				pentry_array[n++] = pgroup->pentries[i];
+		}
+
+		pcmp_sort_params  = pstate->sort_params;
+		cmp_params_length = pstate->num_sort_keys;
+
+		qsort(pentry_array, num_entries, sizeof(sort_head_entry_t*), psort_head_entry_comparator);
+
+		pcmp_sort_params  = NULL;
+		cmp_params_length = 0;
+
+		sllv_t* poutput = sllv_alloc();
+		for (n = 0; n < num_entries; n++) {
+			sllv_append(poutput, pentry_array[n]->prec);
+			pentry_array[n]->prec = NULL;
+		}
+		free(pentry_array);
+		sllv_append(poutput, NULL); // Signal end of output-record stream.
+		return poutput;
+	}
+}
+
+// ----------------------------------------------------------------
+static sort_head_group_t* sort_head_group_alloc() {
+	sort_head_group_t* pgroup = mlr_malloc_or_die(sizeof(sort_head_group_t));
+	pgroup->pentries    = NULL;
+	pgroup->num_entries = 0LL;
+	pgroup->capacity    = 0LL;
+	return pgroup;
+}
+
+static void sort_head_group_free(sort_head_group_t* pgroup) {
+	for (unsigned long long i = 0; i < pgroup->num_entries; i++) {
+		sort_head_entry_t* pentry = pgroup->pentries[i];
+		if (pentry->prec != NULL)
+			lrec_free(pentry->prec);
+		free(pentry->typed_sort_keys);
+		free(pentry);
+	}
+	free(pgroup->pentries);
+	free(pgroup);
+}
+
+static void sort_head_entry_set(sort_head_entry_t* pentry, sort_head_entry_t* pcandidate, int num_sort_keys) {
+	pentry->prec          = pcandidate->prec;
+	pentry->has_sort_keys = pcandidate->has_sort_keys;
+	if (pcandidate->has_sort_keys)
+		memcpy(pentry->typed_sort_keys, pcandidate->typed_sort_keys, num_sort_keys * sizeof(typed_sort_key_t));
+	pentry->bucket_seqno  = pcandidate->bucket_seqno;
+	pentry->seqno         = pcandidate->seqno;
+}
+
+// ----------------------------------------------------------------
+// Returns when the candidate's sort-key value was first seen, remembering it if it's new. Records
+// whose keys sort after the root of the full heap will be discarded, so for them it doesn't matter.
+static unsigned long long sort_head_get_bucket_seqno(mapper_sort_head_state_t* pstate,
+	slls_t* pkey_field_values, sort_head_entry_t* pcandidate)
+{
+	if (sort_head_key_is_past_root(pstate, pcandidate->typed_sort_keys))
+		return pcandidate->seqno;
+
+	sort_head_bucket_t* pbucket = lhmslv_get(pstate->pbuckets_by_key_field_values, pkey_field_values);
+	if (pbucket != NULL)
+		return pbucket->seqno;
+
+	int num_sort_keys = pstate->num_sort_keys;
+	slls_t* pkey_copy = slls_copy(pkey_field_values);
+	pbucket = mlr_malloc_or_die(sizeof(sort_head_bucket_t));
+	pbucket->seqno = pcandidate->seqno;
+	pbucket->typed_sort_keys = mlr_malloc_or_die(num_sort_keys * sizeof(typed_sort_key_t));
+	memcpy(pbucket->typed_sort_keys, pcandidate->typed_sort_keys, num_sort_keys * sizeof(typed_sort_key_t));
+	int i = 0;
+	for (sllse_t* pe = pkey_copy->phead; pe != NULL; pe = pe->pnext, i++)
+		if (!(pstate->sort_params[i] & SORT_NUMERIC))
+			pbucket->typed_sort_keys[i].u.s = pe->value;
+	lhmslv_put(pstate->pbuckets_by_key_field_values, pkey_copy, pbucket, FREE_ENTRY_KEY);
+
+	if (lhmslv_size(pstate->pbuckets_by_key_field_values) >= pstate->next_bucket_prune_size)
+		sort_head_prune_buckets(pstate);
+	return pbucket->seqno;
+}
+
+// True if no record with these sort keys can be retained from now on: without head -g, once the
+// heap is full, ones sorting after its root by key value alone.
+static int sort_head_key_is_past_root(mapper_sort_head_state_t* pstate, typed_sort_key_t* typed_sort_keys) {
+	sort_head_group_t* pgroup = pstate->punkeyed_group;
+	if (pstate->pgroup_by_field_names->length > 0 || pgroup->num_entries == 0
+		|| pgroup->num_entries < pstate->head_count)
+	{
+		return FALSE;
+	}
+	sort_head_entry_t* proot = pgroup->pentries[0];
+	if (!proot->has_sort_keys)
+		return FALSE;
+	return typed_sort_keys_compare(typed_sort_keys, proot->typed_sort_keys, pstate->sort_params,
+		pstate->num_sort_keys) > 0;
+}
+
+// Forgets the sort-key values which can no longer be retained. The hashmap has no removal, so the
+// survivors are moved to a new one.
+static void sort_head_prune_buckets(mapper_sort_head_state_t* pstate) {
+	lhmslv_t* pold = pstate->pbuckets_by_key_field_values;
+	lhmslv_t* pnew = lhmslv_alloc();
+	for (lhmslve_t* pe = pold->phead; pe != NULL; pe = pe->pnext) {
+		sort_head_bucket_t* pbucket = pe->pvvalue;
+		if (sort_head_key_is_past_root(pstate, pbucket->typed_sort_keys)) {
+			sort_head_bucket_free(pbucket);
+		} else {
+			lhmslv_put(pnew, pe->key, pbucket, FREE_ENTRY_KEY);
+			pe->free_flags = 0;
+		}
+	}
+	lhmslv_free(pold);
+	pstate->pbuckets_by_key_field_values = pnew;
+	pstate->next_bucket_prune_size = 2 * lhmslv_size(pnew);
+	if (pstate->next_bucket_prune_size < MIN_BUCKET_PRUNE_SIZE)
+		pstate->next_bucket_prune_size = MIN_BUCKET_PRUNE_SIZE;
+}
+
+static void sort_head_bucket_free(sort_head_bucket_t* pbucket) {
+	free(pbucket->typed_sort_keys);
+	free(pbucket);
+}
+
+// ----------------------------------------------------------------
+// Keeps the head-count earliest-sorting records of the group, freeing the others.
+static void sort_head_group_add(sort_head_group_t* pgroup, sort_head_entry_t* pcandidate,
+	mapper_sort_head_state_t* pstate)
+{
+	sort_head_entry_t** pentries = pgroup->pentries;
+	int* sort_params = pstate->sort_params;
+	int  num_sort_keys = pstate->num_sort_keys;
+	unsigned long long i;
+
+	if (pgroup->num_entries < pstate->head_count) {
+		if (pgroup->num_entries >= pgroup->capacity) {
+			pgroup->capacity = (pgroup->capacity == 0LL) ? 16LL : 2 * pgroup->capacity;
+			if (pgroup->capacity > pstate->head_count)
+				pgroup->capacity = pstate->head_count;
+			pentries = pgroup->pentries = mlr_realloc_or_die(pgroup->pentries,
+				pgroup->capacity * sizeof(sort_head_entry_t*));
+		}
+		sort_head_entry_t* pentry = mlr_malloc_or_die(sizeof(sort_head_entry_t));
+		pentry->typed_sort_keys = mlr_malloc_or_die(num_sort_keys * sizeof(typed_sort_key_t));
+		sort_head_entry_set(pentry, pcandidate, num_sort_keys);
+
+		// Sift up
+		i = pgroup->num_entries++;
+		while (i > 0) {
+			unsigned long long parent = (i - 1) / 2;
+			if (sort_head_entry_compare(pentries[parent], pentry, sort_params, num_sort_keys) >= 0)
+				break;
+			pentries[i] = pentries[parent];
+			i = parent;
+		}
+		pentries[i] = pentry;
+		return;
+	}
+
+	if (pgroup->num_entries == 0LL
+		|| sort_head_entry_compare(pcandidate, pentries[0], sort_params, num_sort_keys) >= 0)
+	{
+		lrec_free(pcandidate->prec);
+		return;
+	}
+
+	// Replace the root and sift down
+	sort_head_entry_t* pentry = pentries[0];
+	lrec_free(pentry->prec);
+	sort_head_entry_set(pentry, pcandidate, num_sort_keys);
+	unsigned long long n = pgroup->num_entries;
+	i = 0;
+	while (TRUE) {
+		unsigned long long child = 2 * i + 1;
+		if (child >= n)
+			break;
+		if (child + 1 < n
+			&& sort_head_entry_compare(pentries[child+1], pentries[child], sort_params, num_sort_keys) > 0)
+		{
+			child++;
+		}
+		if (sort_head_entry_compare(pentries[child], pentry, sort_params, num_sort_keys) <= 0)
+			break;
+		pentries[i] = pentries[child];
+		i = child;
+	}
+	pentries[i] = pentry;
+}
+
+// Total order, as described above: no two entries compare equal.
+static int sort_head_entry_compare(sort_head_entry_t* pa, sort_head_entry_t* pb, int* sort_params,
+	int num_sort_keys)
+{
+	if (pa->has_sort_keys != pb->has_sort_keys)
+		return pa->has_sort_keys ? -1 : 1;
+	if (pa->has_sort_keys) {
+		int s = typed_sort_keys_compare(pa->typed_sort_keys, pb->typed_sort_keys, sort_params, num_sort_keys);
+		if (s != 0)
+			return s;
+		if (pa->bucket_seqno != pb->bucket_seqno)
+			return (pa->bucket_seqno < pb->bucket_seqno) ? -1 : 1;
+	}
+	return (pa->seqno < pb->seqno) ? -1 : (pa->seqno > pb->seqno) ? 1 : 0;
+}
+
+static int psort_head_entry_comparator(const void* pva, const void* pvb) {
+	sort_head_entry_t* pa = *(sort_head_entry_t**)pva;
+	sort_head_entry_t* pb = *(sort_head_entry_t**)pvb;
+	return sort_head_entry_compare(pa, pb, pcmp_sort_params, cmp_params_length);
 }
@@ -0,0 +1,300 @@
+#include "cli/mlrcli.h"
+#include "containers/sllv.h"
+#include "containers/hss.h"
+#include "containers/lhmslv.h"
+#include "containers/mixutil.h"
+#include "lib/mlr_globals.h"
+#include "lib/mlrutil.h"
+#include "mapping/mappers.h"
+#include "output/lrec_writers.h"
+#include "output/output_stream_pool.h"
+
+// ----------------------------------------------------------------
+// One per output file: each has its own writer, since e.g. each CSV file gets its own header.
+// Streams come from the output-stream pool, so the number of files open at a time is bounded
+// by the main --max-open-files option.
+typedef struct _split_output_t {
+	lrec_writer_t* plrec_writer;
+	pooled_output_stream_t* pstream;
+} split_output_t;
+
+typedef struct _mapper_split_state_t {
+	slls_t*             pgroup_by_field_names;
+	long long           chunk_size;
+	char*               prefix;
+	char*               suffix;
+	file_output_mode_t  file_output_mode;
+	cli_writer_opts_t*  pwriter_opts;
+
+	lhmslv_t*           poutputs_by_group; // for -g
+	hss_t*              pgroup_filenames;  // for -g: keys are owned by the output streams
+
+	long long           chunk_number;      // for -n
+	long long           chunk_count;
+	split_output_t*     pchunk_output;
+} mapper_split_state_t;
+
+static void      mapper_split_usage(FILE* o, char* argv0, char* verb);
+static mapper_t* mapper_split_parse_cli(int* pargi, int argc, char** argv,
+	cli_reader_opts_t* _, cli_writer_opts_t* __);
+static mapper_t* mapper_split_alloc(slls_t* pgroup_by_field_names, long long chunk_size, char* prefix, char* suffix,
+	int do_append, cli_writer_opts_t* pwriter_opts, cli_writer_opts_t* pmain_writer_opts);
+static void      mapper_split_free(mapper_t* pmapper, context_t* pctx);
+static sllv_t*   mapper_split_process_grouped(lrec_t* pinrec, context_t* pctx, void* pvstate);
+static sllv_t*   mapper_split_process_chunked(lrec_t* pinrec, context_t* pctx, void* pvstate);
+
+static split_output_t* split_output_alloc(mapper_split_state_t* pstate, char* name);
+static void split_output_end(split_output_t* poutput, context_t* pctx);
+static void split_output_free(split_output_t* poutput, context_t* pctx);
+
+// ----------------------------------------------------------------
+mapper_setup_t mapper_split_setup = {
+	.verb = "split",
+	.pusage_func = mapper_split_usage,
+	.pparse_func = mapper_split_parse_cli,
+	.ignores_input = FALSE,
+};
+
+// ----------------------------------------------------------------
+static void mapper_split_usage(FILE* o, char* argv0, char* verb) {
+	fprintf(o, "Usage: %s %s [options]\n", argv0, verb);
+	fprintf(o, "Writes records to files, one per group or one per so many records, using\n");
+	fprintf(o, "output-format flags from the command line (e.g. --ocsv). Records are not passed\n");
+	fprintf(o, "on to the rest of the chain: see %s tee, or the \"tee\" keyword within %s put.\n",
+		MLR_GLOBALS.bargv0, MLR_GLOBALS.bargv0);
+	fprintf(o, "Exactly one of -g and -n is required.\n");
+	fprintf(o, "Options:\n");
+	fprintf(o, "-g {a,b,c}     One file per distinct combination of values of these fields,\n");
+	fprintf(o, "               named {prefix}_{a value}_{b value}_{c value}.{suffix}. Records\n");
+	fprintf(o, "               lacking any of these fields are discarded. It's an error for a\n");
+	fprintf(o, "               value to contain \"/\", or for two groups to get the same file\n");
+	fprintf(o, "               name (e.g. a=x_y,b=z and a=x,b=y_z).\n");
+	fprintf(o, "-n {n}         The first n records to {prefix}_1.{suffix}, the next n to\n");
+	fprintf(o, "               {prefix}_2.{suffix}, etc.\n");
+	fprintf(o, "--prefix {p}   File-name prefix, which may include a directory. Default \"split\".\n");
+	fprintf(o, "--suffix {s}   File-name suffix. Default the output format, e.g. \"csv\".\n");
+	fprintf(o, "-a             Append to existing files, if any, rather than overwriting.\n");
+	fprintf(o, "Any of the output-format command-line flags (see %s -h).\n", MLR_GLOBALS.bargv0);
+	fprintf(o, "The number of files open at a time is bounded by the main --max-open-files\n");
+	fprintf(o, "option; see also --output-buffer-size.\n");
+	fprintf(o, "Examples:\n");
+	fprintf(o, "  %s --csv %s -g tenant --prefix out/daily input.csv\n", argv0, verb);
+	fprintf(o, "writes out/daily_acme.csv, out/daily_initech.csv, etc.\n");
+	fprintf(o, "  %s --icsv --ojson %s -n 1000 input.csv\n", argv0, verb);
+	fprintf(o, "writes split_1.json, split_2.json, etc., each with up to 1000 records.\n");
+}
+
+// ----------------------------------------------------------------
+static mapper_t* mapper_split_parse_cli(int* pargi, int argc, char** argv,
+	cli_reader_opts_t* _, cli_writer_opts_t* pmain_writer_opts)
+{
+	slls_t*   pgroup_by_field_names = NULL;
+	long long chunk_size = 0LL;
+	char*     prefix = "split";
+	char*     suffix = NULL;
+	int       do_append = FALSE;
+	cli_writer_opts_t* pwriter_opts = mlr_malloc_or_die(sizeof(cli_writer_opts_t));
+	cli_writer_opts_init(pwriter_opts);
+
+	int argi = *pargi;
+	char* verb = argv[argi++];
+
+	for (; argi < argc; /* variable increment: 1 or 2 depending on flag */) {
+
+		if (argv[argi][0] != '-') {
+			break; // No more flag options to process
+
+		} else if (cli_handle_writer_options(argv, argc, &argi, pwriter_opts)) {
+			// handled
+
+		} else if (streq(argv[argi], "-g") && (argc - argi) >= 2) {
+			if (pgroup_by_field_names != NULL)
+				slls_free(pgroup_by_field_names);
+			pgroup_by_field_names = slls_from_line(argv[argi+1], ',', FALSE);
+			argi += 2;
+
+		} else if (streq(argv[argi], "-n") && (argc - argi) >= 2) {
+			if (sscanf(argv[argi+1], "%lld", &chunk_size) != 1 || chunk_size <= 0LL) {
+				fprintf(stderr, "%s %s: -n argument must be a positive integer; got \"%s\".\n",
+					MLR_GLOBALS.bargv0, verb, argv[argi+1]);
+				return NULL;
+			}
+			argi += 2;
+
+		} else if (streq(argv[argi], "--prefix") && (argc - argi) >= 2) {
+			prefix = argv[argi+1];
+			argi += 2;
+
+		} else if (streq(argv[argi], "--suffix") && (argc - argi) >= 2) {
+			suffix = argv[argi+1];
+			argi += 2;
+
+		} else if (streq(argv[argi], "-a")) {
+			do_append = TRUE;
+			argi++;
+
+		} else {
+			mapper_split_usage(stderr, argv[0], verb);
+			return NULL;
+		}
+	}
+
+	if ((pgroup_by_field_names == NULL) == (chunk_size == 0LL)) {
+		mapper_split_usage(stderr, argv[0], verb);
+		return NULL;
+	}
+
+	*pargi = argi;
+	return mapper_split_alloc(pgroup_by_field_names, chunk_size, prefix, suffix, do_append,
+		pwriter_opts, pmain_writer_opts);
+}
+
+// ----------------------------------------------------------------
+static mapper_t* mapper_split_alloc(slls_t* pgroup_by_field_names, long long chunk_size, char* prefix, char* suffix,
+	int do_append, cli_writer_opts_t* pwriter_opts, cli_writer_opts_t* pmain_writer_opts)
+{
+	mapper_t* pmapper = mlr_malloc_or_die(sizeof(mapper_t));
+	mapper_split_state_t* pstate = mlr_malloc_or_die(sizeof(mapper_split_state_t));
+
+	cli_merge_writer_opts(pwriter_opts, pmain_writer_opts);
+	if (suffix == NULL)
+		suffix = streq(pwriter_opts->ofile_fmt, "csvlite") ? "csv" : pwriter_opts->ofile_fmt;
+
+	pstate->pgroup_by_field_names = pgroup_by_field_names;
+	pstate->chunk_size            = chunk_size;
+	pstate->prefix                = prefix;
+	pstate->suffix                = suffix;
+	pstate->file_output_mode      = do_append ? MODE_APPEND : MODE_WRITE;
+	pstate->pwriter_opts          = pwriter_opts;
+	pstate->poutputs_by_group     = lhmslv_alloc();
+	pstate->pgroup_filenames      = hss_alloc();
+	pstate->chunk_number          = 0LL;
+	pstate->chunk_count           = 0LL;
+	pstate->pchunk_output         = NULL;
+
+	pmapper->pvstate       = pstate;
+	pmapper->pprocess_func = (pgroup_by_field_names != NULL)
+		? mapper_split_process_grouped
+		: mapper_split_process_chunked;
+	pmapper->pfree_func    = mapper_split_free;
+	return pmapper;
+}
+
+static void mapper_split_free(mapper_t* pmapper, context_t* pctx) {
+	mapper_split_state_t* pstate = pmapper->pvstate;
+	// lhmslv_free will free the hashmap keys; we need to free the void-star hashmap values.
+	for (lhmslve_t* pe = pstate->poutputs_by_group->phead; pe != NULL; pe = pe->pnext)
+		split_output_free(pe->pvvalue, pctx);
+	lhmslv_free(pstate->poutputs_by_group);
+	hss_free(pstate->pgroup_filenames);
+	if (pstate->pchunk_output != NULL)
+		split_output_free(pstate->pchunk_output, pctx);
+	if (pstate->pgroup_by_field_names != NULL)
+		slls_free(pstate->pgroup_by_field_names);
+	free(pstate->pwriter_opts);
+	free(pstate);
+	free(pmapper);
+}
+
+// ----------------------------------------------------------------
+// The group-by values are hashed once per record, to find the group's writer; the file name is
+// made only when a group is first seen. Records are handed straight to the writer, which frees
+// them.
+static sllv_t* mapper_split_process_grouped(lrec_t* pinrec, context_t* pctx, void* pvstate) {
+	mapper_split_state_t* pstate = pvstate;
+
+	if (pinrec != NULL) {
+		slls_t* pgroup_by_field_values = mlr_reference_selected_values_from_record(pinrec,
+			pstate->pgroup_by_field_names);
+		if (pgroup_by_field_values == NULL) {
+			lrec_free(pinrec);
+			return NULL;
+		}
+
+		split_output_t* poutput = lhmslv_get(pstate->poutputs_by_group, pgroup_by_field_values);
+		if (poutput == NULL) {
+			char* name = slls_join(pgroup_by_field_values, "_");
+			// Group-by values come from the data, so they mustn't be able to name a file outside
+			// the prefix's directory, or to overwrite another group's file.
+			if (strchr(name, '/') != NULL) {
+				fprintf(stderr, "%s split: group-by value in \"%s\" contains \"/\".\n",
+					MLR_GLOBALS.bargv0, name);
+				exit(1);
+			}
+			poutput = split_output_alloc(pstate, name);
+			if (hss_has(pstate->pgroup_filenames, poutput->pstream->filename_or_command)) {
+				fprintf(stderr, "%s split: more than one group would be written to \"%s\".\n",
+					MLR_GLOBALS.bargv0, poutput->pstream->filename_or_command);
+				exit(1);
+			}
+			hss_add(pstate->pgroup_filenames, poutput->pstream->filename_or_command);
+			free(name);
+			lhmslv_put(pstate->poutputs_by_group, slls_copy(pgroup_by_field_values), poutput, FREE_ENTRY_KEY);
+		}
+		slls_free(pgroup_by_field_values);
+
+		FILE* output_stream = pooled_output_stream_get(poutput->pstream);
+		poutput->plrec_writer->pprocess_func(poutput->plrec_writer->pvstate, output_stream, pinrec, pctx);
+		return NULL;
+
+	} else {
+		for (lhmslve_t* pe = pstate->poutputs_by_group->phead; pe != NULL; pe = pe->pnext)
+			split_output_end(pe->pvvalue, pctx);
+		return sllv_single(NULL);
+	}
+}
+
+// ----------------------------------------------------------------
+static sllv_t* mapper_split_process_chunked(lrec_t* pinrec, context_t* pctx, void* pvstate) {
+	mapper_split_state_t* pstate = pvstate;
+
+	if (pinrec != NULL) {
+		if (pstate->pchunk_output != NULL && pstate->chunk_count >= pstate->chunk_size) {
+			split_output_end(pstate->pchunk_output, pctx);
+			split_output_free(pstate->pchunk_output, pctx);
+			pstate->pchunk_output = NULL;
+		}
+		if (pstate->pchunk_output == NULL) {
+			pstate->chunk_number++;
+			pstate->chunk_count = 0LL;
+			char name[32];
+			snprintf(name, sizeof(name), "%lld", pstate->chunk_number);
+			pstate->pchunk_output = split_output_alloc(pstate, name);
+		}
+		pstate->chunk_count++;
+
+		split_output_t* poutput = pstate->pchunk_output;
+		FILE* output_stream = pooled_output_stream_get(poutput->pstream);
+		poutput->plrec_writer->pprocess_func(poutput->plrec_writer->pvstate, output_stream, pinrec, pctx);
+		return NULL;
+
+	} else {
+		if (pstate->pchunk_output != NULL)
+			split_output_end(pstate->pchunk_output, pctx);
+		return sllv_single(NULL);
+	}
+}
+
+// ----------------------------------------------------------------
+static split_output_t* split_output_alloc(mapper_split_state_t* pstate, char* name) {
+	split_output_t* poutput = mlr_malloc_or_die(sizeof(split_output_t));
+	poutput->plrec_writer = lrec_writer_alloc_or_die(pstate->pwriter_opts);
+	char* filename = mlr_paste_5_strings(pstate->prefix, "_", name, ".", pstate->suffix);
+	poutput->pstream = pooled_output_stream_alloc(filename, pstate->file_output_mode);
+	free(filename);
+	return poutput;
+}
+
+// Lets the writer finish up (e.g. PPRINT, which holds records until end of stream) and closes
+// the file. It's reopened for that if it was closed to make room for others.
+static void split_output_end(split_output_t* poutput, context_t* pctx) {
+	FILE* output_stream = pooled_output_stream_get(poutput->pstream);
+	poutput->plrec_writer->pprocess_func(poutput->plrec_writer->pvstate, output_stream, NULL, pctx);
+	pooled_output_stream_close(poutput->pstream);
+}
+
+static void split_output_free(split_output_t* poutput, context_t* pctx) {
+	poutput->plrec_writer->pfree_func(poutput->plrec_writer, pctx);
+	pooled_output_stream_free(poutput->pstream);
+	free(poutput);
+}
@@ -36,11 +36,11 @@ typedef struct _mapper_stats1_state_t {
 	value_ingestor_func_t*    pvalue_ingestor;
 	emitter_func_t*           pemitter;
 
-	regex_t*         value_field_regexes;
+	mlr_regex_t*     value_field_regexes;
 	int              num_value_field_regexes;
 	int              invert_regex_value_field_names;
 
-	regex_t*         group_by_field_regexes;
+	mlr_regex_t*     group_by_field_regexes;
 	int              num_group_by_field_regexes;
 	int              invert_regex_group_by_field_names;
 
@@ -232,7 +232,7 @@ static mapper_t* mapper_stats1_alloc(ap_state_t* pargp, slls_t* paccumulator_nam
 		pstate->pvalue_field_names      = NULL;
 		pstate->pvalue_field_values     = NULL;
 		pstate->num_value_field_regexes = pvalue_field_names->length;
-		pstate->value_field_regexes     = mlr_malloc_or_die(sizeof(regex_t) * pstate->num_value_field_regexes);
+		pstate->value_field_regexes     = mlr_malloc_or_die(sizeof(mlr_regex_t) * pstate->num_value_field_regexes);
 		for (int i = 0; i < pvalue_field_names->length; i++) {
 			// Let them type in a.*b if they want, or "a.*b", or "a.*b"i.
 			// Strip off the leading " and trailing " or "i.
@@ -253,7 +253,7 @@ static mapper_t* mapper_stats1_alloc(ap_state_t* pargp, slls_t* paccumulator_nam
 	if (do_regex_group_by_field_names) {
 		pstate->pgroup_by_field_names   = NULL;
 		pstate->num_group_by_field_regexes = pgroup_by_field_names->length;
-		pstate->group_by_field_regexes     = mlr_malloc_or_die(sizeof(regex_t) * pstate->num_group_by_field_regexes);
+		pstate->group_by_field_regexes     = mlr_malloc_or_die(sizeof(mlr_regex_t) * pstate->num_group_by_field_regexes);
 		int i = 0;
 		for (sllse_t* pe = pgroup_by_field_names->phead; pe != NULL; pe = pe->pnext, i++) {
 			// Let them type in a.*b if they want, or "a.*b", or "a.*b"i.
@@ -297,13 +297,13 @@ static void mapper_stats1_free(mapper_t* pmapper, context_t* _) {
 
 	if (pstate->value_field_regexes != NULL) {
 		for (int i = 0; i < pstate->num_value_field_regexes; i++)
-			regfree(&pstate->value_field_regexes[i]);
+			mlr_regfree(&pstate->value_field_regexes[i]);
 		free(pstate->value_field_regexes);
 	}
 
 	if (pstate->group_by_field_regexes != NULL) {
 		for (int i = 0; i < pstate->num_group_by_field_regexes; i++)
-			regfree(&pstate->group_by_field_regexes[i]);
+			mlr_regfree(&pstate->group_by_field_regexes[i]);
 		free(pstate->group_by_field_regexes);
 	}
 
@@ -562,6 +562,9 @@ static void mapper_stats1_ingest_name_value(lrec_t* pinrec, mapper_stats1_state_
 	if (*value_field_sval == 0) // Key present with null value
 		return;
 
+	lrece_t* pvalue_entry = NULL;
+	(void)lrec_get_ext(pinrec, value_field_name, &pvalue_entry);
+
 	int have_dval = FALSE;
 	int have_nval = FALSE;
 	double value_field_dval = -999.0;
@@ -582,7 +585,7 @@ static void mapper_stats1_ingest_name_value(lrec_t* pinrec, mapper_stats1_state_
 
 		if (pstats1_acc->pdingest_func != NULL) {
 			if (!have_dval) {
-				value_field_dval = mlr_double_from_string_or_die(value_field_sval);
+				value_field_dval = lrec_entry_double_or_die(pinrec, pvalue_entry);
 				have_dval = TRUE;
 			}
 			pstats1_acc->pdingest_func(pstats1_acc->pvstate, value_field_dval);
@@ -590,8 +593,8 @@ static void mapper_stats1_ingest_name_value(lrec_t* pinrec, mapper_stats1_state_
 		if (pstats1_acc->pningest_func != NULL) {
 			if (!have_nval) {
 				value_field_nval = pstate->allow_int_float
-					? mv_scan_number_or_die(value_field_sval)
-					: mv_from_float(mlr_double_from_string_or_die(value_field_sval));
+					? lrec_entry_scan_number_or_die(pinrec, pvalue_entry)
+					: mv_from_float(lrec_entry_double_or_die(pinrec, pvalue_entry));
 				have_nval = TRUE;
 			}
 			pstats1_acc->pningest_func(pstats1_acc->pvstate, &value_field_nval);
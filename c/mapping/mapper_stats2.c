@@ -49,6 +49,8 @@ typedef struct _mapper_stats2_state_t {
 	int       do_verbose;
 	int       do_iterative_stats;
 	int       do_hold_and_fit;
+	int       do_two_pass;    // For --two-pass
+	int       on_second_pass;
 } mapper_stats2_state_t;
 
 typedef stats2_acc_t* stats2_alloc_func_t(char* value_field_name_1, char* value_field_name_2, char* stats2_acc_name, int do_verbose);
@@ -67,6 +69,9 @@ static sllv_t*   mapper_stats2_emit_all(mapper_stats2_state_t* pstate);
 static void      mapper_stats2_emit(mapper_stats2_state_t* pstate, lrec_t* pinrec,
 	char* value_field_name_1, char* value_field_name_2, lhmsv_t* pacc_fields_to_acc_state);
 static sllv_t*   mapper_stats2_fit_all(mapper_stats2_state_t* pstate);
+static void      mapper_stats2_fit(lhms2v_t* pgroup_to_acc_field, lrec_t* prec);
+static int       mapper_stats2_two_pass(mapper_t* pmapper);
+static sllv_t*   mapper_stats2_process_fit_two_pass(lrec_t* pinrec, context_t* pctx, void* pvstate);
 
 static stats2_acc_t* make_stats2            (char* value_field_name_1, char* value_field_name_2, char* stats2_acc_name, int do_verbose);
 static stats2_acc_t* stats2_linreg_pca_alloc(char* value_field_name_1, char* value_field_name_2, char* stats2_acc_name, int do_verbose);
@@ -101,6 +106,7 @@ mapper_setup_t mapper_stats2_setup = {
 	.pusage_func = mapper_stats2_usage,
 	.pparse_func = mapper_stats2_parse_cli,
 	.ignores_input = FALSE,
+	.ptwo_pass_func = mapper_stats2_two_pass,
 };
 
 // ----------------------------------------------------------------
@@ -123,6 +129,8 @@ static void mapper_stats2_usage(FILE* o, char* argv0, char* verb) {
 	fprintf(o, "               the input data to compute new fit fields. All input records are\n");
 	fprintf(o, "               held in memory until end of input stream. Has effect only for\n");
 	fprintf(o, "               linreg-ols, linreg-pca, and logireg.\n");
+	fprintf(o, "               With %s --two-pass and without -g, file input is read twice\n", argv0);
+	fprintf(o, "               rather than held in memory.\n");
 	fprintf(o, "Only one of -s or --fit may be used.\n");
 	fprintf(o, "Example: %s %s -a linreg-pca -f x,y\n", argv0, verb);
 	fprintf(o, "Example: %s %s -a linreg-ols,r2 -f x,y -g size,shape\n", argv0, verb);
@@ -193,6 +201,8 @@ static mapper_t* mapper_stats2_alloc(ap_state_t* pargp, slls_t* paccumulator_nam
 	pstate->do_verbose               = do_verbose;
 	pstate->do_iterative_stats       = do_iterative_stats;
 	pstate->do_hold_and_fit          = do_hold_and_fit;
+	pstate->do_two_pass              = FALSE;
+	pstate->on_second_pass           = FALSE;
 
 	pmapper->pvstate       = pstate;
 	pmapper->pprocess_func = mapper_stats2_process;
@@ -304,7 +314,8 @@ static void mapper_stats2_ingest(lrec_t* pinrec, context_t* pctx, mapper_stats2_
 		lhmslv_put(pstate->acc_groups, slls_copy(pgroup_by_field_values), pgroup_to_acc_field, FREE_ENTRY_KEY);
 	}
 
-	if (pstate->do_hold_and_fit) { // Retain the input record in memory, for fitting and delivery at end of stream
+	// Retain the input record in memory, for fitting and delivery at end of stream
+	if (pstate->do_hold_and_fit && !pstate->do_two_pass) {
 		sllv_t* group_to_records = lhmslv_get(pstate->record_groups, pgroup_by_field_values);
 		if (group_to_records == NULL) {
 			group_to_records = sllv_alloc();
@@ -426,35 +437,70 @@ static sllv_t* mapper_stats2_fit_all(mapper_stats2_state_t* pstate) {
 
 		while (precords->phead) {
 			lrec_t* prec = sllv_pop(precords);
+			mapper_stats2_fit(pa->pvvalue, prec);
+			sllv_append(poutrecs, prec);
+		}
+	}
+	sllv_append(poutrecs, NULL);
+	return poutrecs;
+}
 
-			lhms2v_t* pgroup_to_acc_field = pa->pvvalue;
-
-			// For "x","y"
-			for (lhms2ve_t* pd = pgroup_to_acc_field->phead; pd != NULL; pd = pd->pnext) {
-				char*    value_field_name_1 = pd->key1;
-				char*    value_field_name_2 = pd->key2;
-				lhmsv_t* pacc_fields_to_acc_state = pd->pvvalue;
-
-				// For "linreg-ols", "logireg"
-				for (lhmsve_t* pe = pacc_fields_to_acc_state->phead; pe != NULL; pe = pe->pnext) {
-					stats2_acc_t* pstats2_acc = pe->pvvalue;
-					if (pstats2_acc->pfit_func != NULL) {
-						char* sx = lrec_get(prec, value_field_name_1);
-						char* sy = lrec_get(prec, value_field_name_2);
-						if (sx != NULL && sy != NULL) {
-							double x = mlr_double_from_string_or_die(sx);
-							double y = mlr_double_from_string_or_die(sy);
-							pstats2_acc->pfit_func(pstats2_acc->pvstate, x, y, prec);
-						}
-					}
+static void mapper_stats2_fit(lhms2v_t* pgroup_to_acc_field, lrec_t* prec) {
+	// For "x","y"
+	for (lhms2ve_t* pd = pgroup_to_acc_field->phead; pd != NULL; pd = pd->pnext) {
+		char*    value_field_name_1 = pd->key1;
+		char*    value_field_name_2 = pd->key2;
+		lhmsv_t* pacc_fields_to_acc_state = pd->pvvalue;
+
+		// For "linreg-ols", "logireg"
+		for (lhmsve_t* pe = pacc_fields_to_acc_state->phead; pe != NULL; pe = pe->pnext) {
+			stats2_acc_t* pstats2_acc = pe->pvvalue;
+			if (pstats2_acc->pfit_func != NULL) {
+				char* sx = lrec_get(prec, value_field_name_1);
+				char* sy = lrec_get(prec, value_field_name_2);
+				if (sx != NULL && sy != NULL) {
+					double x = mlr_double_from_string_or_die(sx);
+					double y = mlr_double_from_string_or_die(sy);
+					pstats2_acc->pfit_func(pstats2_acc->pvstate, x, y, prec);
 				}
 			}
+		}
+	}
+}
 
-			sllv_append(poutrecs, prec);
+// ----------------------------------------------------------------
+// With --two-pass the input is read twice rather than retained: see mapper.h. This is only
+// for --fit without -g, since with -g the output is ordered by group.
+static int mapper_stats2_two_pass(mapper_t* pmapper) {
+	mapper_stats2_state_t* pstate = pmapper->pvstate;
+	if (!pstate->do_hold_and_fit || pstate->pgroup_by_field_names->length != 0)
+		return FALSE;
+	pstate->do_two_pass = TRUE;
+	pmapper->pprocess_func = mapper_stats2_process_fit_two_pass;
+	return TRUE;
+}
+
+static sllv_t* mapper_stats2_process_fit_two_pass(lrec_t* pinrec, context_t* pctx, void* pvstate) {
+	mapper_stats2_state_t* pstate = pvstate;
+	if (!pstate->on_second_pass) {
+		if (pinrec != NULL) {
+			mapper_stats2_ingest(pinrec, pctx, pstate);
+			lrec_free(pinrec);
+		} else {
+			pstate->on_second_pass = TRUE;
 		}
+		return NULL;
+	} else if (pinrec != NULL) {
+		slls_t* pgroup_by_field_values = mlr_reference_selected_values_from_record(pinrec,
+			pstate->pgroup_by_field_names);
+		lhms2v_t* pgroup_to_acc_field = lhmslv_get(pstate->acc_groups, pgroup_by_field_values);
+		MLR_INTERNAL_CODING_ERROR_IF(pgroup_to_acc_field == NULL); // should have populated on pass 1
+		slls_free(pgroup_by_field_values);
+		mapper_stats2_fit(pgroup_to_acc_field, pinrec);
+		return sllv_single(pinrec);
+	} else {
+		return sllv_single(NULL);
 	}
-	sllv_append(poutrecs, NULL);
-	return poutrecs;
 }
 
 // ================================================================
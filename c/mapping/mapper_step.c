@@ -15,6 +15,7 @@
 #include "cli/argparse.h"
 
 #define DEFAULT_STRING_ALPHA "0.5"
+#define DEFAULT_WINDOW_SIZE  5
 
 // ----------------------------------------------------------------
 struct _step_t; // forward reference for method declarations
@@ -35,7 +36,7 @@ typedef struct _step_t {
 } step_t;
 
 typedef step_t* step_alloc_func_t(char* input_field_name, int allow_int_float,
-	slls_t* pstring_alphas, slls_t* pewma_suffixes);
+	slls_t* pstring_alphas, slls_t* pewma_suffixes, int window_size);
 
 typedef struct _mapper_step_state_t {
 	ap_state_t*     pargp;
@@ -47,6 +48,7 @@ typedef struct _mapper_step_state_t {
 	int             allow_int_float;
 	slls_t*         pstring_alphas;
 	slls_t*         pewma_suffixes;
+	int             window_size;
 } mapper_step_state_t;
 
 // Multilevel hashmap structure:
@@ -76,21 +78,36 @@ static void      mapper_step_usage(FILE* o, char* argv0, char* verb);
 static mapper_t* mapper_step_parse_cli(int* pargi, int argc, char** argv,
 	cli_reader_opts_t* _, cli_writer_opts_t* __);
 static mapper_t* mapper_step_alloc(ap_state_t* pargp, slls_t* pstepper_names, string_array_t* pvalue_field_names,
-	slls_t* pgroup_by_field_names, int allow_int_float, slls_t* pstring_alphas, slls_t* pewma_suffixes);
+	slls_t* pgroup_by_field_names, int allow_int_float, slls_t* pstring_alphas, slls_t* pewma_suffixes,
+	int window_size);
 static void      mapper_step_free(mapper_t* pmapper, context_t* _);
 static sllv_t*   mapper_step_process(lrec_t* pinrec, context_t* pctx, void* pvstate);
 
-static step_t* step_delta_alloc      (char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2);
-static step_t* step_shift_alloc      (char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2);
-static step_t* step_from_first_alloc (char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2);
-static step_t* step_ratio_alloc      (char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2);
-static step_t* step_rsum_alloc       (char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2);
-static step_t* step_counter_alloc    (char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2);
+static step_t* step_delta_alloc      (char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2,
+	int unused3);
+static step_t* step_shift_alloc      (char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2,
+	int unused3);
+static step_t* step_from_first_alloc (char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2,
+	int unused3);
+static step_t* step_ratio_alloc      (char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2,
+	int unused3);
+static step_t* step_rsum_alloc       (char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2,
+	int unused3);
+static step_t* step_counter_alloc    (char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2,
+	int unused3);
 static step_t* step_ewma_alloc       (char* input_field_name, int unused,
-	slls_t* pstring_alphas, slls_t* pewma_suffixes);
+	slls_t* pstring_alphas, slls_t* pewma_suffixes, int unused3);
+static step_t* step_movavg_alloc     (char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2,
+	int window_size);
+static step_t* step_movstd_alloc     (char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2,
+	int window_size);
+static step_t* step_movmin_alloc     (char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2,
+	int window_size);
+static step_t* step_movmax_alloc     (char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2,
+	int window_size);
 
 static step_t* make_step(char* step_name, char* input_field_name, int allow_int_float,
-	slls_t* pstring_alphas, slls_t* pewma_suffixes);
+	slls_t* pstring_alphas, slls_t* pewma_suffixes, int window_size);
 
 typedef struct _step_lookup_t {
 	char* name;
@@ -105,6 +122,10 @@ static step_lookup_t step_lookup_table[] = {
 	{"rsum",       step_rsum_alloc,       "Compute running sums of field(s) between successive records"},
 	{"counter",    step_counter_alloc,    "Count instances of field(s) between successive records"},
 	{"ewma",       step_ewma_alloc,       "Exponentially weighted moving average over successive records"},
+	{"movavg",     step_movavg_alloc,     "Mean of field(s) over the last -w records"},
+	{"movstd",     step_movstd_alloc,     "Standard deviation of field(s) over the last -w records"},
+	{"movmin",     step_movmin_alloc,     "Minimum of field(s) over the last -w records"},
+	{"movmax",     step_movmax_alloc,     "Maximum of field(s) over the last -w records"},
 };
 static int step_lookup_table_length = sizeof(step_lookup_table) / sizeof(step_lookup_table[0]);
 
@@ -119,7 +140,7 @@ mapper_setup_t mapper_step_setup = {
 // ----------------------------------------------------------------
 static void mapper_step_usage(FILE* o, char* argv0, char* verb) {
 	fprintf(o, "Usage: %s %s [options]\n", argv0, verb);
-	fprintf(o, "Computes values dependent on the previous record, optionally grouped\n");
+	fprintf(o, "Computes values dependent on the previous record(s), optionally grouped\n");
 	fprintf(o, "by category.\n");
 	fprintf(o, "\n");
 	fprintf(o, "Options:\n");
@@ -138,6 +159,9 @@ static void mapper_step_usage(FILE* o, char* argv0, char* verb) {
 	fprintf(o, "-o {a,b,c} Custom suffixes for EWMA output fields. If omitted, these default to\n");
 	fprintf(o, "           the -d values. If supplied, the number of -o values must be the same\n");
 	fprintf(o, "           as the number of -d values.\n");
+	fprintf(o, "-w {n}     Window size for movavg, movstd, movmin, and movmax: these are\n");
+	fprintf(o, "           computed over the current record and the n-1 before it, or fewer\n");
+	fprintf(o, "           at the start of the stream. Default %d.\n", DEFAULT_WINDOW_SIZE);
 	fprintf(o, "\n");
 	fprintf(o, "Examples:\n");
 	fprintf(o, "  %s %s -a rsum -f request_size\n", argv0, verb);
@@ -145,6 +169,7 @@ static void mapper_step_usage(FILE* o, char* argv0, char* verb) {
 	fprintf(o, "  %s %s -a ewma -d 0.1,0.9 -f x,y\n", argv0, verb);
 	fprintf(o, "  %s %s -a ewma -d 0.1,0.9 -o smooth,rough -f x,y\n", argv0, verb);
 	fprintf(o, "  %s %s -a ewma -d 0.1,0.9 -o smooth,rough -f x,y -g group_name\n", argv0, verb);
+	fprintf(o, "  %s %s -a movavg,movmax -w 60 -f sys_load -g hostname\n", argv0, verb);
 	fprintf(o, "\n");
 	fprintf(o, "Please see http://johnkerl.org/miller/doc/reference.html#filter or\n");
 	fprintf(o, "https://en.wikipedia.org/wiki/Moving_average#Exponential_moving_average\n");
@@ -160,6 +185,7 @@ static mapper_t* mapper_step_parse_cli(int* pargi, int argc, char** argv,
 	slls_t*         pstring_alphas        = slls_single_no_free(DEFAULT_STRING_ALPHA);
 	slls_t*         pewma_suffixes        = NULL;
 	int             allow_int_float       = TRUE;
+	int             window_size           = DEFAULT_WINDOW_SIZE;
 
 	char* verb = argv[(*pargi)++];
 
@@ -170,6 +196,7 @@ static mapper_t* mapper_step_parse_cli(int* pargi, int argc, char** argv,
 	ap_define_string_list_flag(pstate,  "-d", &pstring_alphas);
 	ap_define_string_list_flag(pstate,  "-o", &pewma_suffixes);
 	ap_define_false_flag(pstate,        "-F", &allow_int_float);
+	ap_define_int_flag(pstate,          "-w", &window_size);
 
 	if (!ap_parse(pstate, verb, pargi, argc, argv)) {
 		mapper_step_usage(stderr, argv[0], verb);
@@ -180,6 +207,10 @@ static mapper_t* mapper_step_parse_cli(int* pargi, int argc, char** argv,
 		mapper_step_usage(stderr, argv[0], verb);
 		return NULL;
 	}
+	if (window_size < 1) {
+		mapper_step_usage(stderr, argv[0], verb);
+		return NULL;
+	}
 	if (pstring_alphas != NULL && pewma_suffixes != NULL) {
 		if (pewma_suffixes->length != pstring_alphas->length) {
 			mapper_step_usage(stderr, argv[0], verb);
@@ -188,12 +219,13 @@ static mapper_t* mapper_step_parse_cli(int* pargi, int argc, char** argv,
 	}
 
 	return mapper_step_alloc(pstate, pstepper_names, pvalue_field_names, pgroup_by_field_names,
-		allow_int_float, pstring_alphas, pewma_suffixes);
+		allow_int_float, pstring_alphas, pewma_suffixes, window_size);
 }
 
 // ----------------------------------------------------------------
 static mapper_t* mapper_step_alloc(ap_state_t* pargp, slls_t* pstepper_names, string_array_t* pvalue_field_names,
-	slls_t* pgroup_by_field_names, int allow_int_float, slls_t* pstring_alphas, slls_t* pewma_suffixes)
+	slls_t* pgroup_by_field_names, int allow_int_float, slls_t* pstring_alphas, slls_t* pewma_suffixes,
+	int window_size)
 {
 	mapper_t* pmapper = mlr_malloc_or_die(sizeof(mapper_t));
 
@@ -208,6 +240,7 @@ static mapper_t* mapper_step_alloc(ap_state_t* pargp, slls_t* pstepper_names, st
 	pstate->allow_int_float       = allow_int_float;
 	pstate->pstring_alphas        = pstring_alphas;
 	pstate->pewma_suffixes        = pewma_suffixes;
+	pstate->window_size           = window_size;
 
 	pmapper->pvstate       = pstate;
 	pmapper->pprocess_func = mapper_step_process;
@@ -274,6 +307,8 @@ static sllv_t* mapper_step_process(lrec_t* pinrec, context_t* pctx, void* pvstat
 		char* value_field_sval = pstate->pvalue_field_values->strings[i];
 		if (value_field_sval == NULL) // Key not present
 			continue;
+		lrece_t* pvalue_entry = NULL;
+		(void)lrec_get_ext(pinrec, value_field_name, &pvalue_entry);
 
 		int have_dval = FALSE;
 		int have_nval = FALSE;
@@ -293,7 +328,7 @@ static sllv_t* mapper_step_process(lrec_t* pinrec, context_t* pctx, void* pvstat
 			step_t* pstep = lhmsv_get(pacc_field_to_acc_state, step_name);
 			if (pstep == NULL) {
 				pstep = make_step(step_name, value_field_name, pstate->allow_int_float,
-					pstate->pstring_alphas, pstate->pewma_suffixes);
+					pstate->pstring_alphas, pstate->pewma_suffixes, pstate->window_size);
 				if (pstep == NULL) {
 					fprintf(stderr, "mlr step: stepper \"%s\" not found.\n",
 						step_name);
@@ -310,7 +345,7 @@ static sllv_t* mapper_step_process(lrec_t* pinrec, context_t* pctx, void* pvstat
 
 				if (pstep->pdprocess_func != NULL) {
 					if (!have_dval) {
-						value_field_dval = mlr_double_from_string_or_die(value_field_sval);
+						value_field_dval = lrec_entry_double_or_die(pinrec, pvalue_entry);
 						have_dval = TRUE;
 					}
 					pstep->pdprocess_func(pstep->pvstate, value_field_dval, pinrec);
@@ -319,8 +354,8 @@ static sllv_t* mapper_step_process(lrec_t* pinrec, context_t* pctx, void* pvstat
 				if (pstep->pnprocess_func != NULL) {
 					if (!have_nval) {
 						value_field_nval = pstate->allow_int_float
-							? mv_scan_number_or_die(value_field_sval)
-							: mv_from_float(mlr_double_from_string_or_die(value_field_sval));
+							? lrec_entry_scan_number_or_die(pinrec, pvalue_entry)
+							: mv_from_float(lrec_entry_double_or_die(pinrec, pvalue_entry));
 						have_nval = TRUE;
 					}
 					pstep->pnprocess_func(pstep->pvstate, &value_field_nval, pinrec);
@@ -336,12 +371,12 @@ static sllv_t* mapper_step_process(lrec_t* pinrec, context_t* pctx, void* pvstat
 }
 
 static step_t* make_step(char* step_name, char* input_field_name, int allow_int_float,
-	slls_t* pstring_alphas, slls_t* pewma_suffixes)
+	slls_t* pstring_alphas, slls_t* pewma_suffixes, int window_size)
 {
 	for (int i = 0; i < step_lookup_table_length; i++)
 		if (streq(step_name, step_lookup_table[i].name))
 			return step_lookup_table[i].palloc_func(input_field_name, allow_int_float,
-				pstring_alphas, pewma_suffixes);
+				pstring_alphas, pewma_suffixes, window_size);
 	return NULL;
 }
 
@@ -372,7 +407,9 @@ static void step_delta_free(step_t* pstep) {
 	free(pstate);
 	free(pstep);
 }
-static step_t* step_delta_alloc(char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2) {
+static step_t* step_delta_alloc(char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2,
+	int unused3)
+{
 	step_t* pstep = mlr_malloc_or_die(sizeof(step_t));
 	step_delta_state_t* pstate = mlr_malloc_or_die(sizeof(step_delta_state_t));
 	pstate->prev = mv_absent();
@@ -409,7 +446,9 @@ static void step_shift_free(step_t* pstep) {
 	free(pstate);
 	free(pstep);
 }
-static step_t* step_shift_alloc(char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2) {
+static step_t* step_shift_alloc(char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2,
+	int unused3)
+{
 	step_t* pstep = mlr_malloc_or_die(sizeof(step_t));
 	step_shift_state_t* pstate = mlr_malloc_or_die(sizeof(step_shift_state_t));
 	pstate->prev = mlr_strdup_or_die("");
@@ -451,7 +490,9 @@ static void step_from_first_free(step_t* pstep) {
 	free(pstate);
 	free(pstep);
 }
-static step_t* step_from_first_alloc(char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2) {
+static step_t* step_from_first_alloc(char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2,
+	int unused3)
+{
 	step_t* pstep = mlr_malloc_or_die(sizeof(step_t));
 	step_from_first_state_t* pstate = mlr_malloc_or_die(sizeof(step_from_first_state_t));
 	pstate->first = mv_absent();
@@ -494,7 +535,9 @@ static void step_ratio_free(step_t* pstep) {
 	free(pstate);
 	free(pstep);
 }
-static step_t* step_ratio_alloc(char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2) {
+static step_t* step_ratio_alloc(char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2,
+	int unused3)
+{
 	step_t* pstep = mlr_malloc_or_die(sizeof(step_t));
 	step_ratio_state_t* pstate = mlr_malloc_or_die(sizeof(step_ratio_state_t));
 	pstate->prev          = -999.0;
@@ -532,7 +575,9 @@ static void step_rsum_free(step_t* pstep) {
 	free(pstate);
 	free(pstep);
 }
-static step_t* step_rsum_alloc(char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2) {
+static step_t* step_rsum_alloc(char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2,
+	int unused3)
+{
 	step_t* pstep = mlr_malloc_or_die(sizeof(step_t));
 	step_rsum_state_t* pstate = mlr_malloc_or_die(sizeof(step_rsum_state_t));
 	pstate->allow_int_float = allow_int_float;
@@ -569,7 +614,9 @@ static void step_counter_free(step_t* pstep) {
 	free(pstate);
 	free(pstep);
 }
-static step_t* step_counter_alloc(char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2) {
+static step_t* step_counter_alloc(char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2,
+	int unused3)
+{
 	step_t* pstep = mlr_malloc_or_die(sizeof(step_t));
 	step_counter_state_t* pstate = mlr_malloc_or_die(sizeof(step_counter_state_t));
 	pstate->counter = allow_int_float ? mv_from_int(0LL) : mv_from_float(0.0);
@@ -632,7 +679,9 @@ static void step_ewma_free(step_t* pstep) {
 	free(pstep);
 }
 
-static step_t* step_ewma_alloc(char* input_field_name, int unused, slls_t* pstring_alphas, slls_t* pewma_suffixes) {
+static step_t* step_ewma_alloc(char* input_field_name, int unused, slls_t* pstring_alphas, slls_t* pewma_suffixes,
+	int unused3)
+{
 	step_t* pstep              = mlr_malloc_or_die(sizeof(step_t));
 
 	step_ewma_state_t* pstate  = mlr_malloc_or_die(sizeof(step_ewma_state_t));
@@ -664,3 +713,228 @@ static step_t* step_ewma_alloc(char* input_field_name, int unused, slls_t* pstri
 	pstep->pfree_func     = step_ewma_free;
 	return pstep;
 }
+
+// ================================================================
+// Windowed steppers. Each keeps the last window_size values in a ring buffer,
+// so the per-record cost doesn't depend on the window size.
+//
+// For movavg and movstd the mean and the sum of squared deviations are updated
+// as a value enters and another leaves the window (Welford's method); to keep
+// round-off from accumulating over long streams they're recomputed from the
+// ring buffer each time it wraps around, which is O(1) amortized.
+//
+// For movmin and movmax we keep a monotone deque of the values which may yet
+// be the window extremum: for movmax, each value is newer and smaller than the
+// one before it, so the front is the maximum. A new value pops off the back
+// all values it dominates, and the front is popped once it leaves the window.
+// Each value is pushed and popped at most once.
+// ================================================================
+
+typedef struct _double_window_t {
+	double* values;
+	int     capacity;
+	int     count;
+	int     next;
+	double  mean;
+	double  m2; // Sum of squared deviations from the mean
+} double_window_t;
+
+static void double_window_init(double_window_t* pwindow, int capacity) {
+	pwindow->values   = mlr_malloc_or_die(capacity * sizeof(double));
+	pwindow->capacity = capacity;
+	pwindow->count    = 0;
+	pwindow->next     = 0;
+	pwindow->mean     = 0.0;
+	pwindow->m2       = 0.0;
+}
+
+static void double_window_put(double_window_t* pwindow, double x) {
+	if (pwindow->count < pwindow->capacity) {
+		pwindow->count++;
+		double delta = x - pwindow->mean;
+		pwindow->mean += delta / pwindow->count;
+		pwindow->m2 += delta * (x - pwindow->mean);
+	} else {
+		double y = pwindow->values[pwindow->next];
+		double old_mean = pwindow->mean;
+		pwindow->mean += (x - y) / pwindow->count;
+		pwindow->m2 += (x - y) * (x - pwindow->mean + y - old_mean);
+	}
+	pwindow->values[pwindow->next] = x;
+	pwindow->next++;
+
+	if (pwindow->next == pwindow->capacity) {
+		pwindow->next = 0;
+		double sum = 0.0;
+		for (int i = 0; i < pwindow->count; i++)
+			sum += pwindow->values[i];
+		pwindow->mean = sum / pwindow->count;
+		double m2 = 0.0;
+		for (int i = 0; i < pwindow->count; i++) {
+			double d = pwindow->values[i] - pwindow->mean;
+			m2 += d * d;
+		}
+		pwindow->m2 = m2;
+	}
+	if (pwindow->m2 < 0.0) // round-off error
+		pwindow->m2 = 0.0;
+}
+
+// ----------------------------------------------------------------
+typedef struct _step_movavg_state_t {
+	double_window_t window;
+	char*           output_field_name;
+} step_movavg_state_t;
+static void step_movavg_dprocess(void* pvstate, double fltv, lrec_t* prec) {
+	step_movavg_state_t* pstate = pvstate;
+	double_window_put(&pstate->window, fltv);
+	lrec_put(prec, pstate->output_field_name, mlr_alloc_string_from_double(pstate->window.mean, MLR_GLOBALS.ofmt),
+		FREE_ENTRY_VALUE);
+}
+static void step_movavg_zprocess(void* pvstate, lrec_t* prec) {
+	step_movavg_state_t* pstate = pvstate;
+	lrec_put(prec, pstate->output_field_name, "", NO_FREE);
+}
+static void step_movavg_free(step_t* pstep) {
+	step_movavg_state_t* pstate = pstep->pvstate;
+	free(pstate->window.values);
+	free(pstate->output_field_name);
+	free(pstate);
+	free(pstep);
+}
+static step_t* step_movavg_alloc(char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2,
+	int window_size)
+{
+	step_t* pstep = mlr_malloc_or_die(sizeof(step_t));
+	step_movavg_state_t* pstate = mlr_malloc_or_die(sizeof(step_movavg_state_t));
+	double_window_init(&pstate->window, window_size);
+	pstate->output_field_name = mlr_paste_2_strings(input_field_name, "_movavg");
+	pstep->pvstate        = (void*)pstate;
+	pstep->pdprocess_func = step_movavg_dprocess;
+	pstep->pnprocess_func = NULL;
+	pstep->psprocess_func = NULL;
+	pstep->pzprocess_func = step_movavg_zprocess;
+	pstep->pfree_func     = step_movavg_free;
+	return pstep;
+}
+
+// ----------------------------------------------------------------
+typedef struct _step_movstd_state_t {
+	double_window_t window;
+	char*           output_field_name;
+} step_movstd_state_t;
+static void step_movstd_dprocess(void* pvstate, double fltv, lrec_t* prec) {
+	step_movstd_state_t* pstate = pvstate;
+	double_window_put(&pstate->window, fltv);
+	if (pstate->window.count < 2) {
+		lrec_put(prec, pstate->output_field_name, "", NO_FREE);
+	} else {
+		double stddev = sqrt(pstate->window.m2 / (pstate->window.count - 1));
+		lrec_put(prec, pstate->output_field_name, mlr_alloc_string_from_double(stddev, MLR_GLOBALS.ofmt),
+			FREE_ENTRY_VALUE);
+	}
+}
+static void step_movstd_zprocess(void* pvstate, lrec_t* prec) {
+	step_movstd_state_t* pstate = pvstate;
+	lrec_put(prec, pstate->output_field_name, "", NO_FREE);
+}
+static void step_movstd_free(step_t* pstep) {
+	step_movstd_state_t* pstate = pstep->pvstate;
+	free(pstate->window.values);
+	free(pstate->output_field_name);
+	free(pstate);
+	free(pstep);
+}
+static step_t* step_movstd_alloc(char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2,
+	int window_size)
+{
+	step_t* pstep = mlr_malloc_or_die(sizeof(step_t));
+	step_movstd_state_t* pstate = mlr_malloc_or_die(sizeof(step_movstd_state_t));
+	double_window_init(&pstate->window, window_size);
+	pstate->output_field_name = mlr_paste_2_strings(input_field_name, "_movstd");
+	pstep->pvstate        = (void*)pstate;
+	pstep->pdprocess_func = step_movstd_dprocess;
+	pstep->pnprocess_func = NULL;
+	pstep->psprocess_func = NULL;
+	pstep->pzprocess_func = step_movstd_zprocess;
+	pstep->pfree_func     = step_movstd_free;
+	return pstep;
+}
+
+// ----------------------------------------------------------------
+typedef struct _step_movext_state_t {
+	mv_t*               values;  // Ring buffer holding the deque
+	unsigned long long* seqnos;  // Position of each value in the stream
+	int                 capacity;
+	int                 head;
+	int                 length;
+	unsigned long long  seqno;
+	int                 do_max;
+	char*               output_field_name;
+} step_movext_state_t;
+static void step_movext_nprocess(void* pvstate, mv_t* pnumv, lrec_t* prec) {
+	step_movext_state_t* pstate = pvstate;
+	int capacity = pstate->capacity;
+	pstate->seqno++;
+
+	// Drop the front if it has left the window.
+	if (pstate->length > 0 && pstate->seqnos[pstate->head] + capacity <= pstate->seqno) {
+		pstate->head = (pstate->head + 1) % capacity;
+		pstate->length--;
+	}
+	// Drop from the back the values which can no longer be the extremum.
+	while (pstate->length > 0) {
+		mv_t* pback = &pstate->values[(pstate->head + pstate->length - 1) % capacity];
+		if (pstate->do_max ? mv_i_nn_gt(pback, pnumv) : mv_i_nn_lt(pback, pnumv))
+			break;
+		pstate->length--;
+	}
+	int tail = (pstate->head + pstate->length) % capacity;
+	pstate->values[tail] = *pnumv;
+	pstate->seqnos[tail] = pstate->seqno;
+	pstate->length++;
+
+	lrec_put(prec, pstate->output_field_name, mv_alloc_format_val(&pstate->values[pstate->head]),
+		FREE_ENTRY_VALUE);
+}
+static void step_movext_zprocess(void* pvstate, lrec_t* prec) {
+	step_movext_state_t* pstate = pvstate;
+	lrec_put(prec, pstate->output_field_name, "", NO_FREE);
+}
+static void step_movext_free(step_t* pstep) {
+	step_movext_state_t* pstate = pstep->pvstate;
+	free(pstate->values);
+	free(pstate->seqnos);
+	free(pstate->output_field_name);
+	free(pstate);
+	free(pstep);
+}
+static step_t* step_movext_alloc(char* input_field_name, int window_size, int do_max) {
+	step_t* pstep = mlr_malloc_or_die(sizeof(step_t));
+	step_movext_state_t* pstate = mlr_malloc_or_die(sizeof(step_movext_state_t));
+	pstate->values    = mlr_malloc_or_die(window_size * sizeof(mv_t));
+	pstate->seqnos    = mlr_malloc_or_die(window_size * sizeof(unsigned long long));
+	pstate->capacity  = window_size;
+	pstate->head      = 0;
+	pstate->length    = 0;
+	pstate->seqno     = 0LL;
+	pstate->do_max    = do_max;
+	pstate->output_field_name = mlr_paste_2_strings(input_field_name, do_max ? "_movmax" : "_movmin");
+	pstep->pvstate        = (void*)pstate;
+	pstep->pdprocess_func = NULL;
+	pstep->pnprocess_func = step_movext_nprocess;
+	pstep->psprocess_func = NULL;
+	pstep->pzprocess_func = step_movext_zprocess;
+	pstep->pfree_func     = step_movext_free;
+	return pstep;
+}
+static step_t* step_movmin_alloc(char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2,
+	int window_size)
+{
+	return step_movext_alloc(input_field_name, window_size, FALSE);
+}
+static step_t* step_movmax_alloc(char* input_field_name, int allow_int_float, slls_t* unused1, slls_t* unused2,
+	int window_size)
+{
+	return step_movext_alloc(input_field_name, window_size, TRUE);
+}
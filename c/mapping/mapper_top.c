@@ -215,9 +215,11 @@ static void mapper_top_ingest(lrec_t* pinrec, mapper_top_state_t* pstate) {
 			continue;
 		}
 
+		lrece_t* pvalue_entry = NULL;
+		(void)lrec_get_ext(pinrec, value_field_name, &pvalue_entry);
 		mv_t value_field_nval = pstate->allow_int_float
-			? mv_scan_number_or_die(value_field_sval)
-			: mv_from_float(mlr_double_from_string_or_die(value_field_sval));
+			? lrec_entry_scan_number_or_die(pinrec, pvalue_entry)
+			: mv_from_float(lrec_entry_double_or_die(pinrec, pvalue_entry));
 
 		// The top-keeper object will free the record if it isn't retained, or
 		// keep it if it is.
@@ -234,6 +236,9 @@ static sllv_t* mapper_top_emit(mapper_top_state_t* pstate, context_t* pctx) {
 	sllv_t* poutrecs = sllv_alloc();
 
 	for (lhmslve_t* pa = pstate->groups->phead; pa != NULL; pa = pa->pnext) {
+		lhmsv_t* group_to_acc_field = pa->pvvalue;
+		for (lhmsve_t* pd = group_to_acc_field->phead; pd != NULL; pd = pd->pnext)
+			top_keeper_sort(pd->pvvalue);
 
 		// Above we required that there was only one value field in the
 		// show-full-records case. That's for two reasons: (1) here, we print
@@ -241,7 +246,6 @@ static sllv_t* mapper_top_emit(mapper_top_state_t* pstate, context_t* pctx) {
 		// presented as output; (2) there would be double-frees in our
 		// ingester.
 		if (pstate->show_full_records) {
-			lhmsv_t* group_to_acc_field = pa->pvvalue;
 			for (lhmsve_t* pd = group_to_acc_field->phead; pd != NULL; pd = pd->pnext) {
 				top_keeper_t* ptop_keeper_for_group = pd->pvvalue;
 				for (int i = 0;  i < ptop_keeper_for_group->size; i++) {
@@ -264,7 +268,6 @@ static sllv_t* mapper_top_emit(mapper_top_state_t* pstate, context_t* pctx) {
 				}
 
 				// Add in fields such as x_top_1=#
-				lhmsv_t* group_to_acc_field = pa->pvvalue;
 				// for "x", "y"
 				for (lhmsve_t* pd = group_to_acc_field->phead; pd != NULL; pd = pd->pnext) {
 					char* value_field_name = pd->key;
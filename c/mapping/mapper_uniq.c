@@ -3,6 +3,7 @@
 #include <string.h>
 #include <math.h>
 #include "lib/mlrutil.h"
+#include "lib/hyperloglog.h"
 #include "containers/sllv.h"
 #include "containers/lhmsll.h"
 #include "containers/lhmslv.h"
@@ -24,6 +25,11 @@ typedef struct _mapper_uniq_state_t {
 	lhmslv_t* pcounts_by_group;
 	lhmsv_t*  pcounts_unlashed; // string field name -> string field value -> long long count
 	char* output_field_name;
+	// For count-distinct -n -g and for --approx:
+	slls_t*   pnum_distinct_group_by_field_names;
+	lhmslv_t* pdistincts_by_group; // group-by values -> lhmslv_t of distinct values, or hll_t* with --approx
+	int       approx_precision;    // 0 for exact counts
+	hll_t*    phll;                // --approx without grouping
 } mapper_uniq_state_t;
 
 // ----------------------------------------------------------------
@@ -58,7 +64,9 @@ static mapper_t* mapper_uniq_alloc(
 	int show_counts,
 	int show_num_distinct_only,
 	char* output_field_name,
-	int uniqify_entire_records);
+	int uniqify_entire_records,
+	slls_t* pnum_distinct_group_by_field_names,
+	int approx_precision);
 
 static void mapper_uniq_free(
 	mapper_t* pmapper,
@@ -79,6 +87,11 @@ static sllv_t* mapper_uniq_process_uniqify_entire_records_show_num_distinct_only
 	context_t* pctx,
 	void* pvstate);
 
+static sllv_t* mapper_uniq_process_uniqify_entire_records_show_num_distinct_only_approx(
+	lrec_t* pinrec,
+	context_t* pctx,
+	void* pvstate);
+
 static sllv_t* mapper_uniq_process_unlashed(
 	lrec_t* pinrec,
 	context_t* pctx,
@@ -89,6 +102,16 @@ static sllv_t* mapper_uniq_process_num_distinct_only(
 	context_t* pctx,
 	void* pvstate);
 
+static sllv_t* mapper_uniq_process_num_distinct_only_grouped(
+	lrec_t* pinrec,
+	context_t* pctx,
+	void* pvstate);
+
+static sllv_t* mapper_uniq_process_num_distinct_only_approx(
+	lrec_t* pinrec,
+	context_t* pctx,
+	void* pvstate);
+
 static sllv_t* mapper_uniq_process_with_counts(
 	lrec_t* pinrec,
 	context_t* pctx,
@@ -127,6 +150,16 @@ static void mapper_count_distinct_usage(
 	fprintf(o, "Options:\n");
 	fprintf(o, "-f {a,b,c}    Field names for distinct count.\n");
 	fprintf(o, "-n            Show only the number of distinct values. Not compatible with -u.\n");
+	fprintf(o, "-g {d,e,f}    With -n, show the number of distinct values separately for\n");
+	fprintf(o, "              each distinct combination of d, e, and f field values.\n");
+	fprintf(o, "--approx      With -n, estimate the number of distinct values using a\n");
+	fprintf(o, "              HyperLogLog sketch, in memory independent of the number of\n");
+	fprintf(o, "              distinct values. The relative standard error is about\n");
+	fprintf(o, "              1.04/sqrt(2^precision).\n");
+	fprintf(o, "--precision {p}\n");
+	fprintf(o, "              Sketch precision for --approx, from %d to %d. Default %d,\n",
+		HLL_MIN_PRECISION, HLL_MAX_PRECISION, HLL_DEFAULT_PRECISION);
+	fprintf(o, "              i.e. 4KB per sketch and about 1.6%% relative error.\n");
 	fprintf(o, "-o {name}     Field name for output count. Default \"%s\".\n", DEFAULT_OUTPUT_FIELD_NAME);
 	fprintf(o, "              Ignored with -u.\n");
 	fprintf(o, "-u            Do unlashed counts for multiple field names. With -f a,b and\n");
@@ -136,6 +169,19 @@ static void mapper_count_distinct_usage(
 	fprintf(o, "              values separately.\n");
 }
 
+// ----------------------------------------------------------------
+// Returns 0 for exact counting, the sketch precision for --approx, or -1 if
+// the options are invalid.
+static int mapper_uniq_get_approx_precision(int do_approx, int precision) {
+	if (!do_approx)
+		return (precision == -1) ? 0 : -1;
+	if (precision == -1)
+		return HLL_DEFAULT_PRECISION;
+	if (precision < HLL_MIN_PRECISION || precision > HLL_MAX_PRECISION)
+		return -1;
+	return precision;
+}
+
 // ----------------------------------------------------------------
 static mapper_t* mapper_count_distinct_parse_cli(
 	int* pargi,
@@ -148,14 +194,20 @@ static mapper_t* mapper_count_distinct_parse_cli(
 	int     show_num_distinct_only = FALSE;
 	char*   output_field_name = DEFAULT_OUTPUT_FIELD_NAME;
 	int     do_lashed = TRUE;
+	slls_t* pnum_distinct_group_by_field_names = NULL;
+	int     do_approx = FALSE;
+	int     precision = -1;
 
 	char* verb = argv[(*pargi)++];
 
 	ap_state_t* pstate = ap_alloc();
-	ap_define_string_list_flag(pstate, "-f", &pfield_names);
-	ap_define_true_flag(pstate,        "-n", &show_num_distinct_only);
-	ap_define_string_flag(pstate,      "-o", &output_field_name);
-	ap_define_false_flag(pstate,       "-u", &do_lashed);
+	ap_define_string_list_flag(pstate, "-f",          &pfield_names);
+	ap_define_true_flag(pstate,        "-n",          &show_num_distinct_only);
+	ap_define_string_flag(pstate,      "-o",          &output_field_name);
+	ap_define_false_flag(pstate,       "-u",          &do_lashed);
+	ap_define_string_list_flag(pstate, "-g",          &pnum_distinct_group_by_field_names);
+	ap_define_true_flag(pstate,        "--approx",    &do_approx);
+	ap_define_int_flag(pstate,         "--precision", &precision);
 
 	if (!ap_parse(pstate, verb, pargi, argc, argv)) {
 		mapper_count_distinct_usage(stderr, argv[0], verb);
@@ -170,9 +222,18 @@ static mapper_t* mapper_count_distinct_parse_cli(
 		mapper_count_distinct_usage(stderr, argv[0], verb);
 		return NULL;
 	}
+	if ((pnum_distinct_group_by_field_names != NULL || do_approx) && !show_num_distinct_only) {
+		mapper_count_distinct_usage(stderr, argv[0], verb);
+		return NULL;
+	}
+	int approx_precision = mapper_uniq_get_approx_precision(do_approx, precision);
+	if (approx_precision < 0) {
+		mapper_count_distinct_usage(stderr, argv[0], verb);
+		return NULL;
+	}
 
 	return mapper_uniq_alloc(pstate, pfield_names, do_lashed, TRUE, show_num_distinct_only,
-		output_field_name, FALSE);
+		output_field_name, FALSE, pnum_distinct_group_by_field_names, approx_precision);
 }
 
 // ----------------------------------------------------------------
@@ -194,6 +255,10 @@ static void mapper_uniq_usage(
 	fprintf(o, "              With -c, produces unique records, with repeat counts for each.\n");
 	fprintf(o, "              With -n, produces only one record which is the unique-record count.\n");
 	fprintf(o, "              With neither -c nor -n, produces unique records.\n");
+	fprintf(o, "--approx      With -n, estimate the number of distinct values using a\n");
+	fprintf(o, "              HyperLogLog sketch. See %s count-distinct --help.\n", argv0);
+	fprintf(o, "--precision {p}\n");
+	fprintf(o, "              Sketch precision for --approx. Default %d.\n", HLL_DEFAULT_PRECISION);
 }
 
 static mapper_t* mapper_uniq_parse_cli(
@@ -209,16 +274,20 @@ static mapper_t* mapper_uniq_parse_cli(
 	char*   output_field_name = DEFAULT_OUTPUT_FIELD_NAME;
 	int     do_lashed = TRUE;
 	int     uniqify_entire_records = FALSE;
+	int     do_approx = FALSE;
+	int     precision = -1;
 
 	char* verb = argv[(*pargi)++];
 
 	ap_state_t* pstate = ap_alloc();
-	ap_define_string_list_flag(pstate, "-f", &pgroup_by_field_names);
-	ap_define_string_list_flag(pstate, "-g", &pgroup_by_field_names);
-	ap_define_true_flag(pstate,        "-c", &show_counts);
-	ap_define_true_flag(pstate,        "-n", &show_num_distinct_only);
-	ap_define_string_flag(pstate,      "-o", &output_field_name);
-	ap_define_true_flag(pstate,        "-a", &uniqify_entire_records);
+	ap_define_string_list_flag(pstate, "-f",          &pgroup_by_field_names);
+	ap_define_string_list_flag(pstate, "-g",          &pgroup_by_field_names);
+	ap_define_true_flag(pstate,        "-c",          &show_counts);
+	ap_define_true_flag(pstate,        "-n",          &show_num_distinct_only);
+	ap_define_string_flag(pstate,      "-o",          &output_field_name);
+	ap_define_true_flag(pstate,        "-a",          &uniqify_entire_records);
+	ap_define_true_flag(pstate,        "--approx",    &do_approx);
+	ap_define_int_flag(pstate,         "--precision", &precision);
 
 	if (!ap_parse(pstate, verb, pargi, argc, argv)) {
 		mapper_uniq_usage(stderr, argv[0], verb);
@@ -240,9 +309,18 @@ static mapper_t* mapper_uniq_parse_cli(
 			return NULL;
 		}
 	}
+	if (do_approx && (!show_num_distinct_only || show_counts)) {
+		mapper_uniq_usage(stderr, argv[0], verb);
+		return NULL;
+	}
+	int approx_precision = mapper_uniq_get_approx_precision(do_approx, precision);
+	if (approx_precision < 0) {
+		mapper_uniq_usage(stderr, argv[0], verb);
+		return NULL;
+	}
 
 	return mapper_uniq_alloc(pstate, pgroup_by_field_names, do_lashed, show_counts, show_num_distinct_only,
-		output_field_name, uniqify_entire_records);
+		output_field_name, uniqify_entire_records, NULL, approx_precision);
 }
 
 // ----------------------------------------------------------------
@@ -253,7 +331,9 @@ static mapper_t* mapper_uniq_alloc(
 	int show_counts,
 	int show_num_distinct_only,
 	char* output_field_name,
-	int uniqify_entire_records)
+	int uniqify_entire_records,
+	slls_t* pnum_distinct_group_by_field_names,
+	int approx_precision)
 {
 	mapper_t* pmapper = mlr_malloc_or_die(sizeof(mapper_t));
 
@@ -268,17 +348,27 @@ static mapper_t* mapper_uniq_alloc(
 	pstate->pcounts_by_group         = lhmslv_alloc();
 	pstate->pcounts_unlashed         = lhmsv_alloc();
 	pstate->output_field_name        = output_field_name;
+	pstate->pnum_distinct_group_by_field_names = pnum_distinct_group_by_field_names;
+	pstate->pdistincts_by_group      = lhmslv_alloc();
+	pstate->approx_precision         = approx_precision;
+	pstate->phll                     = (approx_precision > 0) ? hll_alloc(approx_precision) : NULL;
 
 	pmapper->pvstate = pstate;
 	if (uniqify_entire_records) {
 		if (show_counts)
 			pmapper->pprocess_func = mapper_uniq_process_uniqify_entire_records_show_counts;
+		else if (show_num_distinct_only && approx_precision > 0)
+			pmapper->pprocess_func = mapper_uniq_process_uniqify_entire_records_show_num_distinct_only_approx;
 		else if (show_num_distinct_only)
 			pmapper->pprocess_func = mapper_uniq_process_uniqify_entire_records_show_num_distinct_only;
 		else
 			pmapper->pprocess_func = mapper_uniq_process_uniqify_entire_records;
 	} else if (!do_lashed)
 		pmapper->pprocess_func = mapper_uniq_process_unlashed;
+	else if (show_num_distinct_only && approx_precision > 0)
+		pmapper->pprocess_func = mapper_uniq_process_num_distinct_only_approx;
+	else if (show_num_distinct_only && pnum_distinct_group_by_field_names != NULL)
+		pmapper->pprocess_func = mapper_uniq_process_num_distinct_only_grouped;
 	else if (show_num_distinct_only)
 		pmapper->pprocess_func = mapper_uniq_process_num_distinct_only;
 	else if (show_counts)
@@ -324,6 +414,17 @@ static void mapper_uniq_free(
 	lhmsv_free(pstate->pcounts_unlashed);
 	pstate->pcounts_unlashed = NULL;
 
+	for (lhmslve_t* pa = pstate->pdistincts_by_group->phead; pa != NULL; pa = pa->pnext) {
+		if (pstate->approx_precision > 0)
+			hll_free(pa->pvvalue);
+		else
+			lhmslv_free(pa->pvvalue);
+	}
+	lhmslv_free(pstate->pdistincts_by_group);
+	pstate->pdistincts_by_group = NULL;
+	slls_free(pstate->pnum_distinct_group_by_field_names);
+	hll_free(pstate->phll);
+
 	pstate->pgroup_by_field_names = NULL;
 	pstate->pcounts_by_group = NULL;
 
@@ -420,6 +521,33 @@ static sllv_t* mapper_uniq_process_uniqify_entire_records_show_num_distinct_only
 	}
 }
 
+// Estimated count of unique records, in bounded memory.
+static sllv_t* mapper_uniq_process_uniqify_entire_records_show_num_distinct_only_approx(
+	lrec_t* pinrec,
+	context_t* pctx,
+	void* pvstate)
+{
+	mapper_uniq_state_t* pstate = pvstate;
+	if (pinrec != NULL) {
+		unsigned long long hash = HLL_HASH_SEED;
+		for (lrece_t* pe = pinrec->phead; pe != NULL; pe = pe->pnext) {
+			hash = hll_hash_update(hash, pe->key);
+			hash = hll_hash_update(hash, pe->value);
+		}
+		hll_add_hash(pstate->phll, hash);
+		lrec_free(pinrec);
+		return NULL;
+	} else { // end of record stream
+		sllv_t* poutrecs = sllv_alloc();
+		lrec_t* poutrec = lrec_unbacked_alloc();
+		lrec_put(poutrec, pstate->output_field_name, mlr_alloc_string_from_ll(hll_estimate(pstate->phll)),
+			FREE_ENTRY_VALUE);
+		sllv_append(poutrecs, poutrec);
+		sllv_append(poutrecs, NULL);
+		return poutrecs;
+	}
+}
+
 // ----------------------------------------------------------------
 static sllv_t* mapper_uniq_process_unlashed(
 	lrec_t* pinrec,
@@ -500,6 +628,128 @@ static sllv_t* mapper_uniq_process_num_distinct_only(
 	}
 }
 
+// ----------------------------------------------------------------
+// Helpers for count-distinct -n -g and for --approx.
+
+static lrec_t* mapper_uniq_alloc_group_record(mapper_uniq_state_t* pstate, slls_t* pgroup_by_field_values) {
+	lrec_t* poutrec = lrec_unbacked_alloc();
+	sllse_t* pb = pstate->pnum_distinct_group_by_field_names->phead;
+	sllse_t* pc =                      pgroup_by_field_values->phead;
+	for ( ; pb != NULL && pc != NULL; pb = pb->pnext, pc = pc->pnext) {
+		lrec_put(poutrec, pb->value, pc->value, NO_FREE);
+	}
+	return poutrec;
+}
+
+// Hashes the values of the distinct-by fields, returning FALSE if any of them
+// is absent from the record.
+static int mapper_uniq_hash_selected_values(lrec_t* prec, slls_t* pfield_names, unsigned long long* phash) {
+	unsigned long long hash = HLL_HASH_SEED;
+	for (sllse_t* pe = pfield_names->phead; pe != NULL; pe = pe->pnext) {
+		char* value = lrec_get(prec, pe->value);
+		if (value == NULL)
+			return FALSE;
+		hash = hll_hash_update(hash, value);
+	}
+	*phash = hash;
+	return TRUE;
+}
+
+// ----------------------------------------------------------------
+static sllv_t* mapper_uniq_process_num_distinct_only_grouped(
+	lrec_t* pinrec,
+	context_t* pctx,
+	void* pvstate)
+{
+	mapper_uniq_state_t* pstate = pvstate;
+	if (pinrec != NULL) {
+		slls_t* pgroup_by_field_values = mlr_reference_selected_values_from_record(pinrec,
+			pstate->pnum_distinct_group_by_field_names);
+		slls_t* pdistinct_field_values = mlr_reference_selected_values_from_record(pinrec,
+			pstate->pgroup_by_field_names);
+		if (pgroup_by_field_values != NULL && pdistinct_field_values != NULL) {
+			lhmslv_t* pdistincts = lhmslv_get(pstate->pdistincts_by_group, pgroup_by_field_values);
+			if (pdistincts == NULL) {
+				pdistincts = lhmslv_alloc();
+				lhmslv_put(pstate->pdistincts_by_group, slls_copy(pgroup_by_field_values), pdistincts,
+					FREE_ENTRY_KEY);
+			}
+			if (!lhmslv_has_key(pdistincts, pdistinct_field_values))
+				lhmslv_put(pdistincts, slls_copy(pdistinct_field_values), NULL, FREE_ENTRY_KEY);
+		}
+		slls_free(pgroup_by_field_values);
+		slls_free(pdistinct_field_values);
+		lrec_free(pinrec);
+		return NULL;
+	}
+	else {
+		sllv_t* poutrecs = sllv_alloc();
+		for (lhmslve_t* pa = pstate->pdistincts_by_group->phead; pa != NULL; pa = pa->pnext) {
+			lhmslv_t* pdistincts = pa->pvvalue;
+			lrec_t* poutrec = mapper_uniq_alloc_group_record(pstate, pa->key);
+			lrec_put(poutrec, pstate->output_field_name, mlr_alloc_string_from_int(pdistincts->num_occupied),
+				FREE_ENTRY_VALUE);
+			sllv_append(poutrecs, poutrec);
+		}
+		sllv_append(poutrecs, NULL);
+		return poutrecs;
+	}
+}
+
+// ----------------------------------------------------------------
+// Same as the above two but with a HyperLogLog sketch per group rather than a
+// hashmap of distinct values: memory is 2^precision bytes per group regardless
+// of the number of distinct values.
+static sllv_t* mapper_uniq_process_num_distinct_only_approx(
+	lrec_t* pinrec,
+	context_t* pctx,
+	void* pvstate)
+{
+	mapper_uniq_state_t* pstate = pvstate;
+	if (pinrec != NULL) {
+		unsigned long long hash;
+		if (mapper_uniq_hash_selected_values(pinrec, pstate->pgroup_by_field_names, &hash)) {
+			if (pstate->pnum_distinct_group_by_field_names == NULL) {
+				hll_add_hash(pstate->phll, hash);
+			} else {
+				slls_t* pgroup_by_field_values = mlr_reference_selected_values_from_record(pinrec,
+					pstate->pnum_distinct_group_by_field_names);
+				if (pgroup_by_field_values != NULL) {
+					hll_t* phll = lhmslv_get(pstate->pdistincts_by_group, pgroup_by_field_values);
+					if (phll == NULL) {
+						phll = hll_alloc(pstate->approx_precision);
+						lhmslv_put(pstate->pdistincts_by_group, slls_copy(pgroup_by_field_values), phll,
+							FREE_ENTRY_KEY);
+					}
+					hll_add_hash(phll, hash);
+					slls_free(pgroup_by_field_values);
+				}
+			}
+		}
+		lrec_free(pinrec);
+		return NULL;
+	}
+	else {
+		sllv_t* poutrecs = sllv_alloc();
+		if (pstate->pnum_distinct_group_by_field_names == NULL) {
+			lrec_t* poutrec = lrec_unbacked_alloc();
+			lrec_put(poutrec, pstate->output_field_name, mlr_alloc_string_from_ll(hll_estimate(pstate->phll)),
+				FREE_ENTRY_VALUE);
+			sllv_append(poutrecs, poutrec);
+		} else {
+			for (lhmslve_t* pa = pstate->pdistincts_by_group->phead; pa != NULL; pa = pa->pnext) {
+				lrec_t* poutrec = mapper_uniq_alloc_group_record(pstate, pa->key);
+				lrec_put(poutrec, pstate->output_field_name, mlr_alloc_string_from_ll(hll_estimate(pa->pvvalue)),
+					FREE_ENTRY_VALUE);
+				sllv_append(poutrecs, poutrec);
+			}
+		}
+		sllv_append(poutrecs, NULL);
+		return poutrecs;
+	}
+}
+
+// ----------------------------------------------------------------
 static sllv_t* mapper_uniq_process_with_counts(
 	lrec_t* pinrec,
 	context_t* pctx,
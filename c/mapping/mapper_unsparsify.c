@@ -10,14 +10,23 @@ typedef struct _mapper_unsparsify_state_t {
 	sllv_t* records;
 	char*   filler;
 	ap_state_t* pargp;
+	int     on_second_pass; // For --two-pass
+	slls_t* pfield_names;   // For -f
+	char**  field_names;
+	int     num_field_names;
 } mapper_unsparsify_state_t;
 
 static void      mapper_unsparsify_usage(FILE* o, char* argv0, char* verb);
 static mapper_t* mapper_unsparsify_parse_cli(int* pargi, int argc, char** argv,
 	cli_reader_opts_t* _, cli_writer_opts_t* __);
-static mapper_t* mapper_unsparsify_alloc(ap_state_t* pargp, char* filler);
+static mapper_t* mapper_unsparsify_alloc(ap_state_t* pargp, char* filler, slls_t* pfield_names);
 static void      mapper_unsparsify_free(mapper_t* pmapper, context_t* _);
 static sllv_t*   mapper_unsparsify_process(lrec_t* pinrec, context_t* pctx, void* pvstate);
+static sllv_t*   mapper_unsparsify_process_streaming(lrec_t* pinrec, context_t* pctx, void* pvstate);
+static int       mapper_unsparsify_two_pass(mapper_t* pmapper);
+static sllv_t*   mapper_unsparsify_process_two_pass(lrec_t* pinrec, context_t* pctx, void* pvstate);
+static void      mapper_unsparsify_ingest(lrec_t* pinrec, mapper_unsparsify_state_t* pstate);
+static void      mapper_unsparsify_fill(lrec_t* prec, mapper_unsparsify_state_t* pstate);
 
 // ----------------------------------------------------------------
 mapper_setup_t mapper_unsparsify_setup = {
@@ -25,6 +34,7 @@ mapper_setup_t mapper_unsparsify_setup = {
 	.pusage_func = mapper_unsparsify_usage,
 	.pparse_func = mapper_unsparsify_parse_cli,
 	.ignores_input = FALSE,
+	.ptwo_pass_func = mapper_unsparsify_two_pass,
 };
 
 // ----------------------------------------------------------------
@@ -33,20 +43,29 @@ static void mapper_unsparsify_usage(FILE* o, char* argv0, char* verb) {
 	fprintf(o, "Prints records with the union of field names over all input records.\n");
 	fprintf(o, "For field names absent in a given record but present in others, fills in\n");
 	fprintf(o, "a value. This verb retains all input before producing any output.\n");
+	fprintf(o, "With \"%s --two-pass\", input files are instead read twice, and not retained.\n", argv0);
 	fprintf(o, "\n");
 	fprintf(o, "Options:\n");
 	fprintf(o, "--fill-with {filler string}  What to fill absent fields with. Defaults to\n");
 	fprintf(o, "                             the empty string.\n");
+	fprintf(o, "-f {a,b,c}                   Specify the field names up front. Each record is\n");
+	fprintf(o, "                             given these fields, filled in if absent, first\n");
+	fprintf(o, "                             and in the order given; any other fields follow\n");
+	fprintf(o, "                             as they were. This is streaming: records are\n");
+	fprintf(o, "                             not retained.\n");
 	fprintf(o, "\n");
 	fprintf(o, "Example: if the input is two records, one being 'a=1,b=2' and the other\n");
 	fprintf(o, "being 'b=3,c=4', then the output is the two records 'a=1,b=2,c=' and\n");
 	fprintf(o, "'a=,b=3,c=4'.\n");
+	fprintf(o, "Example: with -f c,a,d and the same input, the output is the two records\n");
+	fprintf(o, "'c=,a=1,d=,b=2' and 'c=4,a=,d=,b=3'.\n");
 }
 
 static mapper_t* mapper_unsparsify_parse_cli(int* pargi, int argc, char** argv,
 	cli_reader_opts_t* _, cli_writer_opts_t* __)
 {
 	char* filler = "";
+	slls_t* pfield_names = NULL;
 
 	if ((argc - *pargi) < 1) {
 		mapper_unsparsify_usage(stderr, argv[0], argv[*pargi]);
@@ -57,17 +76,18 @@ static mapper_t* mapper_unsparsify_parse_cli(int* pargi, int argc, char** argv,
 
 	ap_state_t* pargp = ap_alloc();
 	ap_define_string_flag(pargp, "--fill-with", &filler);
+	ap_define_string_list_flag(pargp, "-f", &pfield_names);
 	if (!ap_parse(pargp, verb, pargi, argc, argv)) {
 		mapper_unsparsify_usage(stderr, argv[0], verb);
 		return NULL;
 	}
 
-	mapper_t* pmapper = mapper_unsparsify_alloc(pargp, filler);
+	mapper_t* pmapper = mapper_unsparsify_alloc(pargp, filler, pfield_names);
 	return pmapper;
 }
 
 // ----------------------------------------------------------------
-static mapper_t* mapper_unsparsify_alloc(ap_state_t* pargp, char* filler) {
+static mapper_t* mapper_unsparsify_alloc(ap_state_t* pargp, char* filler, slls_t* pfield_names) {
 	mapper_t* pmapper = mlr_malloc_or_die(sizeof(mapper_t));
 
 	mapper_unsparsify_state_t* pstate = mlr_malloc_or_die(sizeof(mapper_unsparsify_state_t));
@@ -75,11 +95,25 @@ static mapper_t* mapper_unsparsify_alloc(ap_state_t* pargp, char* filler) {
 	pstate->key_names = lhmsi_alloc();
 	pstate->filler = filler;
 	pstate->pargp = pargp;
+	pstate->on_second_pass = FALSE;
+	pstate->pfield_names = pfield_names;
+	pstate->field_names = NULL;
+	pstate->num_field_names = 0;
 
 	pmapper->pvstate       = pstate;
 	pmapper->pprocess_func = mapper_unsparsify_process;
 	pmapper->pfree_func    = mapper_unsparsify_free;
 
+	if (pfield_names != NULL) {
+		// Kept as an array since the streaming fill walks the names from last to first.
+		pstate->num_field_names = pfield_names->length;
+		pstate->field_names = mlr_malloc_or_die(pfield_names->length * sizeof(char*));
+		int i = 0;
+		for (sllse_t* pe = pfield_names->phead; pe != NULL; pe = pe->pnext)
+			pstate->field_names[i++] = pe->value;
+		pmapper->pprocess_func = mapper_unsparsify_process_streaming;
+	}
+
 	return pmapper;
 }
 
@@ -88,6 +122,9 @@ static void mapper_unsparsify_free(mapper_t* pmapper, context_t* _) {
 	// Free the container
 	sllv_free(pstate->records);
 	lhmsi_free(pstate->key_names);
+	if (pstate->pfield_names != NULL)
+		slls_free(pstate->pfield_names);
+	free(pstate->field_names);
 	ap_free(pstate->pargp);
 	free(pstate);
 	free(pmapper);
@@ -98,37 +135,88 @@ static sllv_t* mapper_unsparsify_process(lrec_t* pinrec, context_t* pctx, void*
 	mapper_unsparsify_state_t* pstate = pvstate;
 	if (pinrec != NULL) {
 		// Not end of stream.
-		for (lrece_t* pe = pinrec->phead; pe != NULL; pe = pe->pnext) {
-			if (!lhmsi_has_key(pstate->key_names, pe->key)) {
-				lhmsi_put(pstate->key_names, mlr_strdup_or_die(pe->key), 1, FREE_ENTRY_KEY);
-			}
-		}
+		mapper_unsparsify_ingest(pinrec, pstate);
 		// The caller will free the outrecs
 		sllv_append(pstate->records, pinrec);
 		return NULL;
 	}
 	else {
 		// End of stream.
-		sllv_t* poutrecs = sllv_alloc();
-		for (sllve_t* pe = pstate->records->phead; pe != NULL; pe = pe->pnext) {
-			lrec_t* pinrec = pe->pvvalue;
-			lrec_t* poutrec = lrec_unbacked_alloc();
-			for (lhmsie_t* pf = pstate->key_names->phead; pf != NULL; pf = pf->pnext) {
-				char* key = pf->key;
-				char* value = lrec_get(pinrec, key);
-				if (value == NULL) {
-					lrec_put(poutrec, mlr_strdup_or_die(key), pstate->filler, FREE_ENTRY_KEY);
-				} else {
-					lrec_put(poutrec, mlr_strdup_or_die(key), mlr_strdup_or_die(value),
-						FREE_ENTRY_KEY|FREE_ENTRY_VALUE);
-				}
-			}
-			sllv_append(poutrecs, poutrec);
-			// Free the void-star payload
-			lrec_free(pinrec);
-		}
+		sllv_t* poutrecs = pstate->records;
+		for (sllve_t* pe = poutrecs->phead; pe != NULL; pe = pe->pnext)
+			mapper_unsparsify_fill(pe->pvvalue, pstate);
+		pstate->records = sllv_alloc();
 
 		sllv_append(poutrecs, NULL);
 		return poutrecs;
 	}
 }
+
+// ----------------------------------------------------------------
+// With -f there is nothing to discover, so each record is filled and passed along as it arrives.
+// The names are linked in from the state rather than copied, which is safe since the mapper
+// outlives the writer.
+static sllv_t* mapper_unsparsify_process_streaming(lrec_t* pinrec, context_t* pctx, void* pvstate) {
+	mapper_unsparsify_state_t* pstate = pvstate;
+	if (pinrec == NULL) // End of stream
+		return sllv_single(NULL);
+
+	for (int i = pstate->num_field_names - 1; i >= 0; i--) {
+		char* key = pstate->field_names[i];
+		if (lrec_get(pinrec, key) == NULL)
+			lrec_prepend(pinrec, key, pstate->filler, NO_FREE);
+		else
+			lrec_move_to_head(pinrec, key);
+	}
+	return sllv_single(pinrec);
+}
+
+// ----------------------------------------------------------------
+// With --two-pass the input is read twice rather than retained: see mapper.h.
+static int mapper_unsparsify_two_pass(mapper_t* pmapper) {
+	mapper_unsparsify_state_t* pstate = pmapper->pvstate;
+	if (pstate->pfield_names != NULL) // Already streaming
+		return FALSE;
+	pmapper->pprocess_func = mapper_unsparsify_process_two_pass;
+	return TRUE;
+}
+
+static sllv_t* mapper_unsparsify_process_two_pass(lrec_t* pinrec, context_t* pctx, void* pvstate) {
+	mapper_unsparsify_state_t* pstate = pvstate;
+	if (!pstate->on_second_pass) {
+		if (pinrec != NULL) {
+			mapper_unsparsify_ingest(pinrec, pstate);
+			lrec_free(pinrec);
+		} else {
+			pstate->on_second_pass = TRUE;
+		}
+		return NULL;
+	} else if (pinrec != NULL) {
+		mapper_unsparsify_fill(pinrec, pstate);
+		return sllv_single(pinrec);
+	} else {
+		return sllv_single(NULL);
+	}
+}
+
+// ----------------------------------------------------------------
+static void mapper_unsparsify_ingest(lrec_t* pinrec, mapper_unsparsify_state_t* pstate) {
+	for (lrece_t* pe = pinrec->phead; pe != NULL; pe = pe->pnext) {
+		if (!lhmsi_has_key(pstate->key_names, pe->key)) {
+			lhmsi_put(pstate->key_names, mlr_strdup_or_die(pe->key), 1, FREE_ENTRY_KEY);
+		}
+	}
+}
+
+// Puts the record's fields in the order of first appearance over all records, filling in any
+// it lacks. The entries are relinked in place rather than copied, and filled-in keys point
+// into the key_names map, which outlives the writer.
+static void mapper_unsparsify_fill(lrec_t* prec, mapper_unsparsify_state_t* pstate) {
+	for (lhmsie_t* pf = pstate->key_names->phead; pf != NULL; pf = pf->pnext) {
+		char* key = pf->key;
+		if (lrec_get(prec, key) == NULL)
+			lrec_put(prec, key, pstate->filler, NO_FREE);
+		else
+			lrec_move_to_tail(prec, key);
+	}
+}
@@ -39,6 +39,7 @@ extern mapper_setup_t mapper_sec2gmtdate_setup;
 extern mapper_setup_t mapper_seqgen_setup;
 extern mapper_setup_t mapper_shuffle_setup;
 extern mapper_setup_t mapper_sort_setup;
+extern mapper_setup_t mapper_split_setup;
 extern mapper_setup_t mapper_stats1_setup;
 extern mapper_setup_t mapper_stats2_setup;
 extern mapper_setup_t mapper_step_setup;
@@ -52,4 +53,10 @@ extern mapper_setup_t mapper_unsparsify_setup;
 // Construction is in mlrcli.c.
 void mapper_chain_free(sllv_t* pmapper_chain, context_t* pctx);
 
+// Chain planning, also in mlrcli.c. Given a sort mapper followed by a head mapper, returns a
+// single mapper producing the same output while retaining only the records head will pass,
+// freeing the two; else returns NULL.
+mapper_t* mapper_sort_fuse_head(mapper_t* psort_mapper, mapper_t* phead_mapper);
+int mapper_head_get_params(mapper_t* pmapper, slls_t** ppgroup_by_field_names, unsigned long long* phead_count);
+
 #endif // MAPPERS_H
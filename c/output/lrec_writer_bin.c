@@ -0,0 +1,223 @@
+#include <stdlib.h>
+#include "lib/mlrutil.h"
+#include "lib/string_builder.h"
+#include "lib/binary_record_format.h"
+#include "containers/lhmsv.h"
+#include "output/lrec_writers.h"
+
+// See lib/binary_record_format.h for the format.
+
+// Past this many distinct schemas, e.g. for very heterogeneous data, the schema ids are reused
+// from the start, which keeps the reader's schema table bounded too.
+#define MAX_SCHEMAS 1024
+
+typedef struct _bin_writer_schema_t {
+	unsigned long long id;
+	int    num_keys;
+	char** keys;
+} bin_writer_schema_t;
+
+typedef struct _lrec_writer_bin_state_t {
+	int infer_types;
+	int wrote_header;
+
+	// Keyed by the record's key list: see make_schema_lookup_key.
+	lhmsv_t* pschemas_by_keys;
+	unsigned long long num_schemas;
+	bin_writer_schema_t* plast_schema;
+	string_builder_t* plookup_key;
+
+	unsigned char* payload;
+	size_t payload_length;
+	size_t payload_capacity;
+} lrec_writer_bin_state_t;
+
+static void lrec_writer_bin_free(lrec_writer_t* pwriter, context_t* pctx);
+static void lrec_writer_bin_process(void* pvstate, FILE* output_stream, lrec_t* prec, context_t* pctx);
+static bin_writer_schema_t* get_schema(lrec_writer_bin_state_t* pstate, FILE* output_stream, lrec_t* prec);
+static void free_schemas(lrec_writer_bin_state_t* pstate);
+static void write_varint(FILE* output_stream, unsigned long long u);
+static void payload_put_value(lrec_writer_bin_state_t* pstate, lrec_t* prec, lrece_t* pe);
+
+// ----------------------------------------------------------------
+lrec_writer_t* lrec_writer_bin_alloc(int infer_types) {
+	lrec_writer_t* plrec_writer = mlr_malloc_or_die(sizeof(lrec_writer_t));
+
+	lrec_writer_bin_state_t* pstate = mlr_malloc_or_die(sizeof(lrec_writer_bin_state_t));
+	pstate->infer_types      = infer_types;
+	pstate->wrote_header     = FALSE;
+	pstate->pschemas_by_keys = lhmsv_alloc();
+	pstate->num_schemas      = 0ULL;
+	pstate->plast_schema     = NULL;
+	pstate->plookup_key      = sb_alloc(256);
+	pstate->payload_capacity = 1024;
+	pstate->payload          = mlr_malloc_or_die(pstate->payload_capacity);
+	pstate->payload_length   = 0;
+
+	plrec_writer->pvstate       = (void*)pstate;
+	plrec_writer->pprocess_func = lrec_writer_bin_process;
+	plrec_writer->pfree_func    = lrec_writer_bin_free;
+
+	return plrec_writer;
+}
+
+static void lrec_writer_bin_free(lrec_writer_t* pwriter, context_t* pctx) {
+	lrec_writer_bin_state_t* pstate = pwriter->pvstate;
+	free_schemas(pstate);
+	lhmsv_free(pstate->pschemas_by_keys);
+	sb_free(pstate->plookup_key);
+	free(pstate->payload);
+	free(pstate);
+	free(pwriter);
+}
+
+// ----------------------------------------------------------------
+static void lrec_writer_bin_process(void* pvstate, FILE* output_stream, lrec_t* prec, context_t* pctx) {
+	if (prec == NULL)
+		return;
+	lrec_writer_bin_state_t* pstate = pvstate;
+
+	if (!pstate->wrote_header) {
+		fputs(BIN_MAGIC, output_stream);
+		fputc(BIN_VERSION, output_stream);
+		pstate->wrote_header = TRUE;
+	}
+
+	bin_writer_schema_t* pschema = get_schema(pstate, output_stream, prec);
+
+	pstate->payload_length = 0;
+	for (lrece_t* pe = prec->phead; pe != NULL; pe = pe->pnext)
+		payload_put_value(pstate, prec, pe);
+
+	fputc(BIN_BLOCK_RECORD, output_stream);
+	write_varint(output_stream, pschema->id);
+	write_varint(output_stream, pstate->payload_length);
+	fwrite(pstate->payload, 1, pstate->payload_length, output_stream);
+
+	lrec_free(prec); // end of baton-pass
+}
+
+// ----------------------------------------------------------------
+// Usually the record has the same keys as the one before, so that's checked before hashing.
+static bin_writer_schema_t* get_schema(lrec_writer_bin_state_t* pstate, FILE* output_stream, lrec_t* prec) {
+	bin_writer_schema_t* pschema = pstate->plast_schema;
+	if (pschema != NULL && pschema->num_keys == prec->field_count) {
+		int i = 0;
+		lrece_t* pe = prec->phead;
+		for ( ; pe != NULL; pe = pe->pnext, i++) {
+			if (!streq(pe->key, pschema->keys[i]))
+				break;
+		}
+		if (pe == NULL)
+			return pschema;
+	}
+
+	// Keys can't contain null characters, so each is written as its length and a colon followed by
+	// the key, for uniqueness: e.g. keys "a,b" and "c" vs. "a" and "b,c".
+	string_builder_t* psb = pstate->plookup_key;
+	psb->used_length = 0;
+	char length_buffer[32];
+	for (lrece_t* pe = prec->phead; pe != NULL; pe = pe->pnext) {
+		snprintf(length_buffer, sizeof(length_buffer), "%d:", (int)strlen(pe->key));
+		sb_append_string(psb, length_buffer);
+		sb_append_string(psb, pe->key);
+	}
+	sb_append_char(psb, 0);
+
+	pschema = lhmsv_get(pstate->pschemas_by_keys, psb->buffer);
+	if (pschema != NULL) {
+		pstate->plast_schema = pschema;
+		return pschema;
+	}
+
+	if (pstate->num_schemas >= MAX_SCHEMAS) {
+		free_schemas(pstate);
+		lhmsv_clear(pstate->pschemas_by_keys);
+		pstate->num_schemas = 0ULL;
+	}
+
+	pschema = mlr_malloc_or_die(sizeof(bin_writer_schema_t));
+	pschema->id       = pstate->num_schemas++;
+	pschema->num_keys = prec->field_count;
+	pschema->keys     = mlr_malloc_or_die(prec->field_count * sizeof(char*));
+	lhmsv_put(pstate->pschemas_by_keys, mlr_strdup_or_die(psb->buffer), pschema, FREE_ENTRY_KEY);
+	pstate->plast_schema = pschema;
+
+	fputc(BIN_BLOCK_SCHEMA, output_stream);
+	write_varint(output_stream, pschema->id);
+	write_varint(output_stream, pschema->num_keys);
+	int i = 0;
+	for (lrece_t* pe = prec->phead; pe != NULL; pe = pe->pnext, i++) {
+		int key_length = strlen(pe->key);
+		pschema->keys[i] = mlr_strdup_or_die(pe->key);
+		write_varint(output_stream, key_length);
+		fwrite(pe->key, 1, key_length, output_stream);
+	}
+
+	return pschema;
+}
+
+static void free_schemas(lrec_writer_bin_state_t* pstate) {
+	for (lhmsve_t* pe = pstate->pschemas_by_keys->phead; pe != NULL; pe = pe->pnext) {
+		bin_writer_schema_t* pschema = pe->pvvalue;
+		for (int i = 0; i < pschema->num_keys; i++)
+			free(pschema->keys[i]);
+		free(pschema->keys);
+		free(pschema);
+	}
+	pstate->plast_schema = NULL;
+}
+
+// ----------------------------------------------------------------
+static void write_varint(FILE* output_stream, unsigned long long u) {
+	unsigned char buffer[BIN_MAX_VARINT_LENGTH];
+	fwrite(buffer, 1, bin_put_varint(buffer, u), output_stream);
+}
+
+// Returns a pointer to where the caller may write up to the given number of bytes.
+static inline unsigned char* payload_reserve(lrec_writer_bin_state_t* pstate, size_t length) {
+	if (pstate->payload_length + length > pstate->payload_capacity) {
+		while (pstate->payload_length + length > pstate->payload_capacity)
+			pstate->payload_capacity *= 2;
+		pstate->payload = mlr_realloc_or_die(pstate->payload, pstate->payload_capacity);
+	}
+	return pstate->payload + pstate->payload_length;
+}
+
+static inline void payload_put_string(lrec_writer_bin_state_t* pstate, char* value) {
+	size_t length = strlen(value);
+	unsigned char* p = payload_reserve(pstate, BIN_MAX_VARINT_LENGTH + length);
+	int n = bin_put_varint(p, length);
+	memcpy(p + n, value, length);
+	pstate->payload_length += n + length;
+}
+
+// Values already known to be numeric -- e.g. computed by put, or sorted on by sort -nf -- are sent
+// as numbers. With infer_types, so are all other numeric-looking values.
+static void payload_put_value(lrec_writer_bin_state_t* pstate, lrec_t* prec, lrece_t* pe) {
+	char* value = (pe->value == NULL) ? "" : pe->value;
+	char value_type = LREC_VALUE_NON_NUMERIC;
+	lrec_typed_value_t typed_value;
+	if (pe->value != NULL && (pe->value_type != LREC_VALUE_UNINFERRED || pstate->infer_types))
+		value_type = lrec_get_typed_value(prec, pe, &typed_value);
+
+	unsigned char* p = payload_reserve(pstate, 1 + BIN_MAX_VARINT_LENGTH + BIN_FLOAT_LENGTH);
+	if (value_type == LREC_VALUE_INT) {
+		char canonical[32];
+		snprintf(canonical, sizeof(canonical), "%lld", typed_value.intv);
+		int is_canonical = streq(canonical, value);
+		p[0] = is_canonical ? BIN_VALUE_INT : BIN_VALUE_INT_TEXT;
+		pstate->payload_length += 1 + bin_put_varint(p + 1, bin_zigzag_encode(typed_value.intv));
+		if (!is_canonical)
+			payload_put_string(pstate, value);
+	} else if (value_type == LREC_VALUE_FLOAT) {
+		p[0] = BIN_VALUE_FLOAT_TEXT;
+		bin_put_float(p + 1, typed_value.fltv);
+		pstate->payload_length += 1 + BIN_FLOAT_LENGTH;
+		payload_put_string(pstate, value);
+	} else {
+		p[0] = BIN_VALUE_STRING;
+		pstate->payload_length += 1;
+		payload_put_string(pstate, value);
+	}
+}
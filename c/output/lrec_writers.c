@@ -37,6 +37,9 @@ lrec_writer_t*  lrec_writer_alloc(cli_writer_opts_t* popts) {
 				popts->pprint_barred);
 		}
 
+	} else if (streq(popts->ofile_fmt, "bin")) {
+		return lrec_writer_bin_alloc(popts->bin_infer_types);
+
 	} else {
 		return NULL;
 	}
@@ -7,15 +7,15 @@
 #include "containers/sllv.h"
 #include "output/lrec_writers.h"
 #include "output/file_output_mode.h"
+#include "output/output_stream_pool.h"
 #include "lib/context.h"
 
 // ----------------------------------------------------------------
 // This is the value struct for the hashmap:
 typedef struct _lrec_writer_and_fp_t {
 	lrec_writer_t* plrec_writer;
-	char* filename_or_command;
-	FILE* output_stream;
-	int is_popen;
+	pooled_output_stream_t* pstream;
+	int is_ended; // end of stream has been written
 } lrec_writer_and_fp_t;
 
 typedef struct _multi_lrec_writer_t {
@@ -4,16 +4,12 @@
 #include <stdio.h>
 #include "containers/lhmsv.h"
 #include "output/file_output_mode.h"
+#include "output/output_stream_pool.h"
 
 // ----------------------------------------------------------------
-// This is the value struct for the hashmap:
-typedef struct _fp_and_flag_t {
-	FILE* output_stream;
-	int is_popen;
-} fp_and_flag_t;
-
+// The hashmap values are pooled_output_stream_t*.
 typedef struct _multi_out_t {
-	lhmsv_t* pnames_to_fps;
+	lhmsv_t* pnames_to_streams;
 } multi_out_t;
 
 // ----------------------------------------------------------------
@@ -23,6 +19,9 @@ void  multi_out_close(multi_out_t* pmo);
 
 void  multi_out_free(multi_out_t* pmo);
 
-FILE* multi_out_get(multi_out_t* pmo, char* filename_or_command, file_output_mode_t file_output_mode);
+// The caller should get the FILE* using pooled_output_stream_get, and call pooled_output_stream_note_record
+// after writing to it.
+pooled_output_stream_t* multi_out_get(multi_out_t* pmo, char* filename_or_command,
+	file_output_mode_t file_output_mode);
 
 #endif // MULTI_OUT_H
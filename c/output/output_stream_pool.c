@@ -0,0 +1,176 @@
+#include <errno.h>
+#include "lib/mlrutil.h"
+#include "lib/mlr_globals.h"
+#include "output/output_stream_pool.h"
+
+static int       max_open    = DEFAULT_MAX_OPEN_OUTPUT_FILES;
+static long long flush_every = DEFAULT_OUTPUT_FLUSH_EVERY;
+static size_t    buffer_size = DEFAULT_OUTPUT_BUFFER_SIZE;
+
+// Open files (not pipes), most recently used at the head.
+static pooled_output_stream_t* popen_head = NULL;
+static pooled_output_stream_t* popen_tail = NULL;
+static int num_open = 0;
+
+static void lru_unlink(pooled_output_stream_t* pstream);
+static void lru_push_head(pooled_output_stream_t* pstream);
+static int  evict_least_recently_used();
+static FILE* try_open(pooled_output_stream_t* pstream);
+
+// ----------------------------------------------------------------
+void output_stream_pool_set_max_open(int new_max_open) {
+	max_open = new_max_open;
+}
+
+void output_stream_pool_set_flush_every(long long new_flush_every) {
+	flush_every = new_flush_every;
+}
+
+void output_stream_pool_set_buffer_size(size_t new_buffer_size) {
+	buffer_size = new_buffer_size;
+}
+
+// ----------------------------------------------------------------
+pooled_output_stream_t* pooled_output_stream_alloc(char* filename_or_command, file_output_mode_t file_output_mode) {
+	pooled_output_stream_t* pstream = mlr_malloc_or_die(sizeof(pooled_output_stream_t));
+	pstream->filename_or_command    = mlr_strdup_or_die(filename_or_command);
+	pstream->file_output_mode       = file_output_mode;
+	pstream->output_stream          = NULL;
+	pstream->buffer                 = NULL;
+	pstream->num_unflushed_records  = 0LL;
+	pstream->open_error_preposition = "of";
+	pstream->pprev                  = NULL;
+	pstream->pnext                  = NULL;
+	return pstream;
+}
+
+void pooled_output_stream_free(pooled_output_stream_t* pstream) {
+	if (pstream == NULL)
+		return;
+	pooled_output_stream_close(pstream);
+	free(pstream->filename_or_command);
+	free(pstream);
+}
+
+// ----------------------------------------------------------------
+FILE* pooled_output_stream_get(pooled_output_stream_t* pstream) {
+	if (pstream->output_stream != NULL) {
+		if (pstream->file_output_mode != MODE_PIPE && pstream != popen_head) {
+			lru_unlink(pstream);
+			lru_push_head(pstream);
+		}
+		return pstream->output_stream;
+	}
+
+	if (pstream->file_output_mode != MODE_PIPE) {
+		while (num_open >= max_open && evict_least_recently_used())
+			;
+	}
+
+	FILE* output_stream = try_open(pstream);
+	// Out of file descriptors, e.g. from a ulimit lower than --max-open-files: make room.
+	while (output_stream == NULL && (errno == EMFILE || errno == ENFILE) && evict_least_recently_used())
+		output_stream = try_open(pstream);
+
+	if (output_stream == NULL) {
+		int is_pipe = pstream->file_output_mode == MODE_PIPE;
+		perror(is_pipe ? "popen" : "fopen");
+		fprintf(stderr, "%s: failed %s for %s %s \"%s\".\n",
+			MLR_GLOBALS.bargv0, is_pipe ? "popen" : "fopen", get_mode_desc(pstream->file_output_mode),
+			pstream->open_error_preposition, pstream->filename_or_command);
+		exit(1);
+	}
+
+	if (buffer_size > 0) {
+		pstream->buffer = mlr_malloc_or_die(buffer_size);
+		setvbuf(output_stream, pstream->buffer, _IOFBF, buffer_size);
+	}
+	pstream->output_stream = output_stream;
+	pstream->num_unflushed_records = 0LL;
+
+	if (pstream->file_output_mode != MODE_PIPE) {
+		lru_push_head(pstream);
+		num_open++;
+		// If it's closed to make room for others, pick up where it left off.
+		pstream->file_output_mode = MODE_APPEND;
+	}
+	return output_stream;
+}
+
+static FILE* try_open(pooled_output_stream_t* pstream) {
+	errno = 0;
+	if (pstream->file_output_mode == MODE_PIPE)
+		return popen(pstream->filename_or_command, get_mode_string(pstream->file_output_mode));
+	else
+		return fopen(pstream->filename_or_command, get_mode_string(pstream->file_output_mode));
+}
+
+// ----------------------------------------------------------------
+void pooled_output_stream_note_record(pooled_output_stream_t* pstream, int do_flush) {
+	if (!do_flush || pstream->output_stream == NULL)
+		return;
+	pstream->num_unflushed_records++;
+	if (pstream->num_unflushed_records >= flush_every) {
+		fflush(pstream->output_stream);
+		pstream->num_unflushed_records = 0LL;
+	}
+}
+
+// ----------------------------------------------------------------
+void pooled_output_stream_close(pooled_output_stream_t* pstream) {
+	if (pstream->output_stream == NULL)
+		return;
+
+	if (pstream->file_output_mode == MODE_PIPE) {
+		// Sadly, pclose returns an error even on well-formed commands. For example, if the popened
+		// command was "grep nonesuch" and the string "nonesuch" was not encountered, grep returns
+		// non-zero and popen flags it as an error. We cannot differentiate these from genuine
+		// failure cases so the best choice is to simply call pclose and ignore error codes.
+		// If a piped-to command does fail then it should have some output to stderr which the
+		// user can take advantage of.
+		(void)pclose(pstream->output_stream);
+	} else {
+		lru_unlink(pstream);
+		num_open--;
+		if (fclose(pstream->output_stream) != 0) {
+			perror("fclose");
+			fprintf(stderr, "%s: fclose error on \"%s\".\n", MLR_GLOBALS.bargv0, pstream->filename_or_command);
+			exit(1);
+		}
+	}
+	pstream->output_stream = NULL;
+	free(pstream->buffer);
+	pstream->buffer = NULL;
+}
+
+// ----------------------------------------------------------------
+// Returns FALSE if there are no open files to close.
+static int evict_least_recently_used() {
+	if (popen_tail == NULL)
+		return FALSE;
+	pooled_output_stream_close(popen_tail);
+	return TRUE;
+}
+
+static void lru_unlink(pooled_output_stream_t* pstream) {
+	if (pstream->pprev == NULL)
+		popen_head = pstream->pnext;
+	else
+		pstream->pprev->pnext = pstream->pnext;
+	if (pstream->pnext == NULL)
+		popen_tail = pstream->pprev;
+	else
+		pstream->pnext->pprev = pstream->pprev;
+	pstream->pprev = NULL;
+	pstream->pnext = NULL;
+}
+
+static void lru_push_head(pooled_output_stream_t* pstream) {
+	pstream->pprev = NULL;
+	pstream->pnext = popen_head;
+	if (popen_head == NULL)
+		popen_tail = pstream;
+	else
+		popen_head->pprev = pstream;
+	popen_head = pstream;
+}
@@ -0,0 +1,56 @@
+// ================================================================
+// Output streams for redirected output -- tee/emit/print/dump > "file" and the split verb --
+// shared across all of these so that the number of files open at a time can be bounded.
+//
+// Files are kept open on a least-recently-used basis. When opening one more would exceed the
+// limit, or the open fails for lack of file descriptors, the least recently used file is flushed
+// and closed; it's transparently reopened in append mode the next time it's written to. Pipes
+// can't be reopened, so they're never closed early, and they don't count against the limit.
+//
+// Each stream has its own write buffer. With flushing requested (the default; see put
+// --no-fflush), each stream is flushed after every so many records written to it.
+// ================================================================
+
+#ifndef OUTPUT_STREAM_POOL_H
+#define OUTPUT_STREAM_POOL_H
+
+#include <stdio.h>
+#include "output/file_output_mode.h"
+
+#define DEFAULT_MAX_OPEN_OUTPUT_FILES 256
+#define DEFAULT_OUTPUT_FLUSH_EVERY 1
+#define DEFAULT_OUTPUT_BUFFER_SIZE (64 * 1024)
+
+typedef struct _pooled_output_stream_t {
+	char*              filename_or_command;
+	file_output_mode_t file_output_mode; // MODE_APPEND once the file has been opened
+	FILE*              output_stream;    // NULL while not open
+	char*              buffer;
+	long long          num_unflushed_records;
+	char*              open_error_preposition; // "failed fopen for write of/on ..."
+
+	// Doubly linked list of open files, most recently used at the head.
+	struct _pooled_output_stream_t* pprev;
+	struct _pooled_output_stream_t* pnext;
+} pooled_output_stream_t;
+
+// Settings for all streams, from the main command line.
+void output_stream_pool_set_max_open(int max_open);
+void output_stream_pool_set_flush_every(long long flush_every);
+void output_stream_pool_set_buffer_size(size_t buffer_size);
+
+pooled_output_stream_t* pooled_output_stream_alloc(char* filename_or_command, file_output_mode_t file_output_mode);
+// Closes the stream if it's open.
+void pooled_output_stream_free(pooled_output_stream_t* pstream);
+
+// Returns the stream, opening it if need be. The return value is valid until the next call to
+// this function for any stream.
+FILE* pooled_output_stream_get(pooled_output_stream_t* pstream);
+
+// To be called after each record (or print/dump output) written to the stream.
+void pooled_output_stream_note_record(pooled_output_stream_t* pstream, int do_flush);
+
+// Flushes and closes the stream, if open. A later pooled_output_stream_get reopens it for append.
+void pooled_output_stream_close(pooled_output_stream_t* pstream);
+
+#endif // OUTPUT_STREAM_POOL_H
@@ -1,26 +1,81 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
 
 #include "lib/mlrutil.h"
 #include "lib/mlr_globals.h"
+#include "lib/mlr_arch.h"
+#include "lib/mtrand.h"
 #include "containers/lrec.h"
 #include "containers/sllv.h"
 #include "input/lrec_readers.h"
 #include "mapping/mappers.h"
 #include "output/lrec_writers.h"
 
-static int do_stream_chained_in_place(context_t* pctx, cli_opts_t* popts);
-static int do_stream_chained_to_stdout(context_t* pctx, sllv_t* pmapper_list, cli_opts_t* popts);
+// ----------------------------------------------------------------
+// For --profile. Each stage -- the record reader, each mapper in the chain, and the record
+// writer -- accumulates the wall time spent in its own calls, not counting calls to the stages
+// downstream of it, and the allocations made through mlr_malloc_or_die and friends during them.
+// CPU time is only for the whole process: the per-thread and per-process CPU clocks are system
+// calls, too slow to read around every call.
+
+typedef struct _stage_profile_t {
+	double wall_seconds;
+	unsigned long long num_allocs;
+	long long records_in;
+	long long records_out;
+	long long num_bytes; // read for the reader, written for the writer; -1 if not known
+} stage_profile_t;
+
+typedef struct _profile_mark_t {
+	double wall_seconds;
+	unsigned long long num_allocs;
+} profile_mark_t;
+
+typedef struct _stream_profile_t {
+	profile_mark_t   start;
+	stage_profile_t  reader;
+	stage_profile_t* mapper_stages; // one per mapper in the chain
+	int              num_mapper_stages;
+	stage_profile_t  writer;
+	off_t            output_start_offset; // -1 unless the output is a regular file
+} stream_profile_t;
+
+static stream_profile_t* stream_profile_alloc(int num_mapper_stages);
+static void stream_profile_free(stream_profile_t* pprofile);
+static void stream_profile_note_input(stream_profile_t* pprofile, char* filename);
+static void stream_profile_note_output_start(stream_profile_t* pprofile, FILE* output_stream);
+static void stream_profile_note_output_end(stream_profile_t* pprofile, FILE* output_stream);
+static void stream_profile_print(stream_profile_t* pprofile, slls_t* pmapper_verbs, context_t* pctx, FILE* o);
+static void profile_mark(profile_mark_t* pmark);
+static void stage_profile_add(stage_profile_t* pstage, profile_mark_t* pstart);
+
+// ----------------------------------------------------------------
+static int do_stream_chained_in_place(context_t* pctx, cli_opts_t* popts, stream_profile_t** ppprofile);
+static int do_file_in_place(char* filename, context_t* pctx, cli_opts_t* popts, stream_profile_t** ppprofile);
+static int do_file_to_temp(char* filename, char* tempname, context_t* pctx, cli_opts_t* popts,
+	stream_profile_t** ppprofile);
+#if MLR_ARCH_FORK_ENABLED
+static int do_stream_chained_in_place_parallel(context_t* pctx, cli_opts_t* popts);
+#endif
+static int do_stream_chained_to_stdout(context_t* pctx, sllv_t* pmapper_list, cli_opts_t* popts,
+	stream_profile_t** ppprofile);
 
 static int do_file_chained(char* filename, context_t* pctx,
 	lrec_reader_t* plrec_reader, sllv_t* pmapper_list, lrec_writer_t* plrec_writer, FILE* output_stream,
-	cli_opts_t* popts);
+	cli_opts_t* popts, stream_profile_t* pprofile);
+static int do_first_pass(context_t* pctx, lrec_reader_t* plrec_reader, sllv_t* pmapper_list,
+	lrec_writer_t* plrec_writer, FILE* output_stream, cli_opts_t* popts, stream_profile_t* pprofile);
 
-static sllv_t* chain_map(lrec_t* pinrec, context_t* pctx, sllve_t* pmapper_list_head);
+static sllv_t* chain_map(lrec_t* pinrec, context_t* pctx, sllve_t* pmapper_list_head, stage_profile_t* pstage);
 
 static void drive_lrec(lrec_t* pinrec, context_t* pctx, sllve_t* pmapper_list_head, lrec_writer_t* plrec_writer,
-	FILE* output_stream);
+	FILE* output_stream, stream_profile_t* pprofile);
+static void drive_writer(lrec_t* poutrec, context_t* pctx, lrec_writer_t* plrec_writer, FILE* output_stream,
+	stream_profile_t* pprofile);
 
 typedef void progress_indicator_t(context_t* pctx, long long nr_progress_mod);
 static void null_progress_indicator(context_t* pctx, long long nr_progress_mod);
@@ -28,11 +83,24 @@ static void stderr_progress_indicator(context_t* pctx, long long nr_progress_mod
 
 // ----------------------------------------------------------------
 int do_stream_chained(context_t* pctx, sllv_t* pmapper_list, cli_opts_t* popts) {
+	// For in-place mode the profile is allocated once the mapper chain has been.
+	stream_profile_t* pprofile = NULL;
+	if (popts->do_profile && !popts->do_in_place) {
+		pprofile = stream_profile_alloc(pmapper_list->length);
+	}
+
+	int ok;
 	if (popts->do_in_place) {
-		return do_stream_chained_in_place(pctx, popts);
+		ok = do_stream_chained_in_place(pctx, popts, &pprofile);
 	} else {
-		return do_stream_chained_to_stdout(pctx, pmapper_list, popts);
+		ok = do_stream_chained_to_stdout(pctx, pmapper_list, popts, &pprofile);
 	}
+
+	if (pprofile != NULL) {
+		stream_profile_print(pprofile, popts->mapper_verbs, pctx, stderr);
+		stream_profile_free(pprofile);
+	}
+	return ok;
 }
 
 // ----------------------------------------------------------------
@@ -47,76 +115,305 @@ int do_stream_chained(context_t* pctx, sllv_t* pmapper_list, cli_opts_t* popts)
 // over again to reconstruct mappers for each file, this approach leads to greater code
 // stability.
 
-static int do_stream_chained_in_place(context_t* pctx, cli_opts_t* popts) {
+static int do_stream_chained_in_place(context_t* pctx, cli_opts_t* popts, stream_profile_t** ppprofile) {
 	MLR_INTERNAL_CODING_ERROR_IF(popts->filenames == NULL);
 	MLR_INTERNAL_CODING_ERROR_IF(popts->filenames->length == 0);
 
+#if MLR_ARCH_FORK_ENABLED
+	if (popts->in_place_jobs > 1 && popts->filenames->length > 1)
+		return do_stream_chained_in_place_parallel(pctx, popts);
+#endif
+
 	int ok = 1;
 
 	// Read from each file name in turn
 	for (sllse_t* pe = popts->filenames->phead; pe != NULL; pe = pe->pnext) {
+		ok = do_file_in_place(pe->value, pctx, popts, ppprofile) && ok;
+	}
 
-		// Allocate reader, mappers, and writer individually for each file name.
-		// This way CSV headers appear in each file, head -n 10 puts 10 rows for
-		// each output file, and so on.
-		lrec_reader_t* plrec_reader = lrec_reader_alloc_or_die(&popts->reader_opts);
-		lrec_writer_t* plrec_writer = lrec_writer_alloc_or_die(&popts->writer_opts);
+	return ok;
+}
 
-		int argi = popts->mapper_argb;
-		int unused;
-		sllv_t* pmapper_list = cli_parse_mappers(popts->argv, &argi, popts->argc, popts, &unused);
-		MLR_INTERNAL_CODING_ERROR_IF(pmapper_list->length < 1); // Should not have been allowed by the CLI parser.
+// ----------------------------------------------------------------
+static int do_file_in_place(char* filename, context_t* pctx, cli_opts_t* popts, stream_profile_t** ppprofile) {
+	char* tempname = alloc_suffixed_temp_file_name(filename);
+	int ok = do_file_to_temp(filename, tempname, pctx, popts, ppprofile);
+	int rc = rename(tempname, filename);
+	if (rc != 0) {
+		perror("rename");
+		fprintf(stderr, "%s: Could not rename \"%s\" to \"%s\".\n",
+			MLR_GLOBALS.bargv0, tempname, filename);
+		exit(1);
+	}
+	free(tempname);
+	return ok;
+}
 
-		char* filename = pe->value;
-		char* tempname = alloc_suffixed_temp_file_name(filename);
-		FILE* output_stream = fopen(tempname, "wb");
-		if (output_stream == NULL) {
-			perror("fopen");
-			fprintf(stderr, "%s: Could not open \"%s\" for write.\n",
-				MLR_GLOBALS.bargv0, tempname);
+// Processes the file, writing the output to the temp file.
+static int do_file_to_temp(char* filename, char* tempname, context_t* pctx, cli_opts_t* popts,
+	stream_profile_t** ppprofile)
+{
+	// Allocate reader, mappers, and writer individually for each file name.
+	// This way CSV headers appear in each file, head -n 10 puts 10 rows for
+	// each output file, and so on.
+	lrec_reader_t* plrec_reader = lrec_reader_alloc_or_die(&popts->reader_opts);
+	lrec_writer_t* plrec_writer = lrec_writer_alloc_or_die(&popts->writer_opts);
+
+	int argi = popts->mapper_argb;
+	int unused;
+	sllv_t* pmapper_list = cli_parse_mappers(popts->argv, &argi, popts->argc, popts, &unused);
+	MLR_INTERNAL_CODING_ERROR_IF(pmapper_list->length < 1); // Should not have been allowed by the CLI parser.
+	if (popts->do_profile && *ppprofile == NULL)
+		*ppprofile = stream_profile_alloc(pmapper_list->length);
+	stream_profile_t* pprofile = *ppprofile;
+
+	FILE* output_stream = fopen(tempname, "wb");
+	if (output_stream == NULL) {
+		perror("fopen");
+		fprintf(stderr, "%s: Could not open \"%s\" for write.\n",
+			MLR_GLOBALS.bargv0, tempname);
+		exit(1);
+	}
+
+	pctx->filenum++;
+	pctx->filename = filename;
+	pctx->fnr = 0;
+
+	int ok = do_file_chained(filename, pctx, plrec_reader, pmapper_list, plrec_writer,
+		output_stream, popts, pprofile);
+
+	// For in-place mode, there's no breaking from the loop over input files. Just an early
+	// return from the mapper chain, which has already just happened.
+	if (pctx->force_eof == TRUE) // e.g. mlr head
+		pctx->force_eof = FALSE;
+
+	// Mappers and writers receive end-of-stream notifications via null input record.
+	// Do that, now that data from the input file have been exhausted.
+	drive_lrec(NULL, pctx, pmapper_list->phead, plrec_writer, output_stream, pprofile);
+	// Drain the pretty-printer.
+	drive_writer(NULL, pctx, plrec_writer, output_stream, pprofile);
+
+	if (pprofile != NULL) {
+		fflush(output_stream);
+		pprofile->output_start_offset = 0;
+		stream_profile_note_output_end(pprofile, output_stream);
+	}
+	fclose(output_stream);
+
+	plrec_reader->pfree_func(plrec_reader);
+	plrec_writer->pfree_func(plrec_writer, pctx);
+
+	mapper_chain_free(pmapper_list, pctx);
+
+	return ok;
+}
+
+#if MLR_ARCH_FORK_ENABLED
+// ----------------------------------------------------------------
+// For -I with --jobs: each file is processed as above, but in a child process, with up to
+// that many at a time. The children's standard output and standard error (e.g. from put
+// print statements, or error messages) are captured in temp files and passed along in the
+// order of the file names on the command line, so output is the same from run to run.
+//
+// The children write temp files, which the parent renames over the originals, also in file-name
+// order. As in the sequential case, a failure on one file stops processing there: the files
+// after it are left unmodified, even if their children had already finished, and the output
+// of those children is discarded.
+//
+// Since each child starts from the parent's context, FILENUM is as in the sequential case
+// while NR counts only within each file. Likewise each child would start from the parent's
+// random-number state, giving every file the same urand() sequence; so each is reseeded, from
+// --seed plus the file's index if given. Output is then the same from run to run, but not the
+// same as in the sequential case, where each file continues the previous file's sequence.
+
+typedef struct _in_place_job_t {
+	char* filename;
+	char* tempname;
+	pid_t pid;
+	FILE* pstdout_capture;
+	FILE* pstderr_capture;
+	int   is_done;
+	int   wait_status;
+} in_place_job_t;
+
+static void in_place_job_start(in_place_job_t* pjob, int filenum, context_t* pctx, cli_opts_t* popts);
+static int  in_place_job_report(in_place_job_t* pjob);
+static void in_place_job_cancel(in_place_job_t* pjob);
+static void copy_stream(FILE* pfrom, FILE* pto);
+
+static int do_stream_chained_in_place_parallel(context_t* pctx, cli_opts_t* popts) {
+	int num_jobs = popts->filenames->length;
+	in_place_job_t* jobs = mlr_malloc_or_die(num_jobs * sizeof(in_place_job_t));
+	int j = 0;
+	for (sllse_t* pe = popts->filenames->phead; pe != NULL; pe = pe->pnext, j++) {
+		jobs[j].filename        = pe->value;
+		jobs[j].tempname        = NULL;
+		jobs[j].pid             = 0;
+		jobs[j].pstdout_capture = NULL;
+		jobs[j].pstderr_capture = NULL;
+		jobs[j].is_done         = FALSE;
+		jobs[j].wait_status     = 0;
+	}
+
+	// Jobs which have finished but which are still awaiting their turn to be reported hold on
+	// to their capture files. Limit how far ahead of the earliest unreported job we can get,
+	// so the number of open files is bounded.
+	int max_running = popts->in_place_jobs;
+	int max_unreported = 8 * max_running;
+
+	int ok = 1;
+	int num_started = 0;
+	int num_running = 0;
+	int num_reported = 0;
+	while (num_reported < num_jobs) {
+		while (num_running < max_running && num_started < num_jobs
+			&& num_started - num_reported < max_unreported)
+		{
+			in_place_job_start(&jobs[num_started], num_started, pctx, popts);
+			num_started++;
+			num_running++;
+		}
+
+		int wait_status = 0;
+		pid_t pid = wait(&wait_status);
+		if (pid < 0) {
+			perror("wait");
+			fprintf(stderr, "%s: wait for in-place child process failed.\n", MLR_GLOBALS.bargv0);
 			exit(1);
 		}
+		for (j = num_reported; j < num_started; j++) {
+			if (jobs[j].pid == pid && !jobs[j].is_done) {
+				jobs[j].is_done = TRUE;
+				jobs[j].wait_status = wait_status;
+				num_running--;
+				break;
+			}
+		}
 
-		pctx->filenum++;
-		pctx->filename = filename;
-		pctx->fnr = 0;
+		while (ok && num_reported < num_started && jobs[num_reported].is_done) {
+			ok = in_place_job_report(&jobs[num_reported]);
+			num_reported++;
+		}
+		if (!ok) {
+			for (j = num_reported; j < num_started; j++)
+				in_place_job_cancel(&jobs[j]);
+			break;
+		}
+	}
 
-		ok = do_file_chained(filename, pctx, plrec_reader, pmapper_list, plrec_writer,
-			output_stream, popts) && ok;
+	free(jobs);
+	return ok;
+}
 
-		// For in-place mode, there's no breaking from the loop over input files. Just an early
-		// return from the mapper chain, which has already just happened.
-		if (pctx->force_eof == TRUE) // e.g. mlr head
-			pctx->force_eof = FALSE;
+static void in_place_job_start(in_place_job_t* pjob, int filenum, context_t* pctx, cli_opts_t* popts) {
+	pjob->tempname = alloc_suffixed_temp_file_name(pjob->filename);
+	pjob->pstdout_capture = tmpfile();
+	pjob->pstderr_capture = tmpfile();
+	if (pjob->pstdout_capture == NULL || pjob->pstderr_capture == NULL) {
+		perror("tmpfile");
+		fprintf(stderr, "%s: could not create temp file for in-place processing of \"%s\".\n",
+			MLR_GLOBALS.bargv0, pjob->filename);
+		exit(1);
+	}
 
-		// Mappers and writers receive end-of-stream notifications via null input record.
-		// Do that, now that data from the input file have been exhausted.
-		drive_lrec(NULL, pctx, pmapper_list->phead, plrec_writer, output_stream);
-		// Drain the pretty-printer.
-		plrec_writer->pprocess_func(plrec_writer->pvstate, output_stream, NULL, pctx);
+	// Else buffered output would be written once by the parent and again by the child.
+	fflush(stdout);
+	fflush(stderr);
 
-		fclose(output_stream);
-		int rc = rename(tempname, filename);
-		if (rc != 0) {
-			perror("rename");
-			fprintf(stderr, "%s: Could not rename \"%s\" to \"%s\".\n",
-				MLR_GLOBALS.bargv0, tempname, filename);
-			exit(1);
+	pid_t pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		fprintf(stderr, "%s: could not fork for in-place processing of \"%s\".\n",
+			MLR_GLOBALS.bargv0, pjob->filename);
+		exit(1);
+	}
+
+	if (pid == 0) {
+		dup2(fileno(pjob->pstdout_capture), fileno(stdout));
+		dup2(fileno(pjob->pstderr_capture), fileno(stderr));
+
+		if (popts->have_rand_seed)
+			mtrand_init(popts->rand_seed + (unsigned)filenum);
+		else
+			mtrand_init_default();
+
+		stream_profile_t* pprofile = NULL;
+		pctx->filenum = filenum;
+		int ok = do_file_to_temp(pjob->filename, pjob->tempname, pctx, popts, &pprofile);
+		if (pprofile != NULL) {
+			stream_profile_print(pprofile, popts->mapper_verbs, pctx, stderr);
+			stream_profile_free(pprofile);
 		}
-		free(tempname);
+		exit(ok ? 0 : 1);
+	}
 
-		plrec_reader->pfree_func(plrec_reader);
-		plrec_writer->pfree_func(plrec_writer, pctx);
+	pjob->pid = pid;
+}
 
-		mapper_chain_free(pmapper_list, pctx);
+static int in_place_job_report(in_place_job_t* pjob) {
+	fflush(stdout);
+	copy_stream(pjob->pstdout_capture, stdout);
+	fflush(stderr);
+	copy_stream(pjob->pstderr_capture, stderr);
+	fclose(pjob->pstdout_capture);
+	fclose(pjob->pstderr_capture);
+	pjob->pstdout_capture = NULL;
+	pjob->pstderr_capture = NULL;
+
+	int ok = 0;
+	if (WIFEXITED(pjob->wait_status)) {
+		ok = WEXITSTATUS(pjob->wait_status) == 0;
+	} else if (WIFSIGNALED(pjob->wait_status)) {
+		fprintf(stderr, "%s: in-place processing of \"%s\" was terminated by signal %d.\n",
+			MLR_GLOBALS.bargv0, pjob->filename, WTERMSIG(pjob->wait_status));
 	}
 
+	if (ok) {
+		if (rename(pjob->tempname, pjob->filename) != 0) {
+			perror("rename");
+			fprintf(stderr, "%s: Could not rename \"%s\" to \"%s\".\n",
+				MLR_GLOBALS.bargv0, pjob->tempname, pjob->filename);
+			ok = 0;
+		}
+	} else {
+		(void)unlink(pjob->tempname);
+	}
+	free(pjob->tempname);
+	pjob->tempname = NULL;
 	return ok;
 }
 
+// For a job after a failed one: stops the child if it's still running, and discards its output.
+static void in_place_job_cancel(in_place_job_t* pjob) {
+	if (!pjob->is_done) {
+		kill(pjob->pid, SIGTERM);
+		while (waitpid(pjob->pid, NULL, 0) < 0 && errno == EINTR)
+			;
+	}
+	fclose(pjob->pstdout_capture);
+	fclose(pjob->pstderr_capture);
+	(void)unlink(pjob->tempname);
+	free(pjob->tempname);
+}
+
+static void copy_stream(FILE* pfrom, FILE* pto) {
+	char buf[8192];
+	rewind(pfrom);
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), pfrom)) > 0)
+		fwrite(buf, 1, n, pto);
+	fflush(pto);
+}
+#endif // MLR_ARCH_FORK_ENABLED
+
 // ----------------------------------------------------------------
-static int do_stream_chained_to_stdout(context_t* pctx, sllv_t* pmapper_list, cli_opts_t* popts) {
+static int do_stream_chained_to_stdout(context_t* pctx, sllv_t* pmapper_list, cli_opts_t* popts,
+	stream_profile_t** ppprofile)
+{
 	FILE* output_stream = stdout;
+	stream_profile_t* pprofile = *ppprofile;
+	if (pprofile != NULL)
+		stream_profile_note_output_start(pprofile, output_stream);
 
 	lrec_reader_t* plrec_reader = lrec_reader_alloc_or_die(&popts->reader_opts);
 	lrec_writer_t* plrec_writer = lrec_writer_alloc_or_die(&popts->writer_opts);
@@ -132,8 +429,12 @@ static int do_stream_chained_to_stdout(context_t* pctx, sllv_t* pmapper_list, cl
 		pctx->filename = "(stdin)";
 		pctx->fnr = 0;
 		ok = do_file_chained("-", pctx, plrec_reader, pmapper_list, plrec_writer,
-			output_stream, popts) && ok;
+			output_stream, popts, pprofile) && ok;
 	} else {
+		if (popts->do_two_pass)
+			ok = do_first_pass(pctx, plrec_reader, pmapper_list, plrec_writer, output_stream, popts,
+				pprofile) && ok;
+
 		// Read from each file name in turn
 		for (sllse_t* pe = popts->filenames->phead; pe != NULL; pe = pe->pnext) {
 			char* filename = pe->value;
@@ -141,7 +442,7 @@ static int do_stream_chained_to_stdout(context_t* pctx, sllv_t* pmapper_list, cl
 			pctx->filename = filename;
 			pctx->fnr = 0;
 			ok = do_file_chained(filename, pctx, plrec_reader, pmapper_list, plrec_writer,
-				output_stream, popts) && ok;
+				output_stream, popts, pprofile) && ok;
 			if (pctx->force_eof == TRUE) // e.g. mlr head
 				break;
 		}
@@ -149,10 +450,15 @@ static int do_stream_chained_to_stdout(context_t* pctx, sllv_t* pmapper_list, cl
 
 	// Mappers and writers receive end-of-stream notifications via null input record.
 	// Do that, now that data from all input file(s) have been exhausted.
-	drive_lrec(NULL, pctx, pmapper_list->phead, plrec_writer, output_stream);
+	drive_lrec(NULL, pctx, pmapper_list->phead, plrec_writer, output_stream, pprofile);
 
 	// Drain the pretty-printer.
-	plrec_writer->pprocess_func(plrec_writer->pvstate, output_stream, NULL, pctx);
+	drive_writer(NULL, pctx, plrec_writer, output_stream, pprofile);
+
+	if (pprofile != NULL) {
+		fflush(output_stream);
+		stream_profile_note_output_end(pprofile, output_stream);
+	}
 
 	plrec_reader->pfree_func(plrec_reader);
 	plrec_writer->pfree_func(plrec_writer, pctx);
@@ -160,11 +466,49 @@ static int do_stream_chained_to_stdout(context_t* pctx, sllv_t* pmapper_list, cl
 	return ok;
 }
 
+// ----------------------------------------------------------------
+// For --two-pass: the first verb reads all the input files once on its own, then they're read
+// again as usual with that verb and the rest of the chain. This is set up in mlrcli.c only when
+// the input files are regular files and the first verb is in two-pass mode.
+
+static int do_first_pass(context_t* pctx, lrec_reader_t* plrec_reader, sllv_t* pmapper_list,
+	lrec_writer_t* plrec_writer, FILE* output_stream, cli_opts_t* popts, stream_profile_t* pprofile)
+{
+	sllv_t* pfirst_mapper_list = sllv_single(pmapper_list->phead->pvvalue);
+
+	int ok = 1;
+	for (sllse_t* pe = popts->filenames->phead; pe != NULL; pe = pe->pnext) {
+		char* filename = pe->value;
+		pctx->filenum++;
+		pctx->filename = filename;
+		pctx->fnr = 0;
+		ok = do_file_chained(filename, pctx, plrec_reader, pfirst_mapper_list, plrec_writer,
+			output_stream, popts, pprofile) && ok;
+	}
+	// End of the first pass. Mappers produce no output on the first pass.
+	drive_lrec(NULL, pctx, pfirst_mapper_list->phead, plrec_writer, output_stream, pprofile);
+	sllv_free(pfirst_mapper_list);
+
+	pctx->nr        = 0;
+	pctx->fnr       = 0;
+	pctx->filenum   = 0;
+	pctx->filename  = NULL;
+	pctx->force_eof = FALSE;
+
+	return ok;
+}
+
 // ----------------------------------------------------------------
 static int do_file_chained(char* filename, context_t* pctx,
 	lrec_reader_t* plrec_reader, sllv_t* pmapper_list, lrec_writer_t* plrec_writer, FILE* output_stream,
-	cli_opts_t* popts)
+	cli_opts_t* popts, stream_profile_t* pprofile)
 {
+	profile_mark_t mark = { .wall_seconds = 0.0, .num_allocs = 0ULL };
+	if (pprofile != NULL) {
+		stream_profile_note_input(pprofile, filename);
+		profile_mark(&mark);
+	}
+
 	void* pvhandle = plrec_reader->popen_func(plrec_reader->pvstate, popts->reader_opts.prepipe, filename);
 	progress_indicator_t* pindicator = popts->nr_progress_mod == 0LL
 		? null_progress_indicator
@@ -175,6 +519,8 @@ static int do_file_chained(char* filename, context_t* pctx,
 
 	while (1) {
 		lrec_t* pinrec = plrec_reader->pprocess_func(plrec_reader->pvstate, pvhandle, pctx);
+		if (pprofile != NULL)
+			stage_profile_add(&pprofile->reader, &mark);
 		if (pinrec == NULL)
 			break;
 		if (pctx->force_eof == TRUE) { // e.g. mlr head
@@ -183,40 +529,81 @@ static int do_file_chained(char* filename, context_t* pctx,
 		}
 		pctx->nr++;
 		pctx->fnr++;
+		if (pprofile != NULL)
+			pprofile->reader.records_out++;
 
 		pindicator(pctx, popts->nr_progress_mod);
 
-		drive_lrec(pinrec, pctx, pmapper_list->phead, plrec_writer, output_stream);
+		drive_lrec(pinrec, pctx, pmapper_list->phead, plrec_writer, output_stream, pprofile);
+		if (pprofile != NULL)
+			profile_mark(&mark);
 	}
 
 	plrec_reader->pclose_func(plrec_reader->pvstate, pvhandle, popts->reader_opts.prepipe);
+	if (pprofile != NULL)
+		stage_profile_add(&pprofile->reader, &mark);
 	return 1;
 }
 
 // ----------------------------------------------------------------
 static void drive_lrec(lrec_t* pinrec, context_t* pctx, sllve_t* pmapper_list_head, lrec_writer_t* plrec_writer,
-	FILE* output_stream)
+	FILE* output_stream, stream_profile_t* pprofile)
 {
-	sllv_t* outrecs = chain_map(pinrec, pctx, pmapper_list_head);
+	sllv_t* outrecs = chain_map(pinrec, pctx, pmapper_list_head,
+		pprofile == NULL ? NULL : pprofile->mapper_stages);
 	if (outrecs != NULL) {
 		for (sllve_t* pe = outrecs->phead; pe != NULL; pe = pe->pnext) {
 			lrec_t* poutrec = pe->pvvalue;
 			if (poutrec != NULL) // writer frees records (sllv void-star payload)
-				plrec_writer->pprocess_func(plrec_writer->pvstate, output_stream, poutrec, pctx);
+				drive_writer(poutrec, pctx, plrec_writer, output_stream, pprofile);
 		}
 		sllv_free(outrecs); // we free the list
 	}
+	// A mapper which has already printed an error message and has output the records before it.
+	if (pctx->exit_after_output)
+		exit(1);
+}
+
+// A null record drains the writer, e.g. the pretty-printer.
+static void drive_writer(lrec_t* poutrec, context_t* pctx, lrec_writer_t* plrec_writer, FILE* output_stream,
+	stream_profile_t* pprofile)
+{
+	if (pprofile == NULL) {
+		plrec_writer->pprocess_func(plrec_writer->pvstate, output_stream, poutrec, pctx);
+	} else {
+		profile_mark_t mark;
+		profile_mark(&mark);
+		plrec_writer->pprocess_func(plrec_writer->pvstate, output_stream, poutrec, pctx);
+		stage_profile_add(&pprofile->writer, &mark);
+		if (poutrec != NULL)
+			pprofile->writer.records_in++;
+	}
 }
 
 // ----------------------------------------------------------------
 // Map a single input record (maybe null at end of input stream) to zero or
 // more output records.
 //
-// Return: list of lrec_t*. Input: lrec_t* and list of mapper_t*.
+// Return: list of lrec_t*. Input: lrec_t* and list of mapper_t*, and for --profile the
+// mapper's stage profile (followed by those of the rest of the chain), else null.
 
-static sllv_t* chain_map(lrec_t* pinrec, context_t* pctx, sllve_t* pmapper_list_head) {
+static sllv_t* chain_map(lrec_t* pinrec, context_t* pctx, sllve_t* pmapper_list_head, stage_profile_t* pstage) {
 	mapper_t* pmapper = pmapper_list_head->pvvalue;
-	sllv_t* outrecs = pmapper->pprocess_func(pinrec, pctx, pmapper->pvstate);
+	sllv_t* outrecs = NULL;
+	if (pstage == NULL) {
+		outrecs = pmapper->pprocess_func(pinrec, pctx, pmapper->pvstate);
+	} else {
+		profile_mark_t mark;
+		profile_mark(&mark);
+		outrecs = pmapper->pprocess_func(pinrec, pctx, pmapper->pvstate);
+		stage_profile_add(pstage, &mark);
+		if (pinrec != NULL)
+			pstage->records_in++;
+		if (outrecs != NULL)
+			for (sllve_t* pe = outrecs->phead; pe != NULL; pe = pe->pnext)
+				if (pe->pvvalue != NULL)
+					pstage->records_out++;
+	}
 	if (pmapper_list_head->pnext == NULL) {
 		return outrecs;
 	} else if (outrecs == NULL) { // end of input stream
@@ -226,7 +613,8 @@ static sllv_t* chain_map(lrec_t* pinrec, context_t* pctx, sllve_t* pmapper_list_
 
 		for (sllve_t* pe = outrecs->phead; pe != NULL; pe = pe->pnext) {
 			lrec_t* poutrec = pe->pvvalue;
-			sllv_t* nextrecsi = chain_map(poutrec, pctx, pmapper_list_head->pnext);
+			sllv_t* nextrecsi = chain_map(poutrec, pctx, pmapper_list_head->pnext,
+				pstage == NULL ? NULL : pstage + 1);
 			sllv_transfer(nextrecs, nextrecsi);
 			sllv_free(nextrecsi);
 		}
@@ -246,3 +634,115 @@ static void stderr_progress_indicator(context_t* pctx, long long nr_progress_mod
 
 static void null_progress_indicator(context_t* pctx, long long nr_progress_mod) {
 }
+
+// ================================================================
+static stream_profile_t* stream_profile_alloc(int num_mapper_stages) {
+	stream_profile_t* pprofile = mlr_malloc_or_die(sizeof(stream_profile_t));
+	memset(pprofile, 0, sizeof(stream_profile_t));
+	pprofile->mapper_stages = mlr_malloc_or_die(num_mapper_stages * sizeof(stage_profile_t));
+	memset(pprofile->mapper_stages, 0, num_mapper_stages * sizeof(stage_profile_t));
+	pprofile->num_mapper_stages = num_mapper_stages;
+	pprofile->output_start_offset = -1;
+
+	mlr_alloc_counting = TRUE;
+	profile_mark(&pprofile->start);
+	return pprofile;
+}
+
+static void stream_profile_free(stream_profile_t* pprofile) {
+	free(pprofile->mapper_stages);
+	free(pprofile);
+}
+
+// ----------------------------------------------------------------
+// Bytes read are the sizes of the input files, or of standard input if it's redirected from a
+// file: this doesn't account for early exit as with head. Otherwise they're unknown.
+static void stream_profile_note_input(stream_profile_t* pprofile, char* filename) {
+	long long num_bytes = -1LL;
+	struct stat statbuf;
+	if (streq(filename, "-")) {
+		if (fstat(fileno(stdin), &statbuf) == 0 && S_ISREG(statbuf.st_mode))
+			num_bytes = statbuf.st_size;
+	} else {
+		if (stat(filename, &statbuf) == 0 && S_ISREG(statbuf.st_mode))
+			num_bytes = statbuf.st_size;
+	}
+
+	if (num_bytes < 0LL || pprofile->reader.num_bytes < 0LL)
+		pprofile->reader.num_bytes = -1LL;
+	else
+		pprofile->reader.num_bytes += num_bytes;
+}
+
+// Bytes written are known only when the output is a regular file, where the file offset tells.
+static void stream_profile_note_output_start(stream_profile_t* pprofile, FILE* output_stream) {
+	struct stat statbuf;
+	if (fstat(fileno(output_stream), &statbuf) == 0 && S_ISREG(statbuf.st_mode))
+		pprofile->output_start_offset = ftello(output_stream);
+	else
+		pprofile->output_start_offset = -1;
+}
+
+static void stream_profile_note_output_end(stream_profile_t* pprofile, FILE* output_stream) {
+	off_t offset = (pprofile->output_start_offset < 0) ? -1 : ftello(output_stream);
+	if (offset < 0 || pprofile->writer.num_bytes < 0LL)
+		pprofile->writer.num_bytes = -1LL;
+	else
+		pprofile->writer.num_bytes += offset - pprofile->output_start_offset;
+}
+
+// ----------------------------------------------------------------
+// One DKVP record per stage, then one for the whole process. Unknown byte counts are empty. The
+// user and system CPU seconds and peak RSS are for the process's whole lifetime.
+static void stream_profile_print(stream_profile_t* pprofile, slls_t* pmapper_verbs, context_t* pctx, FILE* o) {
+	profile_mark_t end;
+	profile_mark(&end);
+	mlr_alloc_counting = FALSE;
+
+	stage_profile_t* pstage = &pprofile->reader;
+	fprintf(o, "stage=reader,wall_seconds=%.6lf,allocs=%llu,records_out=%lld,bytes_in=",
+		pstage->wall_seconds, pstage->num_allocs, pstage->records_out);
+	if (pstage->num_bytes >= 0LL)
+		fprintf(o, "%lld", pstage->num_bytes);
+	fprintf(o, "\n");
+
+	sllse_t* pe = pmapper_verbs->phead;
+	for (int i = 0; i < pprofile->num_mapper_stages; i++, pe = pe->pnext) {
+		pstage = &pprofile->mapper_stages[i];
+		fprintf(o, "stage=%d,verb=%s,wall_seconds=%.6lf,allocs=%llu,records_in=%lld,records_out=%lld\n",
+			i+1, pe->value, pstage->wall_seconds, pstage->num_allocs, pstage->records_in, pstage->records_out);
+	}
+
+	pstage = &pprofile->writer;
+	fprintf(o, "stage=writer,wall_seconds=%.6lf,allocs=%llu,records_in=%lld,bytes_out=",
+		pstage->wall_seconds, pstage->num_allocs, pstage->records_in);
+	if (pstage->num_bytes >= 0LL)
+		fprintf(o, "%lld", pstage->num_bytes);
+	fprintf(o, "\n");
+
+	fprintf(o, "stage=total,wall_seconds=%.6lf,allocs=%llu,nr=%lld",
+		end.wall_seconds - pprofile->start.wall_seconds, end.num_allocs - pprofile->start.num_allocs, pctx->nr);
+	double user_seconds = 0.0, system_seconds = 0.0;
+	long long peak_rss_kb = 0LL;
+	if (mlr_arch_get_rusage(&user_seconds, &system_seconds, &peak_rss_kb))
+		fprintf(o, ",user_seconds=%.6lf,system_seconds=%.6lf,peak_rss_kb=%lld",
+			user_seconds, system_seconds, peak_rss_kb);
+	fprintf(o, "\n");
+}
+
+// ----------------------------------------------------------------
+static void profile_mark(profile_mark_t* pmark) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	pmark->wall_seconds = (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+	pmark->num_allocs = mlr_alloc_count;
+}
+
+// Adds the time and allocations since the start mark, and moves the start mark up to now.
+static void stage_profile_add(stage_profile_t* pstage, profile_mark_t* pstart) {
+	profile_mark_t now;
+	profile_mark(&now);
+	pstage->wall_seconds += now.wall_seconds - pstart->wall_seconds;
+	pstage->num_allocs   += now.num_allocs   - pstart->num_allocs;
+	*pstart = now;
+}
@@ -401,6 +401,73 @@ static char* test_lrec_put_after() {
 	return NULL;
 }
 
+// ----------------------------------------------------------------
+static char* test_lrec_typed_values() {
+	lrec_t* prec = lrec_unbacked_alloc();
+	lrec_put(prec, "i", "17", NO_FREE);
+	lrec_put(prec, "o", "010", NO_FREE);
+	lrec_put(prec, "f", "2.5", NO_FREE);
+	lrec_put(prec, "s", "abc", NO_FREE);
+	lrec_put(prec, "e", "", NO_FREE);
+	lrec_put_int(prec, "n", mlr_alloc_string_from_ll(-3), FREE_ENTRY_VALUE, -3LL);
+
+	lrece_t* pi = NULL; (void)lrec_get_ext(prec, "i", &pi);
+	lrece_t* po = NULL; (void)lrec_get_ext(prec, "o", &po);
+	lrece_t* pf = NULL; (void)lrec_get_ext(prec, "f", &pf);
+	lrece_t* ps = NULL; (void)lrec_get_ext(prec, "s", &ps);
+	lrece_t* pe = NULL; (void)lrec_get_ext(prec, "e", &pe);
+	lrece_t* pn = NULL; (void)lrec_get_ext(prec, "n", &pn);
+
+	mu_assert_lf(pi->value_type == LREC_VALUE_UNINFERRED);
+	mu_assert_lf(pn->value_type == LREC_VALUE_INT);
+
+	lrec_typed_value_t typed_value;
+	mu_assert_lf(lrec_get_typed_value(prec, pi, &typed_value) == LREC_VALUE_INT);
+	mu_assert_lf(typed_value.intv == 17LL);
+	mu_assert_lf(pi->value_type == LREC_VALUE_INT);
+	mu_assert_lf(lrec_get_typed_value(prec, pn, &typed_value) == LREC_VALUE_INT);
+	mu_assert_lf(typed_value.intv == -3LL);
+	mu_assert_lf(lrec_get_typed_value(prec, pf, &typed_value) == LREC_VALUE_FLOAT);
+	mu_assert_lf(typed_value.fltv == 2.5);
+	mu_assert_lf(lrec_get_typed_value(prec, ps, &typed_value) == LREC_VALUE_NON_NUMERIC);
+	mu_assert_lf(lrec_get_typed_value(prec, pe, &typed_value) == LREC_VALUE_NON_NUMERIC);
+
+	// Ints are inferred as by mlr_try_int_from_string, and floats as by mlr_try_float_from_string.
+	double fltv;
+	mu_assert_lf(lrec_get_typed_value(prec, po, &typed_value) == LREC_VALUE_INT);
+	mu_assert_lf(typed_value.intv == 8LL);
+	mu_assert_lf(lrec_entry_try_float(prec, po, &fltv));
+	mu_assert_lf(fltv == 10.0);
+	mu_assert_lf(lrec_entry_try_float(prec, pi, &fltv));
+	mu_assert_lf(fltv == 17.0);
+	mu_assert_lf(!lrec_entry_try_float(prec, ps, &fltv));
+	mu_assert_lf(lrec_entry_double_or_die(prec, pf) == 2.5);
+
+	// More slots than are inline.
+	mu_assert_lf(prec->num_typed_values == 4);
+	mu_assert_lf(prec->typed_values_capacity > LREC_INLINE_TYPED_VALUES);
+
+	// Assignment resets the cache.
+	lrec_put(prec, "i", "abc", NO_FREE);
+	mu_assert_lf(pi->value_type == LREC_VALUE_UNINFERRED);
+	mu_assert_lf(lrec_get_typed_value(prec, pi, &typed_value) == LREC_VALUE_NON_NUMERIC);
+	lrec_put(prec, "i", "4.5", NO_FREE);
+	mu_assert_lf(lrec_get_typed_value(prec, pi, &typed_value) == LREC_VALUE_FLOAT);
+	mu_assert_lf(typed_value.fltv == 4.5);
+	mu_assert_lf(prec->num_typed_values == 4);
+
+	// Copies carry the cache.
+	lrec_t* pcopy = lrec_copy(prec);
+	lrece_t* pcf = NULL; (void)lrec_get_ext(pcopy, "f", &pcf);
+	mu_assert_lf(pcf->value_type == LREC_VALUE_FLOAT);
+	mu_assert_lf(lrec_get_typed_value(pcopy, pcf, &typed_value) == LREC_VALUE_FLOAT);
+	mu_assert_lf(typed_value.fltv == 2.5);
+	lrec_free(pcopy);
+
+	lrec_free(prec);
+	return NULL;
+}
+
 // ================================================================
 static char * run_all_tests() {
 	mu_run_test(test_lrec_unbacked_api);
@@ -410,6 +477,7 @@ static char * run_all_tests() {
 	mu_run_test(test_lrec_csv_api_disjoint_allocs);
 	mu_run_test(test_lrec_xtab_api);
 	mu_run_test(test_lrec_put_after);
+	mu_run_test(test_lrec_typed_values);
 	return 0;
 }
 
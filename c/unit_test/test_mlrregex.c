@@ -17,7 +17,7 @@ static char * test_save_regex_captures() {
 	const size_t nmatchmax = 10;
 	regmatch_t matches[nmatchmax];
 	string_array_t* pregex_captures = NULL;
-	regex_t regex;
+	mlr_regex_t regex;
 
 	char* input  = "abcde";
 	char* sregex = "abcde";
@@ -28,7 +28,7 @@ static char * test_save_regex_captures() {
 	mu_assert_lf(pregex_captures->length == 1);
 	mu_assert_lf(pregex_captures->strings[0] != NULL);
 	mu_assert_lf(streq(pregex_captures->strings[0], "abcde"));
-	regfree(&regex);
+	mlr_regfree(&regex);
 
 	input  = "abcde";
 	sregex = "a(.*)e";
@@ -38,7 +38,7 @@ static char * test_save_regex_captures() {
 	mu_assert_lf(pregex_captures->length == 2);
 	mu_assert_lf(pregex_captures->strings[0] != NULL);
 	mu_assert_lf(streq(pregex_captures->strings[1], "bcd"));
-	regfree(&regex);
+	mlr_regfree(&regex);
 
 	input  = "abcde";
 	sregex = "a(b)(.)(d)e";
@@ -50,7 +50,7 @@ static char * test_save_regex_captures() {
 	mu_assert_lf(streq(pregex_captures->strings[1], "b"));
 	mu_assert_lf(streq(pregex_captures->strings[2], "c"));
 	mu_assert_lf(streq(pregex_captures->strings[3], "d"));
-	regfree(&regex);
+	mlr_regfree(&regex);
 
 	input  = "abcdefghij";
 	sregex = "(a)(b)(c)(d)(e)(f)(g)(h)(i)";
@@ -68,7 +68,7 @@ static char * test_save_regex_captures() {
 	mu_assert_lf(streq(pregex_captures->strings[7], "g"));
 	mu_assert_lf(streq(pregex_captures->strings[8], "h"));
 	mu_assert_lf(streq(pregex_captures->strings[9], "i"));
-	regfree(&regex);
+	mlr_regfree(&regex);
 
 	string_array_free(pregex_captures);
 
@@ -133,11 +133,146 @@ static char * test_interpolate_regex_captures() {
 	return 0;
 }
 
+// ----------------------------------------------------------------
+// The fast paths must agree with the system regex library on match/no-match
+// and on the position of the leftmost-longest match.
+static int agrees_with_regexec(char* sregex, int cflags, char* input) {
+	const size_t nmatchmax = 10;
+	regmatch_t fast_matches[nmatchmax];
+	regmatch_t posix_matches[nmatchmax];
+
+	mlr_regex_t regex;
+	regcomp_or_die(&regex, sregex, cflags);
+	int fast_matched = regmatch_or_die(&regex, input, nmatchmax, fast_matches);
+	mlr_regfree(&regex);
+
+	regex_t posix_regex;
+	char* doubly_backslashed = mlr_alloc_double_backslash(sregex);
+	regcomp(&posix_regex, doubly_backslashed, cflags | REG_EXTENDED);
+	free(doubly_backslashed);
+	int posix_matched = regexec(&posix_regex, input, nmatchmax, posix_matches, 0) == 0;
+	regfree(&posix_regex);
+
+	if (fast_matched != posix_matched) {
+		printf("regex \"%s\" input \"%s\": matched %d, expected %d\n", sregex, input, fast_matched, posix_matched);
+		return FALSE;
+	}
+	if (!fast_matched)
+		return TRUE;
+	for (int i = 0; i < nmatchmax; i++) {
+		if (fast_matches[i].rm_so != posix_matches[i].rm_so || fast_matches[i].rm_eo != posix_matches[i].rm_eo) {
+			printf("regex \"%s\" input \"%s\": slot %d is [%d,%d), expected [%d,%d)\n", sregex, input, i,
+				(int)fast_matches[i].rm_so, (int)fast_matches[i].rm_eo,
+				(int)posix_matches[i].rm_so, (int)posix_matches[i].rm_eo);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static char * test_fast_paths() {
+	mlr_regex_t regex;
+
+	regcomp_or_die(&regex, "^/api/v2/", 0);
+	mu_assert_lf(regex.kind == MLR_REGEX_KIND_LITERAL);
+	mu_assert_lf(regex.anchored_at_start && !regex.anchored_at_end);
+	mu_assert_lf(streq(regex.literal, "/api/v2/"));
+	mlr_regfree(&regex);
+
+	regcomp_or_die(&regex, "a\\.b", 0);
+	mu_assert_lf(regex.kind == MLR_REGEX_KIND_LITERAL);
+	mu_assert_lf(streq(regex.literal, "a.b"));
+	mlr_regfree(&regex);
+
+	regcomp_or_die(&regex, "^[0-9]+$", 0);
+	mu_assert_lf(regex.kind == MLR_REGEX_KIND_CLASSES);
+	mlr_regfree(&regex);
+
+	regcomp_or_die(&regex, "a(.*)e", 0);
+	mu_assert_lf(regex.kind == MLR_REGEX_KIND_POSIX);
+	mlr_regfree(&regex);
+
+	regcomp_or_die(&regex, "abc|def", 0);
+	mu_assert_lf(regex.kind == MLR_REGEX_KIND_POSIX);
+	mlr_regfree(&regex);
+
+	regcomp_or_die(&regex, "x{2,3}", 0);
+	mu_assert_lf(regex.kind == MLR_REGEX_KIND_POSIX);
+	mlr_regfree(&regex);
+
+	char* regexes[] = {
+		"abc", "^abc", "abc$", "^abc$", "b", "^", "$", "^$", "a\\.c", "a.c", "\\$x", "x]",
+		"a*", "a+", "a?", "^a*$", "ba*", "ba+c", "b.*", ".*c", "^.*$", "a.?c", "x*y*z*",
+		"[0-9]+", "^[0-9]+$", "[^a-c]+", "[]x]", "[a-]+", "[[:digit:][:upper:]]+", "[[:alpha:]]*c",
+		"^[a-z]+[0-9]*$", "[ab]*b", "a[bc]?c",
+		"\\\\", "a\\.", "[.]",
+		NULL
+	};
+	char* inputs[] = {
+		"", "a", "abc", "xabcx", "aaabbbccc", "ABC", "aBc", "abcabc", "a.c", "a\\.c", "$x", "x]y",
+		"12345", "abc123", "123abc", "Zz9", "bac", "bbbb", "]]x", "a-a-b", "\\", "a\\b", "a.",
+		NULL
+	};
+	for (char** pr = regexes; *pr != NULL; pr++) {
+		for (char** pi = inputs; *pi != NULL; pi++) {
+			mu_assert_lf(agrees_with_regexec(*pr, 0, *pi));
+			mu_assert_lf(agrees_with_regexec(*pr, REG_ICASE, *pi));
+		}
+	}
+
+	return 0;
+}
+
+// ----------------------------------------------------------------
+static char * test_regex_cache() {
+	regex_cache_t* pcache = regex_cache_alloc();
+
+	mlr_regex_t* pa = regex_cache_get(pcache, "^a", 0);
+	mu_assert_lf(pcache->num_entries == 1);
+	mu_assert_lf(regex_cache_get(pcache, "^a", 0) == pa);
+	mu_assert_lf(pcache->num_entries == 1);
+
+	// Keyed by cflags as well as by regex string.
+	mlr_regex_t* pai = regex_cache_get(pcache, "^a", REG_ICASE);
+	mu_assert_lf(pai != pa);
+	mu_assert_lf(pcache->num_entries == 2);
+	mu_assert_lf(streq(pcache->pentries[0]->regex_string, "^a"));
+	mu_assert_lf(pcache->pentries[0]->cflags == REG_ICASE);
+
+	// Most recently used first.
+	mu_assert_lf(regex_cache_get(pcache, "^a", 0) == pa);
+	mu_assert_lf(pcache->pentries[0]->cflags == 0);
+
+	regmatch_t matches[1];
+	mu_assert_lf(regmatch_or_die(pa, "abc", 1, matches));
+	mu_assert_lf(!regmatch_or_die(pa, "ABC", 1, matches));
+	mu_assert_lf(regmatch_or_die(pai, "ABC", 1, matches));
+
+	// Least recently used is evicted.
+	char buffer[32];
+	for (int i = 0; i < REGEX_CACHE_CAPACITY; i++) {
+		sprintf(buffer, "x%d", i);
+		regex_cache_get(pcache, buffer, 0);
+	}
+	mu_assert_lf(pcache->num_entries == REGEX_CACHE_CAPACITY);
+	mu_assert_lf(streq(pcache->pentries[0]->regex_string, "x15"));
+	for (int i = 0; i < pcache->num_entries; i++)
+		mu_assert_lf(!streq(pcache->pentries[i]->regex_string, "^a"));
+	mu_assert_lf(regmatch_or_die(regex_cache_get(pcache, "^a", 0), "abc", 1, matches));
+	mu_assert_lf(streq(pcache->pentries[0]->regex_string, "^a"));
+	mu_assert_lf(streq(pcache->pentries[REGEX_CACHE_CAPACITY-1]->regex_string, "x1"));
+
+	regex_cache_free(pcache);
+	return 0;
+}
+
 
 // ================================================================
 static char * all_tests() {
 	mu_run_test(test_save_regex_captures);
 	mu_run_test(test_interpolate_regex_captures);
+	mu_run_test(test_fast_paths);
+	mu_run_test(test_regex_cache);
 	return 0;
 }
 
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 #include "lib/minunit.h"
 #include "lib/mlr_globals.h"
 #include "lib/mlrutil.h"
@@ -18,6 +19,7 @@
 #include "containers/percentile_keeper.h"
 #include "containers/top_keeper.h"
 #include "containers/dheap.h"
+#include "lib/hyperloglog.h"
 #include "lib/mvfuncs.h"
 
 int tests_run         = 0;
@@ -791,6 +793,60 @@ static char* test_top_keeper() {
 	return NULL;
 }
 
+// ----------------------------------------------------------------
+// Capacities above TOP_KEEPER_MAX_SORTED_CAPACITY use the tree, which should
+// retain the same records in the same order, ties included, as the sorted array
+// does. The reference here is that array, maintained by shifting.
+static int top_keeper_tree_matches_array(int capacity, int num_values, int modulus) {
+	top_keeper_t* ptop_keeper = top_keeper_alloc(capacity);
+	mv_t* ref_values = mlr_malloc_or_die(capacity * sizeof(mv_t));
+	int*  ref_is     = mlr_malloc_or_die(capacity * sizeof(int));
+	int   ref_size   = 0;
+
+	for (int i = 0; i < num_values; i++) {
+		mv_t value = mv_from_int((i * 7919LL) % modulus);
+		lrec_t* prec = lrec_unbacked_alloc();
+		lrec_put(prec, "i", mlr_alloc_string_from_int(i), FREE_ENTRY_VALUE);
+		top_keeper_add(ptop_keeper, value, prec);
+
+		int destidx = mlr_bsearch_mv_n_for_insert(ref_values, ref_size, &value);
+		if (destidx >= capacity)
+			continue;
+		if (ref_size < capacity)
+			ref_size++;
+		memmove(&ref_values[destidx+1], &ref_values[destidx], (ref_size - 1 - destidx) * sizeof(mv_t));
+		memmove(&ref_is[destidx+1], &ref_is[destidx], (ref_size - 1 - destidx) * sizeof(int));
+		ref_values[destidx] = value;
+		ref_is[destidx] = i;
+	}
+
+	top_keeper_sort(ptop_keeper);
+	int ok = ptop_keeper->size == ref_size;
+	for (int j = 0; ok && j < ref_size; j++) {
+		ok = ptop_keeper->top_values[j].u.intv == ref_values[j].u.intv
+			&& atoi(lrec_get(ptop_keeper->top_precords[j], "i")) == ref_is[j];
+	}
+
+	for (int j = 0; j < ptop_keeper->size; j++)
+		lrec_free(ptop_keeper->top_precords[j]);
+	top_keeper_free(ptop_keeper);
+	free(ref_values);
+	free(ref_is);
+	return ok;
+}
+
+static char* test_top_keeper_tree() {
+	mu_assert_lf(33 > TOP_KEEPER_MAX_SORTED_CAPACITY);
+	mu_assert_lf(top_keeper_tree_matches_array(33, 200, 50));
+	mu_assert_lf(top_keeper_tree_matches_array(35, 200, 50));
+	mu_assert_lf(top_keeper_tree_matches_array(100, 1000, 7));
+	mu_assert_lf(top_keeper_tree_matches_array(100, 1000, 1));
+	mu_assert_lf(top_keeper_tree_matches_array(100, 50, 10));
+	mu_assert_lf(top_keeper_tree_matches_array(1000, 20000, 997));
+	mu_assert_lf(top_keeper_tree_matches_array(1000, 20000, 1000003));
+	return NULL;
+}
+
 // ----------------------------------------------------------------
 static char* test_dheap() {
 
@@ -861,6 +917,81 @@ static char* test_dheap() {
 	return NULL;
 }
 
+// ----------------------------------------------------------------
+static int hll_is_within(long long estimate, long long n, double tolerance) {
+	return fabs((double)(estimate - n)) <= tolerance * n;
+}
+
+static char* test_hyperloglog() {
+	char buf[32];
+
+	// Relative standard error at precision 12 is about 1.6%; 5% is three sigma.
+	hll_t* pa = hll_alloc(HLL_DEFAULT_PRECISION);
+	hll_t* pb = hll_alloc(HLL_DEFAULT_PRECISION);
+	hll_t* pc = hll_alloc(HLL_DEFAULT_PRECISION + 2);
+	mu_assert_lf(hll_estimate(pa) == 0LL);
+	for (int i = 0; i < 100000; i++) {
+		sprintf(buf, "%d", i);
+		hll_add(i < 60000 ? pa : pb, buf);
+		hll_add(pc, buf);
+		// Duplicates don't count.
+		hll_add(pa, "duplicate");
+	}
+	mu_assert_lf(hll_is_within(hll_estimate(pa), 60001, 0.05));
+	mu_assert_lf(hll_is_within(hll_estimate(pb), 40000, 0.05));
+	mu_assert_lf(hll_is_within(hll_estimate(pc), 100000, 0.025));
+
+	// Small cardinalities use linear counting and are nearly exact.
+	hll_t* psmall = hll_alloc(HLL_DEFAULT_PRECISION);
+	for (int i = 0; i < 100; i++) {
+		sprintf(buf, "small%d", i);
+		hll_add(psmall, buf);
+	}
+	mu_assert_lf(hll_is_within(hll_estimate(psmall), 100, 0.02));
+
+	// The merge of disjoint sketches estimates the union.
+	hll_t* pab = hll_merge_alloc(pa, pb);
+	mu_assert_lf(hll_is_within(hll_estimate(pab), 100001, 0.05));
+
+	// Merging at lower precision is the same as having sketched at lower precision.
+	hll_t* pempty = hll_alloc(HLL_DEFAULT_PRECISION);
+	hll_t* pfolded = hll_merge_alloc(pc, pempty);
+	mu_assert_lf(pfolded->precision == HLL_DEFAULT_PRECISION);
+	hll_t* pdirect = hll_alloc(HLL_DEFAULT_PRECISION);
+	for (int i = 0; i < 100000; i++) {
+		sprintf(buf, "%d", i);
+		hll_add(pdirect, buf);
+	}
+	mu_assert_lf(memcmp(pfolded->registers, pdirect->registers, pdirect->num_registers) == 0);
+
+	// Round trip through the string serialization, and update in place.
+	char* s = hll_to_string(pdirect);
+	mu_assert_lf(strlen(s) == 1 << HLL_DEFAULT_PRECISION);
+	mu_assert_lf(hll_string_precision(s) == HLL_DEFAULT_PRECISION);
+	mu_assert_lf(hll_string_estimate(s, HLL_DEFAULT_PRECISION) == hll_estimate(pdirect));
+	hll_string_add(s, HLL_DEFAULT_PRECISION, "another");
+	hll_add(pdirect, "another");
+	hll_t* pround = hll_from_string(s);
+	mu_assert_lf(pround != NULL);
+	mu_assert_lf(memcmp(pround->registers, pdirect->registers, pdirect->num_registers) == 0);
+	mu_assert_lf(hll_from_string("abc") == NULL);
+	mu_assert_lf(hll_string_precision("AAAAAAAA") == -1);
+	mu_assert_lf(hll_from_string("AAAAAAAAAAAAAAA!") == NULL);
+
+	free(s);
+	hll_free(pa);
+	hll_free(pb);
+	hll_free(pc);
+	hll_free(psmall);
+	hll_free(pab);
+	hll_free(pempty);
+	hll_free(pfolded);
+	hll_free(pdirect);
+	hll_free(pround);
+
+	return NULL;
+}
+
 // ================================================================
 static char * run_all_tests() {
 	mu_run_test(test_slls);
@@ -877,7 +1008,9 @@ static char * run_all_tests() {
 	mu_run_test(test_lhmsmv);
 	mu_run_test(test_percentile_keeper);
 	mu_run_test(test_top_keeper);
+	mu_run_test(test_top_keeper_tree);
 	mu_run_test(test_dheap);
+	mu_run_test(test_hyperloglog);
 	return 0;
 }
 
@@ -0,0 +1,211 @@
+// ================================================================
+// Deterministic synthetic-data generator for the benchmark suite in this
+// directory: see ./run.
+//
+// Usage: gen {shape} {format} {nrecords}
+//        gen keys {format}
+//
+// Shapes:
+//   narrow-num  k,g,t,v plus i,x,y
+//   narrow-str  k,g,t,v plus name,city,url
+//   wide-num    k,g,t,v plus n01..n40
+//   wide-str    k,g,t,v plus s01..s40
+// All shapes share k (integer join key in [0,1000)), g (group name), t (three
+// semicolon-separated words, for nest), and v (float in [0,1)), so the same
+// verb chains run on each. The "keys" file has k=0..999 with a label, for join.
+//
+// Formats: dkvp nidx csv tsv json xtab.
+//
+// The pseudo-random sequence is a fixed-seed xorshift64*, rather than rand(),
+// so the output is the same on every platform. Draws are sequenced one per
+// statement, since the order of evaluation of function arguments isn't.
+// ================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+#define NUM_WIDE_FIELDS 40
+#define NUM_KEYS 1000
+
+static char* words[] = {
+	"pan", "eks", "wye", "zee", "hat", "dog", "cat", "owl", "elk", "yak",
+	"red", "tan", "jade", "ruby", "teal", "gold", "sage", "navy", "plum", "rust",
+	"alpha", "bravo", "delta", "gamma", "kappa", "sigma", "omega", "theta", "zeta", "iota",
+	"oak", "ash", "elm", "fir", "yew", "bay", "box", "fig", "lime", "pine",
+};
+static int num_words = sizeof(words) / sizeof(words[0]);
+
+static char* cities[] = {
+	"Lagos", "Osaka", "Quito", "Perth", "Tunis", "Dakar", "Hanoi", "Lyon",
+	"Porto", "Cusco", "Bergen", "Austin", "Denver", "Tbilisi", "Windhoek", "Valletta",
+};
+static int num_cities = sizeof(cities) / sizeof(cities[0]);
+
+// ----------------------------------------------------------------
+static unsigned long long state = 0x9e3779b97f4a7c15ULL;
+
+static unsigned long long next_u64() {
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return state * 0x2545f4914f6cdd1dULL;
+}
+
+static double next_double() {
+	return (double)(next_u64() >> 11) / 9007199254740992.0; // 2^53
+}
+
+static char* next_word() {
+	return words[next_u64() % num_words];
+}
+
+// ----------------------------------------------------------------
+// Each record is built as parallel arrays of keys and values, then written in
+// the requested format.
+
+#define MAX_FIELDS (4 + NUM_WIDE_FIELDS)
+#define VALUE_SIZE 64
+
+typedef struct _record_t {
+	int  num_fields;
+	char keys[MAX_FIELDS][8];
+	char values[MAX_FIELDS][VALUE_SIZE];
+	int  is_numeric[MAX_FIELDS];
+} record_t;
+
+static void put_field(record_t* prec, char* key, int is_numeric, char* fmt, ...) {
+	int i = prec->num_fields++;
+	strncpy(prec->keys[i], key, sizeof(prec->keys[i]) - 1);
+	prec->keys[i][sizeof(prec->keys[i]) - 1] = 0;
+	va_list ap;
+	va_start(ap, fmt);
+	vsnprintf(prec->values[i], VALUE_SIZE, fmt, ap);
+	va_end(ap);
+	prec->is_numeric[i] = is_numeric;
+}
+
+static void fill_record(record_t* prec, char* shape, long long nr) {
+	prec->num_fields = 0;
+	put_field(prec, "k", 1, "%d", (int)(next_u64() % NUM_KEYS));
+	put_field(prec, "g", 0, "%s", words[next_u64() % 5]);
+	char* t1 = next_word();
+	char* t2 = next_word();
+	char* t3 = next_word();
+	put_field(prec, "t", 0, "%s;%s;%s", t1, t2, t3);
+	put_field(prec, "v", 1, "%.6lf", next_double());
+
+	if (strcmp(shape, "narrow-num") == 0) {
+		put_field(prec, "i", 1, "%lld", nr);
+		put_field(prec, "x", 1, "%.6lf", next_double());
+		put_field(prec, "y", 1, "%.6lf", 1000.0 * next_double() - 500.0);
+	} else if (strcmp(shape, "narrow-str") == 0) {
+		char* first = next_word();
+		char* last  = next_word();
+		put_field(prec, "name", 0, "%s-%s", first, last);
+		put_field(prec, "city", 0, "%s", cities[next_u64() % num_cities]);
+		char* resource = next_word();
+		put_field(prec, "url", 0, "/api/v3/%s/%llx", resource, next_u64() & 0xffffffULL);
+	} else if (strcmp(shape, "wide-num") == 0) {
+		for (int j = 1; j <= NUM_WIDE_FIELDS; j++) {
+			char key[8];
+			snprintf(key, sizeof(key), "n%02d", j);
+			if (j % 2)
+				put_field(prec, key, 1, "%d", (int)(next_u64() % 100000));
+			else
+				put_field(prec, key, 1, "%.4lf", 100.0 * next_double());
+		}
+	} else if (strcmp(shape, "wide-str") == 0) {
+		for (int j = 1; j <= NUM_WIDE_FIELDS; j++) {
+			char key[8];
+			snprintf(key, sizeof(key), "s%02d", j);
+			put_field(prec, key, 0, "%s", next_word());
+		}
+	} else {
+		fprintf(stderr, "gen: unknown shape \"%s\".\n", shape);
+		exit(1);
+	}
+}
+
+static void fill_key_record(record_t* prec, int k) {
+	prec->num_fields = 0;
+	put_field(prec, "k", 1, "%d", k);
+	char* first = next_word();
+	char* last  = next_word();
+	put_field(prec, "label", 0, "%s_%s", first, last);
+}
+
+// ----------------------------------------------------------------
+static void write_record(record_t* prec, char* format, int is_first) {
+	int n = prec->num_fields;
+	if (strcmp(format, "dkvp") == 0) {
+		for (int i = 0; i < n; i++)
+			printf("%s%s=%s", i == 0 ? "" : ",", prec->keys[i], prec->values[i]);
+		printf("\n");
+	} else if (strcmp(format, "nidx") == 0) {
+		for (int i = 0; i < n; i++)
+			printf("%s%s", i == 0 ? "" : " ", prec->values[i]);
+		printf("\n");
+	} else if (strcmp(format, "csv") == 0 || strcmp(format, "tsv") == 0) {
+		char* sep = (format[0] == 'c') ? "," : "\t";
+		if (is_first) {
+			for (int i = 0; i < n; i++)
+				printf("%s%s", i == 0 ? "" : sep, prec->keys[i]);
+			printf("\n");
+		}
+		for (int i = 0; i < n; i++)
+			printf("%s%s", i == 0 ? "" : sep, prec->values[i]);
+		printf("\n");
+	} else if (strcmp(format, "json") == 0) {
+		printf("{ ");
+		for (int i = 0; i < n; i++) {
+			if (prec->is_numeric[i])
+				printf("%s\"%s\": %s", i == 0 ? "" : ", ", prec->keys[i], prec->values[i]);
+			else
+				printf("%s\"%s\": \"%s\"", i == 0 ? "" : ", ", prec->keys[i], prec->values[i]);
+		}
+		printf(" }\n");
+	} else if (strcmp(format, "xtab") == 0) {
+		if (!is_first)
+			printf("\n");
+		for (int i = 0; i < n; i++)
+			printf("%s %s\n", prec->keys[i], prec->values[i]);
+	} else {
+		fprintf(stderr, "gen: unknown format \"%s\".\n", format);
+		exit(1);
+	}
+}
+
+// ----------------------------------------------------------------
+static void usage(char* argv0) {
+	fprintf(stderr, "Usage: %s {shape} {format} {nrecords}\n", argv0);
+	fprintf(stderr, "       %s keys {format}\n", argv0);
+	fprintf(stderr, "Shapes: narrow-num narrow-str wide-num wide-str\n");
+	fprintf(stderr, "Formats: dkvp nidx csv tsv json xtab\n");
+	exit(1);
+}
+
+int main(int argc, char** argv) {
+	record_t rec;
+
+	if (argc == 3 && strcmp(argv[1], "keys") == 0) {
+		for (int k = 0; k < NUM_KEYS; k++) {
+			fill_key_record(&rec, k);
+			write_record(&rec, argv[2], k == 0);
+		}
+		return 0;
+	}
+
+	if (argc != 4)
+		usage(argv[0]);
+	long long nrecords = 0LL;
+	if (sscanf(argv[3], "%lld", &nrecords) != 1 || nrecords < 0LL)
+		usage(argv[0]);
+
+	for (long long nr = 1; nr <= nrecords; nr++) {
+		fill_record(&rec, argv[1], nr);
+		write_record(&rec, argv[2], nr == 1);
+	}
+	return 0;
+}